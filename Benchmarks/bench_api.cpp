@@ -0,0 +1,220 @@
+/* Standard suite for the VS API layer: loading a solver DLL, reading a
+   simfile, one time step through vs_integrate_io, and writing output.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). Variants of the simfile are written to TMPDIR; they read
+   the given simfile with INPUT and add stand-in keywords (N_OSC, IPRINT,
+   ERDFILE), which another solver may ignore.
+
+     bm_get_dll_path/n      vs_get_dll_path on a simfile with n lines before
+                            DLLFILE
+     bm_get_api/0           vs_get_api on a loaded DLL (global API)
+     bm_get_api/1           LoadLibrary, vs_get_api and FreeLibrary
+     bm_solver_load         vs_solver::load (per-instance API)
+     bm_read_configuration  vs_read_configuration: parsfiles and init
+     bm_integrate_io/n      one step with n extra states (N_OSC)
+     bm_output/n            one step with an ERD record every n steps
+                            (0: no ERD file)
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#if defined(_WIN32) || defined(_WIN64)
+  #include <windows.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_bench.h"    // benchmark harness
+
+// from vs_get_api.c (vs_api.h defines the global API, so is not included)
+extern "C" int vs_get_dll_path (char *simfile, char *pathDLL);
+extern "C" int vs_get_api (HMODULE dll, char *dll_fname);
+
+static vs_solver solver;
+
+static std::string bench_path (const char *name)
+{
+  const char *tmp = getenv("TMPDIR");
+  return std::string(tmp ? tmp : "/tmp") + "/vs_bench_api_" + name;
+}
+
+// Load the solver of the simfile. Return FALSE and skip if there is none.
+static vs_bool bench_solver (vs_bench_state &state, std::string *dll = NULL)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  if (dll) *dll = solver.path();
+  return TRUE;
+}
+
+// A simfile that reads the benchmark simfile and adds lines.
+static std::string write_simfile (const char *name, const std::string &extra)
+{
+  std::string path = bench_path(name);
+  FILE *fp;
+
+  if ((fp = fopen(path.c_str(), "w")) == NULL) return "";
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 1e9\n%sEND\n", solver.path(),
+           vs_bench_option("simfile", ""), extra.c_str());
+  fclose (fp);
+  return path;
+}
+
+// Steps through vs_integrate_io until the iterations are done. The run is
+// restarted if the model ends early.
+static void run_steps (vs_bench_state &state, const std::string &simfile)
+{
+  const vs_api_table &api = solver.api;
+  std::vector<vs_real> imp, exp;
+  int n_import = 0, n_export = 0;
+  vs_real t, tstop, tstep;
+
+  api.vs_read_configuration (simfile.c_str(), &n_import, &n_export, &t, &tstop, &tstep);
+  if (api.vs_error_occurred())
+    {
+    state.skip (api.vs_get_error_message());
+    api.vs_terminate_run (t);
+    return;
+    }
+  imp.assign (n_import + 1, 0.0);
+  exp.assign (n_export + 1, 0.0);
+  while (state.keep_running())
+    {
+    if (api.vs_integrate_io(t, imp.data(), exp.data()))
+      {
+      state.pause_timing ();
+      api.vs_terminate_run (t);
+      api.vs_read_configuration (simfile.c_str(), &n_import, &n_export, &t, &tstop,
+                                 &tstep);
+      state.resume_timing ();
+      }
+    t += tstep;
+    }
+  vs_bench_keep (exp[0]);
+  api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations());
+  state.counter ("exports", n_export);
+}
+
+
+static void bm_get_dll_path (vs_bench_state &state)
+{
+  std::string dll, path = bench_path("lines.sim");
+  char result[FILENAME_MAX];
+  FILE *fp;
+  int i;
+
+  if (!bench_solver(state, &dll)) return;
+  if ((fp = fopen(path.c_str(), "w")) == NULL) return;
+  fprintf (fp, "SIMFILE\n");
+  for (i = 0; i < state.arg(); i++) fprintf(fp, "PARSFILE Runs/Part_%d.par\n", i);
+  fprintf (fp, "DLLFILE %s\nEND\n", dll.c_str());
+  fclose (fp);
+
+  while (state.keep_running())
+    if (vs_get_dll_path((char *)path.c_str(), result)) break;
+  vs_bench_keep (result[0]);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_get_dll_path)->arg(0)->arg(100)->arg(1000);
+
+static void bm_get_api (vs_bench_state &state)
+{
+  std::string dll;
+  HMODULE handle;
+  int status = 0;
+
+  if (!bench_solver(state, &dll)) return;
+  solver.unload (); // else the DLL stays mapped and is never loaded again
+  if (state.arg() == 0)
+    {
+    handle = LoadLibrary(dll.c_str());
+    while (state.keep_running()) status |= vs_get_api(handle, (char *)dll.c_str());
+    FreeLibrary (handle);
+    }
+  else
+    while (state.keep_running())
+      {
+      handle = LoadLibrary(dll.c_str());
+      status |= vs_get_api(handle, (char *)dll.c_str());
+      FreeLibrary (handle);
+      }
+  if (status) state.skip ("the DLL lacks API functions");
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_get_api)->arg(0)->arg(1);
+
+static void bm_solver_load (vs_bench_state &state)
+{
+  vs_solver other;
+  std::string dll;
+  int status = 0;
+
+  if (!bench_solver(state, &dll)) return;
+  solver.unload ();
+  while (state.keep_running()) status |= other.load(dll.c_str());
+  if (status) state.skip (other.error_message());
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_solver_load);
+
+static void bm_read_configuration (vs_bench_state &state)
+{
+  int n_import, n_export;
+  vs_real t = 0.0, tstop, tstep;
+
+  if (!bench_solver(state)) return;
+  while (state.keep_running())
+    {
+    solver.api.vs_read_configuration (vs_bench_option("simfile", ""), &n_import,
+                                      &n_export, &t, &tstop, &tstep);
+    state.pause_timing ();
+    solver.api.vs_terminate_run (t);
+    state.resume_timing ();
+    }
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_read_configuration);
+
+static void bm_integrate_io (vs_bench_state &state)
+{
+  char extra[64];
+
+  if (!bench_solver(state)) return;
+  sprintf (extra, "N_OSC %lld\n", state.arg());
+  run_steps (state, write_simfile("osc.sim", extra));
+}
+VS_BENCHMARK(bm_integrate_io)->arg(0)->arg(16)->arg(256);
+
+static void bm_output (vs_bench_state &state)
+{
+  char extra[FILENAME_MAX + 64];
+
+  if (!bench_solver(state)) return;
+  if (state.arg() == 0)
+    extra[0] = 0;
+  else
+    sprintf (extra, "ERDFILE %s\nIPRINT %lld\n", bench_path("out.erd").c_str(),
+             state.arg());
+  run_steps (state, write_simfile("out.sim", extra));
+}
+VS_BENCHMARK(bm_output)->arg(0)->arg(1)->arg(10);
+
+VS_BENCH_MAIN()
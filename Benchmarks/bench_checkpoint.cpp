@@ -0,0 +1,239 @@
+/* Memory and restore latency of vs_checkpoint_store, compared with keeping
+   full state arrays.
+
+   The states are synthetic, shaped like a vehicle model saved every 1 ms:
+   half oscillate smoothly, a quarter drift slowly (e.g. distance, yaw), and a
+   quarter stay constant (e.g. extra states of inactive subsystems). 20000
+   snapshots of 200 states are stored. Arguments: keyframe interval K and
+   anchor interval A (0: no anchors, the restore decodes up to K snapshots).
+
+   bm_checkpoint_solver fills a store through a vs_checkpointer installed in
+   a loaded solver (--simfile=<simfile>, the stand-in solver by default when
+   built with CMake): one run of 10 s saved every 10 ms (SAVE_DT, in a
+   simfile written to TMPDIR), then times restores of the model state to
+   random saved times. Counters: snapshots, ratio, and wrong, restores whose
+   model state differs from the one the solver had at that time.
+
+   Log:
+   Oct 18, 26. bm_checkpoint_solver: a store filled by a loaded solver.
+   Oct 18, 26. Anchor interval as second argument.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_checkpoint.h"   // checkpoint store
+#include "vs_bench.h"        // benchmark harness
+
+#define N_STATE  200
+#define N_SNAP   20000
+#define TSAVE    0.001
+
+// Model state at time t.
+static void synthetic_state (vs_real t, vs_real *x)
+{
+  int i;
+
+  for (i = 0; i < N_STATE/2; i++) x[i] = sin(t*(1.0 + 0.37*i) + i)*(1.0 + i);
+  for (; i < 3*N_STATE/4; i++) x[i] = 20.0*t*(1.0 + 0.01*i) + 0.3*sin(t);
+  for (; i < N_STATE; i++) x[i] = 0.125*i;
+}
+
+static vs_checkpoint_store &filled_store (int keyframe_interval, int anchor_interval)
+{
+  static vs_checkpoint_store store;
+  static int filled_k = 0, filled_a = 0;
+  vs_real x[N_STATE];
+  int i;
+
+  if (filled_k != keyframe_interval || filled_a != anchor_interval)
+    {
+    store = vs_checkpoint_store(N_STATE, keyframe_interval, anchor_interval);
+    for (i = 0; i < N_SNAP; i++)
+      {
+      synthetic_state (i*TSAVE, x);
+      store.append (i*TSAVE, x);
+      }
+    filled_k = keyframe_interval;
+    filled_a = anchor_interval;
+    }
+  return store;
+}
+
+// Full arrays: the memory and copy cost without compression.
+static void bm_full_copy_append (vs_bench_state &state)
+{
+  std::vector<vs_real> saved((size_t)N_SNAP*N_STATE);
+  vs_real x[N_STATE];
+  int i = 0;
+
+  synthetic_state (0.0, x);
+  while (state.keep_running())
+    {
+    memcpy (&saved[(size_t)(i++ % N_SNAP)*N_STATE], x, sizeof(x));
+    x[0] += 1e-3;
+    }
+  state.set_bytes_processed (state.iterations()*sizeof(x));
+  state.counter ("MB", N_SNAP*sizeof(x)/1048576.0);
+}
+VS_BENCHMARK(bm_full_copy_append);
+
+static void bm_checkpoint_append (vs_bench_state &state)
+{
+  vs_checkpoint_store store(N_STATE, (int)state.arg(0), (int)state.arg(1));
+  std::vector<vs_real> x((size_t)N_SNAP*N_STATE);
+  int i = 0;
+
+  state.pause_timing ();
+  for (i = 0; i < N_SNAP; i++) synthetic_state(i*TSAVE, &x[(size_t)i*N_STATE]);
+  state.resume_timing ();
+  i = 0;
+  while (state.keep_running())
+    {
+    if (i == N_SNAP)
+      {
+      state.pause_timing ();
+      store.reset (N_STATE);
+      i = 0;
+      state.resume_timing ();
+      }
+    store.append (i*TSAVE, &x[(size_t)i*N_STATE]);
+    i++;
+    }
+  state.set_bytes_processed (state.iterations()*N_STATE*sizeof(vs_real));
+
+  vs_checkpoint_store &full = filled_store((int)state.arg(0), (int)state.arg(1));
+  state.counter ("MB", full.bytes()/1048576.0);
+  state.counter ("ratio", (double)full.raw_bytes()/full.bytes());
+}
+VS_BENCHMARK(bm_checkpoint_append)->args(1, 0)->args(8, 0)->args(32, 0)->args(128, 0)
+                                  ->args(32, 8)->args(128, 8)->args(1024, 8);
+
+static void bm_checkpoint_restore (vs_bench_state &state)
+{
+  vs_checkpoint_store &store = filled_store((int)state.arg(0), (int)state.arg(1));
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> pick(0, N_SNAP - 1);
+  vs_real x[N_STATE], expect[N_STATE], t_saved = 0.0;
+  long long wrong = 0;
+  int i;
+
+  while (state.keep_running())
+    {
+    i = pick(rng);
+    store.restore (i*TSAVE + 0.3*TSAVE, x, &t_saved);
+    vs_bench_keep (x[0]);
+    }
+
+  // restored values must be bit-exact
+  for (i = 0; i < N_SNAP; i += 97)
+    {
+    store.restore (i*TSAVE, x, &t_saved);
+    synthetic_state (i*TSAVE, expect);
+    wrong += memcmp(x, expect, sizeof(x)) != 0;
+    }
+  state.counter ("wrong", (double)wrong);
+}
+VS_BENCHMARK(bm_checkpoint_restore)->args(1, 0)->args(8, 0)->args(32, 0)->args(128, 0)
+                                   ->args(32, 8)->args(128, 8)->args(1024, 8);
+
+// Full copies of the state at each save, to check the restores against.
+class bench_full_saver : public vs_ext_subsystem
+  {
+  public:
+    unsigned calc_mask (void) const {return VS_EXT_MASK(VS_EXT_EQ_SAVE);}
+    void calc (vs_real, vs_ext_loc)
+      {
+      size_t n = api->vs_n_derivatives() + api->vs_n_extra_state_variables();
+      saved.resize (saved.size() + n);
+      api->vs_copy_all_state_vars_to_array (&saved[saved.size() - n]);
+      }
+    std::vector<vs_real> saved;
+  };
+
+static vs_solver solver;
+
+static void bm_checkpoint_solver (vs_bench_state &state)
+{
+  const char *simfile = vs_bench_option("simfile", NULL), *tmp = getenv("TMPDIR");
+  std::string path = std::string(tmp ? tmp : "/tmp") + "/vs_bench_checkpoint.sim";
+  vs_checkpointer checkpoints(32, 8);
+  bench_full_saver full;
+  vs_ext_dispatcher ext;
+  std::vector<vs_real> x;
+  std::mt19937 rng(7);
+  vs_real t, t_saved;
+  long long wrong = 0;
+  int n, i;
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return;
+    }
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("cannot write the simfile");
+    return;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 10\nSAVE_DT 0.01\nEND\n",
+           solver.path(), simfile);
+  fclose (fp);
+  ext.add (&checkpoints);
+  ext.add (&full);
+  if (ext.install(solver.api))
+    {
+    state.skip (ext.error_message());
+    return;
+    }
+
+  t = solver.api.vs_setdef_and_read(path.c_str(), NULL, NULL);
+  solver.api.vs_initialize (t, NULL, NULL);
+  while (!solver.api.vs_integrate(&t, NULL)) {}
+  vs_checkpoint_store &store = checkpoints.store();
+  n = store.n_state();
+  x.assign (n + 1, 0.0);
+  if (store.size() < 2 || full.saved.size() != (size_t)store.size()*n)
+    {
+    state.skip ("the solver made no saves");
+    solver.api.vs_terminate (t, NULL);
+    solver.api.vs_free_all ();
+    ext.uninstall ();
+    return;
+    }
+
+  while (state.keep_running())
+    {
+    i = std::uniform_int_distribution<int>(0, store.size() - 1)(rng);
+    t_saved = checkpoints.restore(store.time(i));
+    state.pause_timing ();
+    solver.api.vs_copy_all_state_vars_to_array (x.data());
+    if (t_saved != store.time(i) || memcmp(x.data(), &full.saved[(size_t)i*n], n*sizeof(vs_real)))
+      wrong++;
+    state.resume_timing ();
+    }
+  solver.api.vs_terminate (t, NULL);
+  solver.api.vs_free_all ();
+  ext.uninstall ();
+  state.counter ("snapshots", store.size());
+  state.counter ("ratio", (double)store.raw_bytes()/store.bytes());
+  state.counter ("wrong", (double)wrong);
+}
+VS_BENCHMARK(bm_checkpoint_solver)->iterations(2000);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,101 @@
+/* Cost of a solver run's output files (ECHO, FINAL, LOGFILE), written by
+   the solver where the simfile names them, against the same run staged by
+   a vs_output_stage and moved into place by a vs_async_writer.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). Each iteration is one run of 0.5 s (vs_run) of a
+   simfile written to --dir=<directory> (default: /tmp; use the storage of
+   interest), with its outputs in that directory.
+
+     bm_run_output/0    not staged: the solver writes to --dir
+     bm_run_output/1    staged, all runs kept (VS_ECHO_ALL)
+     bm_run_output/2    staged, one run in 10 kept (VS_ECHO_SAMPLE)
+   The staged simfile names its outputs relative to its own directory, so
+   the stage has to resolve them. The writer is flushed before the timing
+   ends. Counter: missing, 1 if a kept run's echo file was not in --dir.
+
+   Log:
+   Oct 18, 26. Measure solver runs with and without the stage (was a line
+               writer against vs_run_log).
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <string>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_solver.h"    // per-instance solver API
+#include "vs_echo_sink.h" // buffered run output
+#include "vs_bench.h"     // benchmark harness
+
+static vs_solver solver;
+
+// Write the run simfile, outputs named absolute or relative. Return FALSE
+// and skip if there is no solver.
+static vs_bool bench_simfile (vs_bench_state &state, vs_bool relative,
+                              std::string &path)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  std::string dir = vs_bench_option("dir", "/tmp") + std::string("/");
+  std::string out = relative ? "" : dir;
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  path = dir + (relative ? "vs_bench_stage_rel.sim" : "vs_bench_stage_abs.sim");
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("could not write to --dir");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 0.5\n", solver.path(), simfile);
+  fprintf (fp, "ECHO %svs_bench_echo.par\nFINAL %svs_bench_end.par\n", out.c_str(),
+           out.c_str());
+  fprintf (fp, "LOGFILE %svs_bench_log.txt\nEND\n", out.c_str());
+  fclose (fp);
+  return TRUE;
+}
+
+static void bm_run_output (vs_bench_state &state)
+{
+  std::string simfile, staged, echo;
+  int mode = (int)state.arg();
+  vs_async_writer writer;
+  vs_output_stage stage(&writer, mode == 2 ? VS_ECHO_SAMPLE : VS_ECHO_ALL, 10);
+  long long run = 0;
+  FILE *fp;
+
+  if (!bench_simfile(state, mode != 0, simfile)) return;
+  echo = vs_bench_option("dir", "/tmp") + std::string("/vs_bench_echo.par");
+  remove (echo.c_str());
+  while (state.keep_running())
+    {
+    if (mode == 0)
+      solver.api.vs_run (simfile.c_str());
+    else
+      {
+      stage.prepare (simfile.c_str(), run, staged);
+      solver.api.vs_run (staged.c_str());
+      stage.finish (FALSE);
+      }
+    run++;
+    }
+  writer.flush ();
+  state.set_items_processed (state.iterations());
+  state.counter ("errors", writer.n_errors());
+  fp = fopen(echo.c_str(), "r");
+  state.counter ("missing", fp == NULL);
+  if (fp) fclose(fp);
+}
+VS_BENCHMARK(bm_run_output)->arg(0)->arg(1)->arg(2);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,161 @@
+/* Cost of getting exports each step: all of them (vs_copy_export_vars,
+   vs_integrate_io) against a vs_export_mask with a few channels.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). A simfile written to TMPDIR adds 400 filter outputs
+   (N_OSC, in g) to the 8 default exports, for 408 channels; the masks take
+   channels spread over them.
+
+     bm_exports/k       exports only, no step: k = 0 vs_copy_export_vars of
+                        all 408, else gather() of k channels
+     bm_step_io/k       one step: k = 0 vs_integrate_io, else
+                        vs_export_mask::integrate_io with k channels
+   max_diff: largest difference between gathered and copied channels.
+
+   Log:
+   Oct 18, 26. Skip if the DLL lacks the functions used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"    // VS types and definitions
+#include "vs_solver.h"      // per-instance solver API
+#include "vs_export_mask.h" // selected export channels
+#include "vs_bench.h"       // benchmark harness
+
+#define N_OSC 400
+
+static vs_solver solver;
+
+// Start a run with the 408 exports. Return FALSE and skip if that fails.
+static vs_bool bench_start (vs_bench_state &state, vs_real *t, int *n_import,
+                            int *n_export)
+{
+  const char *simfile = vs_bench_option("simfile", NULL), *tmp = getenv("TMPDIR");
+  std::string path = std::string(tmp ? tmp : "/tmp") + "/vs_bench_exports.sim";
+  static const char *defaults[] = {"XO", "YO", "YAW", "VX", "AY", "STEER_SW",
+                                   "STATION", "LAT"};
+  vs_real tstop, tstep;
+  FILE *fp;
+  int i;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  if (solver.api.vs_get_export_names == NULL || solver.api.vs_copy_export_vars == NULL)
+    {
+    state.skip ("the DLL has no export and import copy functions");
+    return FALSE;
+    }
+  if ((fp = fopen(path.c_str(), "w")) == NULL) return FALSE;
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 1e9\nN_OSC %d\n", solver.path(),
+           simfile, N_OSC);
+  for (i = 0; i < 8; i++) fprintf(fp, "EXPORT %s\n", defaults[i]);
+  for (i = 1; i <= N_OSC; i++) fprintf(fp, "EXPORT OSC_%d\n", i);
+  fprintf (fp, "END\n");
+  fclose (fp);
+
+  solver.api.vs_read_configuration (path.c_str(), n_import, n_export, t, &tstop, &tstep);
+  if (solver.api.vs_error_occurred())
+    {
+    state.skip (solver.api.vs_get_error_message());
+    solver.api.vs_terminate_run (*t);
+    return FALSE;
+    }
+  return TRUE;
+}
+
+// A mask of k channels spread over the exports, and the export index of each.
+static void bench_mask (vs_export_mask &mask, std::vector<int> &which, int k,
+                        int n_export)
+{
+  std::vector<char *> names(n_export + 1);
+  int i;
+
+  solver.api.vs_get_export_names (names.data());
+  for (i = 0; i < k; i++)
+    {
+    which.push_back ((int)((long long)i*n_export/k));
+    mask.add (names[which.back()]);
+    }
+  mask.resolve (solver.api);
+}
+
+static double bench_diff (vs_export_mask &mask, const std::vector<int> &which, int n_export)
+{
+  std::vector<vs_real> all(n_export + 1), some(mask.size() + 1);
+  double diff = 0.0;
+
+  solver.api.vs_copy_export_vars (all.data());
+  mask.gather (some.data());
+  for (size_t i = 0; i < which.size(); i++)
+    if (fabs(some[i] - all[which[i]]) > diff) diff = fabs(some[i] - all[which[i]]);
+  return diff;
+}
+
+static void bm_exports (vs_bench_state &state)
+{
+  std::vector<vs_real> values;
+  std::vector<int> which;
+  vs_export_mask mask;
+  int n_import, n_export, k = (int)state.arg();
+  vs_real t;
+
+  if (!bench_start(state, &t, &n_import, &n_export)) return;
+  values.assign (n_export + 1, 0.0);
+  if (k)
+    {
+    bench_mask (mask, which, k, n_export);
+    while (state.keep_running()) mask.gather(values.data());
+    state.counter ("max_diff", bench_diff(mask, which, n_export));
+    }
+  else
+    while (state.keep_running()) solver.api.vs_copy_export_vars(values.data());
+  vs_bench_keep (values[0]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations()*(k ? k : n_export));
+}
+VS_BENCHMARK(bm_exports)->arg(0)->arg(5)->arg(10)->arg(50)->arg(408);
+
+static void bm_step_io (vs_bench_state &state)
+{
+  std::vector<vs_real> imports, values;
+  std::vector<int> which;
+  vs_export_mask mask;
+  int n_import, n_export, k = (int)state.arg();
+  vs_real t, tstep;
+
+  if (!bench_start(state, &t, &n_import, &n_export)) return;
+  imports.assign (n_import + 1, 0.0);
+  values.assign (n_export + 1, 0.0);
+  tstep = solver.api.vs_get_tstep();
+  if (k) bench_mask(mask, which, k, n_export);
+  while (state.keep_running())
+    {
+    if (k)
+      mask.integrate_io (t, imports.data(), values.data());
+    else
+      solver.api.vs_integrate_io (t, imports.data(), values.data());
+    t += tstep;
+    }
+  if (k) state.counter("max_diff", bench_diff(mask, which, n_export));
+  vs_bench_keep (values[0]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_step_io)->arg(0)->arg(5)->arg(10)->arg(50);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,272 @@
+/* Evaluation rate of table equations: a tree-walking interpreter compared
+   with a compiled vs_expr, one value at a time and in batches.
+
+   The interpreter parses the text once into a tree, then at each evaluation
+   walks it, looking up names in a map and functions by name, as a simple
+   parsfile interpreter does. Argument: which equation (0 to 2):
+     0  aero force: quadratic in speed with constant coefficients
+     1  tire scaling with a registered symbolic function
+     2  transition with STEP and IF_GT0_THEN
+   The counter "diff" is the largest difference between the interpreter and
+   the compiled results.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_expr.h"     // compiled expressions
+#include "vs_bench.h"    // benchmark harness
+
+#define N_X 4096
+
+static const char *equations[] =
+  {
+  "0.5*1.206*0.32*2.2*x^2 + 120*(1 - exp(-x/5))",
+  "mu_scale(x, 0.9)*(1 + 0.1*sin(2*pi*x/360))*max(0, 1 - abs(x)/100)",
+  "step(x, 0, 0, 10, 1)*x^3/1000 + if_gt0_then(x - 50, 2, 1)"
+  };
+
+static vs_real mu_scale (vs_real x, vs_real mu)
+{
+  return mu*(1.0 - 0.002*fabs(x));
+}
+
+/* ----------------------------------------------------------------------------
+   Tree-walking interpreter.
+---------------------------------------------------------------------------- */
+struct walk_node
+  {
+  char op; // number, v(ariable), f(unction), + - * / ^, n(egate), < >
+  vs_real value;
+  std::string name;
+  std::vector<std::unique_ptr<walk_node> > args;
+  };
+
+typedef std::unique_ptr<walk_node> walk_ptr;
+
+class walker
+  {
+  public:
+    walker (const char *text) : at(text) {root = sum();}
+    vs_real eval (std::map<std::string, vs_real> &vars) {return eval(root.get(), vars);}
+
+  private:
+    const char *at;
+    walk_ptr root;
+
+    walk_ptr make (char op, walk_ptr a, walk_ptr b = walk_ptr())
+      {
+      walk_ptr n(new walk_node);
+      n->op = op;
+      n->args.push_back (std::move(a));
+      if (b) n->args.push_back (std::move(b));
+      return n;
+      }
+    void space (void) {while (isspace((unsigned char)*at)) at++;}
+    walk_ptr primary (void)
+      {
+      walk_ptr n(new walk_node);
+      space ();
+      if (*at == '(')
+        {
+        at++;
+        n = sum();
+        space ();
+        at++;
+        return n;
+        }
+      if (isdigit((unsigned char)*at) || *at == '.')
+        {
+        char *end;
+        n->op = '#';
+        n->value = strtod(at, &end);
+        at = end;
+        return n;
+        }
+      while (isalnum((unsigned char)*at) || *at == '_') n->name += (char)toupper(*at++);
+      space ();
+      n->op = 'v';
+      if (*at != '(') return n;
+      n->op = 'f';
+      at++;
+      for (;;)
+        {
+        n->args.push_back (sum());
+        space ();
+        if (*at++ == ')') break;
+        }
+      return n;
+      }
+    walk_ptr power (void)
+      {
+      walk_ptr a = primary();
+      space ();
+      if (*at != '^') return a;
+      at++;
+      return make('^', std::move(a), unary());
+      }
+    walk_ptr unary (void)
+      {
+      space ();
+      if (*at != '-') return power();
+      at++;
+      return make('n', unary());
+      }
+    walk_ptr product (void)
+      {
+      walk_ptr a = unary();
+      for (space(); *at == '*' || *at == '/'; space())
+        {
+        char op = *at++;
+        a = make(op, std::move(a), unary());
+        }
+      return a;
+      }
+    walk_ptr sum (void)
+      {
+      walk_ptr a = product();
+      for (space(); *at == '+' || *at == '-'; space())
+        {
+        char op = *at++;
+        a = make(op, std::move(a), product());
+        }
+      return a;
+      }
+
+    vs_real eval (walk_node *n, std::map<std::string, vs_real> &vars)
+      {
+      vs_real x[5];
+      size_t i;
+
+      switch (n->op)
+        {
+        case '#': return n->value;
+        case 'v': return n->name == "PI" ? PI : vars[n->name];
+        case 'n': return -eval(n->args[0].get(), vars);
+        }
+      for (i = 0; i < n->args.size(); i++) x[i] = eval(n->args[i].get(), vars);
+      switch (n->op)
+        {
+        case '+': return x[0] + x[1];
+        case '-': return x[0] - x[1];
+        case '*': return x[0]*x[1];
+        case '/': return x[0]/x[1];
+        case '^': return pow(x[0], x[1]);
+        }
+      if (n->name == "EXP") return exp(x[0]);
+      if (n->name == "SIN") return sin(x[0]);
+      if (n->name == "ABS") return fabs(x[0]);
+      if (n->name == "MAX") return x[0] > x[1] ? x[0] : x[1];
+      if (n->name == "MU_SCALE") return mu_scale(x[0], x[1]);
+      if (n->name == "IF_GT0_THEN") return x[0] > 0.0 ? x[1] : x[2];
+      if (n->name == "STEP")
+        {
+        if (x[0] <= x[1]) return x[2];
+        if (x[0] >= x[3]) return x[4];
+        return x[2] + 0.5*(x[4] - x[2])*(1.0 - cos(PI*(x[0] - x[1])/(x[3] - x[1])));
+        }
+      return 0.0;
+      }
+  };
+
+/* ----------------------------------------------------------------------------
+   Benchmarks.
+---------------------------------------------------------------------------- */
+static std::vector<vs_real> bench_x (void)
+{
+  std::vector<vs_real> x(N_X);
+  for (int i = 0; i < N_X; i++) x[i] = -20.0 + 100.0*i/N_X;
+  return x;
+}
+
+static vs_bool bench_compile (vs_bench_state &state, vs_expr &e)
+{
+  e.add_input ("X");
+  e.add_function ("MU_SCALE", (void *)mu_scale, 2);
+  if (e.compile(equations[state.arg(0)]) == 0) return TRUE;
+  state.skip (e.error_message());
+  return FALSE;
+}
+
+// Largest difference between the interpreter and the compiled expression.
+static vs_real bench_diff (vs_bench_state &state, vs_expr &e)
+{
+  walker w(equations[state.arg(0)]);
+  std::map<std::string, vs_real> vars;
+  std::vector<vs_real> x = bench_x();
+  vs_real diff = 0.0, d;
+
+  for (int i = 0; i < N_X; i++)
+    {
+    vars["X"] = x[i];
+    d = fabs(w.eval(vars) - e.eval(&x[i]));
+    if (d > diff) diff = d;
+    }
+  return diff;
+}
+
+static void bm_expr_walk (vs_bench_state &state)
+{
+  walker w(equations[state.arg(0)]);
+  std::map<std::string, vs_real> vars;
+  std::vector<vs_real> x = bench_x();
+  vs_real sum = 0.0;
+
+  while (state.keep_running())
+    {
+    for (int i = 0; i < N_X; i++)
+      {
+      vars["X"] = x[i];
+      sum += w.eval(vars);
+      }
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations()*N_X);
+}
+VS_BENCHMARK(bm_expr_walk)->arg(0)->arg(1)->arg(2);
+
+static void bm_expr_compiled (vs_bench_state &state)
+{
+  vs_expr e;
+  std::vector<vs_real> x = bench_x();
+  vs_real sum = 0.0;
+
+  if (!bench_compile(state, e)) return;
+  while (state.keep_running())
+    {
+    for (int i = 0; i < N_X; i++) sum += e.eval(&x[i]);
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations()*N_X);
+  state.counter ("insns", e.n_instructions());
+  state.counter ("diff", bench_diff(state, e));
+}
+VS_BENCHMARK(bm_expr_compiled)->arg(0)->arg(1)->arg(2);
+
+static void bm_expr_batch (vs_bench_state &state)
+{
+  vs_expr e;
+  std::vector<vs_real> x = bench_x(), y(N_X);
+  const vs_real *in = x.data();
+
+  if (!bench_compile(state, e)) return;
+  while (state.keep_running())
+    {
+    e.eval_batch (N_X, &in, y.data());
+    vs_bench_keep (y[N_X - 1]);
+    }
+  state.set_items_processed (state.iterations()*N_X);
+}
+VS_BENCHMARK(bm_expr_batch)->arg(0)->arg(1)->arg(2);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,115 @@
+/* Per-step cost of dispatching external calls through vs_ext_dispatcher,
+   compared with a legacy external_calc() that keeps its data in globals.
+
+   The solver is replaced by the two function pointers it would hold after the
+   install calls, and each step makes the calls a solver makes: VS_EXT_EQ_IN
+   and VS_EXT_EQ_OUT. The argument is the number of subsystems.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_bench.h"        // benchmark harness
+
+#define MAX_SUBS 64
+
+// --- legacy external code: globals and a switch on where -------------------
+static int     n_legacy;
+static vs_real legacy_in[MAX_SUBS], legacy_out[MAX_SUBS];
+
+static void external_calc (vs_real t, vs_ext_loc where)
+{
+  int i;
+  switch (where)
+    {
+    case VS_EXT_EQ_IN:
+      for (i = 0; i < n_legacy; i++) legacy_in[i] += 0.5*t;
+      break;
+    case VS_EXT_EQ_OUT:
+      for (i = 0; i < n_legacy; i++) legacy_out[i] = legacy_in[i]*2.0;
+      break;
+    default:
+      break;
+    }
+}
+
+// --- same work as per-instance subsystems -----------------------------------
+class bench_subsystem : public vs_ext_subsystem
+  {
+  public:
+    bench_subsystem () : in(0.0), out(0.0) {}
+    unsigned calc_mask (void) const
+      {return VS_EXT_MASK(VS_EXT_EQ_IN) | VS_EXT_MASK(VS_EXT_EQ_OUT);}
+    void calc (vs_real t, vs_ext_loc where)
+      {
+      if (where == VS_EXT_EQ_IN) in += 0.5*t;
+      else                       out = in*2.0;
+      }
+    vs_real in, out;
+  };
+
+// --- stand-in for the install functions of a solver -------------------------
+static void (*installed_calc2) (vs_real, vs_ext_loc, void *);
+static void *installed_user;
+
+static void capture_calc2 (void (*calc) (vs_real, vs_ext_loc, void *), void *user)
+{
+  installed_calc2 = calc;
+  installed_user = user;
+}
+static void capture_echo2 (void (*) (vs_ext_loc, void *), void *) {}
+static void capture_setdef2 (void (*) (void *), void *) {}
+static void capture_scan2 (vs_bool (*) (char *, char *, void *), void *) {}
+static void capture_free2 (void (*) (void *), void *) {}
+
+
+static void bm_legacy_global (vs_bench_state &state)
+{
+  void (*volatile calc) (vs_real, vs_ext_loc) = external_calc;
+  vs_real t = 0.0;
+
+  n_legacy = (int)state.arg();
+  while (state.keep_running())
+    {
+    calc (t, VS_EXT_EQ_IN);
+    calc (t, VS_EXT_EQ_OUT);
+    t += 0.001;
+    }
+  vs_bench_keep (legacy_out[0]);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_legacy_global)->arg(1)->arg(4)->arg(16);
+
+static void bm_dispatcher (vs_bench_state &state)
+{
+  vs_api_table api = vs_api_table();
+  vs_ext_dispatcher ext;
+  bench_subsystem subs[MAX_SUBS];
+  vs_real t = 0.0;
+  int i;
+
+  api.vs_install_calc_function2 = capture_calc2;
+  api.vs_install_echo_function2 = capture_echo2;
+  api.vs_install_setdef_function2 = capture_setdef2;
+  api.vs_install_scan_function2 = capture_scan2;
+  api.vs_install_free_function2 = capture_free2;
+  for (i = 0; i < state.arg(); i++) ext.add(&subs[i]);
+  ext.install (api);
+
+  void (*volatile calc) (vs_real, vs_ext_loc, void *) = installed_calc2;
+  void *user = installed_user;
+  while (state.keep_running())
+    {
+    calc (t, VS_EXT_EQ_IN, user);
+    calc (t, VS_EXT_EQ_OUT, user);
+    t += 0.001;
+    }
+  vs_bench_keep (subs[0].out);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_dispatcher)->arg(1)->arg(4)->arg(16);
+
+VS_BENCH_MAIN()
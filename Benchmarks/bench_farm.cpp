@@ -0,0 +1,232 @@
+/* A run farm (vs_farm.h) on one machine: several vs_farm_worker processes
+   and a coordinator on one farm directory, running the stand-in solver.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). The farm directory is vs_bench_farm in --dir=<directory>
+   (default /tmp). Each job is a run of 150 s of simulated time of a simfile
+   in the farm directory (about 0.2 s with the stand-in), longer than the
+   lease timeout of 0.1 s: a lease is kept only by the beats of its worker
+   (every 0.01 s). The workers are forked and work from another directory
+   (/), so the simfile is found through the farm directory, not through the
+   coordinator's working directory. POSIX only (fork).
+
+     bm_farm_sweep/w     w workers run 8 jobs; time: from the first submit
+                         to the last result
+     bm_farm_takeover    3 workers run 9 jobs; the worker w0 is killed
+                         (SIGKILL) while it holds a lease, and its job goes
+                         to another worker when its beats stop
+   Counters, per farm: done, failed, workers (that made runs), releases
+   (leases taken back), and bad, results whose exports differ from those of
+   the first job (all jobs are the same run).
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <set>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+  #include <signal.h>
+  #include <sys/wait.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // simfile_dll_path
+#include "vs_jobs.h"     // vs_job_result
+#include "vs_farm.h"     // shared-directory farm
+#include "vs_bench.h"    // benchmark harness
+
+#define BENCH_TSTOP 150.0
+#define BENCH_LEASE 0.1
+#define BENCH_BEAT  0.01
+
+typedef struct
+  {
+  double done, failed, workers, releases, bad;
+  } bench_totals;
+
+#ifndef _WIN32
+// Open the farm directory and write the run simfile into it. Return FALSE
+// and skip if there is no solver.
+static vs_bool bench_farm_open (vs_bench_state &state, vs_farm_coordinator &farm,
+                                std::string &dir)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  std::string dll, msg;
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (vs_solver::simfile_dll_path(simfile, dll, msg))
+    {
+    state.skip (msg.c_str());
+    return FALSE;
+    }
+  dir = vs_bench_option("dir", "/tmp") + std::string("/vs_bench_farm/");
+  if (farm.open(dir.c_str()))
+    {
+    state.skip (farm.error_message());
+    return FALSE;
+    }
+  if ((fp = fopen((dir + "run.sim").c_str(), "w")) == NULL)
+    {
+    state.skip ("could not write to --dir");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP %g\nEND\n", dll.c_str(), simfile,
+           BENCH_TSTOP);
+  fclose (fp);
+  farm.set_lease_timeout (BENCH_LEASE);
+  farm.set_poll_interval (0.01);
+  return TRUE;
+}
+
+// Fork n workers named w0, w1, ...
+static void bench_workers (const std::string &dir, int n, std::vector<pid_t> &pids)
+{
+  char name[16];
+  int i, made;
+
+  pids.clear ();
+  for (i = 0; i < n; i++)
+    {
+    pid_t pid = fork();
+    if (pid == 0)
+      {
+      if (chdir("/")) _exit (1);
+      sprintf (name, "w%d", i);
+      vs_farm_worker w(dir.c_str(), name);
+      w.set_beat_interval (BENCH_BEAT);
+      w.set_poll_interval (0.01);
+      made = w.run();
+      _exit (made < 0 ? 1 : 0);
+      }
+    pids.push_back (pid);
+    }
+}
+
+// Submit n jobs of the run simfile.
+static void bench_submit (vs_farm_coordinator &farm, const std::string &dir, int n,
+                          std::vector<int> &ids)
+{
+  int i;
+
+  ids.clear ();
+  for (i = 0; i < n; i++) ids.push_back(farm.submit((dir + "run.sim").c_str()));
+}
+
+// Wait for the jobs, stop the workers and add up the results.
+static void bench_finish (vs_farm_coordinator &farm, const std::vector<int> &ids,
+                          std::vector<pid_t> &pids, bench_totals *sum)
+{
+  std::set<std::string> workers;
+  vs_job_result r, first;
+  size_t i, n_done = 0;
+
+  farm.wait_all (60.0);
+  farm.stop_workers ();
+  for (i = 0; i < pids.size(); i++)
+    if (pids[i] > 0) waitpid(pids[i], NULL, 0);
+  for (i = 0; i < ids.size(); i++)
+    {
+    r = farm.result(ids[i]);
+    if (r.status != VS_JOB_DONE)
+      {
+      sum->failed++;
+      continue;
+      }
+    if (n_done++ == 0) first = r;
+    else if (r.exports != first.exports || r.t_end != first.t_end) sum->bad++;
+    workers.insert (farm.worker(ids[i]));
+    }
+  sum->done += n_done;
+  sum->workers += workers.size();
+  sum->releases += farm.releases();
+}
+
+static void bench_counters (vs_bench_state &state, const bench_totals &sum)
+{
+  state.set_items_processed ((long long)sum.done);
+  state.counter ("done", sum.done/state.iterations());
+  state.counter ("failed", sum.failed/state.iterations());
+  state.counter ("workers", sum.workers/state.iterations());
+  state.counter ("releases", sum.releases/state.iterations());
+  state.counter ("bad", sum.bad);
+}
+#endif
+
+static void bm_farm_sweep (vs_bench_state &state)
+{
+#ifdef _WIN32
+  state.skip ("needs fork");
+#else
+  vs_farm_coordinator farm;
+  bench_totals sum = {0.0, 0.0, 0.0, 0.0, 0.0};
+  std::vector<pid_t> pids;
+  std::vector<int> ids;
+  std::string dir;
+
+  while (state.keep_running())
+    {
+    state.pause_timing ();
+    if (!bench_farm_open(state, farm, dir)) return;
+    bench_workers (dir, (int)state.arg(), pids);
+    state.resume_timing ();
+    bench_submit (farm, dir, 8, ids);
+    bench_finish (farm, ids, pids, &sum);
+    }
+  bench_counters (state, sum);
+#endif
+}
+VS_BENCHMARK(bm_farm_sweep)->arg(1)->arg(2)->arg(4)->iterations(2);
+
+static void bm_farm_takeover (vs_bench_state &state)
+{
+#ifdef _WIN32
+  state.skip ("needs fork");
+#else
+  vs_farm_coordinator farm;
+  bench_totals sum = {0.0, 0.0, 0.0, 0.0, 0.0};
+  std::vector<pid_t> pids;
+  std::vector<int> ids;
+  std::string dir;
+  size_t i;
+  vs_bool killed;
+
+  while (state.keep_running())
+    {
+    state.pause_timing ();
+    if (!bench_farm_open(state, farm, dir)) return;
+    bench_workers (dir, 3, pids);
+    state.resume_timing ();
+    bench_submit (farm, dir, 9, ids);
+
+    // kill w0 once the coordinator sees it holding a lease
+    for (killed = FALSE; !killed && farm.n_pending() > 0; )
+      {
+      farm.service ();
+      for (i = 0; i < ids.size() && !killed; i++)
+        if (farm.poll(ids[i]) == VS_JOB_RUNNING && std::string(farm.worker(ids[i])) == "w0")
+          {
+          kill (pids[0], SIGKILL);
+          waitpid (pids[0], NULL, 0);
+          pids[0] = 0;
+          killed = TRUE;
+          }
+      if (!killed) usleep(1000);
+      }
+    bench_finish (farm, ids, pids, &sum);
+    }
+  bench_counters (state, sum);
+#endif
+}
+VS_BENCHMARK(bm_farm_takeover)->iterations(2);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,184 @@
+/* Ticks of a fleet of vehicles: a vs_fleet (structure-of-arrays buffers,
+   one controller loop over the fleet, vehicles stepped on a pool) against
+   vehicles stepped one after another, each with its own small arrays and
+   its own controller call.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). Every vehicle loads a private copy of it and runs a
+   simfile written to TMPDIR with TSTOP 1e9. The controller sets the
+   throttle import from the speed export of each vehicle.
+
+     bm_sequential/m    m vehicles, vs_integrate_io on each in turn
+     bm_fleet/m/w       m vehicles, vs_fleet::step with w workers
+   Items are vehicle steps.
+
+   Log:
+   Oct 18, 26. Skip if the DLL lacks the functions used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_fleet.h"    // lockstep stepping of many vehicles
+#include "vs_bench.h"    // benchmark harness
+
+#define V_TARGET 25.0 // m/s
+#define K_SPEED  0.5
+
+// Write the run simfile. Return FALSE and skip if there is no solver.
+static vs_bool bench_simfile (vs_bench_state &state, std::string &path)
+{
+  const char *simfile = vs_bench_option("simfile", NULL), *tmp = getenv("TMPDIR");
+  std::string dll, error;
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (vs_solver::simfile_dll_path(simfile, dll, error))
+    {
+    state.skip (error.c_str());
+    return FALSE;
+    }
+  path = std::string(tmp ? tmp : "/tmp") + "/vs_bench_fleet.sim";
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("cannot write the simfile");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 1e9\nEND\n", dll.c_str(), simfile);
+  fclose (fp);
+  return TRUE;
+}
+
+// Import or export index by name in one solver, -1 if none.
+static int bench_index (const vs_api_table &api, vs_bool import, const char *name)
+{
+  std::vector<char *> names;
+  int n = import ? api.vs_get_import_names(NULL) : api.vs_get_export_names(NULL);
+
+  names.assign (n + 1, (char *)NULL);
+  if (import) api.vs_get_import_names(names.data());
+  else api.vs_get_export_names(names.data());
+  for (int i = 0; i < n; i++) if (names[i] && !strcmp(names[i], name)) return i;
+  return -1;
+}
+
+// The controller of one vehicle.
+static void bench_control (const vs_real *exports, vs_real *imports, int vx, int thr)
+{
+  imports[thr] = K_SPEED*(V_TARGET - exports[vx]);
+}
+
+struct bench_car
+  {
+  vs_solver solver;
+  std::vector<vs_real> imports, exports;
+  vs_real t;
+  };
+
+static void bm_sequential (vs_bench_state &state)
+{
+  std::vector<std::unique_ptr<bench_car> > cars;
+  std::string simfile;
+  int m = (int)state.arg(), v, n_import, n_export, vx = -1, thr = -1;
+  vs_real tstop, tstep;
+
+  if (!bench_simfile(state, simfile)) return;
+  for (v = 0; v < m; v++)
+    {
+    cars.push_back (std::unique_ptr<bench_car>(new bench_car));
+    bench_car &c = *cars.back();
+    if (c.solver.load_simfile(simfile.c_str(), TRUE))
+      {
+      state.skip (c.solver.error_message());
+      return;
+      }
+    if (c.solver.api.vs_get_import_names == NULL || c.solver.api.vs_copy_export_vars == NULL)
+      {
+      state.skip ("the DLL has no export and import name functions");
+      return;
+      }
+    c.solver.api.vs_read_configuration (simfile.c_str(), &n_import, &n_export, &c.t,
+                                        &tstop, &tstep);
+    c.imports.assign (n_import + 1, 0.0);
+    c.exports.assign (n_export + 1, 0.0);
+    c.solver.api.vs_copy_export_vars (c.exports.data());
+    vx = bench_index(c.solver.api, FALSE, "VX");
+    thr = bench_index(c.solver.api, TRUE, "IMP_THROTTLE");
+    }
+  if (vx < 0 || thr < 0)
+    {
+    state.skip ("no VX export or IMP_THROTTLE import");
+    return;
+    }
+
+  while (state.keep_running())
+    for (v = 0; v < m; v++)
+      {
+      bench_car &c = *cars[v];
+      bench_control (c.exports.data(), c.imports.data(), vx, thr);
+      c.solver.api.vs_integrate_io (c.t, c.imports.data(), c.exports.data());
+      c.t += tstep;
+      }
+  vs_bench_keep (cars[0]->exports[vx]);
+  state.pause_timing ();
+  for (v = 0; v < m; v++) cars[v]->solver.api.vs_terminate_run(cars[v]->t);
+  state.resume_timing ();
+  state.set_items_processed (state.iterations()*m);
+}
+VS_BENCHMARK(bm_sequential)->arg(1)->arg(8)->arg(32)->arg(64);
+
+static void bm_fleet (vs_bench_state &state)
+{
+  vs_fleet fleet((int)state.arg(1));
+  std::vector<std::string> simfiles;
+  std::string simfile;
+  int m = (int)state.arg(), v, vx, thr;
+
+  if (!bench_simfile(state, simfile)) return;
+  simfiles.assign (m, simfile);
+  if (fleet.open(simfiles))
+    {
+    state.skip (fleet.error_message());
+    return;
+    }
+  vx = fleet.export_index("VX");
+  thr = fleet.import_index("IMP_THROTTLE");
+  if (vx < 0 || thr < 0)
+    {
+    state.skip ("no VX export or IMP_THROTTLE import");
+    return;
+    }
+
+  while (state.keep_running())
+    {
+    const vs_real *speed = fleet.exports(vx);
+    vs_real *throttle = fleet.imports(thr);
+    for (v = 0; v < m; v++) throttle[v] = K_SPEED*(V_TARGET - speed[v]);
+    if (fleet.step() < 0)
+      {
+      state.skip (fleet.error_message());
+      break;
+      }
+    }
+  vs_bench_keep (fleet.exports(vx)[0]);
+  state.pause_timing ();
+  fleet.close ();
+  state.resume_timing ();
+  state.set_items_processed (state.iterations()*m);
+}
+VS_BENCHMARK(bm_fleet)->args(1, 1)->args(8, 1)->args(32, 1)->args(64, 1)
+                      ->args(64, 2)->args(64, 4);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,299 @@
+/* Inverse table lookups: x for a given y, by bisection on forward lookups
+   (what a caller does without an inverse), and with a vs_inverse_table.
+
+   The tables are made here, as a solver fills them: a monotonic curve of
+   n points, y = x + 0.5 sin(x). Each iteration solves one value of y from
+   a list of 4096, used in turn: r = 0, values that rise a little each
+   time (as a model variable does from step to step); r = 1, random.
+
+     bm_inverse_bisect/n/r  LINEAR table, bisection on x with the forward
+                            lookup until the interval is 1e-12 wide
+     bm_inverse_index/n/r   LINEAR table, vs_inverse_table::x
+     bm_inverse_batch/n/r   LINEAR table, all 4096 values in one call
+     bm_inverse_spline/m/r  SPLINE table of 256 points; m = 0: bisection,
+                            m = 1: vs_inverse_table
+     bm_inverse_wavy/r      LINEAR table of 4096 points that is not
+                            monotonic (y = sin(x), 9 runs), vs_inverse_table
+     bm_inverse_scaled/g/r  LINEAR table of 4096 points with gain g/2
+                            (g = 5: 2.5; g = -3: -1.5), offset 1, start_x
+                            -3 and scale_x 0.4, vs_inverse_table
+   Counter: max_err, largest |F(x) - y| over the list, F with the gain,
+   offset, start_x and scale_x of the table.
+
+   Log:
+   Oct 18, 26. Added bm_inverse_scaled.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "vs_deftypes.h"      // VS types and definitions
+#include "vs_inverse_table.h" // inverse table lookup
+#include "vs_bench.h"         // benchmark harness
+
+static const int n_values = 4096; // values of y, used in turn
+
+// A 1D table over [0, x_end] with slopes for the spline form.
+class bench_table
+  {
+  public:
+    bench_table (int n, vs_table_type type, vs_bool wavy) : x(n), y(n), dydx(n)
+      {
+      vs_real x_end = wavy ? 32.0*atan(1.0) : 20.0;
+      int i;
+
+      memset (&tab, 0, sizeof(tab));
+      for (i = 0; i < n; i++)
+        {
+        x[i] = x_end*i/(n - 1);
+        y[i] = wavy ? sin(x[i]) : x[i] + 0.5*sin(x[i]);
+        dydx[i] = wavy ? cos(x[i]) : 1.0 + 0.5*cos(x[i]);
+        }
+      tab.type = type;
+      tab.nx = n;
+      tab.x = x.data();
+      tab.y = y.data();
+      tab.dydx = dydx.data();
+      tab.gain = tab.scale_x = 1.0;
+      }
+
+    void scale (vs_real gain, vs_real offset, vs_real start_x, vs_real scale_x)
+      {
+      tab.gain = gain;
+      tab.offset = offset;
+      tab.start_x = start_x;
+      tab.scale_x = scale_x;
+      }
+
+    // Forward lookup (as the solver does it), with a hint.
+    vs_real f (vs_real v, int *hint) const
+      {
+      int n = tab.nx, j = *hint, lo, hi, mid, k;
+      vs_real h, u, fx;
+
+      v = (v - tab.start_x)/tab.scale_x;
+      if (j < 0 || j > n - 2) j = 0;
+      for (k = 0; k < 8; k++)
+        {
+        if (v < x[j] && j > 0) j--;
+        else if (v >= x[j + 1] && j < n - 2) j++;
+        else break;
+        }
+      if (k == 8)
+        {
+        lo = 0;
+        hi = n - 2;
+        while (lo < hi)
+          {
+          mid = (lo + hi + 1)/2;
+          if (x[mid] <= v) lo = mid;
+          else hi = mid - 1;
+          }
+        j = lo;
+        }
+      *hint = j;
+      h = x[j + 1] - x[j];
+      u = (v - x[j])/h;
+      if (tab.type == VS_SPLINE)
+        fx = (1.0 + 2.0*u)*(1.0 - u)*(1.0 - u)*y[j] + u*(1.0 - u)*(1.0 - u)*h*dydx[j] +
+             u*u*(3.0 - 2.0*u)*y[j + 1] - u*u*(1.0 - u)*h*dydx[j + 1];
+      else
+        fx = y[j] + u*(y[j + 1] - y[j]);
+      return tab.offset + tab.gain*fx;
+      }
+
+    // x for y by bisection on the forward lookup (rising tables, no scale).
+    vs_real bisect (vs_real v, int *hint) const
+      {
+      vs_real a = x[0], b = x[tab.nx - 1], m;
+
+      while (b - a > 1e-12)
+        {
+        m = 0.5*(a + b);
+        if (f(m, hint) < v) a = m;
+        else b = m;
+        }
+      return 0.5*(a + b);
+      }
+
+    vs_table tab;
+
+  private:
+    std::vector<vs_real> x, y, dydx;
+  };
+
+// Values of y in [lo, hi]: rising a little, or random.
+static std::vector<vs_real> bench_values (vs_real lo, vs_real hi, vs_bool random)
+{
+  std::vector<vs_real> v(n_values);
+  int i;
+
+  srand (1);
+  for (i = 0; i < n_values; i++)
+    v[i] = random ? lo + (hi - lo)*rand()/RAND_MAX : lo + (hi - lo)*i/(n_values - 1);
+  return v;
+}
+
+// Largest |F(x) - y| of a solved list.
+static vs_real bench_error (const bench_table &t, const std::vector<vs_real> &y,
+                            const std::vector<vs_real> &x)
+{
+  vs_real err = 0.0;
+  int i, hint = 0;
+
+  for (i = 0; i < n_values; i++)
+    if (fabs(t.f(x[i], &hint) - y[i]) > err) err = fabs(t.f(x[i], &hint) - y[i]);
+  return err;
+}
+
+static void bm_inverse_bisect (vs_bench_state &state)
+{
+  bench_table t((int)state.arg(), VS_TAB_LIN, FALSE);
+  std::vector<vs_real> x(n_values), y;
+  int i = 0, hint = 0;
+
+  y = bench_values(t.tab.y[0], t.tab.y[t.tab.nx - 1], state.arg(1) != 0);
+  while (state.keep_running())
+    {
+    x[i] = t.bisect(y[i], &hint);
+    if (++i == n_values) i = 0;
+    }
+  for (i = 0; i < n_values; i++) x[i] = t.bisect(y[i], &hint);
+  state.set_items_processed (state.iterations());
+  state.counter ("max_err", bench_error(t, y, x));
+}
+VS_BENCHMARK(bm_inverse_bisect)->args(64, 0)->args(64, 1)->args(4096, 0)
+                               ->args(4096, 1);
+
+static void bm_inverse_index (vs_bench_state &state)
+{
+  bench_table t((int)state.arg(), VS_TAB_LIN, FALSE);
+  std::vector<vs_real> x(n_values), y;
+  vs_inverse_table inv;
+  int i = 0, hint = 0;
+
+  y = bench_values(t.tab.y[0], t.tab.y[t.tab.nx - 1], state.arg(1) != 0);
+  if (inv.build(&t.tab))
+    {
+    state.skip (inv.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    x[i] = inv.x(y[i], &hint);
+    if (++i == n_values) i = 0;
+    }
+  inv.x (y.data(), x.data(), n_values, &hint);
+  state.set_items_processed (state.iterations());
+  state.counter ("max_err", bench_error(t, y, x));
+}
+VS_BENCHMARK(bm_inverse_index)->args(64, 0)->args(64, 1)->args(4096, 0)
+                              ->args(4096, 1);
+
+static void bm_inverse_batch (vs_bench_state &state)
+{
+  bench_table t((int)state.arg(), VS_TAB_LIN, FALSE);
+  std::vector<vs_real> x(n_values), y;
+  vs_inverse_table inv;
+  int hint = 0;
+
+  y = bench_values(t.tab.y[0], t.tab.y[t.tab.nx - 1], state.arg(1) != 0);
+  if (inv.build(&t.tab))
+    {
+    state.skip (inv.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    inv.x (y.data(), x.data(), n_values, &hint);
+    vs_bench_keep (x[0]);
+    }
+  state.set_items_processed (state.iterations()*n_values);
+  state.counter ("max_err", bench_error(t, y, x));
+}
+VS_BENCHMARK(bm_inverse_batch)->args(64, 0)->args(64, 1)->args(4096, 0)
+                              ->args(4096, 1);
+
+static void bm_inverse_spline (vs_bench_state &state)
+{
+  bench_table t(256, VS_SPLINE, FALSE);
+  std::vector<vs_real> x(n_values), y;
+  vs_inverse_table inv;
+  int i = 0, hint = 0;
+
+  y = bench_values(t.tab.y[0], t.tab.y[t.tab.nx - 1], state.arg(1) != 0);
+  if (inv.build(&t.tab))
+    {
+    state.skip (inv.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    x[i] = state.arg() ? inv.x(y[i], &hint) : t.bisect(y[i], &hint);
+    if (++i == n_values) i = 0;
+    }
+  for (i = 0; i < n_values; i++)
+    x[i] = state.arg() ? inv.x(y[i], &hint) : t.bisect(y[i], &hint);
+  state.set_items_processed (state.iterations());
+  state.counter ("max_err", bench_error(t, y, x));
+}
+VS_BENCHMARK(bm_inverse_spline)->args(0, 0)->args(0, 1)->args(1, 0)->args(1, 1);
+
+static void bm_inverse_wavy (vs_bench_state &state)
+{
+  bench_table t(4096, VS_TAB_LIN, TRUE);
+  std::vector<vs_real> x(n_values), y;
+  vs_inverse_table inv;
+  int i = 0, hint = 0;
+
+  y = bench_values(-0.99, 0.99, state.arg() != 0);
+  if (inv.build(&t.tab))
+    {
+    state.skip (inv.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    x[i] = inv.x(y[i], &hint);
+    if (++i == n_values) i = 0;
+    }
+  inv.x (y.data(), x.data(), n_values, &hint);
+  state.set_items_processed (state.iterations());
+  state.counter ("max_err", bench_error(t, y, x));
+  state.counter ("runs", inv.n_runs());
+}
+VS_BENCHMARK(bm_inverse_wavy)->arg(0)->arg(1);
+
+static void bm_inverse_scaled (vs_bench_state &state)
+{
+  bench_table t(4096, VS_TAB_LIN, FALSE);
+  std::vector<vs_real> x(n_values), y;
+  vs_inverse_table inv;
+  int i = 0, hint = 0;
+  vs_real y0, y1;
+
+  t.scale (0.5*state.arg(), 1.0, -3.0, 0.4);
+  y0 = t.f(-3.0 + 0.4*t.tab.x[0], &hint);
+  y1 = t.f(-3.0 + 0.4*t.tab.x[t.tab.nx - 1], &hint);
+  y = bench_values(y0 < y1 ? y0 : y1, y0 < y1 ? y1 : y0, state.arg(1) != 0);
+  if (inv.build(&t.tab))
+    {
+    state.skip (inv.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    x[i] = inv.x(y[i], &hint);
+    if (++i == n_values) i = 0;
+    }
+  inv.x (y.data(), x.data(), n_values, &hint);
+  state.set_items_processed (state.iterations());
+  state.counter ("max_err", bench_error(t, y, x));
+}
+VS_BENCHMARK(bm_inverse_scaled)->args(5, 0)->args(5, 1)->args(-3, 0)->args(-3, 1);
+
+VS_BENCH_MAIN()
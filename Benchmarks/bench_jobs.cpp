@@ -0,0 +1,101 @@
+/* Runs of a solver on a vs_job_pool with several workers, each with its own
+   private copy of the DLL (vs_solver::load with private_copy).
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). Each iteration makes a new pool of w workers, so all of
+   them copy and load the DLL at the same time, and runs 2w jobs of 1 s of
+   simulated time (a simfile written to --dir=<directory>, default /tmp),
+   each with its own SPEED. The results are compared with the same runs made
+   one after the other with one solver before the timing: if two workers got
+   the same copy, they share the model data and their results differ.
+
+     bm_pool_runs/w    w workers; time: pool start, runs, pool end
+   Counters: bad, results that differ from the serial runs; failed.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_jobs.h"     // job pool
+#include "vs_bench.h"    // benchmark harness
+
+static vs_solver solver;
+
+// Write the run simfile. Return FALSE and skip if there is no solver.
+static vs_bool bench_simfile (vs_bench_state &state, std::string &path)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  path = vs_bench_option("dir", "/tmp") + std::string("/vs_bench_jobs.sim");
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("could not write to --dir");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 1\nEND\n", solver.path(), simfile);
+  fclose (fp);
+  return TRUE;
+}
+
+static vs_job_mods bench_mods (int k)
+{
+  vs_job_mods mods;
+
+  mods.push_back (std::make_pair(std::string("SPEED"), (vs_real)(40 + 10*k)));
+  return mods;
+}
+
+static void bm_pool_runs (vs_bench_state &state)
+{
+  int w = (int)state.arg(), n = 2*w, k;
+  std::vector<vs_job_result> serial(n);
+  std::vector<int> ids(n);
+  std::string simfile;
+  vs_job_result r;
+  long long bad = 0, failed = 0;
+
+  if (!bench_simfile(state, simfile)) return;
+  for (k = 0; k < n; k++)
+    if (vs_job_run(solver, simfile.c_str(), bench_mods(k), NULL, &serial[k]))
+      {
+      state.skip (serial[k].error.c_str());
+      return;
+      }
+
+  while (state.keep_running())
+    {
+    vs_job_pool pool(w);
+    for (k = 0; k < n; k++) ids[k] = pool.submit(simfile.c_str(), bench_mods(k));
+    for (k = 0; k < n; k++)
+      {
+      pool.wait (ids[k]);
+      r = pool.result(ids[k]);
+      if (r.status != VS_JOB_DONE) failed++;
+      else if (r.exports != serial[k].exports || r.t_end != serial[k].t_end) bad++;
+      }
+    }
+  state.set_items_processed (state.iterations()*n);
+  state.counter ("bad", (double)bad);
+  state.counter ("failed", (double)failed);
+}
+VS_BENCHMARK(bm_pool_runs)->arg(1)->arg(4)->arg(8)->iterations(3);
+
+VS_BENCH_MAIN()
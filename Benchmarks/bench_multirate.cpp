@@ -0,0 +1,160 @@
+/* Cost per solver step of a heavy external subsystem (a stand-in for
+   planning code: a fixed amount of arithmetic on two model outputs, giving
+   a steering import) called every step, against the same subsystem at
+   20 Hz through the multi-rate dispatcher.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). Each iteration is one vs_integrate step of a run with
+   the subsystem installed through a vs_ext_dispatcher.
+
+     bm_planner/0       every step (1 kHz with the stand-in)
+     bm_planner/1       20 Hz, output held
+     bm_planner/2       20 Hz, output interpolated
+     bm_planner/3       20 Hz on the helper thread, output interpolated
+   The subsystem is called at VS_EXT_EQ_OUT only; the dispatcher writes its
+   output at VS_EXT_EQ_IN (every step: mode 0 writes it itself).
+   Counters: calc_us, time in calc() per step; skipped, share of the calls
+   that were skipped; wait_us, time per step the solver waited for the
+   helper; changed, share of the steps after which IMP_STEER_SW had a new
+   value (a case where it never changes over two periods is skipped: its
+   output was not written).
+
+   Log:
+   Oct 18, 26. Check that the import is written; mode 0 writes it directly.
+   Oct 18, 26. Skip if the dispatcher cannot be installed.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_bench.h"        // benchmark harness
+
+#define PLANNER_WORK 20000 // multiply-adds per call
+
+class bench_planner : public vs_ext_subsystem
+  {
+  public:
+    bench_planner (vs_ext_rate r, vs_bool interpolate)
+      : r(r), interpolate(interpolate), ay(NULL), vx(NULL), steer(NULL), ay_in(0.0),
+        vx_in(0.0), out(-1) {}
+    unsigned calc_mask (void) const
+      {return VS_EXT_MASK(VS_EXT_EQ_INIT) | VS_EXT_MASK(VS_EXT_EQ_OUT);}
+    vs_ext_rate rate (void) const {return r;}
+    void sample (vs_real, vs_ext_loc)
+      {
+      ay_in = *ay;
+      vx_in = *vx;
+      }
+    void calc (vs_real, vs_ext_loc where)
+      {
+      vs_real acc = 0.0;
+      int i;
+
+      if (where == VS_EXT_EQ_INIT)
+        {
+        ay = api->vs_get_var_ptr((char *)"AY");
+        vx = api->vs_get_var_ptr((char *)"VX");
+        steer = api->vs_get_var_ptr((char *)"IMP_STEER_SW");
+        if (out < 0) out = add_output(steer, interpolate);
+        return;
+        }
+      if (!r.helper) sample(0.0, where);
+      for (i = 0; i < PLANNER_WORK; i++) acc = acc*0.9999 + 1e-6*i;
+      acc = 7.0 - 2.0*ay_in/(1.0 + fabs(vx_in)) + 1e-12*acc;
+      if (r.period > 0.0 || r.helper) set_output(out, acc);
+      else *steer = acc; // no rate: not written by the dispatcher
+      }
+    const vs_real *steer_var (void) const {return steer;}
+
+  private:
+    vs_ext_rate r;
+    vs_bool  interpolate;
+    vs_real *ay, *vx, *steer, ay_in, vx_in;
+    int out;
+  };
+
+static vs_solver solver;
+
+static void bm_planner (vs_bench_state &state)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  vs_ext_rate r = {0.0, 0.0, FALSE};
+  vs_ext_rate_stats st;
+  vs_ext_dispatcher ext;
+  long long steps = 0, changed = 0;
+  const vs_real *steer;
+  vs_real t, last, tstep;
+  int mode = (int)state.arg();
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return;
+    }
+  if (mode) r.period = 0.05;
+  r.helper = mode == 3;
+  bench_planner planner(r, mode >= 2);
+  ext.add (&planner);
+  if (ext.install(solver.api))
+    {
+    state.skip (ext.error_message());
+    return;
+    }
+
+  t = solver.api.vs_setdef_and_read(simfile, NULL, NULL);
+  solver.api.vs_initialize (t, NULL, NULL);
+  if ((steer = planner.steer_var()) == NULL)
+    {
+    state.skip ("the model has no IMP_STEER_SW");
+    solver.api.vs_terminate (t, NULL);
+    solver.api.vs_free_all ();
+    ext.uninstall ();
+    return;
+    }
+  last = *steer;
+  tstep = solver.api.vs_get_tstep();
+  while (state.keep_running())
+    {
+    if (solver.api.vs_integrate(&t, NULL))
+      { // end of the run: start another one
+      state.pause_timing ();
+      solver.api.vs_terminate (t, NULL);
+      t = solver.api.vs_setdef_and_read(simfile, NULL, NULL);
+      solver.api.vs_initialize (t, NULL, NULL);
+      state.resume_timing ();
+      }
+    if (*steer != last) changed++;
+    last = *steer;
+    steps++;
+    }
+  solver.api.vs_terminate (t, NULL);
+  solver.api.vs_free_all ();
+  ext.uninstall ();
+
+  st = ext.rate_stats(&planner);
+  if (changed == 0 && steps*tstep > 2.0*r.period)
+    {
+    state.skip ("IMP_STEER_SW was never written");
+    return;
+    }
+  state.set_items_processed (steps);
+  if (mode)
+    {
+    state.counter ("calc_us", 1e6*st.calc_seconds/steps);
+    state.counter ("skipped", (double)st.skipped/(st.skipped + st.ticks));
+    state.counter ("wait_us", 1e6*st.wait_seconds/steps);
+    }
+  state.counter ("changed", (double)changed/steps);
+}
+VS_BENCHMARK(bm_planner)->arg(0)->arg(1)->arg(2)->arg(3);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,127 @@
+/* Scaling of vs_post with the number of threads, on a generated sweep.
+
+   The dataset is 64 runs of 20 s at 1 ms with 8 float channels, written as
+   ERD files to --dir (default /tmp/vs_bench_post) on the first use. Four
+   metrics are computed on each of 6 channels (RMS, peak, settling time,
+   FFT peak frequency), 1536 tasks. Argument: threads. The counter
+   "freq_err" is the largest error of the FFT frequency of AY, a sine whose
+   frequency is known for each run; "steals" counts tasks taken by idle
+   workers.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+  #include <direct.h>
+#else
+  #include <sys/stat.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_post.h"     // post-processing
+#include "vs_bench.h"    // benchmark harness
+
+#define N_RUNS 64
+#define N_REC  20001
+#define N_CHAN 8
+#define TSTEP  0.001
+
+static const char *names[N_CHAN] =
+  {"T", "AY", "AX", "AVZ", "VX", "STEER_SW", "ROLL", "PITCH"};
+
+static vs_real run_freq (int run)
+{
+  return 0.5 + 1.5*run/N_RUNS;
+}
+
+// Write the dataset once. Return FALSE if it could not be written.
+static vs_bool make_dataset (std::string &dir)
+{
+  static int status = 1; // 1 = not made yet
+  std::vector<vs_real> data((size_t)N_REC*N_CHAN);
+  char path[FILENAME_MAX];
+  vs_real t, f;
+  int r, k;
+
+  dir = vs_bench_option("dir", "/tmp/vs_bench_post");
+  if (status != 1) return status == 0;
+#ifdef _WIN32
+  _mkdir (dir.c_str());
+#else
+  mkdir (dir.c_str(), 0777);
+#endif
+  status = 0;
+  for (r = 0; r < N_RUNS && status == 0; r++)
+    {
+    f = run_freq(r);
+    for (k = 0; k < N_REC; k++)
+      {
+      vs_real *row = &data[(size_t)k*N_CHAN];
+      t = k*TSTEP;
+      row[0] = t;
+      row[1] = 3.0*sin(2.0*PI*f*t) + 0.1*sin(37.0*t);
+      row[2] = -0.5 + 0.5*exp(-t/2.0);
+      row[3] = 20.0*(1.0 - exp(-t/(0.2 + 0.01*r))*cos(6.0*t));
+      row[4] = 25.0 + 0.3*t;
+      row[5] = 45.0*sin(2.0*PI*f*t);
+      row[6] = 0.05*row[1];
+      row[7] = -0.02*row[2];
+      }
+    sprintf (path, "%s/run%03d.erd", dir.c_str(), r);
+    status = vs_erd_write(path, "bench", N_CHAN, names, N_REC, data.data(), 4);
+    }
+  return status == 0;
+}
+
+static void bm_post (vs_bench_state &state)
+{
+  std::string dir;
+  vs_post post;
+  char path[FILENAME_MAX];
+  vs_real err = 0.0;
+  int r, c, freq = 0;
+
+  if (!make_dataset(dir))
+    {
+    state.skip ("could not write the dataset");
+    return;
+    }
+  for (r = 0; r < N_RUNS; r++)
+    {
+    sprintf (path, "%s/run%03d.erd", dir.c_str(), r);
+    post.add_run (path);
+    }
+  for (c = 1; c < 7; c++)
+    {
+    post.add_metric (names[c], VS_POST_RMS);
+    post.add_metric (names[c], VS_POST_PEAK);
+    post.add_metric (names[c], VS_POST_SETTLE);
+    if (c == 1) freq = post.add_metric(names[c], VS_POST_FFT_FREQ);
+    else post.add_metric(names[c], VS_POST_FFT_FREQ);
+    }
+
+  while (state.keep_running())
+    {
+    if (post.compute(state.arg(0)))
+      {
+      state.skip (post.run_error(0));
+      return;
+      }
+    }
+  state.set_items_processed (state.iterations()*N_RUNS*6);
+  state.set_bytes_processed (state.iterations()*N_RUNS*(long long)N_REC*N_CHAN*4);
+
+  for (r = 0; r < N_RUNS; r++) err = fmax(err, fabs(post.value(r, freq) - run_freq(r)));
+  state.counter ("freq_err", err);
+  state.counter ("steals", (double)post.steals());
+  post.write_summary ((dir + "/summary.csv").c_str());
+}
+VS_BENCHMARK(bm_post)->arg(1)->arg(2)->arg(4)->arg(8)->iterations(3);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,122 @@
+/* Cost of the run result cache: making the key of an unchanged configuration,
+   a hit, and storing a new result.
+
+   No solver is needed. A simfile, a dummy DLL and a tree of parsfiles are
+   written in a temporary directory. Arguments: number of parsfiles in the
+   tree (key), number of values in a result (hit, store).
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_jobs.h"         // vs_job_mods
+#include "vs_result_cache.h" // run result cache
+#include "vs_bench.h"        // benchmark harness
+
+static std::string bench_dir (void)
+{
+  const char *tmp = getenv("TMPDIR");
+  return std::string(tmp ? tmp : "/tmp") + "/vs_bench_cache/";
+}
+
+// Write a simfile whose INPUT parsfile loads n_files - 1 others.
+static std::string write_run (int n_files)
+{
+  std::string dir = bench_dir(), simfile = dir + "run.sim";
+  char name[64];
+  FILE *fp;
+  int i, k;
+
+  remove (simfile.c_str());
+  vs_result_cache().open(dir.c_str(), 0); // makes the directory
+  for (i = 0; i < n_files; i++)
+    {
+    sprintf (name, "part%d.par", i);
+    if ((fp = fopen((dir + name).c_str(), "w")) == NULL) return "";
+    fprintf (fp, "#FullDataName Bench part %d\n", i);
+    for (k = 0; k < 100; k++) fprintf(fp, "PAR_%d_%d %d\n", i, k, k);
+    if (i == 0)
+      for (k = 1; k < n_files; k++) fprintf(fp, "PARSFILE part%d.par\n", k);
+    fclose (fp);
+    }
+  if ((fp = fopen((dir + "solver.so").c_str(), "wb")) == NULL) return "";
+  for (k = 0; k < 1 << 20; k++) fputc(k & 0xff, fp);
+  fclose (fp);
+
+  if ((fp = fopen(simfile.c_str(), "w")) == NULL) return "";
+  fprintf (fp, "SIMFILE\nINPUT %spart0.par\nDATADIR %s\nDLLFILE %ssolver.so\nEND\n",
+           dir.c_str(), dir.c_str(), dir.c_str());
+  fclose (fp);
+  return simfile;
+}
+
+static vs_job_mods bench_mods (void)
+{
+  vs_job_mods mods;
+  mods.push_back (std::make_pair(std::string("M_SU"), 1500.0));
+  mods.push_back (std::make_pair(std::string("IXX_SU"), 800.0));
+  return mods;
+}
+
+static void bm_make_key (vs_bench_state &state)
+{
+  std::string simfile = write_run((int)state.arg(0)), key;
+  vs_job_mods mods = bench_mods();
+  vs_result_cache cache;
+
+  cache.make_key (simfile.c_str(), mods, NULL, key); // hash the files once
+  while (state.keep_running())
+    {
+    cache.make_key (simfile.c_str(), mods, NULL, key);
+    vs_bench_keep (key);
+    }
+}
+VS_BENCHMARK(bm_make_key)->arg(1)->arg(10)->arg(100);
+
+static void bm_cache_hit (vs_bench_state &state)
+{
+  std::string dir = bench_dir() + "results";
+  std::vector<vs_real> values(state.arg(0), 1.0), got;
+  vs_result_cache cache;
+  vs_real t_end;
+
+  cache.open (dir.c_str(), 1LL << 30);
+  cache.store ("0123456789abcdef0123456789abcdef", values, 10.0);
+  while (state.keep_running())
+    {
+    cache.find ("0123456789abcdef0123456789abcdef", got, &t_end);
+    vs_bench_keep (got);
+    }
+  cache.clear ();
+  state.counter ("hit_rate", (double)cache.stats().hits/state.iterations());
+}
+VS_BENCHMARK(bm_cache_hit)->arg(16)->arg(1000);
+
+static void bm_cache_store (vs_bench_state &state)
+{
+  std::string dir = bench_dir() + "results";
+  std::vector<vs_real> values(state.arg(0), 1.0);
+  vs_result_cache cache;
+  char key[40];
+  long long i = 0;
+
+  // room for 100 results, so the store path includes eviction
+  cache.open (dir.c_str(), 100*(long long)(24 + 8*values.size()));
+  while (state.keep_running())
+    {
+    sprintf (key, "%032llx", i++);
+    cache.store (key, values, 10.0);
+    }
+  state.counter ("evictions", (double)cache.stats().evictions);
+  cache.clear ();
+}
+VS_BENCHMARK(bm_cache_store)->arg(16)->arg(1000);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,116 @@
+/* Cost of a vs_rewind_ring: a snapshot at VS_EXT_EQ_SAVE, and a rewind to a
+   random time in the window, against a 1 ms frame budget.
+
+   The solver is replaced by a table of stub API functions with 200 states,
+   stepped at 1 ms. Arguments: window in seconds, cadence in ms. The counter
+   "wrong" checks that each rewind restored the state saved at that time.
+
+   Log:
+   Oct 18, 26. The stub API has vs_start_save_timer.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <string.h>
+#include <random>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_rewind.h"       // rewind buffer
+#include "vs_bench.h"        // benchmark harness
+
+#define TSTEP   0.001
+#define N_STATE 200
+
+static vs_real model_state[N_STATE];
+
+static int     stub_n_derivatives (void) {return N_STATE - 40;}
+static int     stub_n_extra (void) {return 40;}
+static vs_real stub_get_tstep (void) {return TSTEP;}
+static void    stub_to_array (vs_real *a) {memcpy(a, model_state, sizeof(model_state));}
+static void    stub_from_array (vs_real *a) {memcpy(model_state, a, sizeof(model_state));}
+static void    stub_start_save_timer (vs_real) {}
+static void    stub_calc2 (void (*) (vs_real, vs_ext_loc, void *), void *) {}
+static void    stub_echo2 (void (*) (vs_ext_loc, void *), void *) {}
+static void    stub_setdef2 (void (*) (void *), void *) {}
+static void    stub_scan2 (vs_bool (*) (char *, char *, void *), void *) {}
+static void    stub_free2 (void (*) (void *), void *) {}
+
+static vs_api_table stub_api (void)
+{
+  vs_api_table api = vs_api_table();
+  api.vs_n_derivatives = stub_n_derivatives;
+  api.vs_n_extra_state_variables = stub_n_extra;
+  api.vs_get_tstep = stub_get_tstep;
+  api.vs_copy_all_state_vars_to_array = stub_to_array;
+  api.vs_copy_all_state_vars_from_array = stub_from_array;
+  api.vs_start_save_timer = stub_start_save_timer;
+  api.vs_install_calc_function2 = stub_calc2;
+  api.vs_install_echo_function2 = stub_echo2;
+  api.vs_install_setdef_function2 = stub_setdef2;
+  api.vs_install_scan_function2 = stub_scan2;
+  api.vs_install_free_function2 = stub_free2;
+  return api;
+}
+
+// One model step with a save.
+static void step (vs_ext_dispatcher &ext, vs_real &t)
+{
+  t += TSTEP;
+  model_state[0] = t;
+  ext.calc (t, VS_EXT_EQ_SAVE);
+}
+
+static void bm_rewind_capture (vs_bench_state &state)
+{
+  vs_api_table api = stub_api();
+  vs_ext_dispatcher ext;
+  vs_rewind_ring ring(state.arg(0), state.arg(1)*1e-3);
+  vs_real t = 0.0;
+
+  ext.add (&ring);
+  ext.install (api);
+  ext.calc (t, VS_EXT_EQ_INIT);
+  while (state.keep_running())
+    {
+    step (ext, t);
+    }
+  state.set_items_processed (state.iterations());
+  state.counter ("MB", ring.bytes()/1048576.0);
+}
+VS_BENCHMARK(bm_rewind_capture)->args(10, 1)->args(10, 10)->args(60, 10);
+
+static void bm_rewind_restore (vs_bench_state &state)
+{
+  vs_api_table api = stub_api();
+  vs_ext_dispatcher ext;
+  vs_rewind_ring ring(state.arg(0), state.arg(1)*1e-3);
+  std::mt19937 rng(5);
+  vs_real t = 0.0, t_end, back;
+  long long wrong = 0;
+
+  ext.add (&ring);
+  ext.install (api);
+  ext.calc (t, VS_EXT_EQ_INIT);
+  while (t < state.arg(0) + TSTEP) step(ext, t);
+  t_end = t;
+
+  while (state.keep_running())
+    {
+    back = std::uniform_real_distribution<vs_real>(0.0, state.arg(0))(rng);
+    t = ring.rewind(t_end - back);
+    vs_bench_keep (model_state[0]);
+
+    // drive on to the end of the window again
+    state.pause_timing ();
+    if (model_state[0] != t) wrong++;
+    while (t < t_end - 0.5*TSTEP) step(ext, t);
+    state.resume_timing ();
+    }
+  state.counter ("wrong", (double)wrong);
+  state.counter ("snapshots", ring.size());
+}
+VS_BENCHMARK(bm_rewind_restore)->args(10, 1)->args(10, 10)->args(60, 10)->iterations(2000);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,195 @@
+/* Queries of a tiled road (vs_road_tiles) along a long route: the cost of a
+   query, the memory that stays resident, and the latency of the first
+   query in each new tile.
+
+   The route is written to TMPDIR before the first case: 50 km sampled
+   every 0.1 m, 5 elevations across 4 m, tiles of 500 m (about 360 KB).
+   A vehicle drives it at 30 m/s with a query every 1 ms.
+
+     bm_road_drive/a    one contact query per iteration, window of a tiles
+                        ahead and 1 behind (a = 0: no read ahead; 1000:
+                        1000 each way, so the whole route stays). rss_MB:
+                        growth of the resident size of the process over
+                        the drive
+     bm_road_boundary/a one iteration per tile: the first query in it, with
+                        the file dropped from the page cache before the
+                        drive (Linux), so tiles not read ahead come from
+                        the disk. max_us: the slowest of them
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_road_tiles.h" // tiled road store
+#include "vs_bench.h"      // benchmark harness
+
+#define ROUTE_KM  50
+#define DS        0.1
+#define TILE_N    5000 // samples per tile
+#define N_LAT     5
+#define STEP      0.03 // m per query
+
+static std::string route_path;
+
+// Write the route once. Return FALSE and skip if that fails.
+static vs_bool bench_route (vs_bench_state &state)
+{
+  const char *tmp = getenv("TMPDIR");
+  vs_road_tile_layout lay = {0.0, DS, TILE_N, N_LAT, -2.0, 1.0};
+  vs_road_tile_writer w;
+  vs_real x = 0.0, y = 0.0, yaw = 0.0, z[N_LAT], s;
+  long long i, n = (long long)(ROUTE_KM*1000.0/DS) + 1;
+  int j;
+
+  if (!route_path.empty()) return TRUE;
+  route_path = std::string(tmp ? tmp : "/tmp") + "/vs_bench_route.vrt";
+  if (w.open(route_path.c_str(), lay))
+    {
+    state.skip (w.error_message());
+    route_path.clear ();
+    return FALSE;
+    }
+  for (i = 0; i < n; i++)
+    {
+    s = i*DS;
+    for (j = 0; j < N_LAT; j++)
+      z[j] = 2.0*sin(s/700.0) + 0.02*sin(s/3.1 + j) + 0.01*(j - 2);
+    w.add (x, y, yaw, 0.9 + 0.1*sin(s/250.0), z);
+    x += DS*cos(yaw);
+    y += DS*sin(yaw);
+    yaw += DS*0.002*sin(s/900.0);
+    }
+  if (w.close())
+    {
+    state.skip (w.error_message());
+    remove (route_path.c_str());
+    route_path.clear ();
+    return FALSE;
+    }
+  return TRUE;
+}
+
+#ifndef _WIN32
+// Resident size of this process, in kB.
+static long bench_rss (void)
+{
+  char line[256];
+  long rss = -1;
+  FILE *fp;
+
+  if ((fp = fopen("/proc/self/status", "r")) == NULL) return -1;
+  while (fgets(line, sizeof(line), fp))
+    if (!strncmp(line, "VmRSS:", 6)) rss = atol(line + 6);
+  fclose (fp);
+  return rss;
+}
+
+// Drop the route from the page cache.
+static void bench_drop_cache (void)
+{
+  int fd = open(route_path.c_str(), O_RDONLY);
+
+  if (fd < 0) return;
+  posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+  close (fd);
+}
+#else
+static long bench_rss (void) {return -1;}
+static void bench_drop_cache (void) {}
+#endif
+
+static void bm_road_drive (vs_bench_state &state)
+{
+  vs_road_tiles road;
+  vs_real s = 0.0, z, dzds, dzdl, mu, sum = 0.0;
+  long rss0, rss, rss_max = 0;
+
+  if (!bench_route(state)) return;
+  rss0 = bench_rss();
+  if (road.open(route_path.c_str()))
+    {
+    state.skip (road.error_message());
+    return;
+    }
+  road.set_window ((int)state.arg(), state.arg() >= 1000 ? (int)state.arg() : 1);
+  while (state.keep_running())
+    {
+    road.contact (s, 0.5, &z, &dzds, &dzdl, &mu);
+    sum += z;
+    if ((s += STEP) > road.s_end())
+      {
+      state.pause_timing ();
+      if ((rss = bench_rss() - rss0) > rss_max) rss_max = rss;
+      s = 0.0;
+      state.resume_timing ();
+      }
+    }
+  if ((rss = bench_rss() - rss0) > rss_max) rss_max = rss;
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations());
+  state.counter ("rss_MB", rss_max/1024.0);
+  state.counter ("tiles", (double)road.stats().tile_changes);
+}
+VS_BENCHMARK(bm_road_drive)->arg(0)->arg(1)->arg(2)->arg(1000);
+
+static void bm_road_boundary (vs_bench_state &state)
+{
+  typedef std::chrono::steady_clock clock;
+  vs_road_tiles road;
+  vs_real s = 0.0, tile_len = TILE_N*DS, z, dzds, dzdl, mu, sum = 0.0, end;
+  double us, max_us = 0.0;
+  clock::time_point start;
+
+  if (!bench_route(state)) return;
+  bench_drop_cache ();
+  if (road.open(route_path.c_str()))
+    {
+    state.skip (road.error_message());
+    return;
+    }
+  road.set_window ((int)state.arg(), 1);
+  while (state.keep_running())
+    {
+    start = clock::now();
+    road.contact (s, 0.5, &z, &dzds, &dzdl, &mu);
+    us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+    if (us > max_us) max_us = us;
+
+    // The rest of the tile, untimed.
+    state.pause_timing ();
+    for (end = s + tile_len - STEP; s < end; s += STEP)
+      {
+      road.contact (s, 0.5, &z, &dzds, &dzdl, &mu);
+      sum += z;
+      }
+    s = floor(s/tile_len + 0.5)*tile_len;
+    if (s >= road.s_end())
+      {
+      road.close ();
+      bench_drop_cache ();
+      road.open (route_path.c_str());
+      road.set_window ((int)state.arg(), 1);
+      s = 0.0;
+      }
+    state.resume_timing ();
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations());
+  state.counter ("max_us", max_us);
+}
+VS_BENCHMARK(bm_road_boundary)->arg(0)->arg(1)->arg(2)->iterations(300);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,108 @@
+/* Real-time runs of a solver with vs_rt_stepper: pacing, overruns and
+   catch-up against a solver DLL loaded by vs_solver.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). Each iteration is one run of 0.1 s of simulated time
+   (a simfile written to --dir=<directory>, default /tmp) through
+   vs_rt_stepper::run, with a frame function that checks the time it gets.
+
+     bm_rt_run/p    frame period p microseconds (default settings: 100 us
+                    spin, catch-up of up to 10 frames). With p = 1000 the
+                    run takes 0.1 s; with p = 2 every step overruns, so the
+                    catch-up and skipping paths run.
+   Counters, per run: steps, overruns, caught_up, skipped, jitter_max (us),
+   and bad_t, frames whose time was not the one before plus the time step.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_solver.h"     // per-instance solver API
+#include "vs_rt_stepper.h" // real-time stepping
+#include "vs_bench.h"      // benchmark harness
+
+static vs_solver solver;
+
+typedef struct
+  {
+  vs_real   t_last;
+  long long frames, bad_t;
+  } bench_frames;
+
+static void bench_frame (vs_real t, vs_real *, const vs_real *, void *user)
+{
+  bench_frames *f = (bench_frames *)user;
+
+  if (f->frames++ && fabs(t - f->t_last - solver.api.vs_get_tstep()) > 1e-9) f->bad_t++;
+  f->t_last = t;
+}
+
+// Write the run simfile. Return FALSE and skip if there is no solver.
+static vs_bool bench_simfile (vs_bench_state &state, std::string &path)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  path = vs_bench_option("dir", "/tmp") + std::string("/vs_bench_rt.sim");
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("could not write to --dir");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 0.1\nEND\n", solver.path(), simfile);
+  fclose (fp);
+  return TRUE;
+}
+
+static void bm_rt_run (vs_bench_state &state)
+{
+  std::string simfile;
+  vs_rt_config cfg;
+  bench_frames f;
+  double steps = 0.0, overruns = 0.0, caught_up = 0.0, skipped = 0.0, jitter = 0.0;
+  long long bad_t = 0, errors = 0;
+
+  if (!bench_simfile(state, simfile)) return;
+  vs_rt_config_default (&cfg);
+  cfg.period = state.arg()*1e-6;
+  vs_rt_stepper rt(cfg);
+  while (state.keep_running())
+    {
+    f.t_last = 0.0;
+    f.frames = f.bad_t = 0;
+    if (rt.run(solver.api, simfile.c_str(), bench_frame, &f)) errors++;
+    bad_t += f.bad_t;
+    steps += rt.stats().steps;
+    overruns += rt.stats().overruns;
+    caught_up += rt.stats().caught_up;
+    skipped += rt.stats().skipped;
+    if (rt.stats().jitter_max > jitter) jitter = rt.stats().jitter_max;
+    }
+  state.set_items_processed ((long long)steps);
+  state.counter ("steps", steps/state.iterations());
+  state.counter ("overruns", overruns/state.iterations());
+  state.counter ("caught_up", caught_up/state.iterations());
+  state.counter ("skipped", skipped/state.iterations());
+  state.counter ("jitter_max", jitter*1e6);
+  state.counter ("bad_t", (double)bad_t);
+  state.counter ("errors", (double)errors);
+}
+VS_BENCHMARK(bm_rt_run)->arg(1000)->arg(250)->arg(2);
+
+VS_BENCH_MAIN()
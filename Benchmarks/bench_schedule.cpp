@@ -0,0 +1,170 @@
+/* Cost of open-loop import signals computed every step with the scalar
+   utilities of vs_utility.c, compared with a vs_schedule built once per run,
+   and the accuracy of the schedule.
+
+   The test run is 60 s at 1 ms with four imports: steer (two smooth steps
+   and a 0.2 to 3 Hz sine sweep), throttle (a table, limited to 0..1), brake
+   (a smooth step) and a constant. The counter "err" is the largest
+   difference between the schedule and the scalar signals. Building is done
+   once per run; bm_schedule_fill is the cost left in each step. bm_cos_* compare
+   vs_cos_array with the C library cos; "err" is the largest difference.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+extern "C" {
+#include "vs_utility.h"  // VS utility functions
+}
+#include "vs_schedule.h" // import schedules
+#include "vs_bench.h"    // benchmark harness
+
+#define TSTEP   0.001
+#define N_STEPS 60001
+#define N_IMP   4
+
+static const vs_real throttle_t[] = {0.0, 2.0, 6.0, 10.0, 30.0, 35.0, 50.0};
+static const vs_real throttle_y[] = {0.0, 0.0, 0.4, 1.2,  1.2,  0.0,  0.0};
+#define N_THROTTLE 7
+
+// The signals as a driver computes them each step.
+static void scalar_imports (vs_real t, vs_real *imp)
+{
+  vs_real steer, tau, v;
+  int j;
+
+  steer = vs_step_smooth(t, 1.0, 0.0, 1.5, 30.0) + vs_step_smooth(t, 3.0, 0.0, 3.5, -30.0);
+  if (t >= 5.0 && t <= 25.0)
+    {
+    tau = t - 5.0;
+    steer += 10.0*sin(2.0*PI*tau*(0.2 + 0.5*(3.0 - 0.2)/20.0*tau));
+    }
+  imp[0] = steer;
+
+  if (t <= throttle_t[0]) v = throttle_y[0];
+  else if (t > throttle_t[N_THROTTLE - 1]) v = throttle_y[N_THROTTLE - 1];
+  else
+    {
+    for (j = 0; t > throttle_t[j + 1]; j++)
+      ;
+    v = throttle_y[j] + (throttle_y[j + 1] - throttle_y[j])*(t - throttle_t[j])/
+                        (throttle_t[j + 1] - throttle_t[j]);
+    }
+  imp[1] = vs_max(0.0, vs_min(1.0, v));
+  imp[2] = vs_step_smooth(t, 40.0, 0.0, 41.0, 5.0);
+  imp[3] = 3.0;
+}
+
+static void build (vs_schedule &s)
+{
+  s.clear ();
+  s.step_smooth (0, 1.0, 0.0, 1.5, 30.0);
+  s.step_smooth (0, 3.0, 0.0, 3.5, -30.0);
+  s.sine_sweep (0, 5.0, 25.0, 10.0, 0.2, 3.0);
+  s.table (1, N_THROTTLE, throttle_t, throttle_y);
+  s.limit (1, 0.0, 1.0);
+  s.step_smooth (2, 40.0, 0.0, 41.0, 5.0);
+  s.constant (3, 3.0);
+}
+
+static void bm_schedule_scalar (vs_bench_state &state)
+{
+  vs_real imp[N_IMP], sum = 0.0;
+  int k;
+
+  while (state.keep_running())
+    {
+    for (k = 0; k < N_STEPS; k++)
+      {
+      scalar_imports (k*TSTEP, imp);
+      sum += imp[0] + imp[1];
+      }
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations()*N_STEPS);
+}
+VS_BENCHMARK(bm_schedule_scalar);
+
+// Build the schedule, once per run.
+static void bm_schedule_build (vs_bench_state &state)
+{
+  vs_schedule s(N_IMP, 0.0, TSTEP, N_STEPS);
+  vs_real ref[N_IMP], err = 0.0;
+  int k, i;
+
+  while (state.keep_running())
+    {
+    build (s);
+    vs_bench_keep (s.row(0)[0]);
+    }
+  state.set_items_processed (state.iterations()*N_STEPS);
+
+  for (k = 0; k < N_STEPS; k++)
+    {
+    scalar_imports (k*TSTEP, ref);
+    for (i = 0; i < N_IMP; i++) err = vs_max(err, fabs(s.row(k)[i] - ref[i]));
+    }
+  state.counter ("err", err);
+}
+VS_BENCHMARK(bm_schedule_build);
+
+// Per-step cost in the run loop: copy the row for t.
+static void bm_schedule_fill (vs_bench_state &state)
+{
+  vs_schedule s(N_IMP, 0.0, TSTEP, N_STEPS);
+  vs_real imp[N_IMP], sum = 0.0;
+  int k;
+
+  build (s);
+  while (state.keep_running())
+    {
+    for (k = 0; k < N_STEPS; k++)
+      {
+      s.fill (k*TSTEP, imp);
+      sum += imp[0] + imp[1];
+      }
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations()*N_STEPS);
+}
+VS_BENCHMARK(bm_schedule_fill);
+
+static void bm_cos_libm (vs_bench_state &state)
+{
+  std::vector<vs_real> x(4096), y(4096);
+  int i;
+
+  for (i = 0; i < 4096; i++) x[i] = -200.0 + 0.1*i;
+  while (state.keep_running())
+    {
+    for (i = 0; i < 4096; i++) y[i] = cos(x[i]);
+    vs_bench_keep (y[4095]);
+    }
+  state.set_items_processed (state.iterations()*4096);
+}
+VS_BENCHMARK(bm_cos_libm);
+
+static void bm_cos_array (vs_bench_state &state)
+{
+  std::vector<vs_real> x(4096), y(4096);
+  vs_real err = 0.0;
+  int i;
+
+  for (i = 0; i < 4096; i++) x[i] = -200.0 + 0.1*i;
+  while (state.keep_running())
+    {
+    vs_cos_array (4096, x.data(), y.data());
+    vs_bench_keep (y[4095]);
+    }
+  state.set_items_processed (state.iterations()*4096);
+  for (i = 0; i < 4096; i++) err = vs_max(err, fabs(y[i] - cos(x[i])));
+  state.counter ("err", err);
+}
+VS_BENCHMARK(bm_cos_array);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,170 @@
+/* Sensor detections per step: the dense connection array against a sparse
+   vs_sensor_hit_stream.
+
+   A scene of 8 sensors sees 0 to 5 objects each per step (2.5 on average),
+   as in a traffic run. Each iteration is one step: the detections are
+   made, handed over, and read by a fusion loop (a sum over the hits).
+
+     bm_sensor_dense/m     dense form with m max_connections, in the slot
+                           layout assumed in vs_sensor_hits.h: the producer
+                           clears and fills its array of 8 x m slots and
+                           copies it out; fusion scans every slot
+     bm_sensor_sparse/m    the producer adds its hits to a stream (the
+                           arena is reused); fusion reads the hits of each
+                           sensor
+     bm_sensor_compact/m   dense form from the producer, compacted into a
+                           stream at the boundary; fusion reads the stream
+   Counter: bytes, bytes handed over per step (dense array, or hit
+   records).
+
+   Log:
+   Oct 18, 26. The dense layout is the assumed one.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <string.h>
+#include <vector>
+
+#include "vs_deftypes.h"    // VS types and definitions
+#include "vs_sensor_hits.h" // sensor hit stream
+#include "vs_bench.h"       // benchmark harness
+
+#define N_SENSORS 8
+
+// Hits of sensor s at step k, and the j-th of them.
+static int bench_n_hits (long long k, int s)
+{
+  return (int)((k*5 + s*3) % 6);
+}
+
+static vs_sensor_hit bench_hit (long long k, int s, int j)
+{
+  vs_sensor_hit h;
+
+  h.sensor = s;
+  h.object = 1 + (int)((k + 7*j + s) % 200);
+  h.range = 10.0 + 7.0*j + s;
+  h.range_rate = -0.5*j;
+  h.azimuth = 0.01*(j - 2);
+  h.elevation = 0.0;
+  h.visible = 1.0;
+  return h;
+}
+
+// The producer's dense array for step k (cleared, then filled).
+static void bench_fill_dense (std::vector<vs_real> &dense, long long k, int m)
+{
+  vs_real *slot;
+  int s, j, n;
+
+  memset (dense.data(), 0, dense.size()*sizeof(vs_real));
+  for (s = 0; s < N_SENSORS; s++)
+    {
+    n = bench_n_hits(k, s);
+    if (n > m) n = m;
+    for (j = 0; j < n; j++)
+      {
+      vs_sensor_hit h = bench_hit(k, s, j);
+      slot = &dense[((size_t)s*m + j)*VS_SENSOR_SLOT_N];
+      slot[VS_SENSOR_SLOT_OBJECT] = h.object;
+      slot[VS_SENSOR_SLOT_RANGE] = h.range;
+      slot[VS_SENSOR_SLOT_RANGE_RATE] = h.range_rate;
+      slot[VS_SENSOR_SLOT_AZIMUTH] = h.azimuth;
+      slot[VS_SENSOR_SLOT_ELEVATION] = h.elevation;
+      slot[VS_SENSOR_SLOT_VISIBLE] = h.visible;
+      }
+    }
+}
+
+// Fusion over a stream: the hits of each sensor.
+static vs_real bench_fuse (const vs_sensor_hit_stream &hits)
+{
+  vs_real sum = 0.0;
+  int s;
+
+  for (s = 0; s < hits.n_sensors(); s++)
+    for (const vs_sensor_hit *h = hits.begin(s); h < hits.end(s); h++)
+      sum += h->range + h->azimuth;
+  return sum;
+}
+
+static void bm_sensor_dense (vs_bench_state &state)
+{
+  int m = (int)state.arg(), s, k;
+  std::vector<vs_real> produced((size_t)N_SENSORS*m*VS_SENSOR_SLOT_N);
+  std::vector<vs_real> connect(produced.size());
+  const vs_real *slot;
+  vs_real sum = 0.0;
+  long long step = 0;
+
+  while (state.keep_running())
+    {
+    bench_fill_dense (produced, step++, m);
+    memcpy (connect.data(), produced.data(), connect.size()*sizeof(vs_real));
+    slot = connect.data();
+    for (s = 0; s < N_SENSORS; s++)
+      for (k = 0; k < m; k++, slot += VS_SENSOR_SLOT_N)
+        if (slot[VS_SENSOR_SLOT_OBJECT] >= 1.0)
+          sum += slot[VS_SENSOR_SLOT_RANGE] + slot[VS_SENSOR_SLOT_AZIMUTH];
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations());
+  state.counter ("bytes", (double)(connect.size()*sizeof(vs_real)));
+}
+VS_BENCHMARK(bm_sensor_dense)->arg(16)->arg(64)->arg(256);
+
+static void bm_sensor_sparse (vs_bench_state &state)
+{
+  vs_sensor_hit_stream hits(N_SENSORS);
+  int m = (int)state.arg(), s, j, n;
+  vs_real sum = 0.0;
+  long long step = 0;
+  double bytes = 0.0;
+
+  while (state.keep_running())
+    {
+    hits.clear (step*0.001);
+    for (s = 0; s < N_SENSORS; s++)
+      {
+      n = bench_n_hits(step, s);
+      if (n > m) n = m;
+      for (j = 0; j < n; j++) hits.add(bench_hit(step, s, j));
+      }
+    hits.finish ();
+    sum += bench_fuse(hits);
+    bytes += hits.bytes();
+    step++;
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations());
+  state.counter ("bytes", bytes/state.iterations());
+}
+VS_BENCHMARK(bm_sensor_sparse)->arg(16)->arg(64)->arg(256);
+
+static void bm_sensor_compact (vs_bench_state &state)
+{
+  vs_sensor_hit_stream hits(N_SENSORS);
+  int m = (int)state.arg();
+  std::vector<vs_real> produced((size_t)N_SENSORS*m*VS_SENSOR_SLOT_N);
+  vs_real sum = 0.0;
+  long long step = 0;
+  double bytes = 0.0;
+
+  while (state.keep_running())
+    {
+    bench_fill_dense (produced, step, m);
+    hits.clear (step*0.001);
+    hits.compact (produced.data(), m, VS_SENSOR_SLOT_N);
+    hits.finish ();
+    sum += bench_fuse(hits);
+    bytes += hits.bytes();
+    step++;
+    }
+  vs_bench_keep (sum);
+  state.set_items_processed (state.iterations());
+  state.counter ("bytes", bytes/state.iterations());
+}
+VS_BENCHMARK(bm_sensor_compact)->arg(16)->arg(64)->arg(256);
+
+VS_BENCH_MAIN()
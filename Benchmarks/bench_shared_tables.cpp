@@ -0,0 +1,505 @@
+/* Memory per worker with and without vs_shared_tables.
+
+   Each worker process builds the same table group: 16 carpets of 256 x 256
+   points and 16 spline tables of 4096 points (about 8.5 MB), as a solver
+   copy would for tire and road data. It reads all of the data once, then
+   reports its resident memory while all workers are alive. RSS counts
+   shared pages in every process that maps them; PSS divides them among
+   those processes, so PSS is the memory a worker really costs the node.
+   POSIX only (fork).
+
+     bm_worker_memory/s/n   n workers; s = 0: private tables, s = 1: shared
+                            (time: start all n workers, fill or map, read)
+     bm_share/s             share() + detach() of the group in this process:
+                            s = 0 the region is made here, s = 1 it exists
+                            (the cost for each worker after the first)
+     bm_share_solver/s      the same with a group loaded by a solver from a
+                            parsfile (--simfile, the stand-in solver by
+                            default): 4 spline tables of 1024 points and 4
+                            carpets of 64 x 64, installed with
+                            vs_install_keyword_tab_group and read by the run.
+                            Counter diff: largest change of vs_table_calc
+                            over the tables while shared
+     bm_share_stale         a process makes the region and dies before
+                            filling it; share() removes it and makes it
+                            again (counter replaced) instead of failing
+
+   Log:
+   Oct 18, 26. Added bm_share_solver and bm_share_stale.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#ifndef _WIN32
+  #include <sys/wait.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h"      // VS types and definitions
+#include "vs_solver.h"        // per-instance solver API
+#include "vs_shared_tables.h" // shared table data
+#include "vs_bench.h"         // benchmark harness
+
+#define N_CARPET 16
+#define N_SPLINE 16
+#define CARPET_N 256
+#define SPLINE_N 4096
+
+// Same form as vs_malloc_table_data: replace the arrays of a table.
+static void bench_malloc (vs_table *tab, int type, int nx, int ny)
+{
+  int i;
+
+  if (tab->fxy)
+    for (i = 0; i < tab->nx; i++) free(tab->fxy[i]);
+  free (tab->fxy);
+  free (tab->x);
+  free (tab->y);
+  free (tab->dydx);
+  tab->fxy = NULL;
+  tab->dydx = NULL;
+  tab->type = (vs_table_type)type;
+  tab->nx = nx;
+  tab->x = (vs_real *)calloc(nx ? nx : 1, sizeof(vs_real));
+  if (type >= VS_TAB_2D)
+    {
+    tab->ny = ny;
+    tab->y = (vs_real *)calloc(ny ? ny : 1, sizeof(vs_real));
+    tab->fxy = (vs_real **)calloc(nx ? nx : 1, sizeof(vs_real *));
+    for (i = 0; i < nx; i++) tab->fxy[i] = (vs_real *)calloc(ny, sizeof(vs_real));
+    }
+  else
+    {
+    tab->y = (vs_real *)calloc(nx ? nx : 1, sizeof(vs_real));
+    tab->dydx = (vs_real *)calloc(nx ? nx : 1, sizeof(vs_real));
+    }
+}
+
+// A table group as a solver would fill it from parsfiles.
+class bench_group
+  {
+  public:
+    bench_group ()
+      {
+      vs_tab_group blank = {};
+      int i, j, k;
+
+      group = blank;
+      table.resize (N_CARPET + N_SPLINE);
+      pointers.resize (table.size());
+      for (k = 0; k < (int)table.size(); k++)
+        {
+        vs_table blank_tab = {};
+        vs_table *tab = &table[k];
+
+        *tab = blank_tab;
+        pointers[k] = tab;
+        tab->tabs = &group;
+        tab->gain = tab->scale_x = 1.0;
+        if (k < N_CARPET)
+          {
+          bench_malloc (tab, VS_TAB_2D, CARPET_N, CARPET_N);
+          for (i = 0; i < CARPET_N; i++) tab->x[i] = tab->y[i] = i;
+          for (i = 0; i < CARPET_N; i++)
+            for (j = 0; j < CARPET_N; j++) tab->fxy[i][j] = sin(0.01*i*(k + 1)) + cos(0.02*j);
+          }
+        else
+          {
+          bench_malloc (tab, VS_SPLINE, SPLINE_N, 0);
+          for (i = 0; i < SPLINE_N; i++)
+            {
+            tab->x[i] = 0.1*i;
+            tab->y[i] = sin(0.001*i*k);
+            tab->dydx[i] = 0.001*k*cos(0.001*i*k);
+            }
+          }
+        }
+      group.table = pointers.data();
+      group.ntab = (int)table.size();
+      group.ninst = 1;
+      }
+
+    ~bench_group ()
+      {
+      for (size_t k = 0; k < table.size(); k++) bench_malloc(&table[k], VS_TAB_LIN, 0, 0);
+      for (size_t k = 0; k < table.size(); k++)
+        {
+        free (table[k].x);
+        free (table[k].y);
+        free (table[k].dydx);
+        }
+      }
+
+    // Read every value, as lookups over a run would.
+    vs_real read_all (void) const
+      {
+      vs_real sum = 0.0;
+      int i, j;
+
+      for (size_t k = 0; k < table.size(); k++)
+        {
+        const vs_table &tab = table[k];
+        for (i = 0; i < tab.nx; i++)
+          {
+          sum += tab.x[i];
+          if (tab.fxy)
+            for (j = 0; j < tab.ny; j++) sum += tab.fxy[i][j];
+          else
+            sum += tab.y[i] + tab.dydx[i];
+          }
+        }
+      return sum;
+      }
+
+    vs_tab_group group;
+
+  private:
+    bench_group (const bench_group &);
+    bench_group &operator= (const bench_group &);
+
+    std::vector<vs_table> table;
+    std::vector<vs_table *> pointers;
+  };
+
+#ifndef _WIN32
+// Resident and proportional set size of this process, in kB.
+static void bench_memory (long *rss, long *pss)
+{
+  char line[256];
+  FILE *fp;
+
+  *rss = *pss = -1;
+  if ((fp = fopen("/proc/self/smaps_rollup", "r")) != NULL)
+    {
+    while (fgets(line, sizeof(line), fp))
+      {
+      if (!strncmp(line, "Rss:", 4)) *rss = atol(line + 4);
+      else if (!strncmp(line, "Pss:", 4)) *pss = atol(line + 4);
+      }
+    fclose (fp);
+    }
+  else if ((fp = fopen("/proc/self/status", "r")) != NULL)
+    {
+    while (fgets(line, sizeof(line), fp))
+      if (!strncmp(line, "VmRSS:", 6)) *rss = atol(line + 6);
+    fclose (fp);
+    }
+}
+
+// One worker: build the tables, share them or not, read them, report when
+// all workers are up.
+static void bench_worker (vs_bool shared, int ready_fd, int go_fd, int result_fd)
+{
+  bench_group tabs;
+  vs_shared_tables tables; // detaches before the tables are freed
+  long mem[3];
+  char c = 0;
+
+  if (shared && tables.share(&tabs.group, bench_malloc)) _exit (1);
+  vs_bench_keep (tabs.read_all());
+  if (write(ready_fd, &c, 1) != 1 || read(go_fd, &c, 1) < 0) _exit (1);
+  bench_memory (&mem[0], &mem[1]);
+  mem[2] = (long)tables.n_created();
+  tables.detach_all (); // removes the region name if made here
+  _exit (write(result_fd, mem, sizeof(mem)) == sizeof(mem) ? 0 : 1);
+}
+#endif
+
+static void bm_worker_memory (vs_bench_state &state)
+{
+#ifdef _WIN32
+  state.skip ("needs fork");
+#else
+  int n = (int)state.arg(1), i, ready[2], go[2], result[2];
+  long mem[3], rss = 0, pss = 0, created = 0, got = 0;
+  std::vector<pid_t> pids;
+  char c;
+
+  while (state.keep_running())
+    {
+    if (pipe(ready) || pipe(go) || pipe(result))
+      {
+      state.skip ("pipe failed");
+      return;
+      }
+    for (i = 0; i < n; i++)
+      {
+      pid_t pid = fork();
+      if (pid == 0)
+        {
+        close (go[1]);
+        bench_worker (state.arg(0) != 0, ready[1], go[0], result[1]);
+        }
+      pids.push_back (pid);
+      }
+    close (ready[1]);
+    close (go[0]);
+    close (result[1]);
+    for (i = 0; i < n; i++)
+      if (read(ready[0], &c, 1) != 1) break; // a worker failed
+    close (go[1]);                            // all up: measure
+    for (got = 0; read(result[0], mem, sizeof(mem)) == sizeof(mem); got++)
+      {
+      rss += mem[0];
+      pss += mem[1];
+      created += mem[2];
+      }
+    for (i = 0; i < (int)pids.size(); i++) waitpid(pids[i], NULL, 0);
+    pids.clear ();
+    close (ready[0]);
+    close (result[0]);
+    }
+  if (got < n)
+    {
+    state.skip ("a worker failed");
+    return;
+    }
+  state.counter ("rss_kB", (double)rss/(n*state.iterations()));
+  state.counter ("pss_kB", (double)pss/(n*state.iterations()));
+  state.counter ("made", (double)created/state.iterations());
+#endif
+}
+VS_BENCHMARK(bm_worker_memory)->args(0, 1)->args(0, 4)->args(1, 1)->args(1, 4)
+  ->iterations(1);
+
+static void bm_share (vs_bench_state &state)
+{
+  bench_group tabs, copy;
+  vs_shared_tables owner, tables;
+  size_t bytes = 0;
+  int status = 0;
+
+  if (state.arg() && owner.share(&copy.group)) // keeps the region named
+    {
+    state.skip (owner.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    status |= tables.share(&tabs.group);
+    bytes = tables.shared_bytes();
+    tables.detach (&tabs.group);
+    }
+  if (status) state.skip (tables.error_message());
+  state.set_bytes_processed (state.iterations()*(long long)bytes);
+  state.counter ("made", tables.n_created());
+  state.counter ("opened", tables.n_opened());
+}
+VS_BENCHMARK(bm_share)->arg(0)->arg(1);
+
+/* ----------------------------------------------------------------------------
+   A table group read by the solver: the group and its tables are ours, the
+   data is the solver's. Installed when the solver defines its model.
+---------------------------------------------------------------------------- */
+#define SOLVER_NTAB 8 // 4 spline tables, then 4 carpets
+
+static vs_solver solver;
+
+class solver_group
+  {
+  public:
+    solver_group ()
+      {
+      vs_tab_group blank = {};
+      int i;
+
+      group = blank;
+      for (i = 0; i < SOLVER_NTAB; i++)
+        {
+        vs_table blank_tab = {};
+        table[i] = blank_tab;
+        table[i].tabs = &group;
+        table[i].type = VS_TAB_CONST;
+        table[i].gain = table[i].scale_x = 1.0;
+        table[i].jx = &jx[i];
+        table[i].jy = &jy[i];
+        jx[i] = jy[i] = 0;
+        pointers[i] = &table[i];
+        }
+      group.table = pointers;
+      group.ntab = SOLVER_NTAB;
+      group.ninst = 1;
+      group.root_keyword = (char *)"BENCH_SHT";
+      group.table_keyword = (char *)"BENCH_SHT_TABLE";
+      group.carpet_keyword = (char *)"BENCH_SHT_CARPET";
+      }
+
+    static void setdef (void *user)
+      {
+      solver_group *g = (solver_group *)user;
+      solver.api.vs_install_keyword_tab_group (&g->group);
+      }
+
+    // vs_table_calc over a grid of each table.
+    void sample (int index, std::vector<vs_real> &v) const
+      {
+      int i, k;
+
+      v.clear ();
+      for (k = 0; k < SOLVER_NTAB; k++)
+        for (i = 0; i < 200; i++)
+          v.push_back (solver.api.vs_table_calc(index, 0.3*i, 0.5*i, k, 0));
+      }
+
+    vs_tab_group group;
+
+  private:
+    vs_table table[SOLVER_NTAB], *pointers[SOLVER_NTAB];
+    int jx[SOLVER_NTAB], jy[SOLVER_NTAB];
+  };
+
+// Parsfile with the data, and a simfile that reads it after the model.
+static vs_bool bench_solver_files (vs_bench_state &state, std::string &sim)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  std::string dir = vs_bench_option("dir", "/tmp") + std::string("/");
+  std::string par = dir + "vs_bench_shared_tables.par";
+  FILE *fp;
+  int i, j, k;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  if (solver.api.vs_install_keyword_tab_group == NULL ||
+      solver.api.vs_install_setdef_function2 == NULL || solver.api.vs_table_calc == NULL ||
+      solver.api.vs_table_index == NULL)
+    {
+    state.skip ("the DLL has no table functions");
+    return FALSE;
+    }
+  if ((fp = fopen(par.c_str(), "w")) == NULL)
+    {
+    state.skip ("could not write to --dir");
+    return FALSE;
+    }
+  fprintf (fp, "PARSFILE\n");
+  for (k = 0; k < 4; k++)
+    {
+    fprintf (fp, "BENCH_SHT_TABLE(%d) SPLINE\n", k + 1);
+    for (i = 0; i < 1024; i++) fprintf(fp, "%g, %.17g\n", 0.1*i, sin(0.001*i*(k + 1)));
+    fprintf (fp, "ENDTABLE\n");
+    }
+  for (k = 4; k < SOLVER_NTAB; k++)
+    {
+    fprintf (fp, "BENCH_SHT_CARPET(%d) LINEAR\n", k + 1); // rows under 1024 characters
+    for (j = 0; j < 64; j++) fprintf(fp, j ? ", %d" : "%d", 2*j);
+    fprintf (fp, "\n");
+    for (i = 0; i < 64; i++)
+      {
+      fprintf (fp, "%d", 2*i);
+      for (j = 0; j < 64; j++) fprintf(fp, ", %.6f", sin(0.01*i*k) + cos(0.02*j));
+      fprintf (fp, "\n");
+      }
+    fprintf (fp, "ENDTABLE\n");
+    }
+  fprintf (fp, "END\n");
+  fclose (fp);
+
+  sim = dir + "vs_bench_shared_tables.sim";
+  if ((fp = fopen(sim.c_str(), "w")) == NULL)
+    {
+    state.skip ("could not write to --dir");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nPARSFILE %s\nEND\n", solver.path(),
+           simfile, par.c_str());
+  fclose (fp);
+  return TRUE;
+}
+
+static void bm_share_solver (vs_bench_state &state)
+{
+  solver_group tabs;
+  vs_shared_tables owner, tables;
+  std::vector<vs_real> before, after;
+  std::string simfile;
+  int n_import, n_export, index, status = 0;
+  vs_real t, tstop, tstep, diff = 0.0;
+  size_t bytes = 0, i;
+
+  if (!bench_solver_files(state, simfile)) return;
+  solver.api.vs_install_setdef_function2 (solver_group::setdef, &tabs);
+  solver.api.vs_read_configuration (simfile.c_str(), &n_import, &n_export, &t, &tstop,
+                                    &tstep);
+  solver.api.vs_install_setdef_function2 (NULL, NULL);
+  index = solver.api.vs_table_index((char *)"BENCH_SHT");
+  if (solver.api.vs_error_occurred() || index < 0 || tabs.group.table[0]->nx != 1024 ||
+      tabs.group.table[SOLVER_NTAB - 1]->nx != 64)
+    {
+    state.skip ("the solver did not read the tables");
+    solver.api.vs_terminate_run (t);
+    return;
+    }
+  tabs.sample (index, before);
+  if (state.arg() && owner.share(&tabs.group)) // keeps the region named
+    {
+    state.skip (owner.error_message());
+    solver.api.vs_terminate_run (t);
+    return;
+    }
+  while (state.keep_running())
+    {
+    status |= tables.share(&tabs.group);
+    bytes = tables.shared_bytes();
+    state.pause_timing ();
+    tabs.sample (index, after);
+    for (i = 0; i < before.size() && i < after.size(); i++)
+      if (fabs(after[i] - before[i]) > diff) diff = fabs(after[i] - before[i]);
+    state.resume_timing ();
+    tables.detach (&tabs.group);
+    }
+  owner.detach_all ();
+  solver.api.vs_terminate_run (t);
+  if (status) state.skip (tables.error_message());
+  state.set_bytes_processed (state.iterations()*(long long)bytes);
+  state.counter ("made", tables.n_created());
+  state.counter ("opened", tables.n_opened());
+  state.counter ("diff", diff);
+}
+VS_BENCHMARK(bm_share_solver)->arg(0)->arg(1);
+
+static void bm_share_stale (vs_bench_state &state)
+{
+#ifdef _WIN32
+  state.skip ("needs fork"); // and a mapping dies with its last process there
+#else
+  bench_group tabs;
+  vs_shared_tables tables;
+  std::string name = vs_shared_tables::region_name(&tabs.group);
+  int status = 0;
+
+  tables.set_wait (2.0);
+  while (state.keep_running())
+    {
+    state.pause_timing ();
+    pid_t pid = fork();
+    if (pid == 0)
+      {
+      vs_shm shm;
+      _exit (shm.create(name.c_str(), 4096, FALSE, TRUE) ? 1 : 0); // dies unfilled
+      }
+    waitpid (pid, NULL, 0);
+    state.resume_timing ();
+    status |= tables.share(&tabs.group);
+    tables.detach (&tabs.group);
+    }
+  if (status) state.skip (tables.error_message());
+  state.counter ("replaced", tables.n_replaced());
+  state.counter ("made", tables.n_created());
+#endif
+}
+VS_BENCHMARK(bm_share_stale)->iterations(3);
+
+VS_BENCH_MAIN()
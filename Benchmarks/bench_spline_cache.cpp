@@ -0,0 +1,157 @@
+/* Startup cost of the host's bicubic coefficients of a large
+   VS_TAB_2D_SPLINE table (a road grid or tire carpet of n x n points):
+   built on one worker, built on a pool, and mapped from a vs_spline_cache
+   file. The table is the host's; the solver's own coefficients are not
+   involved (see vs_spline_cache.h).
+
+     bm_spline_build/n/w   attach() + detach() without a cache directory,
+                           w workers (w = 1: serial)
+     bm_spline_cached/n/r  attach() + detach() with the cache file made
+                           before the first iteration; r = 1 also reads one
+                           coefficient per page, so the time includes the
+                           page faults that the first lookups would take
+   Counters: MB, size of the coefficients; max_err (build only), largest
+   error at the cell centers against the function the grid was sampled
+   from.
+
+   Log:
+   Oct 18, 26. Coefficients from the cache, not from tab->coef.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_spline_cache.h" // spline coefficient cache
+#include "vs_bench.h"        // benchmark harness
+
+// The surface the grid is sampled from.
+static vs_real bench_f (vs_real x, vs_real y)
+{
+  return 0.05*sin(0.3*x)*cos(0.2*y) + 0.002*x*y;
+}
+
+// An n x n spline table on a slightly uneven grid.
+class bench_table
+  {
+  public:
+    bench_table (int n) : x(n), y(n), f((size_t)n*n), rows(n)
+      {
+      int i, j;
+
+      memset (&tab, 0, sizeof(tab));
+      for (i = 0; i < n; i++)
+        {
+        x[i] = 0.1*i + 0.02*sin((double)i);
+        y[i] = 0.05*i + 0.01*cos((double)i);
+        }
+      for (i = 0; i < n; i++)
+        {
+        rows[i] = &f[(size_t)i*n];
+        for (j = 0; j < n; j++) rows[i][j] = bench_f(x[i], y[j]);
+        }
+      tab.type = VS_TAB_2D_SPLINE;
+      tab.nx = tab.ny = n;
+      tab.x = x.data();
+      tab.y = y.data();
+      tab.fxy = rows.data();
+      tab.gain = tab.scale_x = 1.0;
+      }
+
+    vs_table tab;
+
+  private:
+    std::vector<vs_real> x, y, f;
+    std::vector<vs_real *> rows;
+  };
+
+static double bench_mb (const vs_table &tab)
+{
+  return (tab.nx - 1.0)*(tab.ny - 1.0)*16*sizeof(vs_real)/1048576.0;
+}
+
+static void bm_spline_build (vs_bench_state &state)
+{
+  bench_table t((int)state.arg());
+  vs_spline_cache cache((int)state.arg(1));
+  vs_real err, max_err = 0.0, xc, yc;
+  int i, j;
+
+  while (state.keep_running())
+    {
+    if (cache.attach(&t.tab))
+      {
+      state.skip (cache.error_message());
+      return;
+      }
+    vs_bench_keep (cache.coefficients(&t.tab)->c[0][0][0][0]);
+    cache.detach (&t.tab);
+    }
+
+  cache.attach (&t.tab);
+  for (i = 0; i < t.tab.nx - 1; i += 7)
+    for (j = 0; j < t.tab.ny - 1; j += 7)
+      {
+      xc = 0.5*(t.tab.x[i] + t.tab.x[i + 1]);
+      yc = 0.5*(t.tab.y[j] + t.tab.y[j + 1]);
+      err = fabs(cache.eval(&t.tab, xc, yc) - bench_f(xc, yc));
+      if (err > max_err) max_err = err;
+      }
+  cache.detach (&t.tab);
+  state.set_items_processed (state.iterations()*(t.tab.nx - 1)*(t.tab.ny - 1));
+  state.counter ("MB", bench_mb(t.tab));
+  state.counter ("max_err", max_err);
+}
+VS_BENCHMARK(bm_spline_build)->args(300, 1)->args(300, 4)->args(1000, 1)
+                             ->args(1000, 4)->iterations(5);
+
+static void bm_spline_cached (vs_bench_state &state)
+{
+  const char *tmp = getenv("TMPDIR");
+  std::string dir = std::string(tmp ? tmp : "/tmp") + "/vs_bench_splines";
+  bench_table t((int)state.arg());
+  vs_spline_cache cache(1);
+  std::vector<vs_real> built((size_t)(t.tab.nx - 1)*(t.tab.ny - 1)*16);
+  size_t i, step = 4096/sizeof(vs_real);
+  vs_real sum = 0.0, *c;
+
+  if (cache.set_dir(dir.c_str()) || cache.attach(&t.tab))
+    {
+    state.skip (cache.error_message());
+    return;
+    }
+  cache.build (&t.tab, built.data());
+  c = &cache.coefficients(&t.tab)->c[0][0][0][0];
+  if (cache.stats().loaded + cache.stats().stored == 0 ||
+      memcmp(c, built.data(), built.size()*sizeof(vs_real)))
+    {
+    state.skip ("the cache file was not made, or holds other coefficients");
+    return;
+    }
+  cache.detach (&t.tab);
+
+  while (state.keep_running())
+    {
+    cache.attach (&t.tab);
+    if (state.arg(1))
+      {
+      c = &cache.coefficients(&t.tab)->c[0][0][0][0];
+      for (i = 0; i < built.size(); i += step) sum += c[i];
+      }
+    cache.detach (&t.tab);
+    }
+  vs_bench_keep (sum);
+  remove ((dir + "/" + vs_spline_cache::file_name(&t.tab)).c_str());
+  state.set_items_processed (state.iterations()*(t.tab.nx - 1)*(t.tab.ny - 1));
+  state.counter ("MB", bench_mb(t.tab));
+}
+VS_BENCHMARK(bm_spline_cached)->args(300, 0)->args(300, 1)->args(1000, 0)
+                              ->args(1000, 1)->iterations(5);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,138 @@
+/* Solver calls saved by vs_surrogate screening, and what it costs in accuracy,
+   on a synthetic stand-in for a vehicle model.
+
+   The stand-in cost is a smooth bowl with a ripple, over N parameters in
+   [-2, 2]. A random-search optimizer proposes 20 candidates per round for 30
+   rounds. Without screening every candidate is "run"; with screening only
+   the candidates kept by vs_surrogate::screen (kappa = 2) are run, and their
+   costs train the surrogate. Each benchmark iteration is one whole campaign
+   with a different seed. Argument: number of parameters.
+
+   Counters:
+     calls_saved     fraction of candidates not run
+     best_full       best cost found when running everything
+     best_screened   best cost found with screening
+     improver_recall fraction of candidates better than the best so far that
+                     were kept (the others are improvements missed)
+     rel_rms         RMS prediction error on pruned candidates / cost spread
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_surrogate.h" // surrogate model
+#include "vs_bench.h"     // benchmark harness
+
+#define ROUNDS 30
+#define BATCH  20
+#define KAPPA  2.0
+
+// Stand-in for a full run: returns the cost of a parameter set.
+static vs_real stand_in_cost (const vs_real *x, int n)
+{
+  vs_real c = 0.0, d;
+
+  for (int i = 0; i < n; i++)
+    {
+    d = x[i] - 0.3*(i + 1)/n;
+    c += (1.0 + 0.5*i/n)*d*d;
+    }
+  return c + 0.2*sin(3.0*x[0])*cos(2.0*x[n - 1]);
+}
+
+static void bm_surrogate_screen (vs_bench_state &state)
+{
+  int n = (int)state.arg(0), round, i, kept;
+  long long calls = 0, candidates = 0, improvers = 0, improvers_kept = 0, n_err = 0;
+  vs_real best_full = 0.0, best_screened = 0.0, err2 = 0.0, spread = 0.0;
+  std::vector<vs_real> x(BATCH*n), cost(BATCH), sorted(BATCH), lo(n, -2.0), hi(n, 2.0);
+  std::vector<vs_bool> keep(BATCH);
+  unsigned seed = 1;
+
+  while (state.keep_running())
+    {
+    std::mt19937 rng(seed++);
+    std::uniform_real_distribution<vs_real> uniform(-2.0, 2.0);
+    vs_surrogate model(n);
+    vs_real full = HUGE_VAL, mean, sd, threshold;
+
+    model.set_bounds (lo.data(), hi.data());
+    for (round = 0; round < ROUNDS; round++)
+      {
+      for (i = 0; i < BATCH*n; i++) x[i] = uniform(rng);
+      for (i = 0; i < BATCH; i++)
+        {
+        cost[i] = stand_in_cost(&x[i*n], n);
+        if (cost[i] < full) full = cost[i];
+        }
+
+      sorted = cost;
+      std::sort (sorted.begin(), sorted.end());
+      threshold = model.best();
+
+      kept = model.screen(BATCH, x.data(), KAPPA, keep.data(), NULL);
+      for (i = 0; i < BATCH; i++)
+        {
+        if (cost[i] < threshold)
+          {
+          improvers++;
+          improvers_kept += keep[i] ? 1 : 0;
+          }
+        if (!keep[i])
+          {
+          model.predict (&x[i*n], &mean, &sd);
+          err2 += (mean - cost[i])*(mean - cost[i]);
+          n_err++;
+          }
+        }
+      spread += sorted[BATCH - 1] - sorted[0];
+      for (i = 0; i < BATCH; i++)
+        if (keep[i]) model.add(&x[i*n], cost[i]);
+      calls += kept;
+      candidates += BATCH;
+      }
+    best_full += full;
+    best_screened += model.best();
+    }
+
+  double runs = (double)state.iterations();
+  state.set_items_processed (candidates);
+  state.counter ("calls_saved", 1.0 - (double)calls/candidates);
+  state.counter ("best_full", best_full/runs);
+  state.counter ("best_screened", best_screened/runs);
+  state.counter ("improver_recall", improvers ? (double)improvers_kept/improvers : 1.0);
+  state.counter ("rel_rms", n_err ? sqrt(err2/n_err)/(spread/(runs*ROUNDS)) : 0.0);
+}
+VS_BENCHMARK(bm_surrogate_screen)->arg(2)->arg(4)->arg(8);
+
+// Cost of learning one point and of one prediction with n points known.
+static void bm_surrogate_predict (vs_bench_state &state)
+{
+  int n = (int)state.arg(0), dims = 4, i;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<vs_real> uniform(0.0, 1.0);
+  std::vector<vs_real> x(dims);
+  vs_surrogate model(dims);
+  vs_real mean, sd;
+
+  for (i = 0; i < n; i++)
+    {
+    for (int k = 0; k < dims; k++) x[k] = uniform(rng);
+    model.add (x.data(), stand_in_cost(x.data(), dims));
+    }
+  while (state.keep_running())
+    {
+    model.predict (x.data(), &mean, &sd);
+    vs_bench_keep (mean);
+    }
+}
+VS_BENCHMARK(bm_surrogate_predict)->arg(64)->arg(256);
+
+VS_BENCH_MAIN()
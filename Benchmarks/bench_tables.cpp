@@ -0,0 +1,239 @@
+/* Standard suite for table and road lookups through the VS API. The solver
+   is started with the simfile (--simfile=<simfile>, the stand-in solver by
+   default when built with CMake) and kept at its initial state; lookups do
+   not step the model.
+
+     bm_table_calc/n/r      vs_table_calc of a 1D table of n points
+                            (LINEAR), installed with
+                            vs_install_keyword_tab_group. r = 0: x moves
+                            forward a little each call (the hint helps);
+                            r = 1: random x
+     bm_table_calc_2d/n/r   same for an n x n carpet (2D LINEAR)
+     bm_road_sl/r           vs_road_s_i and vs_road_l_i at points near the
+                            road: r = 0 following it, r = 1 random
+     bm_road_contact/r      vs_get_road_contact at the same points
+
+   Log:
+   Oct 18, 26. Skip if the DLL has no table or road functions.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_bench.h"    // benchmark harness
+
+static vs_solver solver;
+static const int n_points = 4096; // lookup arguments, used in turn
+
+// Load the solver and start a run. Return FALSE and skip if that fails; the
+// caller ends the run with vs_terminate_run.
+static vs_bool bench_start (vs_bench_state &state)
+{
+  const char *simfile = vs_bench_option("simfile", NULL);
+  int n_import, n_export;
+  vs_real t, tstop, tstep;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  if (solver.api.vs_table_calc == NULL || solver.api.vs_install_keyword_tab_group == NULL ||
+      solver.api.vs_malloc_table_data == NULL || solver.api.vs_get_road_contact == NULL ||
+      solver.api.vs_get_road_start_stop == NULL || solver.api.vs_road_l_i == NULL ||
+      solver.api.vs_road_s_i == NULL || solver.api.vs_road_x_sl_i == NULL ||
+      solver.api.vs_road_y_sl_i == NULL)
+    {
+    state.skip ("the DLL has no table or road functions");
+    return FALSE;
+    }
+  solver.api.vs_read_configuration (simfile, &n_import, &n_export, &t, &tstop, &tstep);
+  if (solver.api.vs_error_occurred())
+    {
+    state.skip (solver.api.vs_get_error_message());
+    solver.api.vs_terminate_run (t);
+    return FALSE;
+    }
+  return TRUE;
+}
+
+// Arguments for the lookups in [lo, hi]: small steps forward or random.
+static std::vector<vs_real> bench_points (vs_real lo, vs_real hi, vs_bool random)
+{
+  std::vector<vs_real> v(n_points);
+  int i;
+
+  srand (1);
+  for (i = 0; i < n_points; i++)
+    v[i] = random ? lo + (hi - lo)*rand()/RAND_MAX : lo + (hi - lo)*i/(n_points - 1);
+  return v;
+}
+
+/* ----------------------------------------------------------------------------
+   A table group made here, as a solver extension would make one. The data
+   belongs to the solver (vs_malloc_table_data); the group and tables are
+   ours and must outlive the run.
+---------------------------------------------------------------------------- */
+class bench_tab_group
+  {
+  public:
+    bench_tab_group ()
+      {
+      vs_tab_group blank = {};
+      vs_table blank_tab = {};
+
+      group = blank;
+      tab = blank_tab;
+      table = &tab;
+      jx = jy = 0;
+      group.table = &table;
+      group.ntab = group.ninst = 1;
+      tab.tabs = &group;
+      tab.gain = tab.scale_x = 1.0;
+      tab.jx = &jx;
+      tab.jy = &jy;
+      }
+
+    // Fill an n-point table (ny = 0) or n x n carpet, y = sin(x)(+ cos(col)),
+    // x in [0, 1000], and install the group. Return its index.
+    int install (const vs_api_table &api, int n, int ny)
+      {
+      int i, j;
+
+      api.vs_malloc_table_data (&tab, ny ? VS_TAB_2D : VS_TAB_LIN, n, ny);
+      for (i = 0; i < n; i++)
+        {
+        tab.x[i] = 1000.0*i/(n - 1);
+        if (ny == 0) tab.y[i] = sin(0.01*tab.x[i]);
+        }
+      for (j = 0; j < ny; j++)
+        {
+        tab.y[j] = 1000.0*j/(ny - 1);
+        for (i = 0; i < n; i++) tab.fxy[i][j] = sin(0.01*tab.x[i]) + cos(0.01*tab.y[j]);
+        }
+      return api.vs_install_keyword_tab_group(&group);
+      }
+
+  private:
+    vs_tab_group group;
+    vs_table tab, *table;
+    int jx, jy;
+  };
+
+
+static void bm_table_calc (vs_bench_state &state)
+{
+  bench_tab_group tabs;
+  std::vector<vs_real> x;
+  vs_real sum = 0.0;
+  int index, i = 0;
+
+  if (!bench_start(state)) return;
+  index = tabs.install(solver.api, (int)state.arg(0), 0);
+  x = bench_points(0.0, 1000.0, state.arg(1) != 0);
+  while (state.keep_running())
+    {
+    sum += solver.api.vs_table_calc(index, 0.0, x[i], 0, 0);
+    if (++i == n_points) i = 0;
+    }
+  vs_bench_keep (sum);
+  solver.api.vs_terminate_run (0.0);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_table_calc)->args(16, 0)->args(16, 1)->args(1024, 0)->args(1024, 1)
+  ->args(65536, 0)->args(65536, 1);
+
+static void bm_table_calc_2d (vs_bench_state &state)
+{
+  bench_tab_group tabs;
+  std::vector<vs_real> x, col;
+  vs_real sum = 0.0;
+  int index, i = 0;
+
+  if (!bench_start(state)) return;
+  index = tabs.install(solver.api, (int)state.arg(0), (int)state.arg(0));
+  x = bench_points(0.0, 1000.0, state.arg(1) != 0);
+  col = x;
+  if (state.arg(1)) col = bench_points(1000.0, 0.0, TRUE);
+  while (state.keep_running())
+    {
+    sum += solver.api.vs_table_calc(index, col[i], x[i], 0, 0);
+    if (++i == n_points) i = 0;
+    }
+  vs_bench_keep (sum);
+  solver.api.vs_terminate_run (0.0);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_table_calc_2d)->args(16, 0)->args(16, 1)->args(256, 0)->args(256, 1);
+
+// Global points near the road: along it with a lateral weave, or random.
+static void road_points (vs_bench_state &state, std::vector<vs_real> &x,
+                         std::vector<vs_real> &y)
+{
+  vs_real start = 0.0, stop = 0.0;
+  std::vector<vs_real> s, l;
+  int i;
+
+  solver.api.vs_get_road_start_stop (&start, &stop);
+  s = bench_points(start, stop, state.arg() != 0);
+  l = bench_points(-3.0, 3.0, state.arg() != 0);
+  x.resize (n_points);
+  y.resize (n_points);
+  for (i = 0; i < n_points; i++)
+    {
+    if (state.arg() == 0) l[i] = 3.0*sin(0.05*i);
+    x[i] = solver.api.vs_road_x_sl_i(s[i], l[i], 0.0);
+    y[i] = solver.api.vs_road_y_sl_i(s[i], l[i], 0.0);
+    }
+}
+
+static void bm_road_sl (vs_bench_state &state)
+{
+  std::vector<vs_real> x, y;
+  vs_real sum = 0.0;
+  int i = 0;
+
+  if (!bench_start(state)) return;
+  road_points (state, x, y);
+  while (state.keep_running())
+    {
+    sum += solver.api.vs_road_s_i(x[i], y[i], 0.0) + solver.api.vs_road_l_i(x[i], y[i], 0.0);
+    if (++i == n_points) i = 0;
+    }
+  vs_bench_keep (sum);
+  solver.api.vs_terminate_run (0.0);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_road_sl)->arg(0)->arg(1);
+
+static void bm_road_contact (vs_bench_state &state)
+{
+  std::vector<vs_real> x, y;
+  vs_real z = 0.0, dzdy = 0.0, dzdx = 0.0, mu = 0.0, sum = 0.0;
+  int i = 0;
+
+  if (!bench_start(state)) return;
+  road_points (state, x, y);
+  while (state.keep_running())
+    {
+    solver.api.vs_get_road_contact (y[i], x[i], 0, &z, &dzdy, &dzdx, &mu);
+    sum += z + mu;
+    if (++i == n_points) i = 0;
+    }
+  vs_bench_keep (sum);
+  solver.api.vs_terminate_run (0.0);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_road_contact)->arg(0)->arg(1);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,102 @@
+/* Cost per solver step of a vs_telemetry_tap, and of one read by a monitor.
+
+   The solver is replaced by a table of stub API functions, so this measures
+   the tap itself. Arguments: sample period in steps (1 = every step), and the
+   number of channels.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_telemetry.h"    // telemetry tap and reader
+#include "vs_bench.h"        // benchmark harness
+
+#define TSTEP 0.001
+
+static vs_real model_vars[VS_TELEMETRY_MAX_CHAN];
+
+static vs_real *stub_get_var_ptr (char *) {return &model_vars[0];}
+static vs_real  stub_get_tstep (void) {return TSTEP;}
+static vs_bool  stub_error_occurred (void) {return FALSE;}
+static void     stub_printf (const char *, ...) {}
+static void     stub_calc2 (void (*) (vs_real, vs_ext_loc, void *), void *) {}
+static void     stub_echo2 (void (*) (vs_ext_loc, void *), void *) {}
+static void     stub_setdef2 (void (*) (void *), void *) {}
+static void     stub_scan2 (vs_bool (*) (char *, char *, void *), void *) {}
+static void     stub_free2 (void (*) (void *), void *) {}
+
+static vs_api_table stub_api (void)
+{
+  vs_api_table api = vs_api_table();
+  api.vs_get_var_ptr = stub_get_var_ptr;
+  api.vs_get_tstep = stub_get_tstep;
+  api.vs_error_occurred = stub_error_occurred;
+  api.vs_printf = stub_printf;
+  api.vs_install_calc_function2 = stub_calc2;
+  api.vs_install_echo_function2 = stub_echo2;
+  api.vs_install_setdef_function2 = stub_setdef2;
+  api.vs_install_scan_function2 = stub_scan2;
+  api.vs_install_free_function2 = stub_free2;
+  return api;
+}
+
+static void bm_tap_step (vs_bench_state &state)
+{
+  vs_api_table api = stub_api();
+  vs_ext_dispatcher ext;
+  vs_telemetry_tap tap("bench_tap");
+  char name[32];
+  vs_real t = 0.0;
+  int i;
+
+  for (i = 0; i < state.arg(1); i++)
+    {
+    sprintf (name, "CH%d", i);
+    tap.add_channel (name);
+    }
+  tap.set_period (state.arg(0)*TSTEP);
+  ext.add (&tap);
+  ext.install (api);
+  ext.calc (t, VS_EXT_EQ_INIT);
+
+  while (state.keep_running())
+    {
+    t += TSTEP;
+    ext.calc (t, VS_EXT_EQ_OUT);
+    }
+  ext.calc (t, VS_EXT_EQ_END);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_tap_step)->args(1, 4)->args(1, 32)->args(50, 4)->args(50, 32);
+
+static void bm_monitor_read (vs_bench_state &state)
+{
+  vs_api_table api = stub_api();
+  vs_ext_dispatcher ext;
+  vs_telemetry_tap tap("bench_read");
+  vs_telemetry_reader reader;
+  vs_telemetry_sample s;
+
+  tap.add_channel ("X");
+  ext.add (&tap);
+  ext.install (api);
+  ext.calc (0.0, VS_EXT_EQ_INIT);
+  if (reader.open("bench_read"))
+    {
+    state.skip ("shared memory not available");
+    return;
+    }
+  while (state.keep_running())
+    reader.read (&s);
+  vs_bench_keep (s.t);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_monitor_read);
+
+VS_BENCH_MAIN()
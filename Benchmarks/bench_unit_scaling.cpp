@@ -0,0 +1,241 @@
+/* Cost of the import and export copies, which convert between user and
+   internal units, on wide configurations.
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). A simfile written to TMPDIR sets N_OSC to n, turns
+   on the stand-in's filter imports (OPT_OSC_IMPORTS) and chooses its n
+   filter imports (IMP_OSC_i, in g) and n filter outputs (OSC_i, in g) after
+   the default channels, so every copy has n channels with a gain other
+   than 1.
+
+     bm_copy_imports/n    vs_copy_import_vars, 3 + n imports
+     bm_copy_exports/n    vs_copy_export_vars, 8 + n exports
+     bm_step_io/n         one vs_integrate_io step with both
+   The same copies made by the client with a vs_io_scaling (pointers from
+   vs_get_var_ptr, gains measured once), which does not depend on how the
+   DLL copies:
+     bm_client_imports/n  scatter_imports
+     bm_client_exports/n  gather_exports
+     bm_client_step_io/n  integrate_io
+   Items are channels copied (steps for the step benchmarks). Counters of
+   the client copies: copied, channels left to the DLL; max_diff, largest
+   difference from the DLL's copy relative to the value.
+
+   Log:
+   Oct 18, 26. Client-side copies with vs_io_scaling; OPT_OSC_IMPORTS.
+   Oct 18, 26. Skip if the DLL lacks the functions used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_solver.h"     // per-instance solver API
+#include "vs_io_scaling.h" // client-side import and export copies
+#include "vs_bench.h"      // benchmark harness
+
+static vs_solver solver;
+
+// Start a run with n filter channels. Return FALSE and skip if that fails.
+static vs_bool bench_start (vs_bench_state &state, int n, vs_real *t, int *n_import,
+                            int *n_export)
+{
+  const char *simfile = vs_bench_option("simfile", NULL), *tmp = getenv("TMPDIR");
+  std::string path = std::string(tmp ? tmp : "/tmp") + "/vs_bench_scaling.sim";
+  static const char *imports[] = {"IMP_STEER_SW", "IMP_THROTTLE", "IMP_BRAKE"};
+  static const char *exports[] = {"XO", "YO", "YAW", "VX", "AY", "STEER_SW",
+                                  "STATION", "LAT"};
+  vs_real tstop, tstep;
+  FILE *fp;
+  int i;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  if (solver.api.vs_copy_import_vars == NULL || solver.api.vs_copy_export_vars == NULL)
+    {
+    state.skip ("the DLL has no export and import copy functions");
+    return FALSE;
+    }
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("cannot write the simfile");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 1e9\nN_OSC %d\nOPT_OSC_IMPORTS 1\n",
+           solver.path(), simfile, n);
+  for (i = 0; i < 3; i++) fprintf(fp, "IMPORT %s\n", imports[i]);
+  for (i = 1; i <= n; i++) fprintf(fp, "IMPORT IMP_OSC_%d\n", i);
+  for (i = 0; i < 8; i++) fprintf(fp, "EXPORT %s\n", exports[i]);
+  for (i = 1; i <= n; i++) fprintf(fp, "EXPORT OSC_%d\n", i);
+  fprintf (fp, "END\n");
+  fclose (fp);
+
+  solver.api.vs_read_configuration (path.c_str(), n_import, n_export, t, &tstop, &tstep);
+  if (solver.api.vs_error_occurred())
+    {
+    state.skip (solver.api.vs_get_error_message());
+    solver.api.vs_terminate_run (*t);
+    return FALSE;
+    }
+  return TRUE;
+}
+
+static void bm_copy_imports (vs_bench_state &state)
+{
+  std::vector<vs_real> imports;
+  int n_import, n_export;
+  vs_real t;
+
+  if (!bench_start(state, (int)state.arg(), &t, &n_import, &n_export)) return;
+  imports.assign (n_import + 1, 0.0);
+  for (int i = 3; i < n_import; i++) imports[i] = 0.001*i;
+  while (state.keep_running()) solver.api.vs_copy_import_vars(imports.data());
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations()*n_import);
+}
+VS_BENCHMARK(bm_copy_imports)->arg(0)->arg(100)->arg(400)->arg(1000);
+
+static void bm_copy_exports (vs_bench_state &state)
+{
+  std::vector<vs_real> exports;
+  int n_import, n_export;
+  vs_real t;
+
+  if (!bench_start(state, (int)state.arg(), &t, &n_import, &n_export)) return;
+  exports.assign (n_export + 1, 0.0);
+  while (state.keep_running()) solver.api.vs_copy_export_vars(exports.data());
+  vs_bench_keep (exports[0]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations()*n_export);
+}
+VS_BENCHMARK(bm_copy_exports)->arg(0)->arg(100)->arg(400)->arg(1000);
+
+static void bm_step_io (vs_bench_state &state)
+{
+  std::vector<vs_real> imports, exports;
+  int n_import, n_export;
+  vs_real t, tstep;
+
+  if (!bench_start(state, (int)state.arg(), &t, &n_import, &n_export)) return;
+  imports.assign (n_import + 1, 0.0);
+  exports.assign (n_export + 1, 0.0);
+  tstep = solver.api.vs_get_tstep();
+  while (state.keep_running())
+    {
+    solver.api.vs_integrate_io (t, imports.data(), exports.data());
+    t += tstep;
+    }
+  vs_bench_keep (exports[0]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations());
+}
+VS_BENCHMARK(bm_step_io)->arg(0)->arg(100)->arg(400);
+
+// Resolve the client copies. Return FALSE and skip if that fails.
+static vs_bool bench_client (vs_bench_state &state, vs_io_scaling &io, vs_real t)
+{
+  if (io.resolve(solver.api) >= 0) return TRUE;
+  state.skip ("the DLL has no import and export names");
+  solver.api.vs_terminate_run (t);
+  return FALSE;
+}
+
+static double bench_diff (vs_real a, vs_real b)
+{
+  return fabs(a - b)/(fabs(b) > 1e-300 ? fabs(b) : 1.0);
+}
+
+static void bm_client_imports (vs_bench_state &state)
+{
+  std::vector<vs_real> imports, dll, client;
+  std::vector<vs_real *> ptrs;
+  std::vector<char *> names;
+  vs_io_scaling io;
+  int n_import, n_export, i;
+  double diff = 0.0;
+  vs_real t;
+
+  if (!bench_start(state, (int)state.arg(), &t, &n_import, &n_export)) return;
+  if (!bench_client(state, io, t)) return;
+  imports.assign (n_import + 1, 0.0);
+  for (i = 3; i < n_import; i++) imports[i] = 0.001*i;
+  while (state.keep_running()) io.scatter_imports(imports.data());
+
+  // the variables set by the client and by the DLL
+  names.assign (n_import + 1, (char *)NULL);
+  solver.api.vs_get_import_names (names.data());
+  for (i = 0; i < n_import; i++) ptrs.push_back(solver.api.vs_get_var_ptr(names[i]));
+  for (i = 0; i < n_import; i++) client.push_back(ptrs[i] ? *ptrs[i] : 0.0);
+  solver.api.vs_copy_import_vars (imports.data());
+  for (i = 0; i < n_import; i++) dll.push_back(ptrs[i] ? *ptrs[i] : 0.0);
+  for (i = 0; i < n_import; i++)
+    if (bench_diff(client[i], dll[i]) > diff) diff = bench_diff(client[i], dll[i]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations()*n_import);
+  state.counter ("copied", io.n_copied());
+  state.counter ("max_diff", diff);
+}
+VS_BENCHMARK(bm_client_imports)->arg(0)->arg(100)->arg(400)->arg(1000);
+
+static void bm_client_exports (vs_bench_state &state)
+{
+  std::vector<vs_real> exports, dll;
+  vs_io_scaling io;
+  int n_import, n_export, i;
+  double diff = 0.0;
+  vs_real t;
+
+  if (!bench_start(state, (int)state.arg(), &t, &n_import, &n_export)) return;
+  if (!bench_client(state, io, t)) return;
+  solver.api.vs_integrate (&t, NULL); // exports other than 0
+  exports.assign (n_export + 1, 0.0);
+  dll.assign (n_export + 1, 0.0);
+  while (state.keep_running()) io.gather_exports(exports.data());
+  solver.api.vs_copy_export_vars (dll.data());
+  for (i = 0; i < n_export; i++)
+    if (bench_diff(exports[i], dll[i]) > diff) diff = bench_diff(exports[i], dll[i]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations()*n_export);
+  state.counter ("copied", io.n_copied());
+  state.counter ("max_diff", diff);
+}
+VS_BENCHMARK(bm_client_exports)->arg(0)->arg(100)->arg(400)->arg(1000);
+
+static void bm_client_step_io (vs_bench_state &state)
+{
+  std::vector<vs_real> imports, exports;
+  vs_io_scaling io;
+  int n_import, n_export;
+  vs_real t, tstep;
+
+  if (!bench_start(state, (int)state.arg(), &t, &n_import, &n_export)) return;
+  if (!bench_client(state, io, t)) return;
+  imports.assign (n_import + 1, 0.0);
+  exports.assign (n_export + 1, 0.0);
+  tstep = solver.api.vs_get_tstep();
+  while (state.keep_running())
+    {
+    io.integrate_io (t, imports.data(), exports.data());
+    t += tstep;
+    }
+  vs_bench_keep (exports[0]);
+  solver.api.vs_terminate_run (t);
+  state.set_items_processed (state.iterations());
+  state.counter ("copied", io.n_copied());
+}
+VS_BENCHMARK(bm_client_step_io)->arg(0)->arg(100)->arg(400);
+
+VS_BENCH_MAIN()
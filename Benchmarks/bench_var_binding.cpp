@@ -0,0 +1,130 @@
+/* Per-step cost of reading and writing N model variables by keyword with
+   vs_get_var_ptr(), compared with a vs_var_binding resolved once.
+
+   Needs a solver: --simfile=<simfile>. The variables are the model's import
+   keywords followed by its export names, those that vs_get_var_ptr() finds.
+   A model with fewer than N of them uses them again in turn, in whole
+   passes (N rounded up to a multiple of their number), so every case runs;
+   counter distinct is the number of different variables. A vs_var_binding
+   holds each keyword once, so it gathers and scatters once per pass.
+
+   Log:
+   Oct 18, 26. Every N runs (names reused in turn); lookups checked for NULL.
+   Oct 18, 26. Skip if the DLL lacks the functions used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"    // VS types and definitions
+#include "vs_solver.h"      // per-instance solver API
+#include "vs_var_binding.h" // cached variable pointers
+#include "vs_bench.h"       // benchmark harness
+
+static vs_solver solver;
+static std::vector<char *> names; // variable keywords in the model, found
+
+// Load the solver and read the model once. Return FALSE and skip if no model.
+static vs_bool bench_model (vs_bench_state &state)
+{
+  static int status = 1; // 1 = not loaded yet
+  const char *simfile = vs_bench_option("simfile", NULL);
+  std::vector<char *> all;
+  int n_import, n_export;
+  vs_real tstart, tstop, tstep;
+  size_t i;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (status == 1 && (status = solver.load_simfile(simfile)) == 0)
+    {
+    if (solver.api.vs_get_import_names == NULL || solver.api.vs_get_export_names == NULL)
+      status = 2;
+    else
+      {
+      solver.api.vs_read_configuration (simfile, &n_import, &n_export, &tstart,
+                                        &tstop, &tstep);
+      all.resize (n_import + n_export);
+      solver.api.vs_get_import_names (all.data());
+      solver.api.vs_get_export_names (all.data() + n_import);
+      for (i = 0; i < all.size(); i++)
+        if (solver.api.vs_get_var_ptr(all[i])) names.push_back(all[i]);
+      if (names.empty()) status = 3;
+      }
+    }
+  if (status)
+    {
+    state.skip (status == 2 ? "the DLL has no export and import name functions" :
+                status == 3 ? "the model has no variables found by keyword"
+                            : solver.error_message());
+    return FALSE;
+    }
+  state.counter ("distinct", (double)(names.size() < (size_t)state.arg() ?
+                                      names.size() : (size_t)state.arg()));
+  return TRUE;
+}
+
+// Keyword i of those used (the model's names in turn), and their number for
+// N: whole passes over the model's names.
+static char *bench_name (size_t i)
+{
+  return names[i % names.size()];
+}
+
+static size_t bench_n_used (size_t n)
+{
+  size_t d = names.size() < n ? names.size() : n;
+
+  return (n + d - 1)/d*d;
+}
+
+
+static void bm_keyword_lookup (vs_bench_state &state)
+{
+  std::vector<vs_real> values;
+  size_t i, n;
+  vs_real *p;
+
+  if (!bench_model(state)) return;
+  n = bench_n_used((size_t)state.arg());
+  values.resize (n);
+  while (state.keep_running())
+    {
+    for (i = 0; i < n; i++)
+      if ((p = solver.api.vs_get_var_ptr(bench_name(i))) != NULL) values[i] = *p;
+    for (i = 0; i < n; i++)
+      if ((p = solver.api.vs_get_var_ptr(bench_name(i))) != NULL) *p = values[i];
+    }
+  vs_bench_keep (values[0]);
+  state.set_items_processed (state.iterations()*n);
+}
+VS_BENCHMARK(bm_keyword_lookup)->arg(8)->arg(32)->arg(128);
+
+static void bm_var_binding (vs_bench_state &state)
+{
+  std::vector<vs_real> values;
+  vs_var_binding binding;
+  size_t i, pass, n;
+
+  if (!bench_model(state)) return;
+  n = bench_n_used((size_t)state.arg());
+  for (i = 0; i < n; i++) binding.add(bench_name(i));
+  binding.resolve (solver.api);
+  values.resize (n);
+  while (state.keep_running())
+    for (pass = 0; pass < n; pass += binding.size())
+      {
+      binding.gather (values.data() + pass);
+      binding.scatter (values.data() + pass);
+      }
+  vs_bench_keep (values[0]);
+  state.set_items_processed (state.iterations()*n);
+}
+VS_BENCHMARK(bm_var_binding)->arg(8)->arg(32)->arg(128);
+
+VS_BENCH_MAIN()
@@ -0,0 +1,183 @@
+/* Time to first step and run time of a sweep, cold (vs_job_run: read,
+   initialize, run) against warm (vs_warm_image: reset to the image, apply
+   the changes, run).
+
+   Needs a solver: --simfile=<simfile> (the stand-in solver by default when
+   built with CMake). The sweep changes M_TOTAL and CF, which the model uses
+   while running; runs are 2 s long (TSTOP, in a simfile written to TMPDIR).
+
+     bm_first_step/w    changes applied and one vs_integrate step;
+                        w = 0 cold, w = 1 warm
+     bm_sweep_run/w     one whole run of the sweep; the counter max_diff is
+                        the largest difference of the exports at the end
+                        between warm and cold runs with the same changes,
+                        over 8 sweep points run one after the other from
+                        one image
+
+   Log:
+   Oct 18, 26. max_diff checks runs chained from one image.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_solver.h"     // per-instance solver API
+#include "vs_jobs.h"       // vs_job_mods, vs_job_run
+#include "vs_warm_start.h" // warm-start image
+#include "vs_bench.h"      // benchmark harness
+
+static vs_solver solver;
+
+// Load the solver and write the sweep simfile. Return FALSE and skip if
+// there is no solver.
+static vs_bool bench_simfile (vs_bench_state &state, std::string &path)
+{
+  const char *simfile = vs_bench_option("simfile", NULL), *tmp = getenv("TMPDIR");
+  FILE *fp;
+
+  if (simfile == NULL)
+    {
+    state.skip ("needs --simfile");
+    return FALSE;
+    }
+  if (!solver.loaded() && solver.load_simfile(simfile))
+    {
+    state.skip (solver.error_message());
+    return FALSE;
+    }
+  path = std::string(tmp ? tmp : "/tmp") + "/vs_bench_warm.sim";
+  if ((fp = fopen(path.c_str(), "w")) == NULL)
+    {
+    state.skip ("cannot write the simfile");
+    return FALSE;
+    }
+  fprintf (fp, "SIMFILE\nDLLFILE %s\nINPUT %s\nTSTOP 2\nEND\n", solver.path(), simfile);
+  fclose (fp);
+  return TRUE;
+}
+
+// Changes of sweep point i.
+static vs_job_mods bench_mods (long long i)
+{
+  vs_job_mods mods;
+
+  mods.push_back (std::make_pair(std::string("M_TOTAL"), 1400.0 + 10.0*(i % 21)));
+  mods.push_back (std::make_pair(std::string("CF"), 70000.0 + 1000.0*(i % 17)));
+  return mods;
+}
+
+// Parameters the stand-in uses only when it initializes.
+static void bench_image_keys (vs_warm_image &image)
+{
+  static const char *keys[] = {"SPEED", "N_OSC", "WORK", "IPRINT", "ROAD_LENGTH",
+                               "ROAD_DS", "ROAD_X0", "ROAD_Y0", "ROAD_YAW0"};
+  for (size_t i = 0; i < sizeof(keys)/sizeof(keys[0]); i++) image.needs_init(keys[i]);
+}
+
+static void bm_first_step (vs_bench_state &state)
+{
+  const vs_api_table &api = solver.api;
+  vs_warm_image image(solver);
+  vs_sym_attr_type type;
+  std::string simfile;
+  vs_job_mods mods;
+  vs_real t = 0.0;
+  long long k = 0;
+  size_t i;
+
+  if (!bench_simfile(state, simfile)) return;
+  bench_image_keys (image);
+  if (state.arg() && image.open(simfile.c_str()))
+    {
+    state.skip (image.error_message());
+    return;
+    }
+  while (state.keep_running())
+    {
+    mods = bench_mods(k++);
+    if (state.arg())
+      {
+      image.reset (mods);
+      t = image.start_time();
+      api.vs_integrate (&t, NULL);
+      continue;
+      }
+    t = api.vs_setdef_and_read(simfile.c_str(), NULL, NULL);
+    for (i = 0; i < mods.size(); i++)
+      api.vs_set_sym_real (api.vs_get_var_id((char *)mods[i].first.c_str(), &type),
+                           type, mods[i].second);
+    api.vs_initialize (t, NULL, NULL);
+    api.vs_integrate (&t, NULL);
+    state.pause_timing ();
+    api.vs_terminate (t, NULL);
+    api.vs_free_all ();
+    state.resume_timing ();
+    }
+  vs_bench_keep (t);
+  state.set_items_processed (state.iterations());
+  if (state.arg()) state.counter ("symbols", image.n_symbols());
+}
+VS_BENCHMARK(bm_first_step)->arg(0)->arg(1);
+
+static void bm_sweep_run (vs_bench_state &state)
+{
+  vs_warm_image image(solver);
+  std::vector<vs_job_result> warm(8);
+  vs_job_result cold;
+  std::string simfile;
+  double diff = 0.0;
+  long long k = 0;
+  size_t i;
+  int status = 0;
+
+  if (!bench_simfile(state, simfile)) return;
+  bench_image_keys (image);
+
+  // warm and cold give the same results: the whole sweep from one image,
+  // each run after the one before, then each point cold
+  if (image.open(simfile.c_str()))
+    {
+    state.skip (image.error_message());
+    return;
+    }
+  for (k = 0; k < 8; k++) status |= image.run(bench_mods(k), NULL, &warm[k]);
+  image.close (); // vs_job_run needs the solver to itself
+  for (k = 0; k < 8; k++)
+    {
+    status |= vs_job_run(solver, simfile.c_str(), bench_mods(k), NULL, &cold);
+    for (i = 0; i < warm[k].exports.size() && i < cold.exports.size(); i++)
+      if (fabs(warm[k].exports[i] - cold.exports[i]) > diff)
+        diff = fabs(warm[k].exports[i] - cold.exports[i]);
+    if (warm[k].exports.size() != cold.exports.size() || warm[k].t_end != cold.t_end)
+      diff = HUGE_VAL;
+    }
+  if (status)
+    {
+    state.skip ("a run failed");
+    return;
+    }
+  if (state.arg() && image.open(simfile.c_str()))
+    {
+    state.skip (image.error_message());
+    return;
+    }
+
+  k = 0;
+  while (state.keep_running())
+    if (state.arg())
+      status |= image.run(bench_mods(k++), NULL, &warm[0]);
+    else
+      status |= vs_job_run(solver, simfile.c_str(), bench_mods(k++), NULL, &cold);
+  if (status) state.skip ("a run failed");
+  state.set_items_processed (state.iterations());
+  state.counter ("max_diff", diff);
+}
+VS_BENCHMARK(bm_sweep_run)->arg(0)->arg(1);
+
+VS_BENCH_MAIN()
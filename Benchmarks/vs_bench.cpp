@@ -0,0 +1,258 @@
+/* Benchmark harness for the VS API tools. See vs_bench.h.
+
+   Log:
+   Oct 18, 26. --simfile defaults to the stand-in solver when built with it.
+   Oct 18, 26. Added a fixed iteration count.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "vs_bench.h" // benchmark harness
+
+// registered benchmarks and command line options
+static std::vector<vs_bench_def *> *vss_benchmarks;
+static std::vector<std::pair<std::string, std::string> > vss_options;
+
+static double vss_now (void)
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+vs_bench_state::vs_bench_state (long long iterations,
+                                const std::vector<long long> &args)
+  : items(0), bytes(0), total(iterations), done(0), args(args), elapsed(0.0),
+    started(0.0), running(false)
+{
+}
+
+void vs_bench_state::start_timing (void)
+{
+  if (running) return;
+  started = vss_now();
+  running = true;
+}
+
+void vs_bench_state::stop_timing (void)
+{
+  if (!running) return;
+  elapsed += vss_now() - started;
+  running = false;
+}
+
+void vs_bench_state::pause_timing (void)  {stop_timing();}
+void vs_bench_state::resume_timing (void) {start_timing();}
+
+void vs_bench_state::counter (const char *name, double value)
+{
+  for (size_t i = 0; i < counters.size(); i++)
+    if (counters[i].first == name)
+      {
+      counters[i].second = value;
+      return;
+      }
+  counters.push_back (std::make_pair(std::string(name), value));
+}
+
+
+vs_bench_def *vs_bench_def::arg (long long a)
+{
+  cases.push_back (std::vector<long long>(1, a));
+  return this;
+}
+
+vs_bench_def *vs_bench_def::args (long long a, long long b)
+{
+  std::vector<long long> c;
+  c.push_back (a);
+  c.push_back (b);
+  cases.push_back (c);
+  return this;
+}
+
+vs_bench_def *vs_bench_register (const char *name, vs_bench_func func)
+{
+  if (vss_benchmarks == NULL) vss_benchmarks = new std::vector<vs_bench_def *>;
+  vss_benchmarks->push_back (new vs_bench_def(name, func));
+  return vss_benchmarks->back();
+}
+
+const char *vs_bench_option (const char *name, const char *default_value)
+{
+  for (size_t i = 0; i < vss_options.size(); i++)
+    if (vss_options[i].first == name) return vss_options[i].second.c_str();
+#ifdef VS_STANDIN_SIMFILE
+  // built with the stand-in solver: benchmarks that need a solver use it
+  if (default_value == NULL && !strcmp(name, "simfile")) return VS_STANDIN_SIMFILE;
+#endif
+  return default_value;
+}
+
+
+// Name of a case, e.g. "bm_dispatch/16".
+static std::string vss_case_name (const vs_bench_def *def,
+                                  const std::vector<long long> &args)
+{
+  std::string name = def->name;
+  char tmpstr[32];
+
+  for (size_t i = 0; i < args.size(); i++)
+    {
+    sprintf (tmpstr, "/%lld", args[i]);
+    name += tmpstr;
+    }
+  return name;
+}
+
+// Write a string as a JSON string literal.
+static void vss_json_string (FILE *fp, const std::string &s)
+{
+  fputc ('"', fp);
+  for (size_t i = 0; i < s.size(); i++)
+    {
+    if (s[i] == '"' || s[i] == '\\') fputc('\\', fp);
+    fputc (s[i], fp);
+    }
+  fputc ('"', fp);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Run one case: grow the iteration count until the run is long enough.
+---------------------------------------------------------------------------- */
+static vs_bench_state vss_run_case (const vs_bench_def *def,
+                                    const std::vector<long long> &args,
+                                    double min_time)
+{
+  long long n = def->fixed_iterations > 0 ? def->fixed_iterations : 1;
+
+  for (;;)
+    {
+    vs_bench_state state(n, args);
+    def->func (state);
+    if (!state.skipped.empty() || state.seconds() >= min_time || n >= 1000000000LL ||
+        def->fixed_iterations > 0)
+      return state;
+
+    // aim 40% past the target, at most 10x more iterations per try
+    double grow = state.seconds() > 0.0 ? 1.4*min_time/state.seconds() : 10.0;
+    if (grow > 10.0) grow = 10.0;
+    if (grow < 1.5) grow = 1.5;
+    n = (long long)(n*grow) + 1;
+    }
+}
+
+
+/* ----------------------------------------------------------------------------
+   Main program for a benchmark executable.
+---------------------------------------------------------------------------- */
+int vs_bench_main (int argc, char **argv)
+{
+  const char *filter, *json;
+  double min_time;
+  FILE *fp = NULL;
+  int i, first = 1;
+  char t_date[64];
+  time_t now = time(NULL);
+
+  for (i = 1; i < argc; i++)
+    {
+    const char *eq, *arg = argv[i];
+    if (strncmp(arg, "--", 2))
+      {
+      fprintf (stderr, "Unknown argument \"%s\". Use --name=value.\n", arg);
+      return 1;
+      }
+    arg += 2;
+    eq = strchr(arg, '=');
+    if (eq) vss_options.push_back(std::make_pair(std::string(arg, eq - arg),
+                                                 std::string(eq + 1)));
+    else    vss_options.push_back(std::make_pair(std::string(arg), std::string("1")));
+    }
+  filter = vs_bench_option("filter", "");
+  json = vs_bench_option("json", NULL);
+  min_time = atof(vs_bench_option("min_time", "0.2"));
+
+  if (json && (fp = fopen(json, "w")) == NULL)
+    {
+    fprintf (stderr, "Could not open the JSON file \"%s\".\n", json);
+    return 1;
+    }
+  strftime (t_date, sizeof(t_date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  if (fp)
+    {
+    fprintf (fp, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": ", t_date);
+    vss_json_string (fp, argv[0]);
+    fprintf (fp, ",\n    \"num_cpus\": %u\n  },\n  \"benchmarks\": [",
+             std::thread::hardware_concurrency());
+    }
+
+  printf ("%-44s %14s %14s %12s\n", "Benchmark", "Time/iter", "Iterations", "Rate");
+  printf ("%s\n", std::string(87, '-').c_str());
+  for (size_t b = 0; vss_benchmarks && b < vss_benchmarks->size(); b++)
+    {
+    const vs_bench_def *def = (*vss_benchmarks)[b];
+    std::vector<std::vector<long long> > cases = def->cases;
+    if (cases.empty()) cases.push_back(std::vector<long long>());
+
+    for (size_t c = 0; c < cases.size(); c++)
+      {
+      std::string name = vss_case_name(def, cases[c]);
+      if (*filter && name.find(filter) == std::string::npos) continue;
+
+      vs_bench_state state = vss_run_case(def, cases[c], min_time);
+      if (!state.skipped.empty())
+        {
+        printf ("%-44s skipped: %s\n", name.c_str(), state.skipped.c_str());
+        continue;
+        }
+
+      double ns = 1e9*state.seconds()/(state.iterations() ? state.iterations() : 1);
+      double items_s = state.items ? state.items/state.seconds() : 0.0;
+      double bytes_s = state.bytes ? state.bytes/state.seconds() : 0.0;
+      char rate[32] = "";
+      if (bytes_s)      sprintf(rate, "%.1f MB/s", bytes_s*1e-6);
+      else if (items_s) sprintf(rate, "%.3g/s", items_s);
+      printf ("%-44s %11.1f ns %14lld %12s", name.c_str(), ns, state.iterations(), rate);
+      for (size_t k = 0; k < state.counters.size(); k++)
+        printf (" %s=%g", state.counters[k].first.c_str(), state.counters[k].second);
+      printf ("\n");
+      fflush (stdout);
+
+      if (fp)
+        {
+        fprintf (fp, "%s\n    {\"name\": ", first ? "" : ",");
+        vss_json_string (fp, name);
+        fprintf (fp, ", \"iterations\": %lld, \"real_time\": %.6g, "
+                     "\"time_unit\": \"ns\"", state.iterations(), ns);
+        if (items_s) fprintf(fp, ", \"items_per_second\": %.6g", items_s);
+        if (bytes_s) fprintf(fp, ", \"bytes_per_second\": %.6g", bytes_s);
+        for (size_t k = 0; k < state.counters.size(); k++)
+          {
+          fprintf (fp, ", ");
+          vss_json_string (fp, state.counters[k].first);
+          fprintf (fp, ": %.6g", state.counters[k].second);
+          }
+        fprintf (fp, "}");
+        first = 0;
+        }
+      }
+    }
+
+  if (fp)
+    {
+    fprintf (fp, "\n  ]\n}\n");
+    fclose (fp);
+    }
+  return 0;
+}
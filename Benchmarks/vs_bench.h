@@ -0,0 +1,127 @@
+/* Minimal benchmark harness for the VS API tools, modeled on Google Benchmark.
+
+   A benchmark is a function that times a loop:
+
+     static void bm_something (vs_bench_state &state)
+     {
+       setup ...
+       while (state.keep_running())
+         code to time ...
+       state.set_items_processed (state.iterations());
+     }
+     VS_BENCHMARK(bm_something)->arg(1)->arg(16);
+     VS_BENCH_MAIN()
+
+   The harness picks the iteration count so that each case runs for at least
+   --min_time seconds, prints a table, and writes all results as JSON with
+   --json=<file> for regression tracking. Other --name=value options can be
+   read by benchmarks with vs_bench_option() (e.g. --simfile=...). When the
+   harness is built with VS_STANDIN_SIMFILE (see CMakeLists.txt), --simfile
+   defaults to the stand-in solver.
+
+   Log:
+   Oct 18, 26. Default simfile of the stand-in solver.
+   Oct 18, 26. Added a fixed iteration count.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_BENCH_H
+  #define _VS_BENCH_H
+
+  #include <string>
+  #include <utility>
+  #include <vector>
+
+  class vs_bench_state
+    {
+    public:
+      vs_bench_state (long long iterations, const std::vector<long long> &args);
+
+      // Return true while there are iterations left. Timing starts on the
+      // first call and stops when it returns false.
+      bool keep_running (void)
+        {
+        if (done < total)
+          {
+          if (done++ == 0) start_timing();
+          return true;
+          }
+        stop_timing ();
+        return false;
+        }
+
+      long long iterations (void) const {return total;}
+      long long arg (size_t i = 0) const {return i < args.size() ? args[i] : 0;}
+
+      // Exclude setup inside the loop from the time.
+      void pause_timing (void);
+      void resume_timing (void);
+
+      void set_items_processed (long long n) {items = n;}
+      void set_bytes_processed (long long n) {bytes = n;}
+      void counter (const char *name, double value);
+      void skip (const char *why) {skipped = why; total = 0;}
+
+      // results, used by the harness
+      double seconds (void) const {return elapsed;}
+      long long items, bytes;
+      std::string skipped;
+      std::vector<std::pair<std::string, double> > counters;
+
+    private:
+      void start_timing (void);
+      void stop_timing (void);
+
+      long long total, done;
+      std::vector<long long> args;
+      double elapsed, started;
+      bool running;
+    };
+
+  typedef void (*vs_bench_func) (vs_bench_state &state);
+
+  // A registered benchmark; each arg() call adds a case.
+  class vs_bench_def
+    {
+    public:
+      vs_bench_def (const char *name, vs_bench_func func)
+        : name(name), func(func), fixed_iterations(0) {}
+      vs_bench_def *arg (long long a);
+      vs_bench_def *args (long long a, long long b);
+
+      // Run exactly n iterations, for cases with costly untimed setup.
+      vs_bench_def *iterations (long long n) {fixed_iterations = n; return this;}
+
+      std::string name;
+      vs_bench_func func;
+      long long fixed_iterations;
+      std::vector<std::vector<long long> > cases;
+    };
+
+  vs_bench_def *vs_bench_register (const char *name, vs_bench_func func);
+
+  // Value of a --name=value option, or default_value if not given.
+  const char *vs_bench_option (const char *name, const char *default_value);
+
+  // Keep the compiler from optimizing away a result.
+  template <class T> inline void vs_bench_keep (T const &value)
+    {
+  #if defined(__GNUC__) || defined(__clang__)
+    asm volatile ("" : : "r,m"(value) : "memory");
+  #else
+    static volatile const T *sink;
+    sink = &value;
+  #endif
+    }
+
+  int vs_bench_main (int argc, char **argv);
+
+  #define VSS_BENCH_CAT2(a, b) a##b
+  #define VSS_BENCH_CAT(a, b)  VSS_BENCH_CAT2(a, b)
+  #define VS_BENCHMARK(func) \
+    static vs_bench_def *VSS_BENCH_CAT(vss_bench_, __LINE__) = \
+      vs_bench_register(#func, func)
+  #define VS_BENCH_MAIN() \
+    int main (int argc, char **argv) {return vs_bench_main(argc, argv);}
+
+#endif  // end block for _VS_BENCH_H
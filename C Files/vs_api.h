@@ -2,6 +2,8 @@
    reference manual.
 
   Log:
+  Oct 18, 26. The *_function2 install functions may be NULL (older DLLs).
+  Oct 18, 26. Scan function for vs_install_scan_function2 returns vs_bool.
   Mar 16, 11. M. Sayers. added traffic, sensor, and table functions.
   May 04, 10. M. Sayers. updated to include more new functions and add __cdecl cast.
   May 20, 09. M. Sayers. updated to include vs_run and new functions for CarSim 8.0.
@@ -62,10 +64,11 @@ void     (__cdecl *vs_install_echo_function) (void (*echo) (vs_ext_loc where));
 void     (__cdecl *vs_install_setdef_function) (void (*setdef) (void));
 void     (__cdecl *vs_install_scan_function) (vs_bool (*scan) (char *, char *));
 void     (__cdecl *vs_install_free_function) (void (*free) (void));
+// with user data; vs_get_api leaves these NULL if the DLL predates them
 void     (__cdecl *vs_install_calc_function2) (void (*calc) (vs_real time, vs_ext_loc where, void* userData), void* userData);
 void     (__cdecl *vs_install_echo_function2) (void (*echo) (vs_ext_loc where, void* userData), void* userData);
 void     (__cdecl *vs_install_setdef_function2) (void (*setdef) (void* userData), void* userData);
-void     (__cdecl *vs_install_scan_function2) (void (*scan) (char *, char *, void* userData), void* userData);
+void     (__cdecl *vs_install_scan_function2) (vs_bool (*scan) (char *, char *, void* userData), void* userData);
 void     (__cdecl *vs_install_free_function2) (void (*func) (void* userData), void* userData);
 
 // more detailed control of run (chapter 6)
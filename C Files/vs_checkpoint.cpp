@@ -0,0 +1,247 @@
+/* Compressed store of model state snapshots. See vs_checkpoint.h.
+
+   Coded words are written and read 8 bytes at a time and then masked, which
+   assumes a little-endian host (x86, ARM). The data array keeps 8 bytes of
+   slack after the last snapshot for those reads.
+
+   Log:
+   Oct 18, 26. The checkpointer starts the save timer.
+   Oct 18, 26. Anchors: a restore decodes at most the anchor interval.
+   Oct 18, 26. No checkpoints, and an error, if the DLL cannot copy the state.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_checkpoint.h"   // checkpoint store
+
+// Number of low bytes needed to hold w (0 for w = 0).
+static inline unsigned vss_n_bytes (uint64_t w)
+{
+  if (w == 0) return 0;
+#ifdef _MSC_VER
+  unsigned long bit;
+  _BitScanReverse64 (&bit, w);
+  return (unsigned)bit/8 + 1;
+#else
+  return (unsigned)(71 - __builtin_clzll(w))/8;
+#endif
+}
+
+
+vs_checkpoint_store::vs_checkpoint_store (int n_state, int keyframe_interval,
+                                          int anchor_interval)
+  : n(0), key_every(keyframe_interval > 0 ? keyframe_interval : 1), even(TRUE)
+{
+  anchor_every = anchor_interval > 0 && anchor_interval < key_every ? anchor_interval
+                                                                    : key_every;
+  reset (n_state);
+}
+
+void vs_checkpoint_store::reset (int n_state)
+{
+  n = n_state;
+  data.assign (8, 0);
+  start.clear ();
+  times.clear ();
+  last.assign (n, 0);
+  before.assign (n, 0);
+  key.assign (n, 0);
+  words.assign (2*n, 0);
+  even = TRUE;
+}
+
+size_t vs_checkpoint_store::bytes (void) const
+{
+  return data.size() + start.size()*sizeof(size_t) + times.size()*sizeof(vs_real);
+}
+
+
+// Linear extrapolation from the two snapshots before, as bits.
+static inline uint64_t vss_predict (uint64_t x1, uint64_t x0)
+{
+  vs_real a, b;
+  uint64_t p;
+
+  memcpy (&a, &x1, 8);
+  memcpy (&b, &x0, 8);
+  a = 2.0*a - b;
+  memcpy (&p, &a, 8);
+  return p;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Add a snapshot: a control byte for every two words, then the low nonzero
+   bytes of each word XORed with a reference. The 4-bit code of a word is
+     0 - 8   number of bytes, XORed with the previous snapshot (0 for a
+             keyframe, the keyframe for an anchor)
+     9 - 15  number of bytes + 9, XORed with the linear extrapolation of the
+             two previous snapshots (not for the first two after a keyframe
+             or an anchor)
+---------------------------------------------------------------------------- */
+void vs_checkpoint_store::append (vs_real t, const vs_real *state)
+{
+  size_t at = data.size() - 8, n_ctl = (n + 1)/2;
+  int since_key = (int)(times.size() % key_every), since_anchor = since_key % anchor_every;
+  unsigned char *ctl, *p;
+  uint64_t bits, w, wp;
+  unsigned nb, nbp, code;
+  int i;
+
+  // even spacing holds while each time is at the expected multiple of dt
+  if (times.size() >= 2 && even)
+    {
+    vs_real dt = times[1] - times[0];
+    even = fabs(t - times[0] - dt*times.size()) <= 1e-6*dt;
+    }
+  times.push_back (t);
+  start.push_back (at);
+
+  data.resize (at + n_ctl + 8*n + 8);
+  ctl = &data[at];
+  p = ctl + n_ctl;
+  memset (ctl, 0, n_ctl);
+  for (i = 0; i < n; i++)
+    {
+    memcpy (&bits, &state[i], 8);
+    if (since_key == 0) key[i] = bits;
+    w = since_key == 0 ? bits : since_anchor == 0 ? bits ^ key[i] : bits ^ last[i];
+    code = nb = vss_n_bytes(w);
+    if (since_anchor >= 2 && nb > 0 &&
+        (nbp = vss_n_bytes(wp = bits ^ vss_predict(last[i], before[i]))) < nb &&
+        nbp < 7)
+      {
+      w = wp;
+      nb = nbp;
+      code = nbp + 9;
+      }
+    before[i] = last[i];
+    last[i] = bits;
+    ctl[i >> 1] |= (unsigned char)(code << ((i & 1)*4));
+    memcpy (p, &w, 8);
+    p += nb;
+    }
+  data.resize (p - &data[0] + 8);
+}
+
+// Decode one snapshot over the previous one in w; w0 has the one before.
+void vs_checkpoint_store::decode (size_t at, uint64_t *w, uint64_t *w0) const
+{
+  const unsigned char *ctl = &data[at], *p = ctl + (n + 1)/2;
+  uint64_t x, ref;
+  unsigned code, nb;
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+    code = (ctl[i >> 1] >> ((i & 1)*4)) & 0xf;
+    nb = code > 8 ? code - 9 : code;
+    ref = code > 8 ? vss_predict(w[i], w0[i]) : w[i];
+    memcpy (&x, p, 8);
+    w0[i] = w[i];
+    w[i] = ref ^ (nb == 8 ? x : x & ((1ULL << (8*nb)) - 1));
+    p += nb;
+    }
+}
+
+
+/* ----------------------------------------------------------------------------
+   Index of the last snapshot at or before t, or -1.
+---------------------------------------------------------------------------- */
+int vs_checkpoint_store::find (vs_real t) const
+{
+  int n_snap = size(), i;
+  vs_real dt, tol;
+
+  if (n_snap == 0) return -1;
+  if (even && n_snap > 1)
+    {
+    dt = (times[n_snap - 1] - times[0])/(n_snap - 1);
+    tol = 1e-6*dt;
+    if (t < times[0] - tol) return -1;
+    i = (int)floor((t - times[0] + tol)/dt);
+    i = i < n_snap ? i : n_snap - 1;
+    }
+  else
+    {
+    tol = 1e-12*(fabs(t) + 1.0);
+    i = (int)(std::upper_bound(times.begin(), times.end(), t + tol) - times.begin()) - 1;
+    }
+  return i;
+}
+
+// Decode the keyframe, then the anchor (over the keyframe), then the
+// snapshots after the anchor up to i.
+int vs_checkpoint_store::restore (vs_real t, vs_real *state, vs_real *t_saved)
+{
+  int i = find(t), k, key_i, anchor_i;
+
+  if (i < 0) return -1;
+  key_i = i - i % key_every;
+  anchor_i = i - (i - key_i) % anchor_every;
+  memset (words.data(), 0, 2*n*sizeof(uint64_t));
+  decode (start[key_i], &words[0], &words[n]);
+  for (k = anchor_i > key_i ? anchor_i : key_i + 1; k <= i; k++)
+    decode (start[k], &words[0], &words[n]);
+  memcpy (state, words.data(), n*sizeof(vs_real));
+  if (t_saved) *t_saved = times[i];
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Subsystem that saves the model state when the solver does. It starts the
+   save timer at VS_EXT_EQ_INIT so that the solver calls VS_EXT_EQ_SAVE.
+---------------------------------------------------------------------------- */
+vs_checkpointer::vs_checkpointer (int keyframe_interval, int anchor_interval)
+  : snapshots(0, keyframe_interval, anchor_interval)
+{
+}
+
+void vs_checkpointer::calc (vs_real t, vs_ext_loc where)
+{
+  if (where == VS_EXT_EQ_INIT)
+    {
+    state.clear ();
+    if (api->vs_n_derivatives == NULL || api->vs_n_extra_state_variables == NULL ||
+        api->vs_copy_all_state_vars_to_array == NULL ||
+        api->vs_copy_all_state_vars_from_array == NULL)
+      {
+      api->vs_printf_error ("%s\n", vs_api_missing("vs_copy_all_state_vars_to_array").c_str());
+      return;
+      }
+    if (api->vs_start_save_timer == NULL)
+      {
+      api->vs_printf_error ("%s\n", vs_api_missing("vs_start_save_timer").c_str());
+      return;
+      }
+    api->vs_start_save_timer (t);
+    snapshots.reset (api->vs_n_derivatives() + api->vs_n_extra_state_variables());
+    state.assign (snapshots.n_state(), 0.0);
+    }
+  else if (where == VS_EXT_EQ_SAVE && !state.empty())
+    {
+    api->vs_copy_all_state_vars_to_array (state.data());
+    snapshots.append (t, state.data());
+    }
+}
+
+vs_real vs_checkpointer::restore (vs_real t)
+{
+  vs_real t_saved;
+
+  if (state.empty() || snapshots.restore(t, state.data(), &t_saved)) return -1.0;
+  api->vs_copy_all_state_vars_from_array (state.data());
+  return t_saved;
+}
@@ -0,0 +1,105 @@
+/* Compressed store of model state snapshots, for restarts at any saved time.
+
+   With vs_start_save_timer the solver saves its state at a fixed period, and
+   vs_restore_state / vs_get_saved_state_time go back to one. Keeping full
+   state arrays (vs_n_derivatives() + vs_n_extra_state_variables() values)
+   at a high rate over a long run takes a lot of memory. A vs_checkpoint_store
+   keeps the snapshots compressed instead:
+     - each value is XORed, bit for bit, with its value in the snapshot
+       before, or with the linear extrapolation of the two before if that is
+       closer, so values that did not change become 0 and values that changed
+       a little keep their sign, exponent and high mantissa bytes as zeros;
+     - each 64-bit word is then written as its low nonzero bytes only, with
+       the byte count in a 4-bit code (two codes per control byte);
+     - every K-th snapshot is a keyframe, coded against zeros;
+     - within the K, every A-th snapshot is an anchor, coded against the
+       keyframe only (no extrapolation), so a restore decodes the keyframe,
+       the anchor and at most A - 1 snapshots after it, whatever K is. A
+       larger K saves memory (fewer keyframes); A sets the restore time.
+       A = 0 (or A >= K): no anchors, a restore decodes up to K snapshots.
+   A restore finds the snapshot by time in O(1) when the snapshots are evenly
+   spaced (the usual case with the save timer), and by binary search if not.
+   Restored values are bit-exact.
+
+   A vs_checkpointer is a subsystem (see vs_ext_dispatch.h) that starts the
+   save timer at VS_EXT_EQ_INIT, fills a store at VS_EXT_EQ_SAVE with
+   vs_copy_all_state_vars_to_array, and puts a saved state back in the model
+   with vs_copy_all_state_vars_from_array. The save period is the solver's
+   (SAVE_DT in the stand-in).
+
+   Log:
+   Oct 18, 26. The checkpointer starts the save timer.
+   Oct 18, 26. Anchors coded against the keyframe bound the restore time.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_CHECKPOINT_H
+  #define _VS_CHECKPOINT_H
+
+  #include <stddef.h>
+  #include <stdint.h>
+  #include <vector>
+
+  #include "vs_deftypes.h"     // VS types and definitions
+  #include "vs_ext_dispatch.h" // external code dispatcher
+
+  class vs_checkpoint_store
+    {
+    public:
+      vs_checkpoint_store (int n_state = 0, int keyframe_interval = 32,
+                           int anchor_interval = 8);
+
+      // Forget all snapshots and set the size of a state array.
+      void reset (int n_state);
+
+      // Add a snapshot. Times must increase.
+      void append (vs_real t, const vs_real *state);
+
+      // Get the last snapshot at or before t. Return 0 if OK, -1 if there is
+      // none. t_saved (may be NULL) gets its time.
+      int restore (vs_real t, vs_real *state, vs_real *t_saved);
+
+      int     size (void) const {return (int)times.size();}
+      int     n_state (void) const {return n;}
+      vs_real time (int i) const {return times[i];}
+
+      size_t bytes (void) const;    // memory used by the snapshots
+      size_t raw_bytes (void) const // memory for full arrays
+        {return times.size()*n*sizeof(vs_real);}
+
+    private:
+      int  find (vs_real t) const;
+      void decode (size_t at, uint64_t *w, uint64_t *w0) const;
+
+      int n, key_every, anchor_every;
+      std::vector<unsigned char> data; // coded snapshots, one after the other
+      std::vector<size_t> start;       // offset of each snapshot in data
+      std::vector<vs_real> times;
+      std::vector<uint64_t> last;      // bits of the last snapshot
+      std::vector<uint64_t> before;    // and of the one before
+      std::vector<uint64_t> key;       // and of the last keyframe
+      std::vector<uint64_t> words;     // scratch for restore, 2 x n
+      vs_bool even;                    // snapshots evenly spaced in time
+    };
+
+  class vs_checkpointer : public vs_ext_subsystem
+    {
+    public:
+      vs_checkpointer (int keyframe_interval = 32, int anchor_interval = 8);
+
+      unsigned calc_mask (void) const
+        {return VS_EXT_MASK(VS_EXT_EQ_INIT) | VS_EXT_MASK(VS_EXT_EQ_SAVE);}
+      void calc (vs_real t, vs_ext_loc where);
+
+      // Put the state saved at or before t back in the model. Return the time
+      // of that state, or -1 if none.
+      vs_real restore (vs_real t);
+
+      vs_checkpoint_store &store (void) {return snapshots;}
+
+    private:
+      vs_checkpoint_store snapshots;
+      std::vector<vs_real> state;
+    };
+
+#endif  // end block for _VS_CHECKPOINT_H
@@ -0,0 +1,366 @@
+/* Buffered, asynchronous output for runs. See vs_echo_sink.h.
+
+   Log:
+   Oct 18, 26. A move replaces the destination only with a complete file.
+   Oct 18, 26. Relative paths of the staged simfile are taken from the
+               original's directory; keywords in any case. vs_run_log
+               removed.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+  #include <windows.h>
+  #include <direct.h>
+#else
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_echo_sink.h" // buffered run output
+
+// Copy a file, for moves between file systems. Return 0 if OK.
+static int vss_copy_file (const char *from, const char *to)
+{
+  FILE *in, *out;
+  char buffer[65536];
+  size_t n;
+  int    err = 0;
+
+  if ((in = fopen(from, "rb")) == NULL) return -1;
+  if ((out = fopen(to, "wb")) == NULL)
+    {
+    fclose (in);
+    return -1;
+    }
+  while (!err && (n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    err = fwrite(buffer, 1, n, out) != n;
+  if (ferror(in)) err = 1;
+  fclose (in);
+  if (fclose(out)) err = 1;
+  return err ? -1 : 0;
+}
+
+// Rename from to to, replacing to. Windows rename does not replace a file,
+// so to is removed first there. Return 0 if OK, nonzero if not.
+static int vss_replace (const char *from, const char *to)
+{
+#ifdef _WIN32
+  ::remove (to);
+#endif
+  return rename(from, to);
+}
+
+
+vs_async_writer::vs_async_writer (size_t max_queued_bytes)
+  : queued(0), max_queued(max_queued_bytes), stopping(false), busy(false),
+    written(0), errors(0)
+{
+  thread = std::thread(&vs_async_writer::work, this);
+}
+
+vs_async_writer::~vs_async_writer ()
+{
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  stopping = true;
+  }
+  more.notify_all ();
+  thread.join ();
+}
+
+
+/* ----------------------------------------------------------------------------
+   Queue work for the I/O thread.
+---------------------------------------------------------------------------- */
+void vs_async_writer::queue (op &o)
+{
+  std::unique_lock<std::mutex> guard(lock);
+
+  // back pressure: wait while too much is queued
+  while (queued > max_queued && !ops.empty()) less.wait(guard);
+  queued += o.data.size();
+  ops.push_back (op());
+  std::swap (ops.back(), o);
+  guard.unlock ();
+  more.notify_one ();
+}
+
+void vs_async_writer::write (const std::string &path, std::string &data, vs_bool append)
+{
+  op o;
+
+  o.kind = append ? OP_APPEND : OP_WRITE;
+  o.path = path;
+  o.data.swap (data);
+  queue (o);
+}
+
+void vs_async_writer::move (const std::string &from, const std::string &to)
+{
+  op o;
+
+  o.kind = OP_MOVE;
+  o.path = from;
+  o.to = to;
+  queue (o);
+}
+
+void vs_async_writer::remove (const std::string &path)
+{
+  op o;
+
+  o.kind = OP_REMOVE;
+  o.path = path;
+  queue (o);
+}
+
+void vs_async_writer::flush (void)
+{
+  std::unique_lock<std::mutex> guard(lock);
+  while (!ops.empty() || busy) less.wait(guard);
+}
+
+long long vs_async_writer::bytes_written (void)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return written;
+}
+
+int vs_async_writer::n_errors (void)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return errors;
+}
+
+std::string vs_async_writer::last_error (void)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return error;
+}
+
+
+/* ----------------------------------------------------------------------------
+   I/O thread.
+---------------------------------------------------------------------------- */
+void vs_async_writer::work (void)
+{
+  op o;
+
+  for (;;)
+    {
+      {
+      std::unique_lock<std::mutex> guard(lock);
+      while (!stopping && ops.empty()) more.wait(guard);
+      if (ops.empty()) return; // stopping, and all done
+      std::swap (o, ops.front());
+      ops.pop_front ();
+      busy = true;
+      }
+    run (o);
+      {
+      std::lock_guard<std::mutex> guard(lock);
+      queued -= o.data.size();
+      busy = false;
+      }
+    less.notify_all ();
+    }
+}
+
+void vs_async_writer::run (op &o)
+{
+  FILE *fp;
+  int err = 0;
+  std::string msg, tmp;
+
+  switch (o.kind)
+    {
+    case OP_WRITE:
+    case OP_APPEND:
+      if ((fp = fopen(o.path.c_str(), o.kind == OP_APPEND ? "ab" : "wb")) == NULL)
+        err = 1;
+      else
+        {
+        err = fwrite(o.data.data(), 1, o.data.size(), fp) != o.data.size();
+        if (fclose(fp)) err = 1;
+        }
+      if (err) msg = "Could not write the file \"" + o.path + "\".";
+      break;
+
+    case OP_MOVE: // to is only replaced by a complete file
+      if (vss_replace(o.path.c_str(), o.to.c_str()))
+        { // another file system: copy next to to, then rename over it
+        tmp = o.to + ".tmp";
+        err = vss_copy_file(o.path.c_str(), tmp.c_str()) ||
+              vss_replace(tmp.c_str(), o.to.c_str());
+        if (err) ::remove(tmp.c_str());
+        else ::remove(o.path.c_str());
+        }
+      if (err) msg = "Could not move \"" + o.path + "\" to \"" + o.to + "\".";
+      break;
+
+    case OP_REMOVE:
+#ifdef _WIN32
+      if (::remove(o.path.c_str())) _rmdir(o.path.c_str());
+#else
+      ::remove (o.path.c_str()); // also removes an empty directory
+#endif
+      break;
+    }
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (err)
+    {
+    errors++;
+    error = msg;
+    }
+  else if (o.kind == OP_WRITE || o.kind == OP_APPEND)
+    written += (long long)o.data.size();
+}
+
+
+/* ----------------------------------------------------------------------------
+   Output files of the solver, written to a local directory during the run.
+---------------------------------------------------------------------------- */
+static std::string vss_stage_dir (void)
+{
+  static std::atomic<int> count(0);
+  char tmpstr[FILENAME_MAX];
+
+#ifdef _WIN32
+  char dir[FILENAME_MAX];
+  GetTempPathA (FILENAME_MAX, dir);
+  sprintf (tmpstr, "%svs_stage_%lu_%d\\", dir, GetCurrentProcessId(), ++count);
+  _mkdir (tmpstr);
+#else
+  sprintf (tmpstr, "/tmp/vs_stage_%ld_%d/", (long)getpid(), ++count);
+  mkdir (tmpstr, 0777);
+#endif
+  return tmpstr;
+}
+
+static vs_bool vss_absolute (const std::string &path)
+{
+  return !path.empty() && (path[0] == '/' || path[0] == '\\' ||
+                           (path.size() > 1 && isalpha((unsigned char)path[0]) &&
+                            path[1] == ':'));
+}
+
+// Keywords of the simfile that name a file or directory, and whether the
+// file is an output that is staged.
+static vs_bool vss_path_keyword (const char *key, vs_bool *output)
+{
+  static const char *inputs[] = {"INPUT", "PARSFILE", "ERDFILE", "DATADIR", NULL};
+  static const char *outputs[] = {"ECHO", "FINAL", "LOGFILE", NULL};
+  int i;
+
+  for (i = 0; outputs[i]; i++)
+    if (!strcmp(key, outputs[i])) return *output = TRUE;
+  *output = FALSE;
+  for (i = 0; inputs[i]; i++)
+    if (!strcmp(key, inputs[i])) return TRUE;
+  return FALSE;
+}
+
+vs_output_stage::vs_output_stage (vs_async_writer *async_writer, vs_echo_mode echo_mode,
+                                  int sample_every)
+  : writer(async_writer), mode(echo_mode), every(sample_every > 0 ? sample_every : 1),
+    keep(TRUE)
+{
+}
+
+int vs_output_stage::prepare (const char *simfile, long long run_number,
+                              std::string &staged)
+{
+  FILE *in, *out;
+  char tmpstr[FILENAME_MAX + 32], line[FILENAME_MAX + 32], *key, *rest, *p;
+  std::string name, local, base = simfile;
+  size_t slash;
+  vs_bool output;
+  int err = 0;
+
+  finish (FALSE);
+  staged = simfile;
+  keep = mode == VS_ECHO_ALL || (mode == VS_ECHO_SAMPLE && run_number % every == 0);
+  if ((in = fopen(simfile, "r")) == NULL) return -1;
+  slash = base.find_last_of("/\\");
+  base = slash == std::string::npos ? "" : base.substr(0, slash + 1);
+  dir = vss_stage_dir();
+  staged_simfile = dir + "staged.sim";
+  if ((out = fopen(staged_simfile.c_str(), "w")) == NULL)
+    {
+    fclose (in);
+    writer->remove (dir);
+    dir.clear ();
+    staged_simfile.clear ();
+    return -1;
+    }
+
+  // Names of files are made absolute: the staged copy is in another
+  // directory. Relative ones are taken from the simfile's directory.
+  while (fgets(line, sizeof(line), in))
+    {
+    strcpy (tmpstr, line);
+    key = strtok(tmpstr, " \t\r\n");
+    rest = strtok(NULL, "\r\n");
+    if (key) for (p = key; *p; p++) *p = (char)toupper((unsigned char)*p);
+    if (rest)
+      {
+      while (isspace((unsigned char)*rest)) rest++;
+      for (p = rest + strlen(rest); p > rest && isspace((unsigned char)p[-1]); p--) ;
+      *p = 0;
+      }
+    if (key && rest && *rest && vss_path_keyword(key, &output))
+      {
+      name = rest;
+      if (!vss_absolute(name)) name = base + name;
+      if (output)
+        {
+        slash = name.find_last_of("/\\");
+        local = dir + key + "_" + name.substr(slash == std::string::npos ? 0 : slash + 1);
+        files.push_back (std::make_pair(local, name));
+        }
+      if (fprintf(out, "%s %s\n", key, output ? local.c_str() : name.c_str()) < 0)
+        err = 1;
+      }
+    else if (fputs(line, out) < 0)
+      err = 1;
+    }
+  fclose (in);
+  if (fclose(out)) err = 1;
+  if (err)
+    {
+    finish (TRUE);
+    return -1;
+    }
+  staged = staged_simfile;
+  return 0;
+}
+
+void vs_output_stage::finish (vs_bool failed)
+{
+  size_t i;
+
+  if (dir.empty()) return;
+  for (i = 0; i < files.size(); i++)
+    {
+    if (keep || failed) writer->move(files[i].first, files[i].second);
+    else writer->remove(files[i].first);
+    }
+  writer->remove (staged_simfile);
+  writer->remove (dir);
+  files.clear ();
+  dir.clear ();
+  staged_simfile.clear ();
+}
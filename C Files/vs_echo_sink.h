@@ -0,0 +1,121 @@
+/* Buffered, asynchronous output for runs: echo, log and end parsfiles.
+
+   Each run writes the ECHO, FINAL and LOGFILE files named in its simfile.
+   In batch sweeps this is thousands of small synchronous writes per run on
+   shared storage.
+
+   vs_async_writer
+     A background I/O thread. Callers hand it whole buffers to write, and
+     files to move or remove; they never wait for the disk unless the queue
+     holds more than a set number of bytes.
+
+   vs_output_stage
+     The solver writes its own files inside the DLL. A stage makes a copy of
+     the simfile whose ECHO, FINAL and LOGFILE point to a local temporary
+     directory. After the run the writer moves the files to the places named
+     in the original simfile, or removes them. The copy is in another
+     directory, so the other file names of the simfile (INPUT, PARSFILE,
+     ERDFILE, DATADIR) are made absolute; relative names, of these and of
+     the staged outputs, are taken from the original simfile's directory.
+     Keywords are matched in any case. Batch modes:
+       VS_ECHO_ALL     keep the files of every run
+       VS_ECHO_SAMPLE  keep them for one run in sample_every (and failed runs)
+       VS_ECHO_NONE    keep them for failed runs only
+     Results (ERDFILE) are not staged.
+
+   A vs_job_pool stages its runs with vs_job_pool::set_output_stage.
+
+   Log:
+   Oct 18, 26. A failed move leaves the destination as it was.
+   Oct 18, 26. Relative names of a staged simfile; vs_run_log removed.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_ECHO_SINK_H
+  #define _VS_ECHO_SINK_H
+
+  #include <condition_variable>
+  #include <deque>
+  #include <mutex>
+  #include <string>
+  #include <thread>
+  #include <utility>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  typedef enum
+    {
+    VS_ECHO_ALL, VS_ECHO_SAMPLE, VS_ECHO_NONE
+    } vs_echo_mode;
+
+  class vs_async_writer
+    {
+    public:
+      // max_queued: bytes waiting to be written before write() blocks
+      vs_async_writer (size_t max_queued = 64 << 20);
+      ~vs_async_writer (); // finishes all queued work
+
+      // Write (or append) a buffer to a file. The buffer is taken: data is
+      // left empty.
+      void write (const std::string &path, std::string &data, vs_bool append = FALSE);
+
+      // Move a file, replacing to; if the move fails, to is left as it was.
+      void move (const std::string &from, const std::string &to);
+      void remove (const std::string &path);
+
+      // Wait until all queued work is done.
+      void flush (void);
+
+      long long   bytes_written (void);
+      int         n_errors (void);
+      std::string last_error (void);
+
+    private:
+      enum op_kind {OP_WRITE, OP_APPEND, OP_MOVE, OP_REMOVE};
+      struct op
+        {
+        op_kind kind;
+        std::string path, to, data;
+        };
+
+      void queue (op &o);
+      void work (void);
+      void run (op &o);
+
+      std::thread thread;
+      std::mutex lock;
+      std::condition_variable more, less;
+      std::deque<op> ops;
+      size_t queued, max_queued;
+      bool stopping, busy;
+      long long written;
+      int errors;
+      std::string error;
+    };
+
+  class vs_output_stage
+    {
+    public:
+      vs_output_stage (vs_async_writer *writer, vs_echo_mode mode = VS_ECHO_ALL,
+                       int sample_every = 10);
+      ~vs_output_stage () {finish(FALSE);}
+
+      // Write a copy of simfile with its output files in a local directory.
+      // run_number chooses the sampled runs. Return 0 if OK, -1 if not (then
+      // staged is the original simfile).
+      int prepare (const char *simfile, long long run_number, std::string &staged);
+
+      // After the run: move or remove the staged files.
+      void finish (vs_bool failed);
+
+    private:
+      vs_async_writer *writer;
+      vs_echo_mode mode;
+      int every;
+      vs_bool keep;
+      std::string dir, staged_simfile;
+      std::vector<std::pair<std::string, std::string> > files; // staged, final
+    };
+
+#endif  // end block for _VS_ECHO_SINK_H
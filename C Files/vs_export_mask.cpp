@@ -0,0 +1,169 @@
+/* Selected export channels. See vs_export_mask.h.
+
+   Log:
+   Oct 18, 26. Gains measured by vs_measure_export_gains.
+   Oct 18, 26. Check the optional API functions that are used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_export_mask.h"  // selected export channels
+
+static vs_bool vss_same (const char *a, const char *b)
+{
+  for (; *a && *b; a++, b++)
+    if (toupper((unsigned char)*a) != toupper((unsigned char)*b)) return FALSE;
+  return *a == *b;
+}
+
+vs_export_mask::vs_export_mask () : solver_api(NULL)
+{
+}
+
+/* ----------------------------------------------------------------------------
+   Declare a channel. A name that was already declared keeps its slot.
+---------------------------------------------------------------------------- */
+int vs_export_mask::add (const char *name)
+{
+  for (size_t i = 0; i < names.size(); i++)
+    if (vss_same(names[i].c_str(), name)) return (int)i;
+  names.push_back (name);
+  ptrs.clear (); // must resolve again
+  return (int)names.size() - 1;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Gains of export channels: exports with every variable at 1, then at 2.
+   Variables shared by two channels are set twice to the same value, which
+   is harmless.
+---------------------------------------------------------------------------- */
+void vs_measure_export_gains (const vs_api_table &api, vs_real *const *ptrs,
+                              const int *index, size_t n, vs_real *gains)
+{
+  std::vector<vs_real> one, two, all, saved(n + 1);
+  int n_export = api.vs_get_export_names(NULL);
+  size_t i;
+
+  all.assign ((n_export > 0 ? n_export : 0) + 1, 0.0);
+  for (i = 0; i < n; i++) if (ptrs[i] && index[i] >= 0) saved[i] = *ptrs[i];
+  for (i = 0; i < n; i++) if (ptrs[i] && index[i] >= 0) *ptrs[i] = 1.0;
+  api.vs_copy_export_vars (all.data());
+  one = all;
+  for (i = 0; i < n; i++) if (ptrs[i] && index[i] >= 0) *ptrs[i] = 2.0;
+  api.vs_copy_export_vars (all.data());
+  two = all;
+  for (i = 0; i < n; i++) if (ptrs[i] && index[i] >= 0) *ptrs[i] = saved[i];
+
+  for (i = 0; i < n; i++)
+    {
+    gains[i] = 0.0;
+    if (ptrs[i] == NULL || index[i] < 0) continue;
+    if (one[index[i]] != 0.0 &&
+        fabs(two[index[i]] - 2.0*one[index[i]]) <= 1e-12*fabs(one[index[i]]))
+      gains[i] = one[index[i]];
+    }
+}
+
+
+/* ----------------------------------------------------------------------------
+   Find each channel among the exports, get its variable and measure its
+   gain. Return the number of names that are not exports, -1 if the DLL has
+   no vs_get_export_names or vs_copy_export_vars.
+---------------------------------------------------------------------------- */
+int vs_export_mask::resolve (const vs_api_table &api)
+{
+  std::vector<char *> export_names;
+  int n_export, n_missing = 0, j;
+  size_t i, n = names.size();
+
+  ptrs.clear ();
+  if (api.vs_get_export_names == NULL || api.vs_copy_export_vars == NULL)
+    return -1;
+  solver_api = &api;
+  n_export = api.vs_get_export_names(NULL);
+  if (n_export < 0) n_export = 0;
+  export_names.assign (n_export + 1, (char *)NULL);
+  if (n_export) api.vs_get_export_names(export_names.data());
+  all.assign (n_export + 1, 0.0);
+  zero.assign (n, 0.0);
+  index.assign (n, -1);
+  ptrs.assign (n, (vs_real *)NULL);
+  gains.assign (n, 1.0);
+  copied.clear ();
+
+  for (i = 0; i < n; i++)
+    {
+    for (j = 0; j < n_export; j++)
+      if (export_names[j] && vss_same(export_names[j], names[i].c_str())) break;
+    if (j == n_export)
+      {
+      ptrs[i] = &zero[i];
+      n_missing++;
+      continue;
+      }
+    index[i] = j;
+    ptrs[i] = api.vs_get_var_ptr((char *)names[i].c_str());
+    }
+
+  vs_measure_export_gains (api, ptrs.data(), index.data(), n, gains.data());
+  for (i = 0; i < n; i++)
+    {
+    if (index[i] < 0)
+      gains[i] = 1.0; // not an export: the slot gives zero[i]
+    else if (gains[i] == 0.0)
+      {
+      ptrs[i] = &zero[i]; // gather_copied writes the slot
+      copied.push_back ((int)i);
+      }
+    }
+  return n_missing;
+}
+
+void vs_export_mask::gather_copied (vs_real *values)
+{
+  solver_api->vs_copy_export_vars (all.data());
+  for (size_t k = 0; k < copied.size(); k++) values[copied[k]] = all[index[copied[k]]];
+}
+
+int vs_export_mask::integrate_io (vs_real t, vs_real *imports, vs_real *values)
+{
+  int status;
+
+  if (imports && solver_api->vs_copy_import_vars == NULL) return -1;
+  if (imports) solver_api->vs_copy_import_vars(imports);
+  status = solver_api->vs_integrate(&t, NULL);
+  gather (values);
+  return status;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Resolve when the model has been initialized. Unknown names are errors.
+---------------------------------------------------------------------------- */
+void vs_export_mask::calc (vs_real /*t*/, vs_ext_loc where)
+{
+  int n_missing;
+
+  if (where != VS_EXT_EQ_INIT || api == NULL) return;
+  n_missing = resolve(*api);
+  if (n_missing == 0) return;
+  if (n_missing < 0)
+    {
+    api->vs_printf_error ("%s\n", vs_api_missing("vs_copy_export_vars").c_str());
+    return;
+    }
+
+  for (size_t i = 0; i < names.size(); i++)
+    if (index[i] < 0)
+      api->vs_printf_error ("\"%s\" is not an export variable of this run.\n",
+                            names[i].c_str());
+}
@@ -0,0 +1,99 @@
+/* Selected export channels, gathered without copying the whole export array.
+
+   vs_integrate_io and vs_copy_export_vars fill every export each step,
+   scaled to user units. A co-simulation consumer that needs 5 of several
+   hundred channels pays for all of them. A vs_export_mask holds the names
+   of the channels wanted. It resolves them once, through
+   vs_get_export_names and vs_get_var_ptr, into an array of pointers to the
+   model variables and an array of unit gains. gather() then fills a
+   compact array in user units, one multiply per channel.
+
+   The gains are measured, not looked up: each variable is set to 1 and to
+   2 and read back through vs_copy_export_vars (then restored). A channel
+   that does not scale that way, or has no variable, is taken from a full
+   export copy instead, so gather() always gives what vs_copy_export_vars
+   would. vs_measure_export_gains does the measurement, for any set of
+   export variables (vs_io_scaling uses it too).
+
+     vs_export_mask mask;
+     mask.add ("AY");                      // before the run
+     ext.add (&mask);                      // resolves at VS_EXT_EQ_INIT
+     ...
+     mask.integrate_io (t, imports, ay);   // each step, instead of
+                                           // vs_integrate_io
+
+   Log:
+   Oct 18, 26. vs_measure_export_gains, shared with vs_io_scaling.
+   Oct 18, 26. resolve() and integrate_io() fail on a DLL without the export
+               and import copy functions.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_EXPORT_MASK_H
+  #define _VS_EXPORT_MASK_H
+
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h"     // VS types and definitions
+  #include "vs_solver.h"       // per-instance solver API
+  #include "vs_ext_dispatch.h" // external code dispatcher
+
+  // Measure the unit gains of export channels. Channel i is the export at
+  // index[i] of the export array (-1: none), with the model variable ptrs[i]
+  // (NULL: none). gains[i] gets the user units per model unit, or 0 if the
+  // channel has no variable or does not scale. The variables are restored.
+  void vs_measure_export_gains (const vs_api_table &api, vs_real *const *ptrs,
+                                const int *index, size_t n, vs_real *gains);
+
+  class vs_export_mask : public vs_ext_subsystem
+    {
+    public:
+      vs_export_mask ();
+
+      // Declare an export channel and return its slot in the gathered array.
+      int add (const char *name);
+      int size (void) const {return (int)names.size();}
+      const char *name (int i) const {return names[i].c_str();}
+
+      // Resolve all channels; the model must be read. Return the number of
+      // names that are not exports (their slots give 0), -1 if the DLL has
+      // no vs_get_export_names or vs_copy_export_vars.
+      int resolve (const vs_api_table &api);
+      vs_bool resolved (void) const {return ptrs.size() == names.size();}
+
+      // Channels taken from a full export copy (see above).
+      int n_copied (void) const {return (int)copied.size();}
+
+      // Fill values[] with the channels, in user units.
+      void gather (vs_real *values)
+        {
+        vs_real *const *p = ptrs.data();
+        const vs_real *g = gains.data();
+        for (size_t i = 0, n = ptrs.size(); i < n; i++) values[i] = *p[i]*g[i];
+        if (!copied.empty()) gather_copied(values);
+        }
+
+      // vs_integrate_io with the selected exports only: imports are copied
+      // in (if not NULL), one step is made, and the channels are gathered.
+      // Return as vs_integrate_io, or -1 if there are imports and the DLL
+      // has no vs_copy_import_vars.
+      int integrate_io (vs_real t, vs_real *imports, vs_real *values);
+
+      // vs_ext_subsystem: resolve at VS_EXT_EQ_INIT.
+      unsigned calc_mask (void) const {return VS_EXT_MASK(VS_EXT_EQ_INIT);}
+      void     calc (vs_real t, vs_ext_loc where);
+
+    private:
+      void gather_copied (vs_real *values);
+
+      const vs_api_table *solver_api;  // from resolve()
+      std::vector<std::string> names;
+      std::vector<vs_real *> ptrs;     // one per name, in the same order
+      std::vector<vs_real>   gains;    // user units per internal unit
+      std::vector<int>       copied;   // slots taken from all[]
+      std::vector<int>       index;    // export index of each slot, -1 if none
+      std::vector<vs_real>   all, zero;
+    };
+
+#endif  // end block for _VS_EXPORT_MASK_H
@@ -0,0 +1,728 @@
+/* Compiled expressions. See vs_expr.h.
+
+   Registers are numbered inputs first, then constants, then temporaries.
+   Temporaries are allocated as a stack while the tree is walked, so a
+   program needs about as many as the expression is deep. Calls and STEP take
+   their arguments from consecutive registers.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_expr.h"     // compiled expressions
+
+#define VSS_BLOCK 64 // values per register in eval_batch()
+
+enum {NODE_CONST, NODE_REG, NODE_LOAD, NODE_OP};
+
+enum
+  {
+  OP_MOV, OP_LOAD, OP_NEG, OP_SQR, OP_CUBE,
+  // unary builtins
+  OP_ABS, OP_SQRT, OP_EXP, OP_LOG, OP_LOG10, OP_SIN, OP_COS, OP_TAN,
+  OP_ASIN, OP_ACOS, OP_ATAN, OP_SINH, OP_COSH, OP_TANH, OP_FIX, OP_NINT,
+  // binary
+  OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_LT, OP_GT, OP_LE, OP_GE,
+  OP_EQ, OP_NE, OP_ATAN2, OP_MIN, OP_MAX, OP_SIGN, OP_MOD,
+  // three arguments
+  OP_IF_GT0, OP_IF_TRUE,
+  // arguments in consecutive registers
+  OP_STEP, OP_CALL
+  };
+
+static const struct
+  {
+  const char *name;
+  int op, n_args;
+  } vss_builtins[] =
+  {
+  {"ABS", OP_ABS, 1}, {"SQRT", OP_SQRT, 1}, {"EXP", OP_EXP, 1},
+  {"LOG", OP_LOG, 1}, {"LOG10", OP_LOG10, 1}, {"SIN", OP_SIN, 1},
+  {"COS", OP_COS, 1}, {"TAN", OP_TAN, 1}, {"ASIN", OP_ASIN, 1},
+  {"ACOS", OP_ACOS, 1}, {"ATAN", OP_ATAN, 1}, {"SINH", OP_SINH, 1},
+  {"COSH", OP_COSH, 1}, {"TANH", OP_TANH, 1}, {"FIX", OP_FIX, 1},
+  {"INT", OP_FIX, 1}, {"NINT", OP_NINT, 1}, {"ATAN2", OP_ATAN2, 2},
+  {"MIN", OP_MIN, 2}, {"MAX", OP_MAX, 2}, {"SIGN", OP_SIGN, 2},
+  {"MOD", OP_MOD, 2}, {"IF_GT0_THEN", OP_IF_GT0, 3},
+  {"IF_TRUE_THEN", OP_IF_TRUE, 3}, {"STEP", OP_STEP, 5}
+  };
+
+// Value of a builtin operation; x holds the arguments.
+static vs_real vss_apply (int op, const vs_real *x)
+{
+  switch (op)
+    {
+    case OP_NEG:    return -x[0];
+    case OP_SQR:    return x[0]*x[0];
+    case OP_CUBE:   return x[0]*x[0]*x[0];
+    case OP_ABS:    return fabs(x[0]);
+    case OP_SQRT:   return sqrt(x[0]);
+    case OP_EXP:    return exp(x[0]);
+    case OP_LOG:    return log(x[0]);
+    case OP_LOG10:  return log10(x[0]);
+    case OP_SIN:    return sin(x[0]);
+    case OP_COS:    return cos(x[0]);
+    case OP_TAN:    return tan(x[0]);
+    case OP_ASIN:   return asin(x[0]);
+    case OP_ACOS:   return acos(x[0]);
+    case OP_ATAN:   return atan(x[0]);
+    case OP_SINH:   return sinh(x[0]);
+    case OP_COSH:   return cosh(x[0]);
+    case OP_TANH:   return tanh(x[0]);
+    case OP_FIX:    return x[0] < 0.0 ? ceil(x[0]) : floor(x[0]);
+    case OP_NINT:   return x[0] > 0.0 ? (int)(x[0] + 0.5) :
+                           x[0] < 0.0 ? (int)(x[0] - 0.5) : 0;
+    case OP_ADD:    return x[0] + x[1];
+    case OP_SUB:    return x[0] - x[1];
+    case OP_MUL:    return x[0]*x[1];
+    case OP_DIV:    return x[0]/x[1];
+    case OP_POW:    return pow(x[0], x[1]);
+    case OP_LT:     return x[0] < x[1];
+    case OP_GT:     return x[0] > x[1];
+    case OP_LE:     return x[0] <= x[1];
+    case OP_GE:     return x[0] >= x[1];
+    case OP_EQ:     return x[0] == x[1];
+    case OP_NE:     return x[0] != x[1];
+    case OP_ATAN2:  return atan2(x[0], x[1]);
+    case OP_MIN:    return x[0] < x[1] ? x[0] : x[1];
+    case OP_MAX:    return x[0] > x[1] ? x[0] : x[1];
+    case OP_SIGN:   return x[1] < 0.0 ? -fabs(x[0]) : fabs(x[0]);
+    case OP_MOD:    return fmod(x[0], x[1]);
+    case OP_IF_GT0: return x[0] > 0.0 ? x[1] : x[2];
+    case OP_IF_TRUE: return x[0] != 0.0 ? x[1] : x[2];
+    case OP_STEP:
+      if (x[0] <= x[1]) return x[2];
+      if (x[0] >= x[3]) return x[4];
+      return x[2] + 0.5*(x[4] - x[2])*(1.0 - cos(PI*(x[0] - x[1])/(x[3] - x[1])));
+    }
+  return 0.0;
+}
+
+// Call a registered function with n arguments.
+static vs_real vss_call (void *f, int n, const vs_real *x)
+{
+  switch (n)
+    {
+    case 0: return ((vs_real (*) (void))f)();
+    case 1: return ((vs_real (*) (vs_real))f)(x[0]);
+    case 2: return ((vs_real (*) (vs_real, vs_real))f)(x[0], x[1]);
+    case 3: return ((vs_real (*) (vs_real, vs_real, vs_real))f)(x[0], x[1], x[2]);
+    case 4: return ((vs_real (*) (vs_real, vs_real, vs_real, vs_real))f)
+                   (x[0], x[1], x[2], x[3]);
+    default: return ((vs_real (*) (vs_real, vs_real, vs_real, vs_real, vs_real))f)
+                    (x[0], x[1], x[2], x[3], x[4]);
+    }
+}
+
+static std::string vss_upper (const char *s)
+{
+  std::string u(s);
+  for (size_t i = 0; i < u.size(); i++) u[i] = (char)toupper((unsigned char)u[i]);
+  return u;
+}
+
+
+vs_expr::vs_expr ()
+  : at(NULL), ok(FALSE), resolver(NULL), n_temps(0), n_temps_max(0), result_reg(0)
+{
+}
+
+int vs_expr::add_input (const char *name)
+{
+  inputs.push_back (vss_upper(name));
+  ok = FALSE;
+  return (int)inputs.size() - 1;
+}
+
+void vs_expr::bind (const char *name, const vs_real *ptr)
+{
+  bound_names.push_back (vss_upper(name));
+  bound.push_back (ptr);
+  ok = FALSE;
+}
+
+void vs_expr::add_function (const char *name, void *func, int n_args)
+{
+  function f;
+
+  f.name = vss_upper(name);
+  f.func = func;
+  f.n_args = n_args < 0 ? 0 : n_args > 5 ? 5 : n_args;
+  functions.push_back (f);
+  ok = FALSE;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Parse an expression into a tree, folding constants on the way.
+---------------------------------------------------------------------------- */
+int vs_expr::fail (const char *message)
+{
+  if (error.empty())
+    error = std::string(message) + " at column " +
+            std::to_string((int)(at - source.c_str()) + 1) + " of \"" + source + "\".";
+  return -1;
+}
+
+void vs_expr::skip_space (void)
+{
+  while (*at && isspace((unsigned char)*at)) at++;
+}
+
+// Make an operation node, or fold it.
+int vs_expr::make_op (int op, int a, int b, int c)
+{
+  node n;
+  int args[3] = {a, b, c}, i, n_args = c >= 0 ? 3 : b >= 0 ? 2 : 1;
+  vs_bool all_const = TRUE;
+  vs_real x[3];
+
+  if (a < 0 || (n_args > 1 && b < 0)) return -1;
+  for (i = 0; i < n_args; i++)
+    {
+    if (nodes[args[i]].kind != NODE_CONST) all_const = FALSE;
+    else x[i] = nodes[args[i]].value;
+    }
+
+  if (all_const)
+    {
+    n.kind = NODE_CONST;
+    n.value = vss_apply(op, x);
+    nodes.push_back (n);
+    return (int)nodes.size() - 1;
+    }
+
+  // simplifications; x^3 as x*x*x may differ from pow() in the last bit
+  if (n_args == 2 && nodes[b].kind == NODE_CONST)
+    {
+    vs_real y = nodes[b].value;
+    if ((op == OP_ADD || op == OP_SUB) && y == 0.0) return a;
+    if ((op == OP_MUL || op == OP_DIV) && y == 1.0) return a;
+    if (op == OP_POW && y == 1.0) return a;
+    if (op == OP_POW && y == 2.0) return make_op(OP_SQR, a);
+    if (op == OP_POW && y == 3.0) return make_op(OP_CUBE, a);
+    if (op == OP_POW && y == 0.5) return make_op(OP_SQRT, a);
+    }
+  if (n_args == 2 && nodes[a].kind == NODE_CONST)
+    {
+    if (op == OP_ADD && nodes[a].value == 0.0) return b;
+    if (op == OP_MUL && nodes[a].value == 1.0) return b;
+    }
+
+  n.kind = NODE_OP;
+  n.op = op;
+  n.fn = -1;
+  n.args.assign (args, args + n_args);
+  nodes.push_back (n);
+  return (int)nodes.size() - 1;
+}
+
+int vs_expr::make_name (const std::string &name)
+{
+  node n;
+  size_t i;
+  char tmpstr[256];
+
+  n.value = 0.0;
+  n.fn = -1;
+  if (name == "PI")
+    {
+    n.kind = NODE_CONST;
+    n.value = PI;
+    nodes.push_back (n);
+    return (int)nodes.size() - 1;
+    }
+  for (i = 0; i < inputs.size(); i++)
+    if (inputs[i] == name)
+      {
+      n.kind = NODE_REG;
+      n.reg = (int)i;
+      nodes.push_back (n);
+      return (int)nodes.size() - 1;
+      }
+  for (i = 0; i < bound_names.size() && bound_names[i] != name; i++) ;
+  if (i == bound_names.size())
+    {
+    vs_real *ptr = NULL;
+    if (resolver && resolver->vs_get_var_ptr && name.size() < sizeof(tmpstr))
+      {
+      strcpy (tmpstr, name.c_str());
+      ptr = resolver->vs_get_var_ptr(tmpstr);
+      }
+    if (ptr == NULL) return fail(("Unknown name " + name).c_str());
+    bound_names.push_back (name);
+    bound.push_back (ptr);
+    }
+  n.kind = NODE_LOAD;
+  n.fn = (int)i;
+  nodes.push_back (n);
+  return (int)nodes.size() - 1;
+}
+
+int vs_expr::parse_primary (void)
+{
+  std::string name;
+  std::vector<int> args;
+  node n;
+  char *end;
+  size_t i;
+  int arg;
+
+  skip_space ();
+  if (*at == '(')
+    {
+    at++;
+    arg = parse_compare();
+    skip_space ();
+    if (arg < 0) return -1;
+    if (*at != ')') return fail("Expected )");
+    at++;
+    return arg;
+    }
+
+  if (isdigit((unsigned char)*at) || *at == '.')
+    {
+    n.kind = NODE_CONST;
+    n.value = strtod(at, &end);
+    if (end == at) return fail("Bad number");
+    at = end;
+    nodes.push_back (n);
+    return (int)nodes.size() - 1;
+    }
+
+  if (!isalpha((unsigned char)*at) && *at != '_') return fail("Expected a value");
+  while (isalnum((unsigned char)*at) || *at == '_')
+    name += (char)toupper((unsigned char)*at++);
+  skip_space ();
+  if (*at != '(') return make_name(name);
+
+  // function call
+  at++;
+  skip_space ();
+  if (*at != ')')
+    for (;;)
+      {
+      if ((arg = parse_compare()) < 0) return -1;
+      args.push_back (arg);
+      skip_space ();
+      if (*at == ')') break;
+      if (*at != ',') return fail("Expected , or )");
+      at++;
+      }
+  at++;
+
+  for (i = 0; i < functions.size(); i++)
+    if (functions[i].name == name)
+      {
+      if ((int)args.size() != functions[i].n_args)
+        return fail(("Wrong number of arguments for " + name).c_str());
+      n.kind = NODE_OP;
+      n.op = OP_CALL;
+      n.fn = (int)i;
+      n.args = args;
+      nodes.push_back (n);
+      return (int)nodes.size() - 1;
+      }
+  for (i = 0; i < sizeof(vss_builtins)/sizeof(vss_builtins[0]); i++)
+    if (name == vss_builtins[i].name)
+      {
+      if ((int)args.size() != vss_builtins[i].n_args)
+        return fail(("Wrong number of arguments for " + name).c_str());
+      if (vss_builtins[i].n_args <= 3)
+        return make_op(vss_builtins[i].op, args[0], args.size() > 1 ? args[1] : -1,
+                       args.size() > 2 ? args[2] : -1);
+
+      // STEP: fold by hand, as make_op takes up to three arguments
+      vs_real x[5];
+      vs_bool all_const = TRUE;
+      for (size_t j = 0; j < args.size(); j++)
+        {
+        if (nodes[args[j]].kind == NODE_CONST) x[j] = nodes[args[j]].value;
+        else all_const = FALSE;
+        }
+      n.kind = all_const ? NODE_CONST : NODE_OP;
+      n.value = all_const ? vss_apply(OP_STEP, x) : 0.0;
+      n.op = OP_STEP;
+      n.fn = -1;
+      if (!all_const) n.args = args;
+      nodes.push_back (n);
+      return (int)nodes.size() - 1;
+      }
+  return fail(("Unknown function " + name).c_str());
+}
+
+// Power is right-associative and binds tighter than unary minus: -x^2 = -(x^2).
+int vs_expr::parse_power (void)
+{
+  int a = parse_primary(), b;
+
+  if (a < 0) return -1;
+  skip_space ();
+  if (*at == '^' || (at[0] == '*' && at[1] == '*'))
+    {
+    at += *at == '^' ? 1 : 2;
+    if ((b = parse_unary()) < 0) return -1;
+    return make_op(OP_POW, a, b);
+    }
+  return a;
+}
+
+int vs_expr::parse_unary (void)
+{
+  int a;
+
+  skip_space ();
+  if (*at == '-')
+    {
+    at++;
+    if ((a = parse_unary()) < 0) return -1;
+    return make_op(OP_NEG, a);
+    }
+  if (*at == '+')
+    {
+    at++;
+    return parse_unary();
+    }
+  return parse_power();
+}
+
+int vs_expr::parse_product (void)
+{
+  int a = parse_unary(), b;
+  char c;
+
+  while (a >= 0)
+    {
+    skip_space ();
+    c = *at;
+    if ((c != '*' && c != '/') || at[1] == '*') break;
+    at++;
+    if ((b = parse_unary()) < 0) return -1;
+    a = make_op(c == '*' ? OP_MUL : OP_DIV, a, b);
+    }
+  return a;
+}
+
+int vs_expr::parse_sum (void)
+{
+  int a = parse_product(), b;
+  char c;
+
+  while (a >= 0)
+    {
+    skip_space ();
+    c = *at;
+    if (c != '+' && c != '-') break;
+    at++;
+    if ((b = parse_product()) < 0) return -1;
+    a = make_op(c == '+' ? OP_ADD : OP_SUB, a, b);
+    }
+  return a;
+}
+
+int vs_expr::parse_compare (void)
+{
+  int a = parse_sum(), op;
+
+  if (a < 0) return -1;
+  skip_space ();
+  if      (at[0] == '<' && at[1] == '=') op = OP_LE, at += 2;
+  else if (at[0] == '>' && at[1] == '=') op = OP_GE, at += 2;
+  else if (at[0] == '=' && at[1] == '=') op = OP_EQ, at += 2;
+  else if (at[0] == '!' && at[1] == '=') op = OP_NE, at += 2;
+  else if (at[0] == '<')                 op = OP_LT, at += 1;
+  else if (at[0] == '>')                 op = OP_GT, at += 1;
+  else return a;
+  return make_op(op, a, parse_sum());
+}
+
+
+/* ----------------------------------------------------------------------------
+   Generate the register program.
+---------------------------------------------------------------------------- */
+int vs_expr::constant (vs_real value)
+{
+  size_t i;
+
+  for (i = 0; i < consts.size(); i++)
+    if (consts[i] == value || (value != value && consts[i] != consts[i])) break;
+  if (i == consts.size()) consts.push_back(value);
+  return (int)(inputs.size() + i);
+}
+
+// Temporaries are numbered from 0 here, and offset once the number of
+// constants is known.
+int vs_expr::temp (void)
+{
+  if (++n_temps > n_temps_max) n_temps_max = n_temps;
+  return 0x8000 + n_temps - 1;
+}
+
+// Emit code for node i. The value goes to register want if want >= 0;
+// return the register that holds it.
+int vs_expr::gen (int i, int want)
+{
+  node &n = nodes[i];
+  insn o;
+  int saved = n_temps, r[3] = {0, 0, 0}, j, base;
+
+  switch (n.kind)
+    {
+    case NODE_CONST: return n.reg;
+    case NODE_REG:   return n.reg;
+    case NODE_LOAD:
+      o.op = OP_LOAD;
+      o.dst = (unsigned short)(want >= 0 ? want : temp());
+      o.a = o.b = o.c = o.n = 0;
+      o.fn = n.fn;
+      code.push_back (o);
+      return o.dst;
+    }
+
+  o.fn = n.fn;
+  o.n = (unsigned short)n.args.size();
+  o.a = o.b = o.c = 0;
+  if (n.op == OP_STEP || n.op == OP_CALL)
+    {
+    // arguments in consecutive temporaries
+    base = n_temps;
+    for (j = 0; j < (int)n.args.size(); j++) temp();
+    for (j = 0; j < (int)n.args.size(); j++)
+      {
+      int at_reg = 0x8000 + base + j, got = gen(nodes[i].args[j], at_reg);
+      if (got != at_reg)
+        {
+        insn mov = {OP_MOV, (unsigned short)at_reg, (unsigned short)got, 0, 0, 0, -1};
+        code.push_back (mov);
+        }
+      }
+    o.a = (unsigned short)(0x8000 + base);
+    }
+  else
+    {
+    for (j = 0; j < (int)n.args.size(); j++) r[j] = gen(nodes[i].args[j], -1);
+    o.a = (unsigned short)r[0];
+    if (n.args.size() > 1) o.b = (unsigned short)r[1];
+    if (n.args.size() > 2) o.c = (unsigned short)r[2];
+    }
+
+  n_temps = saved;
+  o.op = (unsigned short)nodes[i].op;
+  o.dst = (unsigned short)(want >= 0 ? want : temp());
+  code.push_back (o);
+  return o.dst;
+}
+
+int vs_expr::compile (const char *text)
+{
+  size_t i;
+  int root, n_fixed;
+
+  source = text ? text : "";
+  error.clear ();
+  nodes.clear ();
+  code.clear ();
+  consts.clear ();
+  ok = FALSE;
+  n_temps = n_temps_max = 0;
+
+  at = source.c_str();
+  root = parse_compare();
+  if (root >= 0)
+    {
+    skip_space ();
+    if (*at) root = fail("Unexpected text");
+    }
+  if (root < 0) return -1;
+
+  // constants get registers first, so temporaries can be numbered after them
+  for (i = 0; i < nodes.size(); i++)
+    if (nodes[i].kind == NODE_CONST) nodes[i].reg = constant(nodes[i].value);
+
+  result_reg = gen(root, -1);
+  if (nodes[root].kind == NODE_REG)
+    {
+    insn mov = {OP_MOV, (unsigned short)temp(), (unsigned short)result_reg, 0, 0, 0, -1};
+    code.push_back (mov);
+    result_reg = mov.dst;
+    }
+
+  // final register numbers
+  n_fixed = (int)(inputs.size() + consts.size());
+  if (n_fixed + n_temps_max >= 0x8000) return fail("Expression is too large");
+  for (i = 0; i < code.size(); i++)
+    {
+    insn &o = code[i];
+    if (o.dst & 0x8000) o.dst = (unsigned short)(n_fixed + (o.dst & 0x7fff));
+    if (o.a & 0x8000) o.a = (unsigned short)(n_fixed + (o.a & 0x7fff));
+    if (o.b & 0x8000) o.b = (unsigned short)(n_fixed + (o.b & 0x7fff));
+    if (o.c & 0x8000) o.c = (unsigned short)(n_fixed + (o.c & 0x7fff));
+    }
+  if (result_reg & 0x8000) result_reg = n_fixed + (result_reg & 0x7fff);
+
+  regs.assign (n_fixed + n_temps_max, 0.0);
+  for (i = 0; i < consts.size(); i++) regs[inputs.size() + i] = consts[i];
+  block.clear (); // filled by the first eval_batch()
+  nodes.clear ();
+  ok = TRUE;
+  return 0;
+}
+
+int vs_expr::compile (const vs_table *tab)
+{
+  std::string text;
+  char tmpstr[100];
+
+  inputs.clear ();
+  add_input ("X");
+  add_input ("Y");
+  if (tab == NULL || tab->type != VS_TAB_EQ || tab->eq_desc == NULL)
+    {
+    source.clear ();
+    ok = FALSE;
+    error = "The table does not have an equation.";
+    return -1;
+    }
+
+  text = std::string("(") + tab->eq_desc + ")";
+  if (tab->gain != 1.0)
+    {
+    sprintf (tmpstr, "%.17g*", tab->gain);
+    text = tmpstr + text;
+    }
+  if (tab->offset != 0.0)
+    {
+    sprintf (tmpstr, "%.17g + ", tab->offset);
+    text = tmpstr + text;
+    }
+  return compile(text.c_str());
+}
+
+
+/* ----------------------------------------------------------------------------
+   Evaluate.
+---------------------------------------------------------------------------- */
+vs_real vs_expr::eval (const vs_real *in)
+{
+  vs_real *r = regs.data(), x[3];
+  const insn *o = code.data(), *end = o + code.size();
+  size_t i;
+
+  if (!ok) return 0.0;
+  for (i = 0; i < inputs.size(); i++) r[i] = in[i];
+
+  for (; o < end; o++)
+    switch (o->op)
+      {
+      case OP_MOV:  r[o->dst] = r[o->a]; break;
+      case OP_LOAD: r[o->dst] = *bound[o->fn]; break;
+      case OP_NEG:  r[o->dst] = -r[o->a]; break;
+      case OP_SQR:  r[o->dst] = r[o->a]*r[o->a]; break;
+      case OP_ADD:  r[o->dst] = r[o->a] + r[o->b]; break;
+      case OP_SUB:  r[o->dst] = r[o->a] - r[o->b]; break;
+      case OP_MUL:  r[o->dst] = r[o->a]*r[o->b]; break;
+      case OP_DIV:  r[o->dst] = r[o->a]/r[o->b]; break;
+      case OP_STEP: r[o->dst] = vss_apply(OP_STEP, r + o->a); break;
+      case OP_CALL: r[o->dst] = vss_call(functions[o->fn].func, o->n, r + o->a); break;
+      default:
+        x[0] = r[o->a];
+        x[1] = r[o->b];
+        x[2] = r[o->c];
+        r[o->dst] = vss_apply(o->op, x);
+      }
+  return r[result_reg];
+}
+
+// Run the program over m values per register; register k is r + k*VSS_BLOCK.
+void vs_expr::run (int m, vs_real *r, int stride)
+{
+  const insn *o = code.data(), *end = o + code.size();
+  vs_real x[5];
+  int k, j;
+
+  for (; o < end; o++)
+    {
+    vs_real *d = r + o->dst*stride;
+    const vs_real *a = r + o->a*stride, *b = r + o->b*stride, *c = r + o->c*stride;
+
+    switch (o->op)
+      {
+      case OP_MOV:  for (k = 0; k < m; k++) d[k] = a[k]; break;
+      case OP_LOAD: for (k = 0; k < m; k++) d[k] = *bound[o->fn]; break;
+      case OP_NEG:  for (k = 0; k < m; k++) d[k] = -a[k]; break;
+      case OP_SQR:  for (k = 0; k < m; k++) d[k] = a[k]*a[k]; break;
+      case OP_CUBE: for (k = 0; k < m; k++) d[k] = a[k]*a[k]*a[k]; break;
+      case OP_ABS:  for (k = 0; k < m; k++) d[k] = fabs(a[k]); break;
+      case OP_SQRT: for (k = 0; k < m; k++) d[k] = sqrt(a[k]); break;
+      case OP_EXP:  for (k = 0; k < m; k++) d[k] = exp(a[k]); break;
+      case OP_SIN:  for (k = 0; k < m; k++) d[k] = sin(a[k]); break;
+      case OP_COS:  for (k = 0; k < m; k++) d[k] = cos(a[k]); break;
+      case OP_ADD:  for (k = 0; k < m; k++) d[k] = a[k] + b[k]; break;
+      case OP_SUB:  for (k = 0; k < m; k++) d[k] = a[k] - b[k]; break;
+      case OP_MUL:  for (k = 0; k < m; k++) d[k] = a[k]*b[k]; break;
+      case OP_DIV:  for (k = 0; k < m; k++) d[k] = a[k]/b[k]; break;
+      case OP_LT:   for (k = 0; k < m; k++) d[k] = a[k] < b[k]; break;
+      case OP_GT:   for (k = 0; k < m; k++) d[k] = a[k] > b[k]; break;
+      case OP_MIN:  for (k = 0; k < m; k++) d[k] = a[k] < b[k] ? a[k] : b[k]; break;
+      case OP_MAX:  for (k = 0; k < m; k++) d[k] = a[k] > b[k] ? a[k] : b[k]; break;
+      case OP_IF_GT0:
+        for (k = 0; k < m; k++) d[k] = a[k] > 0.0 ? b[k] : c[k];
+        break;
+      case OP_STEP:
+      case OP_CALL:
+        for (k = 0; k < m; k++)
+          {
+          for (j = 0; j < o->n; j++) x[j] = a[j*stride + k];
+          d[k] = o->op == OP_STEP ? vss_apply(OP_STEP, x) :
+                                    vss_call(functions[o->fn].func, o->n, x);
+          }
+        break;
+      default:
+        for (k = 0; k < m; k++)
+          {
+          x[0] = a[k];
+          x[1] = b[k];
+          x[2] = c[k];
+          d[k] = vss_apply(o->op, x);
+          }
+      }
+    }
+}
+
+void vs_expr::eval_batch (int n, const vs_real *const *in, vs_real *out)
+{
+  size_t i, n_in = inputs.size();
+  int s, m;
+
+  if (!ok)
+    {
+    for (s = 0; s < n; s++) out[s] = 0.0;
+    return;
+    }
+  if (block.empty())
+    {
+    block.assign (regs.size()*VSS_BLOCK, 0.0);
+    for (i = 0; i < consts.size(); i++)
+      for (s = 0; s < VSS_BLOCK; s++) block[(n_in + i)*VSS_BLOCK + s] = consts[i];
+    }
+
+  for (s = 0; s < n; s += VSS_BLOCK)
+    {
+    m = n - s < VSS_BLOCK ? n - s : VSS_BLOCK;
+    for (i = 0; i < n_in; i++)
+      memcpy (&block[i*VSS_BLOCK], in[i] + s, m*sizeof(vs_real));
+    run (m, block.data(), VSS_BLOCK);
+    memcpy (out + s, &block[(size_t)result_reg*VSS_BLOCK], m*sizeof(vs_real));
+    }
+}
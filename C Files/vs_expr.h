@@ -0,0 +1,139 @@
+/* Compiled expressions: table equations (VS_TAB_EQ) and other parsfile
+   formulas evaluated from external code.
+
+   The solver interprets an equation each time it is evaluated. A vs_expr
+   parses the text once into a short register program:
+     - constant subexpressions are folded (2*PI/360 is one number);
+     - x^2, x^3 and x^0.5 become multiplies and a square root;
+     - functions registered with add_function() are called directly through
+       their pointers, the same ones given to vs_install_symbolic_func().
+   eval() runs the program for one set of inputs; eval_batch() runs it for
+   arrays of inputs, one instruction at a time over blocks of values, so the
+   dispatch cost is shared and the arithmetic loops vectorize.
+
+   Syntax (names are not case-sensitive):
+     numbers, names, ( ), + - * / ^ (or **), unary -,
+     comparisons < > <= >= == != (1 if true, 0 if not),
+     ABS SQRT EXP LOG LOG10 SIN COS TAN ASIN ACOS ATAN SINH COSH TANH
+     FIX NINT INT, ATAN2 MIN MAX SIGN MOD, IF_GT0_THEN IF_TRUE_THEN (3 args),
+     STEP (5 args, as vs_step_smooth), and the constant PI.
+   Builtins follow vs_utility.c (FIX, NINT, SIGN, ...).
+
+   Names are resolved, in order, as inputs (add_input), bound variables
+   (bind), then model variables through vs_get_var_ptr() if set_resolver() was
+   called. Inputs are given to eval(); bound and model variables are read
+   through their pointers each evaluation.
+
+     vs_expr e;
+     e.add_input ("X");
+     e.add_function ("MY_SCALE", (void *)my_scale, 2);
+     if (e.compile("MY_SCALE(X, 0.9)*(1 - EXP(-X/5))")) ... e.error_message()
+     y = e.eval(&x);
+     e.eval_batch (n, &xs, ys);
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_EXPR_H
+  #define _VS_EXPR_H
+
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_solver.h"   // per-instance solver API
+
+  class vs_expr
+    {
+    public:
+      vs_expr ();
+
+      // Declare names before compile(). Inputs are numbered from 0 in the
+      // order added. Functions take n_args (0 to 5) vs_real arguments and
+      // return vs_real; they are never folded.
+      int  add_input (const char *name);
+      void bind (const char *name, const vs_real *ptr);
+      void add_function (const char *name, void *func, int n_args);
+      void set_resolver (const vs_api_table *api) {resolver = api;}
+
+      // Compile text. Return 0 if OK, -1 if not (see error_message()).
+      int compile (const char *text);
+
+      // Compile the equation of a VS_TAB_EQ table, with inputs X (the row
+      // variable) and, for 2D tables, Y (the column variable). The table gain
+      // and offset are folded in.
+      int compile (const vs_table *tab);
+
+      const char *error_message (void) const {return error.c_str();}
+      const char *text (void) const {return source.c_str();}
+      vs_bool compiled (void) const {return ok;}
+
+      // True if the expression folded to a single number.
+      vs_bool is_constant (void) const {return ok && code.empty();}
+      int n_instructions (void) const {return (int)code.size();}
+      int n_inputs (void) const {return (int)inputs.size();}
+
+      // Evaluate for one set of inputs (may be NULL if there are none).
+      vs_real eval (const vs_real *in);
+
+      // Evaluate n times: in[k][i] is input k for case i; out[i] the result.
+      void eval_batch (int n, const vs_real *const *in, vs_real *out);
+
+    private:
+      struct insn
+        {
+        unsigned short op, dst, a, b, c, n; // n: argument count of calls
+        int fn;                             // function or pointer index
+        };
+      struct node
+        {
+        int kind, op, fn; // kind: constant, register, load, operation
+        vs_real value;
+        int reg;
+        std::vector<int> args;
+        node () : kind(0), op(0), fn(-1), value(0.0), reg(0) {}
+        };
+      struct function
+        {
+        std::string name;
+        void *func;
+        int n_args;
+        };
+
+      // parsing
+      int  parse_compare (void);
+      int  parse_sum (void);
+      int  parse_product (void);
+      int  parse_unary (void);
+      int  parse_power (void);
+      int  parse_primary (void);
+      int  make_op (int op, int a, int b = -1, int c = -1);
+      int  make_name (const std::string &name);
+      int  fail (const char *message);
+      void skip_space (void);
+
+      // code generation
+      int  gen (int i, int want);
+      int  temp (void);
+      int  constant (vs_real value);
+      void run (int m, vs_real *r, int stride);
+
+      std::string source, error;
+      const char *at;
+      vs_bool ok;
+      const vs_api_table *resolver;
+
+      std::vector<std::string>      inputs;
+      std::vector<std::string>      bound_names;
+      std::vector<const vs_real *>  bound;  // bound and resolved variables
+      std::vector<function>         functions;
+      std::vector<node>             nodes;
+      std::vector<insn>             code;
+      std::vector<vs_real>          consts; // registers n_in .. n_in + n_const - 1
+      int n_temps, n_temps_max, result_reg;
+      std::vector<vs_real>          regs;   // scalar registers
+      std::vector<vs_real>          block;  // batch registers
+    };
+
+#endif  // end block for _VS_EXPR_H
@@ -0,0 +1,410 @@
+/* Reentrant dispatch of external calls from a VS solver. See vs_ext_dispatch.h.
+
+   Log:
+   Oct 18, 26. Outputs of a subsystem with a rate are written at each
+               VS_EXT_EQ_IN whatever its calc_mask. Its counts are updated
+               under the lock (skipped: atomic), as rate_stats() reads them.
+   Oct 18, 26. install() reports a solver without the *_function2 calls.
+   Oct 18, 26. Multi-rate subsystems and a helper thread.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+
+// Functions installed in the solver. userData is the dispatcher.
+static void vss_calc (vs_real t, vs_ext_loc where, void *user)
+{
+  ((vs_ext_dispatcher *)user)->calc(t, where);
+}
+
+static void vss_echo (vs_ext_loc where, void *user)
+{
+  ((vs_ext_dispatcher *)user)->echo(where);
+}
+
+static void vss_setdef (void *user)
+{
+  ((vs_ext_dispatcher *)user)->setdef();
+}
+
+static vs_bool vss_scan (char *key, char *buffer, void *user)
+{
+  return ((vs_ext_dispatcher *)user)->scan(key, buffer);
+}
+
+static void vss_free (void *user)
+{
+  ((vs_ext_dispatcher *)user)->release();
+}
+
+
+static double vss_seconds (void)
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#define VSS_TICK_TOL 1e-6 // fraction of a period: a call this close is on time
+
+
+int vs_ext_subsystem::add_output (vs_real *var, vs_bool interpolate)
+{
+  output o;
+
+  o.var = var;
+  o.interpolate = interpolate;
+  o.staged = o.y0 = o.y1 = var ? *var : 0.0;
+  outs.push_back (o);
+  return (int)outs.size() - 1;
+}
+
+
+vs_ext_dispatcher::vs_ext_dispatcher () : api(NULL), stopping(false)
+{
+}
+
+vs_ext_dispatcher::~vs_ext_dispatcher ()
+{
+  if (helper.joinable())
+    {
+    {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+    }
+    work.notify_all ();
+    helper.join ();
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   Add or remove a subsystem.
+---------------------------------------------------------------------------- */
+void vs_ext_dispatcher::add (vs_ext_subsystem *sub)
+{
+  if (std::find(subs.begin(), subs.end(), sub) != subs.end()) return;
+  subs.push_back (sub);
+  sub->api = api;
+  rebuild ();
+}
+
+void vs_ext_dispatcher::remove (vs_ext_subsystem *sub)
+{
+  subs.erase (std::remove(subs.begin(), subs.end(), sub), subs.end());
+  rebuild ();
+}
+
+// Make the list of subsystems to call at each location. Subsystems with a
+// rate are left out of the VS_EXT_EQ_IN and VS_EXT_EQ_OUT lists; they keep
+// their counts.
+void vs_ext_dispatcher::rebuild (void)
+{
+  const unsigned eq = VS_EXT_MASK(VS_EXT_EQ_IN) | VS_EXT_MASK(VS_EXT_EQ_OUT);
+  std::vector<std::unique_ptr<rated_sub> > old;
+  int where;
+  size_t i, j;
+
+  drain ();
+  old.swap (rated);
+  for (i = 0; i < subs.size(); i++)
+    {
+    vs_ext_rate rate = subs[i]->rate();
+    unsigned mask = subs[i]->calc_mask() & eq;
+
+    if (mask == 0 || (rate.period <= 0.0 && !rate.helper)) continue;
+    rated.push_back (std::unique_ptr<rated_sub>(new rated_sub));
+    rated_sub &r = *rated.back();
+    r.sub = subs[i];
+    r.rate = rate;
+    if (r.rate.period < 0.0) r.rate.period = 0.0;
+    r.mask = mask;
+    for (where = 0; where < VS_N_EXT_LOC; where++) r.next[where] = rate.phase;
+    r.t_tick = rate.phase;
+    r.published = r.pending = r.busy = FALSE;
+    memset (&r.st, 0, sizeof(r.st));
+    r.skipped = 0;
+    for (j = 0; j < old.size(); j++)
+      if (old[j]->sub == subs[i])
+        {
+        r.st = old[j]->st;
+        r.skipped = old[j]->skipped.load();
+        }
+    }
+
+  for (where = 0; where < VS_N_EXT_LOC; where++)
+    {
+    at[where].clear ();
+    for (i = 0; i < subs.size(); i++)
+      {
+      if (!(subs[i]->calc_mask() & VS_EXT_MASK(where))) continue;
+      for (j = 0; j < rated.size(); j++)
+        if (rated[j]->sub == subs[i] && (rated[j]->mask & VS_EXT_MASK(where))) break;
+      if (j == rated.size()) at[where].push_back(subs[i]);
+      }
+    }
+}
+
+
+/* ----------------------------------------------------------------------------
+   Install the dispatcher in a solver with the *_function2 calls. The calc
+   and echo ones are needed; setdef, scan and free are installed if the
+   solver has them. Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_ext_dispatcher::install (const vs_api_table &solver_api)
+{
+  size_t i;
+
+  error.clear ();
+  if (solver_api.vs_install_calc_function2 == NULL)
+    error = vs_api_missing("vs_install_calc_function2");
+  else if (solver_api.vs_install_echo_function2 == NULL)
+    error = vs_api_missing("vs_install_echo_function2");
+  if (!error.empty()) return -1;
+
+  api = &solver_api;
+  for (i = 0; i < subs.size(); i++) subs[i]->api = api;
+  rebuild ();
+
+  api->vs_install_calc_function2 (vss_calc, this);
+  api->vs_install_echo_function2 (vss_echo, this);
+  if (api->vs_install_setdef_function2)
+    api->vs_install_setdef_function2 (vss_setdef, this);
+  if (api->vs_install_scan_function2)
+    api->vs_install_scan_function2 (vss_scan, this);
+  if (api->vs_install_free_function2)
+    api->vs_install_free_function2 (vss_free, this);
+  return 0;
+}
+
+
+void vs_ext_dispatcher::uninstall (void)
+{
+  if (api == NULL || api->vs_install_calc_function2 == NULL) return;
+  api->vs_install_calc_function2 (NULL, NULL);
+  api->vs_install_echo_function2 (NULL, NULL);
+  if (api->vs_install_setdef_function2) api->vs_install_setdef_function2 (NULL, NULL);
+  if (api->vs_install_scan_function2) api->vs_install_scan_function2 (NULL, NULL);
+  if (api->vs_install_free_function2) api->vs_install_free_function2 (NULL, NULL);
+  api = NULL;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Forward calls from the solver to the subsystems.
+---------------------------------------------------------------------------- */
+void vs_ext_dispatcher::setdef (void)
+{
+  for (size_t i = 0; i < subs.size(); i++) subs[i]->setdef();
+}
+
+// The first subsystem that recognizes the keyword handles it.
+vs_bool vs_ext_dispatcher::scan (char *key, char *buffer)
+{
+  for (size_t i = 0; i < subs.size(); i++)
+    if (subs[i]->scan(key, buffer)) return TRUE;
+  return FALSE;
+}
+
+void vs_ext_dispatcher::echo (vs_ext_loc where)
+{
+  for (size_t i = 0; i < subs.size(); i++) subs[i]->echo(where);
+}
+
+void vs_ext_dispatcher::release (void)
+{
+  for (size_t i = 0; i < subs.size(); i++) subs[i]->release();
+}
+
+vs_ext_rate_stats vs_ext_dispatcher::rate_stats (const vs_ext_subsystem *sub) const
+{
+  vs_ext_rate_stats st;
+
+  memset (&st, 0, sizeof(st));
+  for (size_t i = 0; i < rated.size(); i++)
+    if (rated[i]->sub == sub)
+      {
+      std::lock_guard<std::mutex> guard(lock);
+      st = rated[i]->st;
+      st.skipped = rated[i]->skipped.load(std::memory_order_relaxed);
+      }
+  return st;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Subsystems with a rate. At VS_EXT_EQ_INIT the schedules start again; at
+   VS_EXT_EQ_END the helper finishes its ticks. At VS_EXT_EQ_IN and
+   VS_EXT_EQ_OUT the subsystems whose tick has come are called. At
+   VS_EXT_EQ_IN the outputs of all of them are written, also of those that
+   are only called at VS_EXT_EQ_OUT.
+---------------------------------------------------------------------------- */
+void vs_ext_dispatcher::calc_rated (vs_real t, vs_ext_loc where)
+{
+  size_t i;
+  int k;
+
+  if (where == VS_EXT_EQ_INIT)
+    {
+    drain ();
+    for (i = 0; i < rated.size(); i++)
+      {
+      rated_sub &r = *rated[i];
+      for (k = 0; k < VS_N_EXT_LOC; k++) r.next[k] = r.rate.phase;
+      r.published = r.pending = FALSE;
+      }
+    return;
+    }
+  if (where == VS_EXT_EQ_END)
+    {
+    drain ();
+    return;
+    }
+  if (where != VS_EXT_EQ_IN && where != VS_EXT_EQ_OUT) return;
+
+  for (i = 0; i < rated.size(); i++)
+    {
+    rated_sub &r = *rated[i];
+    vs_real tol = VSS_TICK_TOL*r.rate.period;
+
+    if (!(r.mask & VS_EXT_MASK(where)))
+      ;
+    else if (t < r.next[where] - tol)
+      r.skipped.fetch_add (1, std::memory_order_relaxed);
+    else
+      {
+      tick (r, t, where);
+      if (r.rate.period > 0.0) // the next tick after t, even if some were missed
+        do r.next[where] += r.rate.period; while (r.next[where] <= t + tol);
+      }
+    if (where == VS_EXT_EQ_IN) apply (r, t);
+    }
+}
+
+void vs_ext_dispatcher::tick (rated_sub &r, vs_real t, vs_ext_loc where)
+{
+  double start, seconds;
+  job j;
+
+  if (!r.rate.helper)
+    {
+    start = vss_seconds();
+    r.sub->calc (t, where);
+    seconds = vss_seconds() - start;
+    {
+    std::lock_guard<std::mutex> guard(lock);
+    r.st.ticks++;
+    r.st.calc_seconds += seconds;
+    }
+    publish (r, t);
+    return;
+    }
+
+  // The results of the last tick (if any) are used from now on.
+  wait (r);
+  if (r.pending) publish(r, t);
+  r.sub->sample (t, where);
+  j.r = &r;
+  j.t = t;
+  j.where = where;
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  r.st.ticks++;
+  r.busy = r.pending = TRUE;
+  jobs.push_back (j);
+  if (!helper.joinable()) helper = std::thread(&vs_ext_dispatcher::helper_main, this);
+  }
+  work.notify_one ();
+}
+
+// Outputs given by the last tick become those in use, at time t.
+void vs_ext_dispatcher::publish (rated_sub &r, vs_real t)
+{
+  std::vector<vs_ext_subsystem::output> &outs = r.sub->outs;
+
+  for (size_t i = 0; i < outs.size(); i++)
+    {
+    outs[i].y0 = r.published ? outs[i].y1 : outs[i].staged;
+    outs[i].y1 = outs[i].staged;
+    }
+  r.t_tick = t;
+  r.published = TRUE;
+}
+
+void vs_ext_dispatcher::apply (const rated_sub &r, vs_real t)
+{
+  const std::vector<vs_ext_subsystem::output> &outs = r.sub->outs;
+  vs_real f = 1.0;
+
+  if (!r.published || outs.empty()) return;
+  if (r.rate.period > 0.0)
+    {
+    f = (t - r.t_tick)/r.rate.period;
+    if (f > 1.0) f = 1.0;
+    if (f < 0.0) f = 0.0;
+    }
+  for (size_t i = 0; i < outs.size(); i++)
+    if (outs[i].var)
+      *outs[i].var = outs[i].interpolate ? outs[i].y0 + f*(outs[i].y1 - outs[i].y0)
+                                         : outs[i].y1;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Helper thread: runs the queued ticks in order.
+---------------------------------------------------------------------------- */
+void vs_ext_dispatcher::wait (rated_sub &r)
+{
+  std::unique_lock<std::mutex> guard(lock);
+  double start;
+
+  if (!r.busy) return;
+  start = vss_seconds();
+  while (r.busy) done.wait(guard);
+  r.st.wait_seconds += vss_seconds() - start;
+}
+
+void vs_ext_dispatcher::drain (void)
+{
+  std::unique_lock<std::mutex> guard(lock);
+  while (!jobs.empty() || std::any_of(rated.begin(), rated.end(),
+                           [] (const std::unique_ptr<rated_sub> &r) {return r->busy;}))
+    done.wait (guard);
+}
+
+void vs_ext_dispatcher::helper_main (void)
+{
+  std::unique_lock<std::mutex> guard(lock);
+  double start, seconds;
+  job j;
+
+  for (;;)
+    {
+    while (!stopping && jobs.empty()) work.wait(guard);
+    if (jobs.empty()) return; // stopping
+    j = jobs.front();
+    jobs.pop_front ();
+    guard.unlock ();
+    start = vss_seconds();
+    j.r->sub->calc (j.t, j.where);
+    seconds = vss_seconds() - start;
+    guard.lock ();
+    j.r->st.calc_seconds += seconds;
+    j.r->busy = FALSE;
+    done.notify_all ();
+    }
+}
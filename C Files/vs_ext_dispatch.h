@@ -0,0 +1,225 @@
+/* Reentrant framework for external C++ code in a VS solver.
+
+   solver_extended.c installs external_calc, external_echo, external_scan and
+   external_setdef with the vs_install_*_function calls, so all data used by
+   the external code has to live in globals. Here the *_function2 variants are
+   installed instead. The solver hands the vs_ext_dispatcher back as userData,
+   and the dispatcher forwards each call to the subsystems added to it. Any
+   number of dispatchers (one per loaded vs_solver) can exist in a process.
+
+   A subsystem declares the vs_ext_loc values it wants with calc_mask(). The
+   dispatcher keeps one list of subsystems per location, so each call from the
+   solver only visits the subsystems registered for that location.
+
+   Typical use:
+     vs_solver solver;
+     vs_ext_dispatcher ext;
+     my_controller ctrl;          // derived from vs_ext_subsystem
+     solver.load (pathDLL, TRUE);
+     ext.add (&ctrl);
+     if (ext.install (solver.api)) ... ext.error_message()
+     solver.api.vs_run (simfile);
+
+   Multi-rate subsystems. Perception or planning code that needs 10 to 50 Hz
+   can return a vs_ext_rate from rate(). Its calc() at VS_EXT_EQ_IN and
+   VS_EXT_EQ_OUT then runs only on its ticks, at t = phase + k*period (the
+   first call at or after each tick time). Calls between ticks are skipped.
+   Other locations (init, end, ...) are called as usual.
+
+   A subsystem with a rate can write its outputs straight to model variables,
+   which then hold between ticks. It can also declare them with add_output()
+   and give their values with set_output(). The dispatcher then writes them
+   at each VS_EXT_EQ_IN, either held, or interpolated: ramped over one period
+   from the value of the previous tick to that of the last one. This is done
+   whatever the calc_mask(), so a subsystem called only at VS_EXT_EQ_OUT
+   still has its outputs written before each step.
+
+   With helper set, the tick's calc() runs on a helper thread of the
+   dispatcher while the solver goes on with its next steps. The subsystem
+   copies what it needs from the model in sample(), which is called on the
+   solver thread just before. calc() must then touch only its own data and
+   give results with set_output(). Those outputs are used from the next
+   tick, one period later. If the helper is still busy at that tick, the
+   solver waits for it. A helper subsystem should have only one of
+   VS_EXT_EQ_IN and VS_EXT_EQ_OUT in its calc_mask(): with both, its tick at
+   VS_EXT_EQ_OUT waits for its own calc() of VS_EXT_EQ_IN in the same step
+   (one subsystem's calc() calls never overlap), so nothing runs alongside
+   the solver.
+
+   Subsystems with a rate are called before the others at a location.
+   rate_stats() gives the ticks, the skipped calls and the time spent in
+   calc(), to show the CPU time saved.
+
+   Log:
+   Oct 18, 26. Outputs are written at VS_EXT_EQ_IN whatever the calc_mask();
+               a helper subsystem should tick at one location only.
+   Oct 18, 26. install() returns -1 if the solver lacks the *_function2
+               calls it needs.
+   Oct 18, 26. Multi-rate subsystems and a helper thread.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_EXT_DISPATCH_H
+  #define _VS_EXT_DISPATCH_H
+
+  #include <atomic>
+  #include <condition_variable>
+  #include <deque>
+  #include <memory>
+  #include <mutex>
+  #include <string>
+  #include <thread>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_solver.h"   // per-instance solver API
+
+  #define VS_N_EXT_LOC       (VS_EXT_EQ_SAVE + 1) // number of vs_ext_loc values
+  #define VS_EXT_MASK(where) (1u << (where))      // bit for calc_mask()
+
+  typedef struct
+    {
+    vs_real period; // seconds between ticks, 0 = every call
+    vs_real phase;  // time of the first tick
+    vs_bool helper; // run calc() of the ticks on the helper thread
+    } vs_ext_rate;
+
+  typedef struct
+    {
+    long long ticks;        // calls of calc() at VS_EXT_EQ_IN and VS_EXT_EQ_OUT
+    long long skipped;      // calls of the solver between ticks
+    double    calc_seconds; // time in calc() at the ticks
+    double    wait_seconds; // time the solver waited for the helper thread
+    } vs_ext_rate_stats;
+
+  // One piece of external code. Override the calls that are needed.
+  class vs_ext_subsystem
+    {
+    public:
+      vs_ext_subsystem () : api(NULL) {}
+      virtual ~vs_ext_subsystem () {}
+
+      // locations for which calc() is called, as VS_EXT_MASK bits
+      virtual unsigned calc_mask (void) const {return 0;}
+
+      virtual void    setdef (void) {}
+      virtual vs_bool scan (char * /*key*/, char * /*buffer*/) {return FALSE;}
+      virtual void    echo (vs_ext_loc /*where*/) {}
+      virtual void    calc (vs_real /*t*/, vs_ext_loc /*where*/) {}
+      virtual void    release (void) {}
+
+      // Multi-rate subsystems (see above). The default is every call.
+      virtual vs_ext_rate rate (void) const {vs_ext_rate r = {0.0, 0.0, FALSE}; return r;}
+      virtual void        sample (vs_real /*t*/, vs_ext_loc /*where*/) {}
+
+    protected:
+      friend class vs_ext_dispatcher;
+      const vs_api_table *api; // API of the solver, set by install()
+
+      // Outputs of a subsystem with a rate, written by the dispatcher.
+      // Return the index for set_output().
+      int  add_output (vs_real *var, vs_bool interpolate = FALSE);
+      void set_output (int i, vs_real value) {outs[i].staged = value;}
+
+    private:
+      struct output
+        {
+        vs_real *var;
+        vs_bool  interpolate;
+        vs_real  staged, y0, y1; // from set_output, previous and last tick
+        };
+      std::vector<output> outs;
+    };
+
+
+  // Per-solver dispatcher installed as userData with the *_function2 calls.
+  class vs_ext_dispatcher
+    {
+    public:
+      vs_ext_dispatcher ();
+      ~vs_ext_dispatcher ();
+
+      // Subsystems are not owned and are called in the order added.
+      void add (vs_ext_subsystem *sub);
+      void remove (vs_ext_subsystem *sub);
+
+      // Install the dispatcher in a solver. Call after the subsystems are
+      // added and before the run starts. Return 0 if OK, -1 if the solver
+      // has no vs_install_calc_function2 or vs_install_echo_function2 (a
+      // DLL older than them), with a message in error_message().
+      int  install (const vs_api_table &api);
+
+      // Remove the installed functions, so the solver no longer refers to
+      // this dispatcher. Call before the dispatcher goes away if the solver
+      // stays loaded.
+      void uninstall (void);
+
+      // Targets of the installed functions.
+      void    setdef (void);
+      vs_bool scan (char *key, char *buffer);
+      void    echo (vs_ext_loc where);
+      void    calc (vs_real t, vs_ext_loc where)
+        {
+        if ((unsigned)where < VS_N_EXT_LOC)
+          {
+          if (!rated.empty()) calc_rated (t, where);
+          vs_ext_subsystem *const *sub = at[where].data();
+          for (size_t i = 0, n = at[where].size(); i < n; i++)
+            sub[i]->calc(t, where);
+          }
+        }
+      void    release (void);
+
+      // Counts of a subsystem with a rate since it was added (zeros if none).
+      vs_ext_rate_stats rate_stats (const vs_ext_subsystem *sub) const;
+
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_ext_dispatcher (const vs_ext_dispatcher &);            // not copyable
+      vs_ext_dispatcher &operator= (const vs_ext_dispatcher &);
+
+      // A subsystem with a rate and its schedule.
+      struct rated_sub
+        {
+        vs_ext_subsystem *sub;
+        vs_ext_rate rate;
+        unsigned    mask;                 // VS_EXT_EQ_IN and VS_EXT_EQ_OUT bits
+        vs_real     next[VS_N_EXT_LOC];   // time of the next tick
+        vs_real     t_tick;               // tick of the outputs in use
+        vs_bool     published, pending;   // pending: a helper tick not used yet
+        vs_bool     busy;                 // on the helper (under lock)
+        vs_ext_rate_stats st;             // under lock, but for skipped
+        std::atomic<long long> skipped;   // solver thread; read by rate_stats
+        };
+
+      void rebuild (void);
+      void calc_rated (vs_real t, vs_ext_loc where);
+      void tick (rated_sub &r, vs_real t, vs_ext_loc where);
+      void publish (rated_sub &r, vs_real t);
+      void apply (const rated_sub &r, vs_real t);
+      void wait (rated_sub &r);
+      void drain (void);
+      void helper_main (void);
+
+      const vs_api_table *api;
+      std::vector<vs_ext_subsystem *> subs;             // all subsystems
+      std::vector<vs_ext_subsystem *> at[VS_N_EXT_LOC]; // calc() per location
+      std::vector<std::unique_ptr<rated_sub> > rated;   // subsystems with a rate
+
+      // helper thread and its queue of ticks
+      struct job
+        {
+        rated_sub *r;
+        vs_real    t;
+        vs_ext_loc where;
+        };
+      std::thread helper;
+      mutable std::mutex lock;
+      std::condition_variable work, done;
+      std::deque<job> jobs;
+      bool stopping;
+      std::string error;
+    };
+
+#endif  // end block for _VS_EXT_DISPATCH_H
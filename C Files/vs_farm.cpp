@@ -0,0 +1,738 @@
+/* Runs spread over several machines through a shared directory. See
+   vs_farm.h.
+
+   Log:
+   Oct 18, 26. Simfile paths are stored absolute, or relative to the farm
+               directory, and not left relative to the coordinator's
+               working directory.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+  #include <windows.h>
+  #include <direct.h>
+  #include <process.h>
+#else
+  #include <dirent.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_jobs.h"     // vs_job_run
+#include "vs_farm.h"     // shared-directory farm
+
+#define VSS_JOB_MAGIC    "VS_FARM_JOB 1"
+#define VSS_RESULT_MAGIC "VS_FARM_RESULT 1"
+
+static double vss_wall_seconds (void)
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void vss_sleep (double seconds)
+{
+  std::this_thread::sleep_for (std::chrono::duration<double>(seconds));
+}
+
+static void vss_mkdir (const std::string &path)
+{
+#ifdef _WIN32
+  _mkdir (path.c_str());
+#else
+  mkdir (path.c_str(), 0777);
+#endif
+}
+
+static vs_bool vss_absolute (const std::string &path)
+{
+  return !path.empty() && (path[0] == '/' || path[0] == '\\' ||
+                           (path.size() > 1 && isalpha((unsigned char)path[0]) &&
+                            path[1] == ':'));
+}
+
+// A path made absolute from the working directory.
+static std::string vss_full_path (const std::string &path)
+{
+  char cwd[FILENAME_MAX];
+  std::string full;
+
+  if (vss_absolute(path)) return path;
+#ifdef _WIN32
+  if (_getcwd(cwd, sizeof(cwd)) == NULL) return path;
+#else
+  if (getcwd(cwd, sizeof(cwd)) == NULL) return path;
+#endif
+  full = cwd;
+  if (!full.empty() && full[full.size() - 1] != '/' && full[full.size() - 1] != '\\')
+    full += "/";
+  return full + (path.compare(0, 2, "./") ? path : path.substr(2));
+}
+
+static vs_bool vss_exists (const std::string &path)
+{
+  struct stat sb;
+  return stat(path.c_str(), &sb) == 0;
+}
+
+// Names of the files in a directory that end in ext, sorted.
+static std::vector<std::string> vss_list (const std::string &dir, const char *ext)
+{
+  std::vector<std::string> found;
+  std::string name;
+  size_t n_ext = strlen(ext);
+
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA((dir + "*" + ext).c_str(), &data);
+  if (h != INVALID_HANDLE_VALUE)
+    {
+    do found.push_back(data.cFileName);
+    while (FindNextFileA(h, &data));
+    FindClose (h);
+    }
+#else
+  DIR *d = opendir(dir.c_str());
+  struct dirent *e;
+  if (d)
+    {
+    while ((e = readdir(d)) != NULL) found.push_back(e->d_name);
+    closedir (d);
+    }
+#endif
+  for (size_t i = 0; i < found.size(); )
+    {
+    name = found[i];
+    if (name.size() > n_ext && !name.compare(name.size() - n_ext, n_ext, ext)) i++;
+    else found.erase(found.begin() + i);
+    }
+  std::sort (found.begin(), found.end());
+  return found;
+}
+
+static vs_bool vss_read_file (const std::string &path, std::string &text)
+{
+  FILE *fp = fopen(path.c_str(), "rb");
+  char buf[4096];
+  size_t n;
+
+  text.clear ();
+  if (fp == NULL) return FALSE;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) text.append(buf, n);
+  fclose (fp);
+  return TRUE;
+}
+
+// Write a file through a temporary name, so readers never see half of it.
+static vs_bool vss_write_file (const std::string &path, const std::string &text)
+{
+  std::string tmp = path + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  int err;
+
+  if (fp == NULL) return FALSE;
+  err = fwrite(text.data(), 1, text.size(), fp) != text.size();
+  if (fclose(fp)) err = 1;
+#ifdef _WIN32
+  if (!err) remove(path.c_str());
+#endif
+  if (err || rename(tmp.c_str(), path.c_str()))
+    {
+    remove (tmp.c_str());
+    return FALSE;
+    }
+  return TRUE;
+}
+
+// Next line of text from *pos, without the end of line.
+static vs_bool vss_line (const std::string &text, size_t *pos, std::string &line)
+{
+  size_t end;
+
+  if (*pos >= text.size()) return FALSE;
+  end = text.find('\n', *pos);
+  if (end == std::string::npos) end = text.size();
+  line = text.substr(*pos, end - *pos);
+  if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+  *pos = end + 1;
+  return TRUE;
+}
+
+static std::string vss_job_name (int id)
+{
+  char name[32];
+  sprintf (name, "%08d", id);
+  return name;
+}
+
+static std::string vss_format (const char *fmt, double x)
+{
+  char buf[64];
+  sprintf (buf, fmt, x);
+  return buf;
+}
+
+static vs_job_result vss_result (vs_job_status status, const char *error)
+{
+  vs_job_result r;
+
+  r.status = status;
+  r.t_end = 0.0;
+  r.seconds = 0.0;
+  r.cached = FALSE;
+  r.error = error;
+  return r;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Job and result files.
+---------------------------------------------------------------------------- */
+static std::string vss_job_text (const std::string &simfile, const vs_job_mods &mods)
+{
+  std::string text = VSS_JOB_MAGIC "\nsimfile " + simfile + "\n";
+  size_t i;
+
+  for (i = 0; i < mods.size(); i++)
+    text += "mod " + mods[i].first + vss_format(" %.17g\n", mods[i].second);
+  return text;
+}
+
+// A relative simfile path is taken from the farm directory dir.
+static vs_bool vss_parse_job (const std::string &text, const std::string &dir,
+                              std::string &simfile, vs_job_mods &mods)
+{
+  std::string line;
+  size_t pos = 0;
+  char key[256];
+  double value;
+
+  if (!vss_line(text, &pos, line) || line != VSS_JOB_MAGIC) return FALSE;
+  simfile.clear ();
+  mods.clear ();
+  while (vss_line(text, &pos, line))
+    {
+    if (!line.compare(0, 8, "simfile "))
+      simfile = line.substr(8);
+    else if (sscanf(line.c_str(), "mod %255s %lf", key, &value) == 2)
+      mods.push_back (std::make_pair(std::string(key), (vs_real)value));
+    }
+  if (!simfile.empty() && !vss_absolute(simfile)) simfile = dir + simfile;
+  return !simfile.empty();
+}
+
+// The error message is last and runs to the end of the file, since it may
+// have several lines.
+static std::string vss_result_text (const vs_job_result &r, const std::string &worker)
+{
+  std::string text = VSS_RESULT_MAGIC "\n";
+  size_t i;
+
+  text += vss_format("status %.0f\n", (double)r.status);
+  text += vss_format("t_end %.17g\n", r.t_end);
+  text += vss_format("seconds %.17g\n", r.seconds);
+  text += "worker " + worker + "\n";
+  text += vss_format("exports %.0f\n", (double)r.exports.size());
+  for (i = 0; i < r.exports.size(); i++) text += vss_format("%.17g\n", r.exports[i]);
+  text += "error\n" + r.error;
+  return text;
+}
+
+static vs_bool vss_parse_result (const std::string &text, vs_job_result &r,
+                                 std::string &worker)
+{
+  std::string line;
+  size_t pos = 0;
+  double x;
+  int status, n, i;
+
+  r = vss_result(VS_JOB_FAILED, "");
+  if (!vss_line(text, &pos, line) || line != VSS_RESULT_MAGIC) return FALSE;
+  if (!vss_line(text, &pos, line) || sscanf(line.c_str(), "status %d", &status) != 1 ||
+      !vss_line(text, &pos, line) || sscanf(line.c_str(), "t_end %lf", &x) != 1)
+    return FALSE;
+  r.status = (vs_job_status)status;
+  r.t_end = x;
+  if (!vss_line(text, &pos, line) || sscanf(line.c_str(), "seconds %lf", &r.seconds) != 1 ||
+      !vss_line(text, &pos, line) || line.compare(0, 7, "worker "))
+    return FALSE;
+  worker = line.substr(7);
+  if (!vss_line(text, &pos, line) || sscanf(line.c_str(), "exports %d", &n) != 1 || n < 0)
+    return FALSE;
+  r.exports.resize (n);
+  for (i = 0; i < n; i++)
+    {
+    if (!vss_line(text, &pos, line) || sscanf(line.c_str(), "%lf", &x) != 1) return FALSE;
+    r.exports[i] = x;
+    }
+  if (!vss_line(text, &pos, line) || line != "error") return FALSE;
+  if (pos < text.size()) r.error = text.substr(pos);
+  return TRUE;
+}
+
+// Split "00000012.NAME.job" into id and worker name.
+static vs_bool vss_parse_lease (const std::string &name, int *id, std::string &worker)
+{
+  size_t dot = name.find('.'), ext = name.rfind('.');
+
+  if (dot == std::string::npos || ext <= dot) return FALSE;
+  *id = atoi(name.c_str());
+  worker = name.substr(dot + 1, ext - dot - 1);
+  return *id > 0 && !worker.empty();
+}
+
+
+/* ----------------------------------------------------------------------------
+   Coordinator.
+---------------------------------------------------------------------------- */
+vs_farm_coordinator::vs_farm_coordinator ()
+  : next_id(1), max_attempts(3), lease_timeout(30.0), poll_interval(0.1),
+    n_releases(0)
+{
+}
+
+int vs_farm_coordinator::open (const char *directory)
+{
+  static const char *subdirs[4] = {"jobs/", "leases/", "results/", "workers/"};
+  static const char *exts[4] = {".job", ".job", ".res", ".beat"};
+  std::vector<std::string> old;
+  size_t k;
+  int i;
+
+  dir = directory;
+  if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+    dir += "/";
+  root = vss_full_path(dir);
+  vss_mkdir (dir);
+  for (i = 0; i < 4; i++)
+    {
+    vss_mkdir (dir + subdirs[i]);
+    if (!vss_exists(dir + subdirs[i]))
+      {
+      error = "The farm directory \"" + dir + subdirs[i] + "\" could not be made.";
+      dir.clear ();
+      return -1;
+      }
+    old = vss_list(dir + subdirs[i], exts[i]);
+    for (k = 0; k < old.size(); k++) remove((dir + subdirs[i] + old[k]).c_str());
+    }
+  remove ((dir + "stop").c_str());
+
+  jobs.clear ();
+  beats.clear ();
+  next_id = 1;
+  n_releases = 0;
+  return 0;
+}
+
+int vs_farm_coordinator::submit (const char *simfile, const vs_job_mods &mods)
+{
+  std::string path = vss_full_path(simfile);
+  job j;
+  int id = next_id;
+
+  if (dir.empty())
+    {
+    error = "The farm directory is not open.";
+    return -1;
+    }
+
+  // workers have their own working directory, and other machines may mount
+  // the farm directory somewhere else
+  if (!path.compare(0, root.size(), root)) path = path.substr(root.size());
+  if (!vss_write_file(dir + "jobs/" + vss_job_name(id) + ".job",
+                      vss_job_text(path, mods)))
+    {
+    error = "The job file for \"" + std::string(simfile) + "\" could not be written.";
+    return -1;
+    }
+  j.simfile = simfile;
+  j.mods = mods;
+  j.status = VS_JOB_QUEUED;
+  j.attempts = 0;
+  j.result = vss_result(VS_JOB_UNKNOWN, "");
+  jobs[id] = j;
+  next_id++;
+  return id;
+}
+
+// Remove a job from the queue and from any lease. A worker that loses its
+// lease stops the run.
+void vs_farm_coordinator::withdraw (int id)
+{
+  std::vector<std::string> leases = vss_list(dir + "leases/", ".job");
+  std::string prefix = vss_job_name(id) + ".";
+  size_t i;
+
+  remove ((dir + "jobs/" + vss_job_name(id) + ".job").c_str());
+  for (i = 0; i < leases.size(); i++)
+    if (!leases[i].compare(0, prefix.size(), prefix))
+      remove ((dir + "leases/" + leases[i]).c_str());
+}
+
+void vs_farm_coordinator::end (job &j, const vs_job_result &r)
+{
+  j.result = r;
+  j.status = r.status;
+}
+
+// Read one result file. The first result of a job wins; later ones (from a
+// worker that was thought dead) are dropped.
+void vs_farm_coordinator::collect (const std::string &name)
+{
+  std::string path = dir + "results/" + name, text, worker;
+  std::map<int, job>::iterator it = jobs.find(atoi(name.c_str()));
+  vs_job_result r;
+
+  if (!vss_read_file(path, text)) return;
+  remove (path.c_str());
+  if (it == jobs.end() || it->second.status >= VS_JOB_DONE) return;
+  if (!vss_parse_result(text, r, worker))
+    r = vss_result(VS_JOB_FAILED, "The result file could not be read.");
+  withdraw (it->first);
+  it->second.worker = worker;
+  end (it->second, r);
+}
+
+int vs_farm_coordinator::service (void)
+{
+  std::vector<std::string> names;
+  std::map<int, job>::iterator it;
+  std::map<std::string, beat>::iterator b;
+  std::string text, worker, lease;
+  double now = vss_wall_seconds();
+  size_t i;
+  int id, n_open = n_pending();
+
+  if (dir.empty()) return 0;
+
+  // results first: a job whose result is in is not looked for in leases/
+  names = vss_list(dir + "results/", ".res");
+  for (i = 0; i < names.size(); i++) collect(names[i]);
+
+  // heartbeats, timed on this machine's clock
+  names = vss_list(dir + "workers/", ".beat");
+  for (i = 0; i < names.size(); i++)
+    {
+    if (!vss_read_file(dir + "workers/" + names[i], text)) continue;
+    worker = names[i].substr(0, names[i].size() - 5);
+    b = beats.find(worker);
+    if (b == beats.end() || b->second.text != text)
+      {
+      beats[worker].text = text;
+      beats[worker].changed = now;
+      }
+    }
+
+  names = vss_list(dir + "leases/", ".job");
+  for (i = 0; i < names.size(); i++)
+    {
+    if (!vss_parse_lease(names[i], &id, worker)) continue;
+    it = jobs.find(id);
+    if (it == jobs.end() || it->second.status >= VS_JOB_DONE)
+      {
+      remove ((dir + "leases/" + names[i]).c_str());
+      continue;
+      }
+    job &j = it->second;
+    if (j.status == VS_JOB_QUEUED || j.worker != worker)
+      {
+      j.status = VS_JOB_RUNNING;
+      j.worker = worker;
+      j.attempts++;
+      }
+
+    // a worker not heard from yet gets the timeout from when its lease is seen
+    b = beats.find(worker);
+    if (b == beats.end())
+      {
+      beats[worker].changed = now;
+      continue;
+      }
+    if (now - b->second.changed < lease_timeout) continue;
+
+    lease = dir + "leases/" + names[i];
+    if (j.attempts >= max_attempts)
+      {
+      remove (lease.c_str());
+      end (j, vss_result(VS_JOB_FAILED, ("The job was lost by " +
+                         vss_format("%.0f", j.attempts) + " workers; the last was " +
+                         worker + ".").c_str()));
+      }
+    else if (!rename(lease.c_str(), (dir + "jobs/" + vss_job_name(id) + ".job").c_str()))
+      {
+      j.status = VS_JOB_QUEUED;
+      j.worker.clear ();
+      n_releases++;
+      }
+    }
+  return n_open - n_pending();
+}
+
+int vs_farm_coordinator::n_pending (void) const
+{
+  std::map<int, job>::const_iterator it;
+  int n = 0;
+
+  for (it = jobs.begin(); it != jobs.end(); ++it)
+    if (it->second.status < VS_JOB_DONE) n++;
+  return n;
+}
+
+vs_job_status vs_farm_coordinator::poll (int id)
+{
+  std::map<int, job>::const_iterator it;
+
+  service ();
+  it = jobs.find(id);
+  return it == jobs.end() ? VS_JOB_UNKNOWN : it->second.status;
+}
+
+vs_job_status vs_farm_coordinator::wait (int id, double timeout)
+{
+  double t0 = vss_wall_seconds();
+  vs_job_status status;
+
+  for (;;)
+    {
+    status = poll(id);
+    if (status == VS_JOB_UNKNOWN || status >= VS_JOB_DONE) return status;
+    if (timeout >= 0.0 && vss_wall_seconds() - t0 >= timeout) return status;
+    vss_sleep (poll_interval);
+    }
+}
+
+int vs_farm_coordinator::wait_all (double timeout)
+{
+  double t0 = vss_wall_seconds();
+  int n;
+
+  for (;;)
+    {
+    service ();
+    n = n_pending();
+    if (n == 0 || (timeout >= 0.0 && vss_wall_seconds() - t0 >= timeout)) return n;
+    vss_sleep (poll_interval);
+    }
+}
+
+int vs_farm_coordinator::cancel (int id)
+{
+  std::map<int, job>::iterator it = jobs.find(id);
+
+  if (it == jobs.end()) return -1;
+  if (it->second.status < VS_JOB_DONE)
+    {
+    withdraw (id);
+    end (it->second, vss_result(VS_JOB_CANCELLED, "The run was cancelled."));
+    }
+  return 0;
+}
+
+vs_job_result vs_farm_coordinator::result (int id) const
+{
+  std::map<int, job>::const_iterator it = jobs.find(id);
+
+  if (it == jobs.end() || it->second.status < VS_JOB_DONE)
+    return vss_result(VS_JOB_UNKNOWN, "");
+  return it->second.result;
+}
+
+const char *vs_farm_coordinator::worker (int id) const
+{
+  std::map<int, job>::const_iterator it = jobs.find(id);
+  return it == jobs.end() ? "" : it->second.worker.c_str();
+}
+
+void vs_farm_coordinator::forget (int id)
+{
+  std::map<int, job>::iterator it = jobs.find(id);
+
+  if (it == jobs.end()) return;
+  if (it->second.status < VS_JOB_DONE) withdraw(id);
+  jobs.erase (it);
+}
+
+int vs_farm_coordinator::n_workers (void) const
+{
+  std::map<std::string, beat>::const_iterator b;
+  double now = vss_wall_seconds();
+  int n = 0;
+
+  for (b = beats.begin(); b != beats.end(); ++b)
+    if (!b->second.text.empty() && now - b->second.changed < lease_timeout) n++;
+  return n;
+}
+
+void vs_farm_coordinator::stop_workers (void)
+{
+  if (!dir.empty()) vss_write_file(dir + "stop", "stop\n");
+}
+
+
+/* ----------------------------------------------------------------------------
+   Worker.
+---------------------------------------------------------------------------- */
+vs_farm_worker::vs_farm_worker (const char *directory, const char *name)
+  : job_id(0), n_beats(0), beat_interval(1.0), poll_interval(0.2),
+    stopping(false), cancel(false), beating(false)
+{
+  char host[256], pid[32];
+  size_t i;
+
+  dir = directory;
+  if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+    dir += "/";
+  if (name)
+    worker_name = name;
+  else
+    {
+#ifdef _WIN32
+    DWORD n = sizeof(host);
+    if (!GetComputerNameA(host, &n)) strcpy(host, "host");
+    sprintf (pid, "%d", (int)_getpid());
+#else
+    if (gethostname(host, sizeof(host))) strcpy(host, "host");
+    host[sizeof(host) - 1] = 0;
+    sprintf (pid, "%d", (int)getpid());
+#endif
+    worker_name = std::string(host) + "-" + pid;
+    }
+
+  // the name is part of file names, with '.' as a separator
+  for (i = 0; i < worker_name.size(); i++)
+    if (!isalnum((unsigned char)worker_name[i]) && worker_name[i] != '-')
+      worker_name[i] = '_';
+}
+
+// Write the beat file: a new count, and the job being run.
+void vs_farm_worker::write_beat (int id)
+{
+  char text[64];
+
+  sprintf (text, "%lld %d\n", ++n_beats, id);
+  vss_write_file (dir + "workers/" + worker_name + ".beat", text);
+}
+
+// Beat until run() ends. While a job runs, also check that the lease is still
+// ours; if not, the run is stopped.
+void vs_farm_worker::beat_main (void)
+{
+  std::unique_lock<std::mutex> guard(lock);
+
+  while (beating)
+    {
+    write_beat (job_id);
+    if (!lease.empty() && !vss_exists(lease)) cancel = true;
+    wake.wait_for (guard, std::chrono::duration<double>(beat_interval));
+    }
+}
+
+// Take the oldest queued job. Return 0 if one was taken.
+int vs_farm_worker::claim (std::string &path, int *id)
+{
+  std::vector<std::string> names = vss_list(dir + "jobs/", ".job");
+  std::string to;
+  size_t i;
+
+  for (i = 0; i < names.size(); i++)
+    {
+    *id = atoi(names[i].c_str());
+    to = dir + "leases/" + vss_job_name(*id) + "." + worker_name + ".job";
+    if (*id > 0 && !rename((dir + "jobs/" + names[i]).c_str(), to.c_str()))
+      {
+      path = to;
+      return 0;
+      }
+    }
+  return -1;
+}
+
+int vs_farm_worker::run (int max_jobs)
+{
+  vs_solver solver;
+  std::string loaded, dll, msg, simfile, path, text;
+  vs_job_mods mods;
+  vs_job_result r;
+  int id, n_runs = 0;
+
+  if (!vss_exists(dir + "jobs/") || !vss_exists(dir + "leases/") ||
+      !vss_exists(dir + "results/") || !vss_exists(dir + "workers/"))
+    {
+    error = "\"" + dir + "\" is not a farm directory.";
+    return -1;
+    }
+
+  beating = true;
+  std::thread beater(&vs_farm_worker::beat_main, this);
+
+  while (!stopping && !vss_exists(dir + "stop") && (max_jobs <= 0 || n_runs < max_jobs))
+    {
+    if (claim(path, &id))
+      {
+      vss_sleep (poll_interval);
+      continue;
+      }
+      {
+      std::lock_guard<std::mutex> guard(lock);
+      lease = path;
+      job_id = id;
+      cancel = false;
+      }
+    wake.notify_one (); // beat now with the job id
+
+    if (!vss_read_file(path, text) || !vss_parse_job(text, dir, simfile, mods))
+      r = vss_result(VS_JOB_FAILED, "The job file could not be read.");
+    else if (vs_solver::simfile_dll_path(simfile.c_str(), dll, msg))
+      r = vss_result(VS_JOB_FAILED, msg.c_str());
+    else if (dll != loaded && solver.load(dll.c_str(), FALSE))
+      {
+      r = vss_result(VS_JOB_FAILED, solver.error_message());
+      loaded.clear ();
+      }
+    else
+      {
+      loaded = dll;
+      vs_job_run (solver, simfile.c_str(), mods, &cancel, &r);
+      }
+
+      {
+      std::lock_guard<std::mutex> guard(lock);
+      lease.clear ();
+      job_id = 0;
+      }
+    // no result if the lease was taken back: the job is someone else's now
+    if (!cancel && vss_exists(path))
+      {
+      vss_write_file (dir + "results/" + vss_job_name(id) + ".res",
+                      vss_result_text(r, worker_name));
+      remove (path.c_str());
+      }
+    n_runs++;
+    }
+
+    {
+    std::lock_guard<std::mutex> guard(lock);
+    beating = false;
+    }
+  wake.notify_one ();
+  beater.join ();
+  remove ((dir + "workers/" + worker_name + ".beat").c_str());
+  return n_runs;
+}
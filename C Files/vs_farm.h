@@ -0,0 +1,194 @@
+/* Runs spread over several machines through a shared directory.
+
+   A vs_farm_coordinator writes jobs (a simfile plus parameter changes, as
+   for vs_job_pool) into a directory that all machines can reach. Each
+   machine runs one or more worker processes (vs_farm_worker, or the
+   vs_farm_worker program), which take jobs, make the runs with vs_job_run
+   and write the results back. Several workers on one machine are just
+   several processes with the same directory.
+
+   Directory layout (all files are written to a temporary name and renamed,
+   so nobody reads half a file):
+     jobs/00000012.job          queued job
+     leases/00000012.NAME.job   job taken by worker NAME (renamed from jobs/)
+     results/00000012.res       result written by the worker
+     workers/NAME.beat          heartbeat of worker NAME
+     stop                       workers exit when they see it
+
+   A worker takes a job by renaming it from jobs/ to leases/; a rename is
+   atomic, so only one worker gets it. While it runs, the worker rewrites its
+   beat file with a new count every beat interval. The coordinator does not
+   compare clocks of different machines: it notes on its own clock when each
+   beat file last changed, and when a worker holding a lease has not beaten
+   for the lease timeout, the job is renamed back to jobs/ for another worker
+   (up to a number of attempts). A worker whose lease disappears (given to
+   another worker, or cancelled) stops its run and writes no result. If a
+   worker that was thought dead does finish, the first result that arrives
+   is kept and the job is withdrawn from anywhere else.
+
+   Workers do not share the coordinator's working directory, and other
+   machines may mount the farm directory under another path. A simfile given
+   to submit() with a relative path is taken from the coordinator's working
+   directory; the job holds it relative to the farm directory if it is in
+   that directory, and absolute if not. Workers take a relative path in a job
+   from their own farm directory. A simfile outside the farm directory must
+   therefore have the same absolute path on every machine; keep the runs of
+   a sweep in the farm directory when machines mount it differently.
+
+   The coordinator does its work when service(), poll(), wait() or
+   wait_all() is called; call one of them regularly.
+
+     vs_farm_coordinator farm;
+     farm.open ("/shared/sweep");
+     id = farm.submit ("Runs/Run1.sim", mods);
+     farm.wait_all (-1.0);
+     r = farm.result (id);
+
+   Workers:  vs_farm_worker [-name n] [-jobs n] [-beat s] /shared/sweep
+   Or vs_farm_run to submit a list of jobs and write the results (see
+   vs_farm_run.cpp).
+
+   Log:
+   Oct 18, 26. Simfile paths in jobs are absolute or relative to the farm
+               directory.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_FARM_H
+  #define _VS_FARM_H
+
+  #include <atomic>
+  #include <condition_variable>
+  #include <map>
+  #include <mutex>
+  #include <string>
+  #include <thread>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_jobs.h"     // vs_job_mods, vs_job_result, vs_job_run
+
+  class vs_farm_coordinator
+    {
+    public:
+      vs_farm_coordinator ();
+
+      // Use a directory (made if needed). Jobs and results left in it from an
+      // earlier coordinator are removed (live workers beat again). Return 0 if
+      // OK, -1 if not.
+      int open (const char *dir);
+
+      // Queue a run and return its job id (> 0), or -1 if the job file could
+      // not be written. A relative simfile path is taken from the working
+      // directory (see above).
+      int submit (const char *simfile, const vs_job_mods &mods = vs_job_mods());
+
+      // Collect results and give the jobs of dead workers to others. Return
+      // the number of jobs that ended in this call.
+      int service (void);
+
+      vs_job_status poll (int id); // calls service()
+
+      // Wait for one job, or for all. timeout < 0 waits forever. wait_all
+      // returns the number of jobs not ended.
+      vs_job_status wait (int id, double timeout = -1.0);
+      int wait_all (double timeout = -1.0);
+
+      // Cancel a queued or running job. Return 0 if the job was found.
+      int cancel (int id);
+
+      // Result of an ended job; status VS_JOB_UNKNOWN if not ended. The name
+      // of the worker that made the run is in worker().
+      vs_job_result result (int id) const;
+      const char *worker (int id) const;
+      void forget (int id);
+
+      // A lease is taken back when its worker has not beaten for timeout
+      // seconds; a job is failed after max_attempts leases.
+      void set_lease_timeout (double timeout) {lease_timeout = timeout;}
+      void set_max_attempts (int n) {max_attempts = n;}
+      void set_poll_interval (double seconds) {poll_interval = seconds;}
+
+      // Jobs queued or running.
+      int n_pending (void) const;
+
+      // Workers that have beaten within the lease timeout.
+      int n_workers (void) const;
+
+      // Jobs given back to the queue because a worker died.
+      long long releases (void) const {return n_releases;}
+
+      // Ask all workers to exit after their current run.
+      void stop_workers (void);
+
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      struct job
+        {
+        std::string simfile, worker;
+        vs_job_mods mods;
+        vs_job_status status;
+        int attempts;  // leases so far
+        vs_job_result result;
+        };
+      struct beat
+        {
+        std::string text; // contents of the beat file when last read
+        double changed;   // coordinator time when it last changed
+        };
+
+      void collect (const std::string &name);
+      void withdraw (int id);
+      void end (job &j, const vs_job_result &r);
+
+      std::string dir, root, error; // root: dir from the file system root
+      std::map<int, job> jobs;
+      std::map<std::string, beat> beats;
+      int next_id, max_attempts;
+      double lease_timeout, poll_interval;
+      long long n_releases;
+    };
+
+  class vs_farm_worker
+    {
+    public:
+      // name: unique among the workers of the directory (letters, digits,
+      // '-' and '_'); NULL for host-pid.
+      vs_farm_worker (const char *dir, const char *name = NULL);
+
+      // Take and run jobs until the stop file appears, stop() is called or
+      // max_jobs (> 0) runs were made. Return the number of runs made, or -1
+      // if the directory could not be used.
+      int run (int max_jobs = 0);
+
+      // Make run() return after the current run (any thread, or a signal
+      // handler).
+      void stop (void) {stopping = true;}
+
+      void set_beat_interval (double seconds) {beat_interval = seconds;}
+      void set_poll_interval (double seconds) {poll_interval = seconds;}
+
+      const char *name (void) const {return worker_name.c_str();}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_farm_worker (const vs_farm_worker &);            // not copyable
+      vs_farm_worker &operator= (const vs_farm_worker &);
+
+      int  claim (std::string &lease, int *id);
+      void beat_main (void);
+      void write_beat (int id);
+
+      std::string dir, worker_name, error;
+      std::string lease;   // current lease file, "" when idle (under lock)
+      int  job_id;         // id of the current job (under lock)
+      long long n_beats;
+      double beat_interval, poll_interval;
+      std::atomic<bool> stopping, cancel;
+      bool beating;
+      std::mutex lock;
+      std::condition_variable wake;
+    };
+
+#endif  // end block for _VS_FARM_H
@@ -0,0 +1,190 @@
+/* Coordinator program of a run farm (see vs_farm.h): submit a list of jobs
+   to the farm directory, wait for the workers, and write the results.
+
+   Usage: vs_farm_run [-lease s] [-attempts n] [-timeout s] [-csv file]
+                      [-stop] dir jobfile
+
+   Each line of the job file is a simfile followed by parameter changes,
+   KEYWORD=value; blank lines and lines starting with # are skipped. A
+   simfile path with spaces is put in double quotes:
+     "C:/Sweep Runs/Run1.sim"  SPEED=80  MU=0.85
+   A relative simfile path is taken from the current directory, and given to
+   the workers as described in vs_farm.h.
+
+   The CSV file has one row per job: simfile, status, worker, seconds, end
+   time, the exports and the error message. With -stop, the workers are
+   asked to exit when all jobs are over.
+
+   Log:
+   Oct 18, 26. Note on relative simfile paths.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_jobs.h"     // vs_job_mods
+#include "vs_farm.h"     // shared-directory farm
+
+static const char *vss_status_name (vs_job_status status)
+{
+  switch (status)
+    {
+    case VS_JOB_QUEUED:    return "queued";
+    case VS_JOB_RUNNING:   return "running";
+    case VS_JOB_DONE:      return "done";
+    case VS_JOB_FAILED:    return "failed";
+    case VS_JOB_CANCELLED: return "cancelled";
+    default:               return "unknown";
+    }
+}
+
+// Parse one line of the job file. Return FALSE for a line with no job.
+static vs_bool vss_parse_line (const char *line, std::string &simfile, vs_job_mods &mods)
+{
+  const char *p = line, *end, *eq;
+  std::string word;
+
+  simfile.clear ();
+  mods.clear ();
+  for (;;)
+    {
+    while (*p == ' ' || *p == '\t') p++;
+    if (!*p || *p == '\n' || *p == '\r' || (*p == '#' && simfile.empty())) break;
+    if (*p == '"' && simfile.empty() && (end = strchr(p + 1, '"')) != NULL)
+      {
+      simfile.assign (p + 1, end - p - 1);
+      p = end + 1;
+      continue;
+      }
+    for (end = p; *end && *end != ' ' && *end != '\t' && *end != '\n' && *end != '\r'; end++) ;
+    word.assign (p, end - p);
+    p = end;
+    if (simfile.empty())
+      simfile = word;
+    else if ((eq = strchr(word.c_str(), '=')) != NULL)
+      mods.push_back (std::make_pair(word.substr(0, eq - word.c_str()),
+                                     (vs_real)atof(eq + 1)));
+    else
+      printf ("Ignored \"%s\": not KEYWORD=value.\n", word.c_str());
+    }
+  return !simfile.empty();
+}
+
+// CSV field in quotes, with quotes doubled.
+static void vss_csv_text (FILE *fp, const std::string &text)
+{
+  size_t i;
+
+  fputc ('"', fp);
+  for (i = 0; i < text.size(); i++)
+    {
+    if (text[i] == '"') fputc('"', fp);
+    fputc (text[i] == '\n' || text[i] == '\r' ? ' ' : text[i], fp);
+    }
+  fputc ('"', fp);
+}
+
+int main (int argc, char **argv)
+{
+  vs_farm_coordinator farm;
+  std::vector<int> ids;
+  std::vector<std::string> simfiles;
+  std::string simfile;
+  vs_job_mods mods;
+  vs_job_result r;
+  const char *dir = NULL, *jobfile = NULL, *csv = NULL;
+  double timeout = -1.0;
+  vs_bool stop = FALSE;
+  char line[4096];
+  FILE *fp;
+  size_t i, k;
+  int id, n_failed = 0, n_left;
+
+  for (i = 1; i < (size_t)argc; i++)
+    {
+    if (!strcmp(argv[i], "-lease") && i + 1 < (size_t)argc) farm.set_lease_timeout(atof(argv[++i]));
+    else if (!strcmp(argv[i], "-attempts") && i + 1 < (size_t)argc) farm.set_max_attempts(atoi(argv[++i]));
+    else if (!strcmp(argv[i], "-timeout") && i + 1 < (size_t)argc) timeout = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-csv") && i + 1 < (size_t)argc) csv = argv[++i];
+    else if (!strcmp(argv[i], "-stop")) stop = TRUE;
+    else if (dir == NULL) dir = argv[i];
+    else jobfile = argv[i];
+    }
+  if (jobfile == NULL)
+    {
+    printf ("Usage: vs_farm_run [-lease s] [-attempts n] [-timeout s] [-csv file]\n"
+            "                   [-stop] dir jobfile\n");
+    return 1;
+    }
+
+  if (farm.open(dir))
+    {
+    printf ("%s\n", farm.error_message());
+    return 1;
+    }
+  if ((fp = fopen(jobfile, "r")) == NULL)
+    {
+    printf ("Could not read \"%s\".\n", jobfile);
+    return 1;
+    }
+  while (fgets(line, sizeof(line), fp))
+    {
+    if (!vss_parse_line(line, simfile, mods)) continue;
+    if ((id = farm.submit(simfile.c_str(), mods)) < 0)
+      {
+      printf ("%s\n", farm.error_message());
+      fclose (fp);
+      return 1;
+      }
+    ids.push_back (id);
+    simfiles.push_back (simfile);
+    }
+  fclose (fp);
+  printf ("Submitted %d jobs to %s.\n", (int)ids.size(), dir);
+
+  // report progress every few seconds while waiting
+  do
+    {
+    n_left = farm.wait_all(timeout < 0.0 ? 5.0 : (timeout < 5.0 ? timeout : 5.0));
+    if (timeout >= 0.0) timeout = timeout > 5.0 ? timeout - 5.0 : 0.0;
+    printf ("%d of %d jobs left, %d workers, %lld re-leased.\n", n_left,
+            (int)ids.size(), farm.n_workers(), farm.releases());
+    }
+  while (n_left > 0 && timeout != 0.0);
+
+  for (i = 0; i < ids.size(); i++)
+    if (farm.poll(ids[i]) < VS_JOB_DONE) farm.cancel(ids[i]);
+  if (stop) farm.stop_workers();
+
+  fp = csv ? fopen(csv, "w") : NULL;
+  if (csv && fp == NULL) printf("Could not write \"%s\".\n", csv);
+  if (fp) fprintf(fp, "simfile,status,worker,seconds,t_end,exports,error\n");
+  for (i = 0; i < ids.size(); i++)
+    {
+    r = farm.result(ids[i]);
+    if (r.status != VS_JOB_DONE)
+      {
+      n_failed++;
+      printf ("%s: %s %s\n", simfiles[i].c_str(), vss_status_name(r.status),
+              r.error.c_str());
+      }
+    if (fp == NULL) continue;
+    vss_csv_text (fp, simfiles[i]);
+    fprintf (fp, ",%s,%s,%.3f,%.17g,", vss_status_name(r.status), farm.worker(ids[i]),
+             r.seconds, r.t_end);
+    for (k = 0; k < r.exports.size(); k++) fprintf(fp, "%s%.17g", k ? " " : "", r.exports[k]);
+    fputc (',', fp);
+    vss_csv_text (fp, r.error);
+    fputc ('\n', fp);
+    }
+  if (fp) fclose(fp);
+
+  printf ("%d of %d jobs done.\n", (int)ids.size() - n_failed, (int)ids.size());
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,64 @@
+/* Worker process of a run farm (see vs_farm.h). Start one per core on each
+   machine that can reach the farm directory.
+
+   Usage: vs_farm_worker [-name n] [-jobs n] [-beat s] [-poll s] dir
+
+   The worker takes jobs until the coordinator asks the workers to stop, or
+   after -jobs runs. Ctrl-C ends it after the current run.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_farm.h"     // shared-directory farm
+
+static vs_farm_worker *worker;
+
+static void vss_interrupt (int)
+{
+  if (worker) worker->stop();
+}
+
+int main (int argc, char **argv)
+{
+  const char *dir = NULL, *name = NULL;
+  double beat = 1.0, poll = 0.2;
+  int i, max_jobs = 0, n;
+
+  for (i = 1; i < argc; i++)
+    {
+    if (!strcmp(argv[i], "-name") && i + 1 < argc) name = argv[++i];
+    else if (!strcmp(argv[i], "-jobs") && i + 1 < argc) max_jobs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-beat") && i + 1 < argc) beat = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-poll") && i + 1 < argc) poll = atof(argv[++i]);
+    else dir = argv[i];
+    }
+  if (dir == NULL)
+    {
+    printf ("Usage: vs_farm_worker [-name n] [-jobs n] [-beat s] [-poll s] dir\n");
+    return 1;
+    }
+
+  vs_farm_worker w(dir, name);
+  w.set_beat_interval (beat);
+  w.set_poll_interval (poll);
+  worker = &w;
+  signal (SIGINT, vss_interrupt);
+  n = w.run(max_jobs);
+  worker = NULL;
+
+  if (n < 0)
+    {
+    printf ("%s\n", w.error_message());
+    return 1;
+    }
+  printf ("Worker %s made %d runs.\n", w.name(), n);
+  return 0;
+}
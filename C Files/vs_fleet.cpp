@@ -0,0 +1,230 @@
+/* Lockstep stepping of many vehicles. See vs_fleet.h.
+
+   Log:
+   Oct 18, 26. Check the optional API functions that are used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_solver.h"    // per-instance solver API
+#include "vs_task_pool.h" // work-stealing pool
+#include "vs_fleet.h"     // lockstep stepping of many vehicles
+
+#define VSS_LINE 8 // vs_real values per 64-byte cache line
+
+static vs_bool vss_same (const char *a, const char *b)
+{
+  for (; *a && *b; a++, b++)
+    if (toupper((unsigned char)*a) != toupper((unsigned char)*b)) return FALSE;
+  return *a == *b;
+}
+
+static void vss_names (int (*get) (char **), std::vector<std::string> &names)
+{
+  std::vector<char *> p;
+  int n = get(NULL);
+
+  names.clear ();
+  if (n <= 0) return;
+  p.assign (n + 1, (char *)NULL);
+  get (p.data());
+  for (int i = 0; i < n; i++) names.push_back(p[i] ? p[i] : "");
+}
+
+
+vs_fleet::vs_fleet (int n_workers)
+  : pool(n_workers), imp_buf(NULL), exp_buf(NULL), n_imp(0), n_exp(0), ld(0),
+    block(1), t(0.0), dt(0.0), n_ticks(0)
+{
+}
+
+vs_fleet::~vs_fleet ()
+{
+  close ();
+}
+
+/* ----------------------------------------------------------------------------
+   Load and read every vehicle, then lay out the buffers. The configurations
+   are read on the pool, each by one worker.
+---------------------------------------------------------------------------- */
+int vs_fleet::open (const std::vector<std::string> &simfiles)
+{
+  std::vector<std::string> names;
+  std::vector<int> n_import(simfiles.size()), n_export(simfiles.size());
+  size_t v, m = simfiles.size();
+  uintptr_t base;
+
+  close ();
+  error.clear ();
+  for (v = 0; v < m; v++)
+    {
+    cars.push_back (std::unique_ptr<car>(new car));
+    if (cars[v]->solver.load_simfile(simfiles[v].c_str(), TRUE))
+      {
+      error = "Vehicle " + std::to_string(v) + ": " + cars[v]->solver.error_message();
+      cars.pop_back ();
+      close ();
+      return -1;
+      }
+    const vs_api_table &api = cars[v]->solver.api;
+    if (api.vs_get_import_names == NULL || api.vs_get_export_names == NULL)
+      error = vs_api_missing("vs_get_import_names");
+    else if (api.vs_copy_export_vars == NULL)
+      error = vs_api_missing("vs_copy_export_vars");
+    if (!error.empty())
+      {
+      error = "Vehicle " + std::to_string(v) + ": " + error;
+      close ();
+      return -1;
+      }
+    }
+
+  pool.run ((int)m, [&] (int k, int) {
+    car &c = *cars[k];
+    vs_real tstop, step;
+    c.solver.api.vs_read_configuration (simfiles[k].c_str(), &n_import[k],
+                                        &n_export[k], &c.t, &tstop, &step);
+    c.started = TRUE;
+    c.running = !c.solver.api.vs_error_occurred();
+    c.failed = !c.running;
+    });
+
+  for (v = 0; v < m; v++)
+    {
+    const vs_api_table &api = cars[v]->solver.api;
+
+    if (cars[v]->failed)
+      error = api.vs_get_error_message();
+    else if (v == 0)
+      {
+      vss_names (api.vs_get_import_names, import_names);
+      vss_names (api.vs_get_export_names, export_names);
+      n_imp = n_import[0];
+      n_exp = n_export[0];
+      t = cars[0]->t;
+      dt = api.vs_get_tstep();
+      }
+    else if (n_import[v] != n_imp || n_export[v] != n_exp ||
+             api.vs_get_tstep() != dt)
+      error = "It does not have the imports, exports or time step of vehicle 0.";
+    else
+      {
+      vss_names (api.vs_get_import_names, names);
+      for (int i = 0; i < n_imp && error.empty(); i++)
+        if (!vss_same(names[i].c_str(), import_names[i].c_str()))
+          error = "Import " + std::to_string(i) + " is " + names[i] + ", not " +
+                  import_names[i] + " as in vehicle 0.";
+      vss_names (api.vs_get_export_names, names);
+      for (int i = 0; i < n_exp && error.empty(); i++)
+        if (!vss_same(names[i].c_str(), export_names[i].c_str()))
+          error = "Export " + std::to_string(i) + " is " + names[i] + ", not " +
+                  export_names[i] + " as in vehicle 0.";
+      }
+    if (!error.empty())
+      {
+      error = "Vehicle " + std::to_string(v) + " (" + simfiles[v] + "): " + error;
+      close ();
+      return -1;
+      }
+    cars[v]->in.assign (n_imp + 1, 0.0);
+    cars[v]->out.assign (n_exp + 1, 0.0);
+    }
+
+  // Rows of whole cache lines, from a 64-byte boundary.
+  ld = (int)((m + VSS_LINE - 1)/VSS_LINE*VSS_LINE);
+  if (ld == 0) ld = VSS_LINE;
+  buffer.assign ((size_t)(n_imp + n_exp)*ld + VSS_LINE, 0.0);
+  base = (uintptr_t)buffer.data();
+  imp_buf = buffer.data() + ((64 - base % 64) % 64)/sizeof(vs_real);
+  exp_buf = imp_buf + (size_t)n_imp*ld;
+  block = (int)m >= VSS_LINE*pool.size() ? VSS_LINE : 1;
+
+  // Exports at the start, as vs_read_configuration left them.
+  for (v = 0; v < m; v++)
+    {
+    cars[v]->solver.api.vs_copy_export_vars (cars[v]->out.data());
+    for (int i = 0; i < n_exp; i++) exp_buf[(size_t)i*ld + v] = cars[v]->out[i];
+    }
+  return 0;
+}
+
+void vs_fleet::close (void)
+{
+  for (size_t v = 0; v < cars.size(); v++)
+    if (cars[v]->started)
+      cars[v]->solver.api.vs_terminate_run(cars[v]->t);
+  cars.clear ();
+  import_names.clear ();
+  export_names.clear ();
+  buffer.clear ();
+  imp_buf = exp_buf = NULL;
+  n_imp = n_exp = ld = 0;
+  t = dt = 0.0;
+  n_ticks = 0;
+}
+
+int vs_fleet::import_index (const char *name) const
+{
+  for (size_t i = 0; i < import_names.size(); i++)
+    if (vss_same(import_names[i].c_str(), name)) return (int)i;
+  return -1;
+}
+
+int vs_fleet::export_index (const char *name) const
+{
+  for (size_t i = 0; i < export_names.size(); i++)
+    if (vss_same(export_names[i].c_str(), name)) return (int)i;
+  return -1;
+}
+
+
+/* ----------------------------------------------------------------------------
+   One tick.
+---------------------------------------------------------------------------- */
+void vs_fleet::step_car (int v)
+{
+  car &c = *cars[v];
+  vs_real *in = c.in.data(), *out = c.out.data();
+  int i;
+
+  if (!c.running) return;
+  for (i = 0; i < n_imp; i++) in[i] = imp_buf[(size_t)i*ld + v];
+  if (c.solver.api.vs_integrate_io(c.t, in, out))
+    {
+    c.running = FALSE;
+    c.failed = c.solver.api.vs_error_occurred();
+    }
+  c.t += dt;
+  for (i = 0; i < n_exp; i++) exp_buf[(size_t)i*ld + v] = out[i];
+}
+
+int vs_fleet::step (void)
+{
+  int m = size(), n_tasks = (m + block - 1)/block, v, n_running = 0;
+
+  if (pool.size() == 1) // no hand-off to the pool
+    for (v = 0; v < m; v++) step_car(v);
+  else
+    pool.run (n_tasks, [&] (int task, int) {
+      for (int k = task*block, end = k + block < m ? k + block : m; k < end; k++)
+        step_car (k);
+      });
+  t += dt;
+  n_ticks++;
+
+  for (v = 0; v < m; v++)
+    {
+    if (cars[v]->failed && error.empty())
+      error = "Vehicle " + std::to_string(v) + ": " +
+              cars[v]->solver.api.vs_get_error_message();
+    n_running += cars[v]->running;
+    }
+  return error.empty() ? n_running : -1;
+}
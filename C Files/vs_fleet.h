@@ -0,0 +1,110 @@
+/* Lockstep stepping of many vehicles, each in its own solver instance.
+
+   Traffic and platoon studies advance M vehicles together. Calling
+   vs_integrate_io on each in turn, with a small import and export array
+   per vehicle, leaves the controller that drives them to loop over
+   vehicles as well. A vs_fleet loads one private copy of the solver per
+   vehicle (see vs_solver.h) and keeps all imports and exports in two
+   structure-of-arrays buffers, one row per channel and one column per
+   vehicle:
+
+     imports(c)[v]   import c of vehicle v, set by the caller
+     exports(c)[v]   export c of vehicle v, after the last tick
+
+   A controller for the whole fleet is then a loop over a row, which the
+   compiler can vectorize:
+
+     vs_fleet fleet(0);                   // one worker per core
+     fleet.open (simfiles);               // one simfile per vehicle
+     int vx = fleet.export_index("VX"), thr = fleet.import_index("IMP_THROTTLE");
+     while (fleet.step() > 0)             // one tick of every running vehicle
+       for (v = 0; v < fleet.size(); v++)
+         fleet.imports(thr)[v] = k*(v_target - fleet.exports(vx)[v]);
+
+   step() advances all running vehicles by one time step on a vs_task_pool.
+   Each task steps a block of vehicles and moves their columns in and out
+   of the buffers. Rows are padded to a multiple of 8 vehicles and start on
+   64-byte boundaries, so with blocks of 8 (used when there are at least 8
+   vehicles per worker) no two workers write the same cache line.
+
+   All vehicles must have the same imports, exports and time step. A
+   vehicle whose run stops (vs_integrate_io not 0) keeps its last exports
+   and is not stepped again.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_FLEET_H
+  #define _VS_FLEET_H
+
+  #include <memory>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h"  // VS types and definitions
+  #include "vs_solver.h"    // per-instance solver API
+  #include "vs_task_pool.h" // work-stealing pool
+
+  class vs_fleet
+    {
+    public:
+      // n_workers 0: one per hardware thread.
+      vs_fleet (int n_workers = 0);
+      ~vs_fleet ();
+
+      // Load a solver for each simfile and read its configuration. Return 0
+      // if OK, -1 if not (see error_message()).
+      int  open (const std::vector<std::string> &simfiles);
+      void close (void);
+
+      int size (void) const {return (int)cars.size();}
+      int stride (void) const {return ld;}
+      int n_import (void) const {return n_imp;}
+      int n_export (void) const {return n_exp;}
+
+      // Row of a channel by name, -1 if there is none.
+      int import_index (const char *name) const;
+      int export_index (const char *name) const;
+
+      // Rows of the buffers: stride() values, size() of them used.
+      vs_real       *imports (int channel) {return imp_buf + (size_t)channel*ld;}
+      const vs_real *exports (int channel) const {return exp_buf + (size_t)channel*ld;}
+
+      // One tick. Return the number of vehicles still running, -1 if a run
+      // ended with an error (see error_message()).
+      int step (void);
+
+      vs_real   time (void) const {return t;}
+      vs_real   tstep (void) const {return dt;}
+      long long ticks (void) const {return n_ticks;}
+      vs_bool   running (int v) const {return cars[v]->running;}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_fleet (const vs_fleet &);            // not copyable
+      vs_fleet &operator= (const vs_fleet &);
+
+      struct car
+        {
+        car () : t(0.0), started(FALSE), running(FALSE), failed(FALSE) {}
+        vs_solver solver;
+        vs_real   t;
+        vs_bool   started, running, failed; // started: the run must be ended
+        std::vector<vs_real> in, out;       // vs_integrate_io arrays
+        };
+
+      void step_car (int v);
+
+      vs_task_pool pool;
+      std::vector<std::unique_ptr<car> > cars;
+      std::vector<std::string> import_names, export_names;
+      std::vector<vs_real> buffer;  // both buffers, with room to align
+      vs_real *imp_buf, *exp_buf;   // n_imp and n_exp rows of ld values
+      int       n_imp, n_exp, ld, block;
+      vs_real   t, dt;
+      long long n_ticks;
+      std::string error;
+    };
+
+#endif  // end block for _VS_FLEET_H
@@ -2,15 +2,25 @@
    in vs_api.h are global, so this only works for a single loaded DLL.
    
    Log:
+   Oct 18, 26. The *_function2 install functions are optional: they are NULL
+               if the DLL predates them.
+   Oct 18, 26. Builds without windows.h (see vs_target.h); messages go to
+               stderr there. vs_copy_extra_state_vars_from_array was got by
+               the wrong name. vs_get_dll_path skips blank lines.
+   Oct 18, 26. Get the *_function2 install functions that pass user data.
    May 17, 10. M. Sayers. Complete re-write with vs_get_api, better error handling.
    May 18, 09. M. Sayers. Include vs_get_api_install_external for CarSim 8.0.
    Jun 13, 08. M. Sayers. Created for the release of CarSim 7.1.
    */
    
 // Standard C headers.
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <windows.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+  #include <windows.h>
+#endif
 
 #include "vs_deftypes.h" // VS types and definitions
 #include "vs_api.h"  // VS API definitions as prototypes
@@ -25,7 +35,11 @@ static int vss_printf_error (int code, const char *format, ...)
   vsprintf (tmpstr, format, args);
   va_end (args);
   
+#if defined(_WIN32) || defined(_WIN64)
   MessageBox (NULL, tmpstr, "Sorry", MB_ICONERROR);
+#else
+  fprintf (stderr, "%s\n", tmpstr);
+#endif
   return code;
 }
 
@@ -49,6 +63,7 @@ int vs_get_dll_path(char *simfile, char *pathDLL)
     {
     key = (char *)strtok(tmpstr, " \t\n");
     rest = (char *)strtok(NULL, "\n\t");
+    if (key == NULL) continue;
     if (!strcmp(key, "DLLFILE") && rest && rest[0])
       {
       strcpy (pathDLL, rest);
@@ -87,6 +102,12 @@ static int vss_get (void *api_func, HMODULE dll, char *func, char *dll_name,
 
 }
 
+// get an API function that older DLLs lack; NULL if it is not there
+static void vss_get_optional (void *api_func, HMODULE dll, char *func)
+{
+  (*(void**)api_func) = dll ? (void *)GetProcAddress(dll, func) : NULL;
+}
+
 // utility to handle error if a DLL isn't there.
 static int vss_print_no_dll (char *where, char *dll_name)
 {
@@ -155,6 +176,12 @@ int vs_get_api (HMODULE dll, char *dname)
   if (vss_get(&vs_install_setdef_function, dll, "vs_install_setdef_function", dname, me)) return -2;
   if (vss_get(&vs_install_scan_function, dll, "vs_install_scan_function", dname, me)) return -2;
   if (vss_get(&vs_install_free_function, dll, "vs_install_free_function", dname, me)) return -2;
+  // with user data; NULL in DLLs that predate them (check before use)
+  vss_get_optional (&vs_install_calc_function2, dll, "vs_install_calc_function2");
+  vss_get_optional (&vs_install_echo_function2, dll, "vs_install_echo_function2");
+  vss_get_optional (&vs_install_setdef_function2, dll, "vs_install_setdef_function2");
+  vss_get_optional (&vs_install_scan_function2, dll, "vs_install_scan_function2");
+  vss_get_optional (&vs_install_free_function2, dll, "vs_install_free_function2");
 
   // functions for interacting with the VS math model (chapter 7)
   if (vss_get(&vs_define_import, dll, "vs_define_import", dname, me)) return -2;
@@ -256,7 +283,7 @@ int vs_get_api (HMODULE dll, char *dname)
   if (vss_get(&vs_copy_all_state_vars_to_array, dll, "vs_copy_all_state_vars_to_array", dname, me)) return -2;
   if (vss_get(&vs_copy_differential_state_vars_from_array, dll, "vs_copy_differential_state_vars_from_array", dname, me)) return -2;
   if (vss_get(&vs_copy_differential_state_vars_to_array, dll, "vs_copy_differential_state_vars_to_array", dname, me)) return -2;
-  if (vss_get(&vs_copy_extra_state_vars_from_array, dll, "vs_target_l", dname, me)) return -2;
+  if (vss_get(&vs_copy_extra_state_vars_from_array, dll, "vs_copy_extra_state_vars_from_array", dname, me)) return -2;
   if (vss_get(&vs_copy_extra_state_vars_to_array, dll, "vs_copy_extra_state_vars_to_array", dname, me)) return -2;
   if (vss_get(&vs_get_export_names, dll, "vs_get_export_names", dname, me)) return -2;
   if (vss_get(&vs_get_import_names, dll, "vs_get_import_names", dname, me)) return -2;
@@ -375,6 +402,12 @@ int vs_get_api_install_external (HMODULE dll, char *dname)
   if (vss_get(&vs_install_setdef_function, dll, "vs_install_setdef_function", dname, me)) return -2;
   if (vss_get(&vs_install_scan_function, dll, "vs_install_scan_function", dname, me)) return -2;
   if (vss_get(&vs_install_free_function, dll, "vs_install_free_function", dname, me)) return -2;
+  // with user data; NULL in DLLs that predate them (check before use)
+  vss_get_optional (&vs_install_calc_function2, dll, "vs_install_calc_function2");
+  vss_get_optional (&vs_install_echo_function2, dll, "vs_install_echo_function2");
+  vss_get_optional (&vs_install_setdef_function2, dll, "vs_install_setdef_function2");
+  vss_get_optional (&vs_install_scan_function2, dll, "vs_install_scan_function2");
+  vss_get_optional (&vs_install_free_function2, dll, "vs_install_free_function2");
 
   return 0;
 }
\ No newline at end of file
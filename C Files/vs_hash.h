@@ -0,0 +1,58 @@
+/* 128-bit content hash, for naming cached and shared data by what it holds
+   (shared tables, spline coefficients, run results).
+
+   Two independent 64-bit lanes, an FNV-1a style xor-multiply and a
+   multiply-rotate mix, over the data 8 bytes at a time; a last partial word
+   is mixed with its length. The hash is not cryptographic, and its value
+   depends on how the data is split between add() calls: callers add the
+   same pieces in the same order. Where a collision would give wrong data,
+   the data that is cheap to keep is compared as well.
+
+   Log:
+   Oct 18, 26. Created, from the copies in the shared tables, spline cache
+               and result cache.
+*/
+
+#ifndef _VS_HASH_H
+  #define _VS_HASH_H
+
+  #include <stddef.h>
+  #include <stdint.h>
+  #include <string.h>
+
+  class vs_hasher
+    {
+    public:
+      vs_hasher () {h[0] = 0xcbf29ce484222325ULL; h[1] = 0x9e3779b97f4a7c15ULL;}
+
+      void add (const void *data, size_t n)
+        {
+        const unsigned char *p = (const unsigned char *)data;
+        uint64_t w;
+
+        for (; n >= 8; n -= 8, p += 8)
+          {
+          memcpy (&w, p, 8);
+          mix (w);
+          }
+        if (n)
+          {
+          w = 0;
+          memcpy (&w, p, n);
+          mix (w ^ ((uint64_t)n << 56));
+          }
+        }
+      void add (int64_t i) {mix((uint64_t)i);}
+
+      uint64_t h[2];
+
+    private:
+      void mix (uint64_t w)
+        {
+        h[0] = (h[0] ^ w)*0x100000001b3ULL;
+        h[1] = (h[1] ^ (w*0x9e3779b97f4a7c15ULL))*0xc2b2ae3d27d4eb4fULL;
+        h[1] = (h[1] << 31) | (h[1] >> 33);
+        }
+    };
+
+#endif  // end block for _VS_HASH_H
@@ -0,0 +1,271 @@
+/* Inverse lookup of 1D tables. See vs_inverse_table.h.
+
+   Log:
+   Oct 18, 26. Added vs_inverse_group.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"      // VS types and definitions
+#include "vs_inverse_table.h" // inverse table lookup
+
+#define VSS_NEWTON 30 // most Newton steps in a spline interval
+
+vs_inverse_table::vs_inverse_table ()
+  : gain(1.0), offset(0.0), start_x(0.0), scale_x(1.0), y_min(0.0), x_min(0.0),
+    x_max(0.0), spline(FALSE), hold(FALSE)
+{
+}
+
+void vs_inverse_table::clear (void)
+{
+  key.clear ();
+  xs.clear ();
+  ys.clear ();
+  d.clear ();
+  run_of.clear ();
+  runs.clear ();
+}
+
+
+/* ----------------------------------------------------------------------------
+   Cut the points into monotonic runs. A run ends where y turns back; a
+   flat part belongs to the run before it. Neighbor runs share a point.
+---------------------------------------------------------------------------- */
+int vs_inverse_table::build (const vs_table *tab)
+{
+  int n, i, start, dir, s;
+  const vs_real *x, *y;
+  vs_real y_max;
+
+  clear ();
+  error.clear ();
+  if (tab == NULL)
+    {
+    error = "There is no table.";
+    return -1;
+    }
+  switch (tab->type)
+    {
+    case VS_TAB_LIN: case VS_TAB_LIN_FLAT: case VS_TAB_LIN_LOOP:
+      spline = FALSE;
+      break;
+    case VS_SPLINE: case VS_SPLINE_FLAT: case VS_SPLINE_LOOP:
+      spline = TRUE;
+      break;
+    default:
+      error = "Only LINEAR and SPLINE 1D tables have an inverse.";
+      return -1;
+    }
+  n = tab->nx;
+  x = tab->x;
+  y = tab->y;
+  if (n < 2 || x == NULL || y == NULL || (spline && tab->dydx == NULL))
+    {
+    error = "The table needs two points or more (and slopes, for a spline).";
+    return -1;
+    }
+  if (tab->gain == 0.0 || tab->scale_x == 0.0)
+    {
+    error = "A table with a gain or scale of zero has no inverse.";
+    return -1;
+    }
+  hold = tab->type != VS_TAB_LIN && tab->type != VS_SPLINE;
+  gain = tab->gain;
+  offset = tab->offset;
+  start_x = tab->start_x;
+  scale_x = tab->scale_x;
+
+  auto add_run = [&] (int a, int b, int sign)
+    {
+    run r = {(int)key.size(), (int)key.size() + b - a, (vs_real)sign};
+
+    for (int j = a; j <= b; j++)
+      {
+      key.push_back (sign*y[j]);
+      xs.push_back (x[j]);
+      ys.push_back (y[j]);
+      d.push_back (spline ? tab->dydx[j] : 0.0);
+      run_of.push_back ((int)runs.size());
+      }
+    runs.push_back (r);
+    };
+
+  start = 0;
+  dir = 0;
+  for (i = 1; i < n; i++)
+    {
+    s = y[i] > y[i - 1] ? 1 : (y[i] < y[i - 1] ? -1 : 0);
+    if (s == 0 || s == dir) continue;
+    if (dir)
+      {
+      add_run (start, i - 1, dir);
+      start = i - 1;
+      }
+    dir = s;
+    }
+  if (dir == 0)
+    {
+    error = "The table is flat; it has no inverse.";
+    return -1;
+    }
+  add_run (start, n - 1, dir);
+
+  x_min = x_max = x[0];
+  y_min = y_max = y[0];
+  for (i = 1; i < n; i++)
+    {
+    if (y[i] < y_min)
+      {
+      y_min = y[i];
+      x_min = x[i];
+      }
+    if (y[i] > y_max)
+      {
+      y_max = y[i];
+      x_max = x[i];
+      }
+    }
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Lookups.
+---------------------------------------------------------------------------- */
+vs_real vs_inverse_table::x (vs_real y, int *hint) const
+{
+  vs_real v, q;
+  size_t r;
+  int k = *hint;
+
+  if (runs.empty()) return 0.0;
+  v = (y - offset)/gain;
+  r = k >= 0 && k < (int)run_of.size() ? run_of[k] : 0;
+  q = runs[r].sign*v;
+  if (!(q >= key[runs[r].first] && q <= key[runs[r].last]))
+    { // not on the run of the hint: the first run with it
+    for (r = 0; r < runs.size(); r++)
+      {
+      q = runs[r].sign*v;
+      if (q >= key[runs[r].first] && q <= key[runs[r].last]) break;
+      }
+    if (r == runs.size()) return start_x + scale_x*outside(v);
+    }
+  return start_x + scale_x*solve(runs[r], v, hint);
+}
+
+void vs_inverse_table::x (const vs_real *y, vs_real *x, int n, int *hint) const
+{
+  int i;
+
+  for (i = 0; i < n; i++) x[i] = this->x(y[i], hint);
+}
+
+// Table x for table value v in a run that has it.
+vs_real vs_inverse_table::solve (const run &r, vs_real v, int *hint) const
+{
+  vs_real q = r.sign*v, den, u, a, b, h, y0, y1, d0, d1, p, dp, un;
+  int lo = r.first, hi = r.last - 1, k = *hint, len, half, i;
+
+  // interval k: key[k] < q <= key[k + 1], or the first one
+  if (k >= lo && k <= hi)
+    for (i = 0; i < 4; i++)
+      {
+      if (key[k] >= q && k > lo) k--;
+      else if (key[k + 1] < q && k < hi) k++;
+      else
+        {
+        lo = hi = k;
+        break;
+        }
+      }
+  // bisection without branches on the data (random values mispredict them)
+  for (len = hi - lo + 1; len > 1; len -= half)
+    {
+    half = len/2;
+    lo = key[lo + half] < q ? lo + half : lo;
+    }
+  k = lo;
+  *hint = k;
+
+  den = key[k + 1] - key[k];
+  u = den > 0.0 ? (q - key[k])/den : 0.0;
+  if (u < 0.0) u = 0.0;
+  if (u > 1.0) u = 1.0;
+  h = xs[k + 1] - xs[k];
+  if (!spline) return xs[k] + u*h;
+
+  // Newton on the cubic from the straight-line guess, kept in [a, b]
+  y0 = ys[k];
+  y1 = ys[k + 1];
+  d0 = d[k]*h;
+  d1 = d[k + 1]*h;
+  a = 0.0;
+  b = 1.0;
+  for (i = 0; i < VSS_NEWTON; i++)
+    {
+    p = (1.0 + 2.0*u)*(1.0 - u)*(1.0 - u)*y0 + u*(1.0 - u)*(1.0 - u)*d0 +
+        u*u*(3.0 - 2.0*u)*y1 - u*u*(1.0 - u)*d1;
+    if (fabs(p - v) <= 1e-14*(fabs(y0) + fabs(y1))) break;
+    if (r.sign*(p - v) < 0.0) a = u;
+    else b = u;
+    dp = 6.0*u*(u - 1.0)*(y0 - y1) + (3.0*u*u - 4.0*u + 1.0)*d0 + (3.0*u*u - 2.0*u)*d1;
+    un = dp != 0.0 ? u - (p - v)/dp : 0.5*(a + b);
+    if (!(un > a && un < b)) un = 0.5*(a + b);
+    if (fabs(un - u) < 1e-15) break;
+    u = un;
+    }
+  return xs[k] + u*h;
+}
+
+// Table x for a table value past the range of all runs.
+vs_real vs_inverse_table::outside (vs_real v) const
+{
+  const run &r = runs[0];
+  vs_real slope;
+  int e, o;
+
+  if (runs.size() > 1) return v < y_min ? x_min : x_max;
+  if (r.sign*v < key[r.first])
+    {
+    e = r.first;
+    o = e + 1;
+    }
+  else
+    {
+    e = r.last;
+    o = e - 1;
+    }
+  if (hold) return xs[e];
+  slope = spline ? d[e] : (ys[o] - ys[e])/(xs[o] - xs[e]);
+  if (!(slope*r.sign > 0.0)) return xs[e];
+  return xs[e] + (v - ys[e])/slope;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Index the tables of a group that has inverse lookups.
+---------------------------------------------------------------------------- */
+int vs_inverse_group::build (const vs_tab_group *group)
+{
+  int i;
+
+  clear ();
+  error.clear ();
+  if (group == NULL || !group->inverse || group->table == NULL) return 0;
+  tables.resize (group->ntab);
+  for (i = 0; i < group->ntab; i++)
+    if (tables[i].build(group->table[i]))
+      {
+      error = std::string("Table ") + std::to_string(i + 1) + ": " +
+              tables[i].error_message();
+      clear ();
+      return -1;
+      }
+  return 0;
+}
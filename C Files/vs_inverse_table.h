@@ -0,0 +1,118 @@
+/* Inverse lookup of 1D tables: the x for which a table gives y.
+
+   Tire and powertrain code often has to solve a table for its argument
+   (the slip for a force, the throttle for a torque). Searching on x with
+   forward lookups takes dozens of them per solve. A vs_inverse_table is
+   built once from the table, after it is filled: the points are cut into
+   monotonic runs (one for a monotonic table), and each run keeps its y
+   values as a sorted key array (y, or -y where y falls), with the x values
+   and spline slopes next to them. A lookup finds the run whose y range has
+   the value, then the interval in it from a hint (a few steps from the last
+   one) or by bisection, and inverts the interval: a straight line for
+   LINEAR tables, a few safeguarded Newton steps on the cubic for SPLINE
+   tables.
+
+     vs_inverse_table inv;
+     inv.build (tab);          // after the table is filled
+     x = inv.x (y, &hint);     // one lookup; hint kept by the caller
+     inv.x (ys, xs, n, &hint); // many, in order
+
+   The hint is an interval of this index (up to nx + runs - 2), not a table
+   interval, so it is kept in the caller's storage (one int per instance),
+   never in the solver's j_inverse array.
+
+   A vs_inverse_group indexes every table of a group that has its inverse
+   flag set, at load time: build it once the solver has filled the group's
+   tables (after vs_copy_table_data, or after vs_read_configuration for the
+   solver's own groups), and again if they are read again.
+
+     vs_inverse_group inv;
+     inv.build (group);        // nothing for a group without the flag
+     x = inv.table(itab).x (y, &hints[itab*group->ninst + inst]);
+
+   Gain, offset, start_x and scale_x of the table are applied as in the
+   forward lookup. Types: LINEAR, SPLINE and their FLAT and LOOP forms; a
+   LOOP table is inverted over one period.
+
+   Where the table is not monotonic, a value can be found on more than one
+   run. The run of the hint is tried first, so a value that moves a little
+   stays on its branch; otherwise the first run (lowest x) with it is used.
+   On a flat part the lowest x of the part is returned. Values past the
+   ends of a monotonic table are extrapolated as the forward lookup does
+   (held for FLAT and LOOP tables); past the range of a non-monotonic
+   table, the x of its lowest or highest point is returned.
+
+   Log:
+   Oct 18, 26. Added vs_inverse_group; hints are kept by the caller.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_INVERSE_TABLE_H
+  #define _VS_INVERSE_TABLE_H
+
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  class vs_inverse_table
+    {
+    public:
+      vs_inverse_table ();
+
+      // Index a 1D table. Build again if the table data change. Return 0 if
+      // OK, -1 if not.
+      int  build (const vs_table *tab);
+      void clear (void);
+
+      // x for which the table gives y. hint: an int the caller keeps between
+      // calls, one per instance (any value to start).
+      vs_real x (vs_real y, int *hint) const;
+
+      // x[i] for y[i], i = 0 to n-1, with one hint.
+      void    x (const vs_real *y, vs_real *x, int n, int *hint) const;
+
+      vs_bool built (void) const {return !runs.empty();}
+      vs_bool monotonic (void) const {return runs.size() == 1;}
+      int     n_runs (void) const {return (int)runs.size();}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      struct run
+        {
+        int     first, last; // points in the arrays below
+        vs_real sign;        // 1 if y rises, -1 if it falls
+        };
+
+      vs_real solve (const run &r, vs_real v, int *hint) const;
+      vs_real outside (vs_real v) const;
+
+      std::vector<vs_real> key, xs, ys, d; // by run: sign*y, x, y, slope
+      std::vector<int> run_of;             // run of each point
+      std::vector<run> runs;
+      vs_real gain, offset, start_x, scale_x;
+      vs_real y_min, x_min, x_max; // lowest y; x of the lowest and highest y
+      vs_bool spline, hold;  // cubic intervals; hold past the ends
+      std::string error;
+    };
+
+  // Inverse index of each table in a group with the inverse flag.
+  class vs_inverse_group
+    {
+    public:
+      // Build one index per table if group->inverse is set; none if it is
+      // not. Return 0 if OK, -1 if a table has no inverse.
+      int  build (const vs_tab_group *group);
+      void clear (void) {tables.clear();}
+
+      vs_bool built (void) const {return !tables.empty();}
+      int     ntab (void) const {return (int)tables.size();}
+      const vs_inverse_table &table (int itab) const {return tables[itab];}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      std::vector<vs_inverse_table> tables;
+      std::string error;
+    };
+
+#endif  // end block for _VS_INVERSE_TABLE_H
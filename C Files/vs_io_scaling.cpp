@@ -0,0 +1,214 @@
+/* Import and export copies done by the client. See vs_io_scaling.h.
+
+   Log:
+   Oct 18, 26. Export gains by vs_measure_export_gains; the copies read the
+               arrays into locals, so they are not read again per store.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define VSS_SSE2
+#endif
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_export_mask.h"  // vs_measure_export_gains
+#include "vs_io_scaling.h"   // client-side import and export copies
+
+// Round up to a multiple of 64 bytes.
+static size_t vss_align64 (size_t n)
+{
+  return (n + 63) & ~(size_t)63;
+}
+
+// x2 is twice x1, and x1 is not 0: the channel scales by x1.
+static vs_bool vss_linear (vs_real x1, vs_real x2)
+{
+  return x1 != 0.0 && fabs(x2 - 2.0*x1) <= 1e-12*fabs(x1);
+}
+
+vs_io_scaling::vs_io_scaling ()
+  : solver_api(NULL), n_import(0), n_export(0), block(NULL), import_ptr(NULL),
+    export_ptr(NULL), import_scale(NULL), export_gain(NULL), import_copy(FALSE)
+{
+}
+
+vs_io_scaling::~vs_io_scaling ()
+{
+  free (block);
+}
+
+/* ----------------------------------------------------------------------------
+   The four arrays, each on a 64-byte boundary of one block, with room for
+   a pair past the end.
+---------------------------------------------------------------------------- */
+void vs_io_scaling::pack (int n_imports, int n_exports)
+{
+  size_t np_i = vss_align64((n_imports + 2)*sizeof(vs_real *)),
+         np_e = vss_align64((n_exports + 2)*sizeof(vs_real *)),
+         ng_i = vss_align64((n_imports + 2)*sizeof(vs_real)),
+         ng_e = vss_align64((n_exports + 2)*sizeof(vs_real));
+  char *p;
+
+  free (block);
+  block = malloc(np_i + np_e + ng_i + ng_e + 64);
+  p = (char *)block + (64 - (size_t)block % 64) % 64;
+  import_ptr = (vs_real **)p;
+  export_ptr = (vs_real **)(p + np_i);
+  import_scale = (vs_real *)(p + np_i + np_e);
+  export_gain = (vs_real *)(p + np_i + np_e + ng_i);
+  n_import = n_imports;
+  n_export = n_exports;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Get the variable of each channel and measure its gain. Return the number
+   of channels left to the DLL, -1 if the DLL lacks a function used.
+---------------------------------------------------------------------------- */
+int vs_io_scaling::resolve (const vs_api_table &api)
+{
+  std::vector<char *> names;
+  std::vector<vs_real> one, two, saved, values;
+  std::vector<int> index;
+  int n_imp, n_exp, i;
+
+  solver_api = NULL;
+  if (api.vs_get_import_names == NULL || api.vs_get_export_names == NULL ||
+      api.vs_copy_import_vars == NULL || api.vs_copy_export_vars == NULL)
+    return -1;
+  n_imp = api.vs_get_import_names(NULL);
+  n_exp = api.vs_get_export_names(NULL);
+  if (n_imp < 0) n_imp = 0;
+  if (n_exp < 0) n_exp = 0;
+  pack (n_imp, n_exp);
+  dummy.assign (n_imp + n_exp + 1, 0.0);
+  all.assign (n_exp + 1, 0.0);
+  copied.clear ();
+  import_copy = FALSE;
+
+  // imports: copied in as 1, then 2, and read from their variables
+  names.assign (n_imp + 1, (char *)NULL);
+  if (n_imp) api.vs_get_import_names(names.data());
+  saved.assign (n_imp + 1, 0.0);
+  for (i = 0; i < n_imp; i++)
+    {
+    import_ptr[i] = names[i] ? api.vs_get_var_ptr(names[i]) : NULL;
+    if (import_ptr[i]) saved[i] = *import_ptr[i];
+    }
+  one.assign (n_imp + 1, 0.0);
+  two.assign (n_imp + 1, 0.0);
+  values.assign (n_imp + 1, 1.0);
+  api.vs_copy_import_vars (values.data());
+  for (i = 0; i < n_imp; i++) if (import_ptr[i]) one[i] = *import_ptr[i];
+  values.assign (n_imp + 1, 2.0);
+  api.vs_copy_import_vars (values.data());
+  for (i = 0; i < n_imp; i++) if (import_ptr[i]) two[i] = *import_ptr[i];
+  for (i = 0; i < n_imp; i++) if (import_ptr[i]) *import_ptr[i] = saved[i];
+  for (i = 0; i < n_imp; i++)
+    {
+    import_scale[i] = one[i];
+    if (import_ptr[i] == NULL || !vss_linear(one[i], two[i]))
+      {
+      import_ptr[i] = &dummy[i];
+      import_scale[i] = 0.0;
+      import_copy = TRUE;
+      }
+    }
+
+  // exports: measured as in vs_export_mask, export i for channel i
+  names.assign (n_exp + 1, (char *)NULL);
+  if (n_exp) api.vs_get_export_names(names.data());
+  index.assign (n_exp + 1, 0);
+  for (i = 0; i < n_exp; i++)
+    {
+    export_ptr[i] = names[i] ? api.vs_get_var_ptr(names[i]) : NULL;
+    index[i] = i;
+    }
+  vs_measure_export_gains (api, export_ptr, index.data(), n_exp, export_gain);
+  for (i = 0; i < n_exp; i++)
+    if (export_gain[i] == 0.0)
+      {
+      export_ptr[i] = &dummy[n_imp + i]; // gather_exports writes the slot
+      copied.push_back (i);
+      }
+
+  solver_api = &api;
+  return n_copied();
+}
+
+
+/* ----------------------------------------------------------------------------
+   The copies, two channels at a time with SSE2. The arrays and counts are
+   read into locals first: the SSE2 stores may alias anything, so members
+   would be read again after each store.
+---------------------------------------------------------------------------- */
+void vs_io_scaling::scatter_imports (const vs_real *imports)
+{
+  vs_real *const *p = import_ptr;
+  const vs_real *g = import_scale;
+  int i = 0, n = n_import;
+
+  if (import_copy)
+    {
+    solver_api->vs_copy_import_vars ((vs_real *)imports);
+    return;
+    }
+#ifdef VSS_SSE2
+  for (; i + 2 <= n; i += 2)
+    {
+    __m128d v = _mm_mul_pd(_mm_loadu_pd(imports + i), _mm_load_pd(g + i));
+    _mm_storel_pd (p[i], v);
+    _mm_storeh_pd (p[i + 1], v);
+    }
+#endif
+  for (; i < n; i++) *p[i] = imports[i]*g[i];
+}
+
+void vs_io_scaling::gather_exports (vs_real *exports)
+{
+  vs_real *const *p = export_ptr;
+  const vs_real *g = export_gain;
+  int i = 0, n = n_export;
+  size_t k;
+
+#ifdef VSS_SSE2
+  for (; i + 2 <= n; i += 2)
+    {
+    __m128d v = _mm_loadh_pd(_mm_load_sd(p[i]), p[i + 1]);
+    _mm_storeu_pd (exports + i, _mm_mul_pd(v, _mm_load_pd(g + i)));
+    }
+#endif
+  for (; i < n; i++) exports[i] = *p[i]*g[i];
+  if (copied.empty()) return;
+  solver_api->vs_copy_export_vars (all.data());
+  for (k = 0; k < copied.size(); k++) exports[copied[k]] = all[copied[k]];
+}
+
+int vs_io_scaling::integrate_io (vs_real t, const vs_real *imports, vs_real *exports)
+{
+  int status;
+
+  if (imports) scatter_imports(imports);
+  status = solver_api->vs_integrate(&t, NULL);
+  if (exports) gather_exports(exports);
+  return status;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Resolve when the model has been initialized.
+---------------------------------------------------------------------------- */
+void vs_io_scaling::calc (vs_real /*t*/, vs_ext_loc where)
+{
+  if (where != VS_EXT_EQ_INIT || api == NULL) return;
+  if (resolve(*api) < 0)
+    api->vs_printf_error ("%s\n", vs_api_missing("vs_get_import_names, "
+                          "vs_get_export_names or a copy function").c_str());
+}
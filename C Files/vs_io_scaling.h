@@ -0,0 +1,92 @@
+/* Import and export copies done by the client, with the unit gains
+   gathered into aligned arrays once.
+
+   vs_copy_import_vars and vs_copy_export_vars (and vs_integrate_io, which
+   calls both) convert every channel between user and internal units inside
+   the DLL, in whatever way the DLL does it. A vs_io_scaling does the same
+   copies from the client side, for any DLL: when the run is configured it
+   looks up the variable of every import and export with vs_get_var_ptr and
+   finds its gain, and keeps the pointers and gains in four arrays, each on
+   a 64-byte boundary. Each step, scatter_imports() and gather_exports() are
+   then one pass over the channels, the scaling fused with the copy (two
+   channels at a time with SSE2).
+
+   The API has no function that gives a unit gain, so the gains are measured,
+   as in vs_export_mask: each variable is set to 1 and to 2 and read back
+   through vs_copy_export_vars; each import is copied in as 1 and as 2
+   through vs_copy_import_vars and its variable read (the variables are
+   restored). A channel that does not scale that way, or has no variable, is
+   left to the DLL: exports by a full vs_copy_export_vars for those slots,
+   imports by the DLL's vs_copy_import_vars for all of them if any import is
+   such a channel. VS units have a gain and no offset.
+
+   Exports are the model value times the gain, as the DLL gives them.
+   Imports are multiplied by the measured reciprocal of the gain where the
+   DLL divides by the gain, so an import can differ from the DLL's copy in
+   the last bit.
+
+     vs_io_scaling io;
+     ext.add (&io);                       // resolves at VS_EXT_EQ_INIT
+     ...
+     io.integrate_io (t, imports, exports); // each step, instead of
+                                            // vs_integrate_io
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_IO_SCALING_H
+  #define _VS_IO_SCALING_H
+
+  #include <vector>
+
+  #include "vs_deftypes.h"     // VS types and definitions
+  #include "vs_solver.h"       // per-instance solver API
+  #include "vs_ext_dispatch.h" // external code dispatcher
+
+  class vs_io_scaling : public vs_ext_subsystem
+    {
+    public:
+      vs_io_scaling ();
+      ~vs_io_scaling ();
+
+      // Resolve all imports and exports of the run; the model must be read.
+      // Return the number of channels left to the DLL, -1 if the DLL has no
+      // vs_get_import_names, vs_get_export_names or copy functions.
+      int resolve (const vs_api_table &api);
+      vs_bool resolved (void) const {return solver_api != NULL;}
+
+      int n_imports (void) const {return n_import;}
+      int n_exports (void) const {return n_export;}
+      int n_copied (void) const {return (int)copied.size() + (import_copy ? n_import : 0);}
+
+      // As vs_copy_import_vars and vs_copy_export_vars.
+      void scatter_imports (const vs_real *imports);
+      void gather_exports (vs_real *exports);
+
+      // As vs_integrate_io: imports copied in (if not NULL), one step,
+      // exports copied out (if not NULL).
+      int integrate_io (vs_real t, const vs_real *imports, vs_real *exports);
+
+      // vs_ext_subsystem: resolve at VS_EXT_EQ_INIT.
+      unsigned calc_mask (void) const {return VS_EXT_MASK(VS_EXT_EQ_INIT);}
+      void     calc (vs_real t, vs_ext_loc where);
+
+    private:
+      vs_io_scaling (const vs_io_scaling &);            // not copyable
+      vs_io_scaling &operator= (const vs_io_scaling &);
+
+      void pack (int n_imports, int n_exports);
+
+      const vs_api_table *solver_api;   // from resolve()
+      int n_import, n_export;
+      void *block;                      // the four arrays below
+      vs_real **import_ptr, **export_ptr;
+      vs_real *import_scale;            // internal units per user unit
+      vs_real *export_gain;             // user units per internal unit
+      vs_bool import_copy;              // imports go through the DLL
+      std::vector<int> copied;          // exports taken from all[]
+      std::vector<vs_real> all, dummy;
+    };
+
+#endif  // end block for _VS_IO_SCALING_H
@@ -0,0 +1,477 @@
+/* Asynchronous solver runs on a pool of worker threads. See vs_jobs.h.
+
+   Log:
+   Oct 18, 26. A cached result has the seconds of the run that made it.
+   Oct 18, 26. Jobs copy the cache and stage settings at submit; the setters
+               take the pool lock.
+   Oct 18, 26. Check the optional API functions that are used.
+   Oct 18, 26. Stage the output files of runs.
+   Oct 18, 26. Use a vs_result_cache.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_echo_sink.h"    // buffered run output
+#include "vs_jobs.h"         // asynchronous runs
+#include "vs_result_cache.h" // run result cache
+
+// Subsystem that stops the run when the job is cancelled.
+class vss_cancel_check : public vs_ext_subsystem
+  {
+  public:
+    vss_cancel_check (const std::atomic<bool> *flag) : flag(flag) {}
+    unsigned calc_mask (void) const {return VS_EXT_MASK(VS_EXT_EQ_OUT);}
+    void calc (vs_real, vs_ext_loc)
+      {
+      if (flag->load(std::memory_order_relaxed))
+        api->vs_set_stop_run (1.0, "The run was cancelled.");
+      }
+  private:
+    const std::atomic<bool> *flag;
+  };
+
+static double vss_wall_seconds (void)
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Result with no run.
+static vs_job_result vss_result (vs_job_status status)
+{
+  vs_job_result r;
+
+  r.status = status;
+  r.t_end = 0.0;
+  r.seconds = 0.0;
+  r.cached = FALSE;
+  return r;
+}
+
+static bool vss_ended (vs_job_status status)
+{
+  return status == VS_JOB_DONE || status == VS_JOB_FAILED ||
+         status == VS_JOB_CANCELLED;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Make one run with a loaded solver, the same way vs_run does, with the
+   parameter changes applied after the parsfiles are read. Return 0 if OK.
+---------------------------------------------------------------------------- */
+int vs_job_run (vs_solver &solver, const char *simfile, const vs_job_mods &mods,
+                const std::atomic<bool> *cancel, vs_job_result *result)
+{
+  const vs_api_table &api = solver.api;
+  vs_ext_dispatcher ext;
+  vss_cancel_check check(cancel);
+  vs_sym_attr_type type;
+  double wall = vss_wall_seconds();
+  vs_real t;
+  size_t i;
+  int id, n;
+
+  *result = vss_result(VS_JOB_FAILED);
+
+  if (cancel)
+    {
+    ext.add (&check);
+    if (ext.install(api))
+      {
+      result->error = ext.error_message();
+      return -1;
+      }
+    }
+  t = api.vs_setdef_and_read(simfile, NULL, NULL);
+  for (i = 0; i < mods.size() && !api.vs_error_occurred(); i++)
+    {
+    id = api.vs_get_var_id((char *)mods[i].first.c_str(), &type);
+    if (id < 0)
+      api.vs_printf_error ("The keyword \"%s\" is not a parameter in this model.\n",
+                           mods[i].first.c_str());
+    else
+      api.vs_set_sym_real (id, type, mods[i].second);
+    }
+
+  if (!api.vs_error_occurred())
+    {
+    api.vs_initialize (t, NULL, NULL);
+    while (!api.vs_stop_run()) api.vs_integrate(&t, NULL);
+
+    n = api.vs_get_export_names && api.vs_copy_export_vars ?
+        api.vs_get_export_names(NULL) : 0;
+    result->exports.assign (n > 0 ? n : 0, 0.0);
+    if (n > 0) api.vs_copy_export_vars(result->exports.data());
+    result->t_end = t;
+    }
+
+  if (api.vs_error_occurred())
+    result->error = api.vs_get_error_message();
+  else if (cancel && cancel->load())
+    result->status = VS_JOB_CANCELLED;
+  else
+    result->status = VS_JOB_DONE;
+
+  api.vs_terminate (t, NULL);
+  api.vs_free_all ();
+  ext.uninstall ();
+  result->seconds = vss_wall_seconds() - wall;
+  return result->status == VS_JOB_DONE ? 0 : -1;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Pool of workers.
+---------------------------------------------------------------------------- */
+vs_job_pool::vs_job_pool (int n_workers)
+  : next_id(1), stopping(false), cache(NULL), stage_writer(NULL),
+    stage_mode(VS_ECHO_ALL), stage_every(10)
+{
+  int i;
+
+  if (n_workers <= 0) n_workers = (int)std::thread::hardware_concurrency();
+  if (n_workers <= 0) n_workers = 1;
+  for (i = 0; i < n_workers; i++)
+    workers.push_back (std::thread(&vs_job_pool::work, this));
+}
+
+vs_job_pool::~vs_job_pool ()
+{
+  std::vector<std::shared_ptr<job> > dropped;
+  std::map<int, std::shared_ptr<job> >::iterator it;
+  size_t i;
+
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  stopping = true;
+  dropped.swap (queue);
+  for (it = jobs.begin(); it != jobs.end(); ++it) it->second->cancel = true;
+  }
+  for (i = 0; i < dropped.size(); i++)
+    finish (dropped[i], vss_result(VS_JOB_CANCELLED));
+
+  queued.notify_all ();
+  for (i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+// Loop of one worker. Each worker keeps its own copy of the solver loaded
+// as long as the runs use the same DLL.
+void vs_job_pool::work (void)
+{
+  vs_solver solver;
+  std::string loaded, dll, msg, simfile;
+
+  for (;;)
+    {
+    std::shared_ptr<job> j;
+    vs_job_result r = vss_result(VS_JOB_FAILED);
+
+      {
+      std::unique_lock<std::mutex> guard(lock);
+      while (!stopping && queue.empty()) queued.wait(guard);
+      if (queue.empty()) return;
+      j = queue.front();
+      queue.erase (queue.begin());
+      j->status = VS_JOB_RUNNING;
+      }
+
+    if (vs_solver::simfile_dll_path(j->simfile.c_str(), dll, msg))
+      r.error = msg;
+    else if (dll != loaded && solver.load(dll.c_str(), TRUE))
+      {
+      r.error = solver.error_message();
+      loaded.clear ();
+      }
+    else
+      {
+      loaded = dll;
+      vs_output_stage stage(j->stage_writer, j->stage_mode, j->stage_every);
+      simfile = j->simfile;
+      if (j->stage_writer) stage.prepare(j->simfile.c_str(), j->id, simfile);
+      if (!vs_job_run(solver, simfile.c_str(), j->mods, &j->cancel, &r) &&
+          j->cache && !j->key.empty())
+        j->cache->store (j->key, r.exports, r.t_end, r.seconds);
+      if (j->stage_writer) stage.finish(r.status == VS_JOB_FAILED);
+      }
+    finish (j, r);
+    }
+}
+
+// Store the result of a job and wake up anyone waiting for it.
+void vs_job_pool::finish (std::shared_ptr<job> j, const vs_job_result &r)
+{
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  j->result = r;
+  j->status = r.status;
+  }
+  j->promise.set_value (r);
+  ended.notify_all ();
+}
+
+// Find a job; the lock must be held.
+std::shared_ptr<vs_job_pool::job> vs_job_pool::find (int id)
+{
+  std::map<int, std::shared_ptr<job> >::iterator it = jobs.find(id);
+  return it == jobs.end() ? std::shared_ptr<job>() : it->second;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Public functions of the pool.
+---------------------------------------------------------------------------- */
+int vs_job_pool::submit (const char *simfile, const vs_job_mods &mods)
+{
+  std::shared_ptr<job> j(new job);
+  vs_job_result r = vss_result(VS_JOB_DONE);
+  bool hit;
+
+  j->simfile = simfile;
+  j->mods = mods;
+  j->status = VS_JOB_QUEUED;
+  j->cancel = false;
+  j->future = j->promise.get_future().share();
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  j->cache = cache;
+  j->stage_writer = stage_writer;
+  j->stage_mode = stage_mode;
+  j->stage_every = stage_every;
+  }
+  if (j->cache && j->cache->make_key(simfile, mods, NULL, j->key)) j->key.clear();
+  hit = !j->key.empty() && !j->cache->find(j->key, r.exports, &r.t_end, &r.seconds);
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  j->id = next_id++;
+  jobs[j->id] = j;
+  if (!hit) queue.push_back(j);
+  }
+
+  if (hit)
+    {
+    r.cached = TRUE;
+    finish (j, r);
+    }
+  else
+    queued.notify_one ();
+  return j->id;
+}
+
+void vs_job_pool::set_cache (vs_result_cache *result_cache)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  cache = result_cache;
+}
+
+void vs_job_pool::set_output_stage (vs_async_writer *writer, vs_echo_mode mode,
+                                    int sample_every)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  stage_writer = writer;
+  stage_mode = mode;
+  stage_every = sample_every;
+}
+
+vs_job_status vs_job_pool::poll (int id)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::shared_ptr<job> j = find(id);
+  return j ? j->status : VS_JOB_UNKNOWN;
+}
+
+vs_job_status vs_job_pool::wait (int id, double timeout)
+{
+  std::unique_lock<std::mutex> guard(lock);
+  std::shared_ptr<job> j = find(id);
+
+  if (!j) return VS_JOB_UNKNOWN;
+  if (timeout < 0.0)
+    while (!vss_ended(j->status)) ended.wait(guard);
+  else
+    ended.wait_for (guard, std::chrono::duration<double>(timeout),
+                    [&j] {return vss_ended(j->status);});
+  return j->status;
+}
+
+int vs_job_pool::cancel (int id)
+{
+  std::shared_ptr<job> j;
+  size_t i;
+
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!(j = find(id))) return -1;
+  j->cancel = true;
+  if (j->status != VS_JOB_QUEUED) return 0;
+  for (i = 0; i < queue.size(); i++)
+    if (queue[i] == j)
+      {
+      queue.erase (queue.begin() + i);
+      break;
+      }
+  }
+  finish (j, vss_result(VS_JOB_CANCELLED));
+  return 0;
+}
+
+vs_job_result vs_job_pool::result (int id)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::shared_ptr<job> j = find(id);
+
+  if (j && vss_ended(j->status)) return j->result;
+  return vss_result(VS_JOB_UNKNOWN);
+}
+
+std::shared_future<vs_job_result> vs_job_pool::future (int id)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::shared_ptr<job> j = find(id);
+  return j ? j->future : std::shared_future<vs_job_result>();
+}
+
+void vs_job_pool::forget (int id)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  jobs.erase (id);
+}
+
+
+/* ----------------------------------------------------------------------------
+   C interface to one pool per process.
+---------------------------------------------------------------------------- */
+static vs_job_pool     *vss_pool;
+static std::mutex       vss_pool_lock;
+static vs_result_cache  vss_cache;
+static vs_async_writer *vss_writer;
+static vs_echo_mode     vss_echo_mode = VS_ECHO_ALL;
+static int              vss_echo_every = 10;
+
+// Apply the settings of the C interface to a new pool.
+static void vss_configure (vs_job_pool *pool)
+{
+  if (vss_cache.is_open()) pool->set_cache(&vss_cache);
+  if (vss_writer) pool->set_output_stage(vss_writer, vss_echo_mode, vss_echo_every);
+}
+
+static vs_job_pool *vss_get_pool (void)
+{
+  std::lock_guard<std::mutex> guard(vss_pool_lock);
+  if (vss_pool == NULL)
+    {
+    vss_pool = new vs_job_pool;
+    vss_configure (vss_pool);
+    }
+  return vss_pool;
+}
+
+int vs_jobs_start (int n_workers)
+{
+  std::lock_guard<std::mutex> guard(vss_pool_lock);
+  if (vss_pool == NULL)
+    {
+    vss_pool = new vs_job_pool(n_workers);
+    vss_configure (vss_pool);
+    }
+  return vss_pool->n_workers();
+}
+
+void vs_jobs_stop (void)
+{
+  std::lock_guard<std::mutex> guard(vss_pool_lock);
+  delete vss_pool;
+  vss_pool = NULL;
+  delete vss_writer; // after the pool: waits for the last moves
+  vss_writer = NULL;
+}
+
+int vs_job_submit (const char *simfile, int n_mods, const char **keys,
+                   const double *values)
+{
+  vs_job_mods mods;
+  int i;
+
+  for (i = 0; i < n_mods; i++) mods.push_back(std::make_pair(keys[i], values[i]));
+  return vss_get_pool()->submit(simfile, mods);
+}
+
+int vs_job_poll (int id)    {return vss_get_pool()->poll(id);}
+int vs_job_cancel (int id)  {return vss_get_pool()->cancel(id);}
+void vs_job_free (int id)   {vss_get_pool()->forget(id);}
+
+int vs_job_wait (int id, double timeout)
+{
+  return vss_get_pool()->wait(id, timeout);
+}
+
+int vs_job_n_exports (int id)
+{
+  return (int)vss_get_pool()->result(id).exports.size();
+}
+
+int vs_job_get_exports (int id, double *exports, int n)
+{
+  vs_job_result r = vss_get_pool()->result(id);
+  int i;
+
+  for (i = 0; i < n && i < (int)r.exports.size(); i++) exports[i] = r.exports[i];
+  return i;
+}
+
+double vs_job_end_time (int id)
+{
+  return vss_get_pool()->result(id).t_end;
+}
+
+const char *vs_job_error (int id)
+{
+  static thread_local std::string error;
+  error = vss_get_pool()->result(id).error;
+  return error.c_str();
+}
+
+// Use a result cache directory for the pool. Call before submitting runs.
+int vs_jobs_cache (const char *dir, double max_mb)
+{
+  std::lock_guard<std::mutex> guard(vss_pool_lock);
+  int status = vss_cache.open(dir, (long long)(max_mb*1024.0*1024.0));
+
+  if (vss_pool) vss_pool->set_cache(status ? NULL : &vss_cache);
+  return status;
+}
+
+void vs_jobs_cache_stats (double *stats)
+{
+  vs_result_cache_stats s = vss_cache.stats();
+
+  stats[0] = (double)s.hits;
+  stats[1] = (double)s.misses;
+  stats[2] = (double)s.stores;
+  stats[3] = (double)s.evictions;
+  stats[4] = (double)s.entries;
+  stats[5] = (double)s.bytes;
+}
+
+void vs_jobs_echo_mode (int mode, int sample_every)
+{
+  std::lock_guard<std::mutex> guard(vss_pool_lock);
+
+  vss_echo_mode = mode == 1 ? VS_ECHO_SAMPLE : mode == 2 ? VS_ECHO_NONE : VS_ECHO_ALL;
+  vss_echo_every = sample_every;
+  if (vss_writer == NULL) vss_writer = new vs_async_writer;
+  if (vss_pool) vss_pool->set_output_stage(vss_writer, vss_echo_mode, vss_echo_every);
+}
@@ -0,0 +1,184 @@
+/* Asynchronous solver runs on a pool of worker threads.
+
+   calllib('vs_solver', 'vs_run', sim_file) in vehicle_sim.m blocks until the
+   run is over. A vs_job_pool takes runs (a simfile plus parameter changes) in
+   a queue and returns a job id at once. The caller can poll, wait, cancel,
+   or get a std::shared_future for the result, and do other work meanwhile.
+
+   Each worker owns a private copy of the solver DLL (see vs_solver.h), so
+   runs in different workers do not share model data. A run goes through the
+   steps used by vs_run:
+     vs_setdef_and_read -> changes with vs_set_sym_real -> vs_initialize ->
+     vs_integrate until vs_stop_run -> vs_terminate -> vs_free_all
+   A cancelled run is stopped with vs_set_stop_run on the solver thread.
+
+   The same pool is available to C and MATLAB through the functions declared
+   at the end (one pool per process). See vs_jobs_def_m.h and vs_job_*.m.
+
+   With a vs_result_cache, a run that was already made is not made again.
+   With set_output_stage, the echo, end and log files of the runs are written
+   to a local directory and moved (or dropped, in batch mode) in the
+   background.
+
+   Log:
+   Oct 18, 26. A cached result keeps the seconds of its run.
+   Oct 18, 26. The cache and stage settings are taken under the pool lock and
+               copied into each job at submit.
+   Oct 18, 26. Stage the output files of runs.
+   Oct 18, 26. Use a vs_result_cache.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_JOBS_H
+  #define _VS_JOBS_H
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  typedef enum
+    {
+    VS_JOB_UNKNOWN = -1, VS_JOB_QUEUED, VS_JOB_RUNNING, VS_JOB_DONE,
+    VS_JOB_FAILED, VS_JOB_CANCELLED
+    } vs_job_status;
+
+  #ifdef __cplusplus
+
+  #include <atomic>
+  #include <condition_variable>
+  #include <future>
+  #include <map>
+  #include <memory>
+  #include <mutex>
+  #include <string>
+  #include <thread>
+  #include <utility>
+  #include <vector>
+
+  #include "vs_solver.h"    // per-instance solver API
+  #include "vs_echo_sink.h" // buffered run output
+
+  // Parameter changes for a run: keyword and value, applied after the
+  // parsfiles are read.
+  typedef std::vector<std::pair<std::string, vs_real> > vs_job_mods;
+
+  typedef struct
+    {
+    vs_job_status status;  // VS_JOB_DONE, VS_JOB_FAILED or VS_JOB_CANCELLED
+    vs_real t_end;         // simulation time when the run ended
+    std::vector<vs_real> exports; // export variables at the end of the run
+                                  // (none if the DLL cannot give them)
+    std::string error;     // error message if the run failed
+    double seconds;        // wall-clock time of the run (if cached, of the
+                           // run that stored it)
+    vs_bool cached;        // TRUE if taken from a vs_result_cache
+    } vs_job_result;
+
+  class vs_result_cache;
+
+  // Make one run with a loaded solver. cancel may be NULL. Return 0 if OK.
+  int vs_job_run (vs_solver &solver, const char *simfile, const vs_job_mods &mods,
+                  const std::atomic<bool> *cancel, vs_job_result *result);
+
+  class vs_job_pool
+    {
+    public:
+      // n_workers = 0: one per hardware thread.
+      vs_job_pool (int n_workers = 0);
+      ~vs_job_pool (); // cancels queued runs and waits for running ones
+
+      // Queue a run and return its job id (> 0).
+      int submit (const char *simfile, const vs_job_mods &mods = vs_job_mods());
+
+      vs_job_status poll (int id);
+
+      // Wait for a job to end. timeout < 0 waits forever. Return the status.
+      vs_job_status wait (int id, double timeout = -1.0);
+
+      // Cancel a queued or running job. Return 0 if the job was found.
+      int cancel (int id);
+
+      // Result of an ended job; status VS_JOB_UNKNOWN if not ended.
+      vs_job_result result (int id);
+      std::shared_future<vs_job_result> future (int id);
+
+      // Drop a job and its result.
+      void forget (int id);
+
+      int n_workers (void) const {return (int)workers.size();}
+
+      // Take results from a cache when the same run was made before, and
+      // store new ones. NULL to stop using it. Each job keeps the settings
+      // it was submitted with, so this may be called while runs go on; the
+      // cache must outlive the jobs that use it.
+      void set_cache (vs_result_cache *result_cache);
+
+      // Write the ECHO, FINAL and LOGFILE files of each run locally and move
+      // or drop them afterwards with an async writer (see vs_echo_sink.h).
+      // NULL writer to stop. As set_cache, applies to later submits.
+      void set_output_stage (vs_async_writer *writer, vs_echo_mode mode,
+                             int sample_every = 10);
+
+    private:
+      struct job
+        {
+        int id;
+        std::string simfile, key; // key in the result cache, if any
+        vs_job_mods mods;
+        vs_result_cache *cache;     // pool settings when submitted
+        vs_async_writer *stage_writer;
+        vs_echo_mode stage_mode;
+        int stage_every;
+        vs_job_status status;
+        std::atomic<bool> cancel;
+        vs_job_result result;
+        std::promise<vs_job_result> promise;
+        std::shared_future<vs_job_result> future;
+        };
+
+      void work (void);
+      void finish (std::shared_ptr<job> j, const vs_job_result &r);
+      std::shared_ptr<job> find (int id);
+
+      std::vector<std::thread> workers;
+      std::mutex lock;
+      std::condition_variable queued, ended;
+      std::vector<std::shared_ptr<job> > queue; // FIFO of queued jobs
+      std::map<int, std::shared_ptr<job> > jobs;
+      int next_id;
+      bool stopping;
+      vs_result_cache *cache; // settings for new jobs, under the lock
+      vs_async_writer *stage_writer;
+      vs_echo_mode stage_mode;
+      int stage_every;
+    };
+
+  extern "C" {
+  #endif // __cplusplus
+
+  // C interface to one pool per process, for MATLAB and C programs.
+  VS_API_EXPORT int    vs_jobs_start (int n_workers);
+  VS_API_EXPORT void   vs_jobs_stop (void);
+  VS_API_EXPORT int    vs_job_submit (const char *simfile, int n_mods,
+                                      const char **keys, const double *values);
+  VS_API_EXPORT int    vs_job_poll (int id);
+  VS_API_EXPORT int    vs_job_wait (int id, double timeout);
+  VS_API_EXPORT int    vs_job_cancel (int id);
+  VS_API_EXPORT int    vs_job_n_exports (int id);
+  VS_API_EXPORT int    vs_job_get_exports (int id, double *exports, int n);
+  VS_API_EXPORT double vs_job_end_time (int id);
+  VS_API_EXPORT const char *vs_job_error (int id);
+  VS_API_EXPORT void   vs_job_free (int id);
+
+  // Result cache of the pool (see vs_result_cache.h). stats gets hits, misses,
+  // stores, evictions, entries and bytes.
+  VS_API_EXPORT int    vs_jobs_cache (const char *dir, double max_mb);
+  VS_API_EXPORT void   vs_jobs_cache_stats (double *stats);
+
+  // Batch mode for the echo, end and log files: 0 = keep all, 1 = keep one run
+  // in sample_every, 2 = keep none. Failed runs always keep them.
+  VS_API_EXPORT void   vs_jobs_echo_mode (int mode, int sample_every);
+
+  #ifdef __cplusplus
+  }
+  #endif
+
+#endif  // end block for _VS_JOBS_H
@@ -0,0 +1,24 @@
+/* Functions of the vs_jobs library, for the MATLAB function loadlibrary.
+   See vs_jobs.h and vs_jobs_start.m.
+
+  Log:
+  Oct 18, 26. Added vs_jobs_echo_mode.
+  Oct 18, 26. Added vs_jobs_cache.
+  Oct 18, 26. Created.
+  */
+
+int     vs_jobs_start (int n_workers);
+void    vs_jobs_stop (void);
+int     vs_job_submit (const char *simfile, int n_mods, const char **keys,
+                       const double *values);
+int     vs_job_poll (int id);
+int     vs_job_wait (int id, double timeout);
+int     vs_job_cancel (int id);
+int     vs_job_n_exports (int id);
+int     vs_job_get_exports (int id, double *exports, int n);
+double  vs_job_end_time (int id);
+const char *vs_job_error (int id);
+void    vs_job_free (int id);
+int     vs_jobs_cache (const char *dir, double max_mb);
+void    vs_jobs_cache_stats (double *stats);
+void    vs_jobs_echo_mode (int mode, int sample_every);
@@ -0,0 +1,203 @@
+/* Files mapped into memory. See vs_mmap.h.
+
+   Log:
+   Oct 18, 26. advise().
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stddef.h>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_mmap.h"     // mapped files
+
+vs_mapped_file::vs_mapped_file () : addr(NULL), length(0), opened(FALSE)
+{
+#ifdef _WIN32
+  file = mapping = NULL;
+#else
+  fd = -1;
+#endif
+}
+
+vs_mapped_file::~vs_mapped_file ()
+{
+  close ();
+}
+
+// Map the whole of the open file. Return 0 if OK, -1 if not.
+int vs_mapped_file::map (vs_bool read_only)
+{
+#ifdef _WIN32
+  LARGE_INTEGER size;
+
+  if (!GetFileSizeEx((HANDLE)file, &size)) return -1;
+  length = (size_t)size.QuadPart;
+  if (length == 0) return 0;
+  mapping = CreateFileMappingA((HANDLE)file, NULL, read_only ? PAGE_READONLY : PAGE_READWRITE,
+                               0, 0, NULL);
+  if (mapping == NULL) return -1;
+  addr = MapViewOfFile((HANDLE)mapping, read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS,
+                       0, 0, 0);
+  return addr ? 0 : -1;
+#else
+  struct stat st;
+
+  if (fstat(fd, &st)) return -1;
+  length = (size_t)st.st_size;
+  if (length == 0) return 0;
+  addr = mmap(NULL, length, read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+              MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED)
+    {
+    addr = NULL;
+    return -1;
+    }
+  return 0;
+#endif
+}
+
+
+/* ----------------------------------------------------------------------------
+   Map an existing file. Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_mapped_file::open (const char *path, vs_bool read_only)
+{
+  close ();
+#ifdef _WIN32
+  file = CreateFileA(path, read_only ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                     FILE_SHARE_READ | (read_only ? 0 : FILE_SHARE_WRITE), NULL,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    {
+    file = NULL;
+    return -1;
+    }
+#else
+  if ((fd = ::open(path, read_only ? O_RDONLY : O_RDWR)) < 0) return -1;
+#endif
+  if (map(read_only))
+    {
+    close ();
+    return -1;
+    }
+  opened = TRUE;
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Create a file of the given size and map it read/write. Return 0 if OK.
+---------------------------------------------------------------------------- */
+int vs_mapped_file::create (const char *path, size_t size)
+{
+  close ();
+#ifdef _WIN32
+  LARGE_INTEGER at;
+
+  file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                     CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    {
+    file = NULL;
+    return -1;
+    }
+  at.QuadPart = (LONGLONG)size;
+  if (!SetFilePointerEx((HANDLE)file, at, NULL, FILE_BEGIN) || !SetEndOfFile((HANDLE)file))
+    {
+    close ();
+    return -1;
+    }
+#else
+  if ((fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) return -1;
+  if (ftruncate(fd, (off_t)size))
+    {
+    close ();
+    return -1;
+    }
+#endif
+  if (map(FALSE))
+    {
+    close ();
+    return -1;
+    }
+  opened = TRUE;
+  return 0;
+}
+
+int vs_mapped_file::flush (void)
+{
+  if (addr == NULL) return 0;
+#ifdef _WIN32
+  return FlushViewOfFile(addr, 0) && FlushFileBuffers((HANDLE)file) ? 0 : -1;
+#else
+  return msync(addr, length, MS_SYNC) ? -1 : 0;
+#endif
+}
+
+/* ----------------------------------------------------------------------------
+   Advice on a range, widened to whole pages. On Windows, read ahead is
+   PrefetchVirtualMemory (Windows 8 and later, found at run time) and
+   VirtualUnlock of pages that are not locked takes them out of the working
+   set.
+---------------------------------------------------------------------------- */
+int vs_mapped_file::advise (size_t offset, size_t size, vs_map_advice advice)
+{
+  size_t page, end;
+  char *start;
+
+  if (addr == NULL || offset >= length) return addr ? 0 : -1;
+  end = offset + size < length ? offset + size : length;
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo (&info);
+  page = info.dwPageSize;
+#else
+  page = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+  offset -= offset % page;
+  start = (char *)addr + offset;
+  size = end - offset;
+
+#ifdef _WIN32
+  if (advice == VS_MAP_DONTNEED)
+    {
+    VirtualUnlock (start, size); // fails for unlocked pages, but trims them
+    return 0;
+    }
+  typedef struct {PVOID VirtualAddress; SIZE_T NumberOfBytes;} vss_range;
+  typedef BOOL (WINAPI *vss_prefetch) (HANDLE, ULONG_PTR, vss_range *, ULONG);
+  static vss_prefetch prefetch = (vss_prefetch)GetProcAddress(
+                                   GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+  vss_range range = {start, size};
+  return prefetch && prefetch(GetCurrentProcess(), 1, &range, 0) ? 0 : -1;
+#else
+  return madvise(start, size, advice == VS_MAP_WILLNEED ? MADV_WILLNEED : MADV_DONTNEED)
+         ? -1 : 0;
+#endif
+}
+
+void vs_mapped_file::close (void)
+{
+#ifdef _WIN32
+  if (addr) UnmapViewOfFile(addr);
+  if (mapping) CloseHandle((HANDLE)mapping);
+  if (file) CloseHandle((HANDLE)file);
+  file = mapping = NULL;
+#else
+  if (addr) munmap(addr, length);
+  if (fd >= 0) ::close(fd);
+  fd = -1;
+#endif
+  addr = NULL;
+  length = 0;
+  opened = FALSE;
+}
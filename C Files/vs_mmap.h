@@ -0,0 +1,63 @@
+/* Files mapped into memory, for result files and other data read in place.
+
+   open() maps an existing file, read-only or read/write. create() makes (or
+   truncates) a file of a given size and maps it read/write. An empty file
+   opens as a valid object with data() NULL and size() 0.
+
+   advise() tells the system how a range of the mapping will be used: read
+   soon (read ahead now), or not needed (pages of a read-only mapping are
+   dropped and read again from the file if touched).
+
+   Log:
+   Oct 18, 26. advise().
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_MMAP_H
+  #define _VS_MMAP_H
+
+  #include <stddef.h>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  typedef enum {VS_MAP_WILLNEED, VS_MAP_DONTNEED} vs_map_advice;
+
+  class vs_mapped_file
+    {
+    public:
+      vs_mapped_file ();
+      ~vs_mapped_file ();
+
+      // Return 0 if OK, -1 if not.
+      int  open (const char *path, vs_bool read_only = TRUE);
+      int  create (const char *path, size_t size);
+      void close (void);
+
+      // Write changes to disk now (read/write mappings).
+      int  flush (void);
+
+      // Advice for the bytes from offset to offset + length (see above).
+      // Return 0 if OK, -1 if not (or not supported).
+      int  advise (size_t offset, size_t length, vs_map_advice advice);
+
+      vs_bool is_open (void) const {return opened;}
+      void   *data (void) const {return addr;}
+      size_t  size (void) const {return length;}
+
+    private:
+      vs_mapped_file (const vs_mapped_file &);            // not copyable
+      vs_mapped_file &operator= (const vs_mapped_file &);
+
+      int map (vs_bool read_only);
+
+      void   *addr;
+      size_t  length;
+      vs_bool opened;
+  #ifdef _WIN32
+      void   *file, *mapping; // HANDLEs
+  #else
+      int     fd;
+  #endif
+    };
+
+#endif  // end block for _VS_MMAP_H
@@ -0,0 +1,89 @@
+/* Monitor program for runs that publish telemetry with vs_telemetry_tap.
+
+   Usage: vs_monitor [-once] [-interval seconds] [run ...]
+
+   Without run names, all runs published on this machine are shown. The
+   monitor only reads shared memory, so it never slows the solvers down.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_telemetry.h" // telemetry tap and reader
+
+static const char *vss_state_name (int state, int error)
+{
+  if (error) return "ERROR";
+  switch (state)
+    {
+    case VS_TELEMETRY_STARTING: return "start";
+    case VS_TELEMETRY_RUNNING:  return "running";
+    case VS_TELEMETRY_ENDED:    return "ended";
+    default:                    return "?";
+    }
+}
+
+int main (int argc, char **argv)
+{
+  std::map<std::string, vs_telemetry_reader *> readers;
+  std::vector<std::string> named;
+  double interval = 1.0;
+  int i, once = 0;
+
+  for (i = 1; i < argc; i++)
+    {
+    if (!strcmp(argv[i], "-once")) once = 1;
+    else if (!strcmp(argv[i], "-interval") && i + 1 < argc) interval = atof(argv[++i]);
+    else named.push_back(argv[i]);
+    }
+
+  for (;;)
+    {
+    std::vector<std::string> runs = named.empty() ? vs_telemetry_reader::list() : named;
+
+    printf ("\n%-24s %8s %12s %8s %12s  %s\n", "Run", "State", "Time", "RTF",
+            "Steps", "Channels");
+    for (i = 0; i < (int)runs.size(); i++)
+      {
+      vs_telemetry_reader *&r = readers[runs[i]];
+      vs_telemetry_sample s;
+      int c;
+
+      if (r == NULL) r = new vs_telemetry_reader;
+      if (r->n_channels() == 0 && r->open(runs[i].c_str()))
+        {
+        printf ("%-24s %8s\n", runs[i].c_str(), "-");
+        continue;
+        }
+      if (r->read(&s))
+        {
+        printf ("%-24s %8s\n", runs[i].c_str(), "busy");
+        continue;
+        }
+      printf ("%-24s %8s %12.3f %8.2f %12lld ", runs[i].c_str(),
+              vss_state_name(s.state, s.error), s.t, s.rtf, (long long)s.steps);
+      for (c = 0; c < r->n_channels(); c++)
+        printf (" %s=%g", r->channel(c), s.values[c]);
+      printf ("\n");
+      }
+    fflush (stdout);
+    if (once) break;
+    std::this_thread::sleep_for (std::chrono::duration<double>(interval));
+    }
+
+  for (std::map<std::string, vs_telemetry_reader *>::iterator it = readers.begin();
+       it != readers.end(); ++it)
+    delete it->second;
+  return 0;
+}
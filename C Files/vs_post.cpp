@@ -0,0 +1,475 @@
+/* Parallel post-processing of export channels. See vs_post.h.
+
+   Log:
+   Oct 18, 26. Settle time from the time channel, not from sample 0.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_mmap.h"      // mapped files
+#include "vs_task_pool.h" // work-stealing pool
+#include "vs_post.h"      // post-processing
+
+static const char *vss_metric_names[] =
+  {"mean", "rms", "min", "max", "peak", "settle", "fft_freq", "fft_amp"};
+
+// Name of the .bin file that goes with an .erd file.
+static std::string vss_bin_path (const char *erd_path)
+{
+  std::string path(erd_path);
+  size_t n = path.size();
+
+  if (n > 4 && path[n - 4] == '.' && toupper(path[n - 3]) == 'E' &&
+      toupper(path[n - 2]) == 'R' && toupper(path[n - 1]) == 'D')
+    path.resize (n - 4);
+  return path + ".bin";
+}
+
+
+/* ----------------------------------------------------------------------------
+   ERD files.
+---------------------------------------------------------------------------- */
+int vs_erd_write (const char *path, const char *title, int n_chan,
+                  const char *const *names, int n_rec, const vs_real *data, int bytes)
+{
+  FILE *fp;
+  std::vector<float> row;
+  size_t i, n = (size_t)n_chan;
+  int k, err = 0;
+
+  if ((fp = fopen(path, "w")) == NULL) return -1;
+  fprintf (fp, "ERDFILEV2.00\n%d 1 %d 1 %d\n", n_chan, n_rec, bytes == 4 ? 4 : 8);
+  fprintf (fp, "TITLE %s\n", title ? title : "");
+  for (i = 0; i < n; i++)
+    fprintf (fp, "%s%s", i % 10 ? " " : i ? "\nSHORTNAME " : "SHORTNAME ", names[i]);
+  fprintf (fp, "\nEND\n");
+  if (fclose(fp)) return -1;
+
+  if ((fp = fopen(vss_bin_path(path).c_str(), "wb")) == NULL) return -1;
+  if (bytes == 4)
+    {
+    row.resize (n);
+    for (k = 0; k < n_rec && !err; k++)
+      {
+      for (i = 0; i < n; i++) row[i] = (float)data[k*n + i];
+      err = fwrite(row.data(), sizeof(float), n, fp) != n;
+      }
+    }
+  else
+    err = fwrite(data, sizeof(vs_real), n*n_rec, fp) != n*n_rec;
+  if (fclose(fp)) err = 1;
+  return err ? -1 : 0;
+}
+
+int vs_erd_file::open (const char *path)
+{
+  FILE *fp;
+  char line[4096], *tok;
+  int n_chan = 0, number, n_numbers = 0;
+  size_t i;
+
+  close ();
+  if ((fp = fopen(path, "r")) == NULL)
+    {
+    error = std::string("Could not open \"") + path + "\".";
+    return -1;
+    }
+  if (fgets(line, sizeof(line), fp) == NULL || strncmp(line, "ERDFILE", 7) ||
+      fgets(line, sizeof(line), fp) == NULL)
+    {
+    fclose (fp);
+    error = std::string("\"") + path + "\" is not an ERD file.";
+    return -1;
+    }
+  for (tok = strtok(line, " \t\r\n,"); tok; tok = strtok(NULL, " \t\r\n,"))
+    if (sscanf(tok, "%d", &number) == 1)
+      {
+      if (n_numbers++ == 0) n_chan = number;
+      bytes = number;
+      }
+  while (fgets(line, sizeof(line), fp))
+    {
+    tok = strtok(line, " \t\r\n");
+    if (tok == NULL || strcmp(tok, "SHORTNAME")) continue;
+    while ((tok = strtok(NULL, " \t\r\n")) != NULL) names.push_back(tok);
+    }
+  fclose (fp);
+
+  if (n_chan <= 0 || (bytes != 4 && bytes != 8))
+    {
+    error = std::string("Unsupported ERD layout in \"") + path + "\".";
+    names.clear ();
+    return -1;
+    }
+  names.resize (n_chan);
+  for (i = 0; i < names.size(); i++)
+    if (names[i].empty()) names[i] = "CH" + std::to_string((int)i);
+
+  if (bin.open(vss_bin_path(path).c_str()))
+    {
+    error = "Could not map \"" + vss_bin_path(path) + "\".";
+    names.clear ();
+    return -1;
+    }
+  n_rec = (int)(bin.size()/((size_t)n_chan*bytes));
+  return 0;
+}
+
+void vs_erd_file::close (void)
+{
+  bin.close ();
+  names.clear ();
+  n_rec = 0;
+}
+
+int vs_erd_file::find (const char *name) const
+{
+  for (size_t i = 0; i < names.size(); i++)
+    {
+    const char *a = names[i].c_str(), *b = name;
+    while (*a && toupper((unsigned char)*a) == toupper((unsigned char)*b)) a++, b++;
+    if (*a == 0 && *b == 0) return (int)i;
+    }
+  return -1;
+}
+
+int vs_erd_file::read (int i, vs_real *out) const
+{
+  size_t n = names.size(), k;
+
+  if (bytes == 4)
+    {
+    const float *p = (const float *)bin.data() + i;
+    for (k = 0; k < (size_t)n_rec; k++) out[k] = p[k*n];
+    }
+  else
+    {
+    const vs_real *p = (const vs_real *)bin.data() + i;
+    for (k = 0; k < (size_t)n_rec; k++) out[k] = p[k*n];
+    }
+  return n_rec;
+}
+
+vs_real vs_erd_file::value (int record, int i) const
+{
+  size_t at = (size_t)record*names.size() + i;
+  return bytes == 4 ? ((const float *)bin.data())[at] : ((const vs_real *)bin.data())[at];
+}
+
+
+/* ----------------------------------------------------------------------------
+   Kernels. Reductions keep four partial results so the loops vectorize and
+   pipeline without reordering by the compiler.
+---------------------------------------------------------------------------- */
+static void vss_sums (const vs_real *x, int n, vs_real *sum, vs_real *sum_sq)
+{
+  vs_real s[4] = {0.0, 0.0, 0.0, 0.0}, q[4] = {0.0, 0.0, 0.0, 0.0};
+  int i, j;
+
+  for (i = 0; i + 4 <= n; i += 4)
+    for (j = 0; j < 4; j++)
+      {
+      s[j] += x[i + j];
+      q[j] += x[i + j]*x[i + j];
+      }
+  for (; i < n; i++)
+    {
+    s[0] += x[i];
+    q[0] += x[i]*x[i];
+    }
+  *sum = (s[0] + s[1]) + (s[2] + s[3]);
+  *sum_sq = (q[0] + q[1]) + (q[2] + q[3]);
+}
+
+static void vss_range (const vs_real *x, int n, vs_real *lo, vs_real *hi)
+{
+  vs_real a[4], b[4];
+  int i, j;
+
+  for (j = 0; j < 4; j++) a[j] = b[j] = x[0];
+  for (i = 0; i + 4 <= n; i += 4)
+    for (j = 0; j < 4; j++)
+      {
+      a[j] = x[i + j] < a[j] ? x[i + j] : a[j];
+      b[j] = x[i + j] > b[j] ? x[i + j] : b[j];
+      }
+  for (; i < n; i++)
+    {
+    a[0] = x[i] < a[0] ? x[i] : a[0];
+    b[0] = x[i] > b[0] ? x[i] : b[0];
+    }
+  for (j = 1; j < 4; j++)
+    {
+    a[0] = a[j] < a[0] ? a[j] : a[0];
+    b[0] = b[j] > b[0] ? b[j] : b[0];
+    }
+  *lo = a[0];
+  *hi = b[0];
+}
+
+// w[k] = exp(-2 pi i k/n) for k < n/2 (n >= 4), by a stable recurrence.
+static void vss_twiddles (int n, std::vector<vs_real> &w)
+{
+  vs_real t = sin(-PI/n), wpr = -2.0*t*t, wpi = sin(-2.0*PI/n);
+  int k;
+
+  if ((int)w.size() == n) return; // kept from the last call
+  w.resize (n);
+  w[0] = 1.0;
+  w[1] = 0.0;
+  for (k = 1; k < n/2; k++)
+    {
+    w[2*k] = w[2*k - 2] + w[2*k - 2]*wpr - w[2*k - 1]*wpi;
+    w[2*k + 1] = w[2*k - 1] + w[2*k - 1]*wpr + w[2*k - 2]*wpi;
+    }
+}
+
+// In-place complex FFT of n (a power of 2) interleaved values. w holds the
+// twiddles of an FFT of size n*stride.
+static void vss_fft (vs_real *d, int n, const vs_real *w, int stride)
+{
+  int i, j, k, m, len, step;
+  vs_real tr, ti, t, *x, *y;
+
+  for (i = 0, j = 0; i < n; i++)
+    {
+    if (j > i)
+      {
+      t = d[2*j]; d[2*j] = d[2*i]; d[2*i] = t;
+      t = d[2*j + 1]; d[2*j + 1] = d[2*i + 1]; d[2*i + 1] = t;
+      }
+    for (m = n >> 1; m >= 1 && (j & m); m >>= 1) j ^= m;
+    j |= m;
+    }
+
+  for (len = 2; len <= n; len <<= 1)
+    {
+    step = n/len*stride;
+    for (i = 0; i < n; i += len)
+      {
+      x = d + 2*i;
+      y = x + len;
+      for (k = 0; k < len/2; k++)
+        {
+        vs_real wr = w[2*k*step], wi = w[2*k*step + 1];
+        tr = wr*y[2*k] - wi*y[2*k + 1];
+        ti = wr*y[2*k + 1] + wi*y[2*k];
+        y[2*k] = x[2*k] - tr;
+        y[2*k + 1] = x[2*k + 1] - ti;
+        x[2*k] += tr;
+        x[2*k + 1] += ti;
+        }
+      }
+    }
+}
+
+/* Largest bin (1 to n/2) of the spectrum of n real values (n a power of 2,
+   at least 4), packed in d as n/2 complex values. Return the bin, and its
+   magnitude in *mag. The real FFT is an FFT of half the size, then split:
+     X[k] = E[k] + exp(-2 pi i k/n) O[k],
+     E[k] = (Z[k] + conj Z[n/2-k])/2,  O[k] = -i (Z[k] - conj Z[n/2-k])/2. */
+static int vss_spectrum_peak (vs_real *d, int n, std::vector<vs_real> &w, vs_real *mag)
+{
+  int k, m = n/2, best = 0;
+  vs_real er, ei, or_, oi, xr, xi, p, p_best = -1.0, zr, zi, cr, ci, wr, wi;
+
+  vss_twiddles (n, w);
+  vss_fft (d, m, w.data(), 2);
+  for (k = 1; k <= m; k++)
+    {
+    zr = d[2*(k % m)];
+    zi = d[2*(k % m) + 1];
+    cr = d[2*((m - k) % m)];
+    ci = -d[2*((m - k) % m) + 1];
+    er = 0.5*(zr + cr);
+    ei = 0.5*(zi + ci);
+    or_ = 0.5*(zi - ci);
+    oi = -0.5*(zr - cr);
+    wr = k < m ? w[2*k] : -1.0;
+    wi = k < m ? w[2*k + 1] : 0.0;
+    xr = er + wr*or_ - wi*oi;
+    xi = ei + wr*oi + wi*or_;
+    p = xr*xr + xi*xi;
+    if (p > p_best)
+      {
+      p_best = p;
+      best = k;
+      }
+    }
+  *mag = sqrt(p_best);
+  return best;
+}
+
+
+/* ----------------------------------------------------------------------------
+   The engine.
+---------------------------------------------------------------------------- */
+vs_post::vs_post () : wall(0.0), n_steals(0)
+{
+}
+
+vs_post::~vs_post ()
+{
+  clear_runs ();
+}
+
+void vs_post::add_run (const char *erd_path)
+{
+  run_info r;
+
+  r.path = erd_path;
+  r.file = NULL;
+  runs.push_back (r);
+}
+
+void vs_post::clear_runs (void)
+{
+  for (size_t i = 0; i < runs.size(); i++) delete runs[i].file;
+  runs.clear ();
+  values.clear ();
+}
+
+int vs_post::add_metric (const char *channel, vs_post_metric metric, vs_real param)
+{
+  metric_info m;
+  size_t i;
+
+  m.channel = channel;
+  for (i = 0; i < m.channel.size(); i++)
+    m.channel[i] = (char)toupper((unsigned char)m.channel[i]);
+  m.metric = metric;
+  m.param = param;
+  for (i = 0; i < channels.size() && channels[i] != m.channel; i++) ;
+  if (i == channels.size()) channels.push_back(m.channel);
+  m.group = (int)i;
+  metrics.push_back (m);
+  return (int)metrics.size() - 1;
+}
+
+// All metrics on one channel of one run.
+void vs_post::run_channel (int run, int channel, std::vector<vs_real> &x,
+                           std::vector<vs_real> &work, std::vector<vs_real> &twiddle)
+{
+  const vs_erd_file &f = *runs[run].file;
+  vs_real *out = &values[(size_t)run*metrics.size()];
+  vs_real sum = 0.0, sum_sq = 0.0, lo = 0.0, hi = 0.0, dt, band, best;
+  int n = f.n_records(), i, n2, k_best, ch = f.find(channels[channel].c_str());
+  vs_bool have_sums = FALSE, have_range = FALSE, have_fft = FALSE;
+  size_t m;
+
+  if (ch < 0 || n < 2) return;
+  x.resize (n);
+  f.read (ch, x.data());
+  dt = (f.value(n - 1, 0) - f.value(0, 0))/(n - 1);
+  k_best = 0;
+  best = 0.0;
+
+  for (m = 0; m < metrics.size(); m++)
+    {
+    if (metrics[m].group != channel) continue;
+    vs_post_metric type = metrics[m].metric;
+
+    if (!have_sums && (type == VS_POST_MEAN || type == VS_POST_RMS || type >= VS_POST_FFT_FREQ))
+      {
+      vss_sums (x.data(), n, &sum, &sum_sq);
+      have_sums = TRUE;
+      }
+    if (!have_range && (type == VS_POST_MIN || type == VS_POST_MAX ||
+                        type == VS_POST_PEAK || type == VS_POST_SETTLE))
+      {
+      vss_range (x.data(), n, &lo, &hi);
+      have_range = TRUE;
+      }
+    if (!have_fft && type >= VS_POST_FFT_FREQ)
+      {
+      for (n2 = 4; n2 < n; n2 <<= 1) ;
+      work.assign (n2, 0.0);
+      for (i = 0; i < n; i++) work[i] = x[i] - sum/n;
+      k_best = vss_spectrum_peak(work.data(), n2, twiddle, &best);
+      best = 2.0*best/n;
+      have_fft = TRUE;
+      }
+
+    switch (type)
+      {
+      case VS_POST_MEAN: out[m] = sum/n; break;
+      case VS_POST_RMS:  out[m] = sqrt(sum_sq/n); break;
+      case VS_POST_MIN:  out[m] = lo; break;
+      case VS_POST_MAX:  out[m] = hi; break;
+      case VS_POST_PEAK: out[m] = fabs(lo) > fabs(hi) ? fabs(lo) : fabs(hi); break;
+      case VS_POST_SETTLE:
+        band = metrics[m].param > 0.0 ? metrics[m].param : 0.02*(hi - lo);
+        for (i = n - 1; i >= 0 && fabs(x[i] - x[n - 1]) <= band; i--) ;
+        out[m] = f.value(i + 1, 0); // time of the first sample that stays
+        break;
+      case VS_POST_FFT_FREQ: out[m] = k_best/(work.size()*dt); break; // n2*dt
+      case VS_POST_FFT_AMP:  out[m] = best; break;
+      }
+    }
+}
+
+int vs_post::compute (int n_threads)
+{
+  vs_task_pool pool(n_threads);
+  std::vector<std::vector<vs_real> > x(pool.size()), work(pool.size()),
+                                     twiddle(pool.size());
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  int n_ch = (int)channels.size(), failed = 0;
+  size_t i;
+
+  values.assign (runs.size()*metrics.size(), NAN);
+
+  // map the files
+  pool.run ((int)runs.size(), [&] (int r, int)
+    {
+    if (runs[r].file == NULL) runs[r].file = new vs_erd_file;
+    if (runs[r].file->n_channels() == 0 && runs[r].file->open(runs[r].path.c_str()))
+      runs[r].error = runs[r].file->error_message();
+    });
+
+  pool.run ((int)runs.size()*n_ch, [&] (int task, int worker)
+    {
+    int r = task/n_ch;
+    if (runs[r].error.empty()) run_channel(r, task % n_ch, x[worker], work[worker],
+                                             twiddle[worker]);
+    });
+
+  for (i = 0; i < runs.size(); i++) if (!runs[i].error.empty()) failed++;
+  wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  n_steals = pool.steals();
+  return failed;
+}
+
+int vs_post::write_summary (const char *csv_path) const
+{
+  FILE *fp;
+  size_t r, m;
+  vs_real v;
+
+  if ((fp = fopen(csv_path, "w")) == NULL) return -1;
+  fprintf (fp, "run");
+  for (m = 0; m < metrics.size(); m++)
+    fprintf (fp, ",%s_%s", metrics[m].channel.c_str(), vss_metric_names[metrics[m].metric]);
+  fprintf (fp, "\n");
+  for (r = 0; r < runs.size(); r++)
+    {
+    fprintf (fp, "\"%s\"", runs[r].path.c_str());
+    for (m = 0; m < metrics.size(); m++)
+      {
+      v = values.empty() ? NAN : value((int)r, (int)m);
+      if (v != v) fprintf(fp, ",NaN");
+      else fprintf(fp, ",%.10g", v);
+      }
+    fprintf (fp, "\n");
+    }
+  return fclose(fp) ? -1 : 0;
+}
@@ -0,0 +1,145 @@
+/* Parallel post-processing of the export channels of many runs.
+
+   After a sweep, each run's exports (named as by vs_get_export_names) are in
+   a binary ERD file pair: a text header (.erd) and the records (.bin). A
+   vs_post maps all the files, then computes the requested metrics with a
+   vs_task_pool, one task per run and channel: the channel is gathered once
+   into a contiguous array and all metrics on it are computed from there
+   with simple loops the compiler vectorizes. The results go to one summary
+   table with a row per run.
+
+     vs_post post;
+     post.add_run ("Runs/Run1.erd");  ...
+     post.add_metric ("AY", VS_POST_PEAK);
+     post.add_metric ("AVZ", VS_POST_SETTLE, 0.5);
+     post.add_metric ("AY", VS_POST_FFT_FREQ);
+     post.compute (0);                // all cores
+     post.write_summary ("summary.csv");
+
+   ERD files: line 1 starts with "ERDFILE"; on line 2 the first number is the
+   number of channels and the last the bytes per value (4 or 8). Channel
+   names are on SHORTNAME lines (several per line, or several lines). The
+   .bin file holds records of all channels, the first being time, sampled at
+   a fixed rate. vs_erd_write makes files in this layout.
+
+   Metrics (param in brackets):
+     VS_POST_MEAN, VS_POST_RMS, VS_POST_MIN, VS_POST_MAX
+     VS_POST_PEAK      largest absolute value
+     VS_POST_SETTLE    time (from the time channel, so a run that does not
+                       start at 0 gives its own times) after which the
+                       channel stays within [param] of its final value
+                       (param <= 0: 2% of its range)
+     VS_POST_FFT_FREQ  frequency (Hz) of the largest FFT peak, mean removed
+     VS_POST_FFT_AMP   amplitude of that peak
+
+   Log:
+   Oct 18, 26. VS_POST_SETTLE is a time of the time channel.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_POST_H
+  #define _VS_POST_H
+
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_mmap.h"     // mapped files
+
+  typedef enum
+    {
+    VS_POST_MEAN, VS_POST_RMS, VS_POST_MIN, VS_POST_MAX, VS_POST_PEAK,
+    VS_POST_SETTLE, VS_POST_FFT_FREQ, VS_POST_FFT_AMP
+    } vs_post_metric;
+
+  // Write an ERD header (path ends in .erd) and its .bin file with n_rec
+  // records of n_chan values (data is row-major). bytes is 4 or 8. Return 0
+  // if OK, -1 if not.
+  int vs_erd_write (const char *path, const char *title, int n_chan,
+                    const char *const *names, int n_rec, const vs_real *data,
+                    int bytes);
+
+  // One ERD file pair, mapped.
+  class vs_erd_file
+    {
+    public:
+      vs_erd_file () : n_rec(0), bytes(8) {}
+
+      int  open (const char *path); // Return 0 if OK, -1 if not.
+      void close (void);
+
+      int n_channels (void) const {return (int)names.size();}
+      int n_records (void) const {return n_rec;}
+      const char *name (int i) const {return names[i].c_str();}
+      int find (const char *name) const; // -1 if not there
+
+      // Channel i as vs_real. Return the number of values.
+      int     read (int i, vs_real *out) const;
+      vs_real value (int record, int i) const;
+
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_mapped_file bin;
+      std::vector<std::string> names;
+      int n_rec, bytes;
+      std::string error;
+    };
+
+  class vs_post
+    {
+    public:
+      vs_post ();
+      ~vs_post ();
+
+      void add_run (const char *erd_path);
+      int  add_metric (const char *channel, vs_post_metric metric, vs_real param = 0.0);
+      void clear_runs (void);
+
+      // Compute all metrics for all runs with n_threads (0 = all cores).
+      // Return the number of runs that could not be read.
+      int compute (int n_threads = 0);
+
+      int n_runs (void) const {return (int)runs.size();}
+      int n_metrics (void) const {return (int)metrics.size();}
+
+      // Result of a metric for a run (NaN if the run or channel is missing).
+      vs_real value (int run, int metric) const
+        {return values[(size_t)run*metrics.size() + metric];}
+      const char *run_error (int run) const {return runs[run].error.c_str();}
+
+      // Summary table, CSV with a header row. Return 0 if OK, -1 if not.
+      int write_summary (const char *csv_path) const;
+
+      double    seconds (void) const {return wall;} // time of the last compute()
+      long long steals (void) const {return n_steals;}
+
+    private:
+      vs_post (const vs_post &);            // not copyable
+      vs_post &operator= (const vs_post &);
+
+      struct run_info
+        {
+        std::string path, error;
+        vs_erd_file *file;
+        };
+      struct metric_info
+        {
+        std::string channel;
+        vs_post_metric metric;
+        vs_real param;
+        int group; // index in channels
+        };
+
+      void run_channel (int run, int channel, std::vector<vs_real> &x,
+                        std::vector<vs_real> &work, std::vector<vs_real> &twiddle);
+
+      std::vector<run_info>    runs;
+      std::vector<metric_info> metrics;
+      std::vector<std::string> channels; // distinct channels of the metrics
+      std::vector<vs_real>     values;   // runs x metrics
+      double wall;
+      long long n_steals;
+    };
+
+#endif  // end block for _VS_POST_H
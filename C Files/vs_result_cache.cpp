@@ -0,0 +1,562 @@
+/* Content-addressed cache of run results. See vs_result_cache.h.
+
+   Log:
+   Oct 18, 26. Keys are hashed with vs_hasher (vs_hash.h), 8 bytes at a
+               time; results stored under older keys are not found.
+   Oct 18, 26. Data files named in parsfiles are part of the key; results
+               keep the seconds of their run (file version 2).
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+  #include <windows.h>
+  #include <direct.h>
+  #include <sys/utime.h>
+#else
+  #include <dirent.h>
+  #include <unistd.h>
+  #include <utime.h>
+#endif
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_hash.h"         // content hash
+#include "vs_jobs.h"         // vs_job_mods
+#include "vs_result_cache.h" // run result cache
+
+#define VSS_MAX_DEPTH 32 // nesting of PARSFILE, to stop on loops
+
+// Layout of a result file: header, then n values.
+typedef struct
+  {
+  uint32_t magic, version;
+  int32_t  n, pad;
+  double   t_end, seconds;
+  } vss_result_header;
+
+// vs_hasher with the pieces of a key.
+struct vs_result_cache::hasher : public vs_hasher
+  {
+  using vs_hasher::add;
+  void add (const char *text) {add(text, strlen(text) + 1);}
+  void add (const std::string &text) {add(text.c_str(), text.size() + 1);}
+  void add (const digest &d) {add(&d, sizeof(d));}
+  void add (vs_real x) {add(&x, sizeof(x));}
+
+  digest get (void) const
+    {
+    digest d;
+    d.a = h[0];
+    d.b = h[1];
+    return d;
+    }
+  };
+
+static std::string vss_upper (const std::string &s)
+{
+  std::string u(s);
+  for (size_t i = 0; i < u.size(); i++) u[i] = (char)toupper((unsigned char)u[i]);
+  return u;
+}
+
+// Remove leading and trailing white space.
+static std::string vss_trim (const char *s)
+{
+  const char *end = s + strlen(s);
+
+  while (*s && isspace((unsigned char)*s)) s++;
+  while (end > s && isspace((unsigned char)end[-1])) end--;
+  return std::string(s, end - s);
+}
+
+static vs_bool vss_is_absolute (const std::string &path)
+{
+  return !path.empty() && (path[0] == '/' || path[0] == '\\' ||
+                           (path.size() > 1 && path[1] == ':'));
+}
+
+// Path of a file named in a simfile or parsfile, for this OS.
+static std::string vss_os_path (const std::string &path, const std::string &dir)
+{
+  std::string p = vss_is_absolute(path) || dir.empty() ? path : dir + path;
+#ifndef _WIN32
+  std::replace (p.begin(), p.end(), '\\', '/');
+#endif
+  return p;
+}
+
+// Modification time, as finely as the OS gives it.
+static long long vss_mtime (const struct stat &sb)
+{
+#ifdef __linux__
+  return (long long)sb.st_mtim.tv_sec*1000000000LL + sb.st_mtim.tv_nsec;
+#else
+  return (long long)sb.st_mtime;
+#endif
+}
+
+// Directory part of a path, with its separator.
+static std::string vss_dir_of (const std::string &path)
+{
+  size_t i = path.find_last_of("/\\");
+  return i == std::string::npos ? std::string() : path.substr(0, i + 1);
+}
+
+// Keywords whose file is written by the run, or read apart from the key.
+static vs_bool vss_not_data (const std::string &key)
+{
+  static const char *skip[] =
+    {"PARSFILE", "INPUT", "ECHO", "FINAL", "LOGFILE", "ERDFILE", "DLLFILE",
+     "PROGDIR", "DATADIR", NULL};
+  int i;
+
+  for (i = 0; skip[i]; i++)
+    if (key == skip[i]) return TRUE;
+  return FALSE;
+}
+
+// Words after the keyword of a parsfile line that could name a file: they
+// have a dot or a separator and are not numbers. The rest of the line is
+// one more, for names with spaces.
+static void vss_data_words (const std::string &line, std::vector<std::string> &words)
+{
+  size_t i = line.find_first_of(" \t,"), j;
+  std::string w;
+  char *end;
+
+  if (i == std::string::npos || vss_not_data(vss_upper(line.substr(0, i)))) return;
+  w = vss_trim(line.c_str() + i);
+  if (w.find_first_of(" \t") != std::string::npos && w.find_first_of("./\\") !=
+      std::string::npos)
+    words.push_back (w);
+  while ((i = line.find_first_not_of(" \t,", i)) != std::string::npos)
+    {
+    j = line.find_first_of(" \t,", i);
+    w = line.substr(i, j == std::string::npos ? std::string::npos : j - i);
+    i = j;
+    if (w.find_first_of("./\\") == std::string::npos) continue;
+    strtod (w.c_str(), &end);
+    if (*end) words.push_back(w);
+    }
+}
+
+
+vs_result_cache::vs_result_cache () : max_bytes(0), bytes(0)
+{
+  memset (&st, 0, sizeof(st));
+}
+
+
+/* ----------------------------------------------------------------------------
+   Use a directory for results. The most recently used results are the ones
+   with the latest modification time.
+---------------------------------------------------------------------------- */
+int vs_result_cache::open (const char *directory, long long max_size)
+{
+  std::vector<std::pair<long long, std::string> > found; // mtime, file name
+  std::string name;
+  struct stat sb;
+  size_t i, n_ext = strlen(VS_RESULT_CACHE_EXT);
+
+  close ();
+  std::lock_guard<std::mutex> guard(lock);
+  dir = directory;
+  if (!dir.empty() && dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\')
+    dir += "/";
+#ifdef _WIN32
+  _mkdir (dir.c_str());
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA((dir + "*" VS_RESULT_CACHE_EXT).c_str(), &data);
+  if (h != INVALID_HANDLE_VALUE)
+    {
+    do found.push_back(std::make_pair(0LL, std::string(data.cFileName)));
+    while (FindNextFileA(h, &data));
+    FindClose (h);
+    }
+#else
+  mkdir (dir.c_str(), 0777);
+  DIR *d = opendir(dir.c_str());
+  struct dirent *e;
+  if (d)
+    {
+    while ((e = readdir(d)) != NULL) found.push_back(std::make_pair(0LL, e->d_name));
+    closedir (d);
+    }
+#endif
+  if (stat(dir.c_str(), &sb) || !(sb.st_mode & S_IFDIR))
+    {
+    error = "The cache directory \"" + dir + "\" could not be made.";
+    dir.clear ();
+    return -1;
+    }
+
+  max_bytes = max_size;
+  for (i = 0; i < found.size(); i++)
+    {
+    name = found[i].second;
+    if (name.size() != 32 + n_ext || name.compare(32, n_ext, VS_RESULT_CACHE_EXT) ||
+        stat((dir + name).c_str(), &sb))
+      {
+      found[i].second.clear ();
+      continue;
+      }
+    found[i].first = vss_mtime(sb);
+    }
+  std::sort (found.begin(), found.end());
+
+  // oldest first, so the newest ends at the front of the list
+  for (i = 0; i < found.size(); i++)
+    if (!found[i].second.empty() && !stat((dir + found[i].second).c_str(), &sb))
+      touch (found[i].second.substr(0, 32), (long long)sb.st_size);
+  evict ();
+  return 0;
+}
+
+void vs_result_cache::close (void)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  dir.clear ();
+  entries.clear ();
+  lru.clear ();
+  bytes = 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Hash of a file, read again only if its size or time changed. A parsfile is
+   hashed as text without blank lines and comments, and the files it loads
+   with PARSFILE are noted. Return NULL if the file can't be read.
+---------------------------------------------------------------------------- */
+const vs_result_cache::file_info *vs_result_cache::file (const std::string &path,
+                                                         vs_bool is_parsfile)
+{
+  struct stat sb;
+  file_info info;
+  hasher h;
+  FILE *fp;
+  char tmpstr[4096];
+  std::string line;
+  size_t n;
+
+  if (stat(path.c_str(), &sb)) return NULL;
+  std::unordered_map<std::string, file_info>::iterator it = files.find(path);
+  if (it != files.end() && it->second.size == (long long)sb.st_size &&
+      it->second.mtime == vss_mtime(sb))
+    return &it->second;
+
+  if ((fp = fopen(path.c_str(), is_parsfile ? "r" : "rb")) == NULL) return NULL;
+  if (is_parsfile)
+    {
+    while (fgets(tmpstr, sizeof(tmpstr), fp))
+      {
+      line = vss_trim(tmpstr);
+      if (line.empty() || line[0] == '#' || line[0] == '!') continue;
+      h.add (line);
+      if (line.size() > 9 && !vss_upper(line.substr(0, 8)).compare("PARSFILE") &&
+          isspace((unsigned char)line[8]))
+        info.parsfiles.push_back (vss_trim(line.c_str() + 8));
+      else
+        vss_data_words (line, info.data);
+      }
+    }
+  else
+    {
+    while ((n = fread(tmpstr, 1, sizeof(tmpstr), fp)) > 0) h.add(tmpstr, n);
+    }
+  fclose (fp);
+
+  info.size = (long long)sb.st_size;
+  info.mtime = vss_mtime(sb);
+  info.hash = h.get();
+  files[path] = info;
+  return &files[path];
+}
+
+// Add a parsfile, the data files it names and the parsfiles it loads, in
+// order. A data file is looked for in DATADIR, then next to the parsfile.
+void vs_result_cache::add_tree (hasher &h, const std::string &path,
+                                const std::string &data_dir, int depth)
+{
+  const file_info *info = file(path, TRUE), *data;
+  std::vector<std::string> children, words;
+  std::string name;
+  struct stat sb;
+  size_t i;
+  int k;
+
+  if (info == NULL || depth > VSS_MAX_DEPTH)
+    {
+    h.add ("missing");
+    h.add (path);
+    return;
+    }
+  h.add (info->hash);
+  children = info->parsfiles; // copy: the map may grow during the recursion
+  words = info->data;
+  for (i = 0; i < words.size(); i++)
+    for (k = 0; k < 2; k++)
+      {
+      name = vss_os_path(words[i], k ? vss_dir_of(path) : data_dir);
+      if (stat(name.c_str(), &sb) || !(sb.st_mode & S_IFREG)) continue;
+      if ((data = file(name, FALSE)) == NULL) break;
+      h.add ("data");
+      h.add (words[i]);
+      h.add (data->hash);
+      break;
+      }
+  for (i = 0; i < children.size(); i++)
+    add_tree (h, vss_os_path(children[i], data_dir), data_dir, depth + 1);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Make the key of a run.
+---------------------------------------------------------------------------- */
+int vs_result_cache::make_key (const char *simfile, const vs_job_mods &mods,
+                               const vs_real *timing, std::string &key)
+{
+  std::string dll, input, data_dir, msg, word;
+  std::vector<std::pair<std::string, vs_real> > sorted;
+  const file_info *info;
+  hasher h;
+  FILE *fp;
+  char tmpstr[FILENAME_MAX + 32], *k, *rest;
+  size_t i;
+
+  if ((fp = fopen(simfile, "r")) == NULL)
+    {
+    std::lock_guard<std::mutex> guard(lock);
+    error = "The simfile \"" + std::string(simfile) + "\" could not be opened.";
+    return -1;
+    }
+  while (fgets(tmpstr, sizeof(tmpstr), fp))
+    {
+    k = strtok(tmpstr, " \t\n");
+    rest = strtok(NULL, "\n");
+    if (k == NULL) continue;
+    word = vss_upper(k);
+    if (word == "END") break;
+    if (rest == NULL) continue;
+    if (word == "DLLFILE") dll = vss_trim(rest);
+    else if (word == "INPUT") input = vss_trim(rest);
+    else if (word == "DATADIR") data_dir = vss_trim(rest);
+    }
+  fclose (fp);
+  if (!data_dir.empty() && data_dir[data_dir.size() - 1] != '/' &&
+      data_dir[data_dir.size() - 1] != '\\')
+    data_dir += "\\";
+
+  sorted.reserve (mods.size());
+  for (i = 0; i < mods.size(); i++)
+    sorted.push_back (std::make_pair(vss_upper(mods[i].first), mods[i].second));
+  std::stable_sort (sorted.begin(), sorted.end(),
+                    [] (const std::pair<std::string, vs_real> &x,
+                        const std::pair<std::string, vs_real> &y)
+                      {return x.first < y.first;});
+
+  std::lock_guard<std::mutex> guard(lock);
+  h.add ("dll");
+  if ((info = file(vss_os_path(dll, ""), FALSE)) != NULL) h.add(info->hash);
+  else h.add(dll);
+
+  h.add ("input");
+  if (input.empty())
+    add_tree (h, simfile, vss_os_path(data_dir, vss_dir_of(simfile)), 0);
+  else
+    add_tree (h, vss_os_path(input, vss_dir_of(simfile)),
+              vss_os_path(data_dir, vss_dir_of(simfile)), 0);
+
+  h.add ("mods");
+  for (i = 0; i < sorted.size(); i++)
+    {
+    h.add (sorted[i].first);
+    h.add (sorted[i].second);
+    }
+  if (timing)
+    {
+    h.add ("timing");
+    for (i = 0; i < 3; i++) h.add(timing[i]);
+    }
+
+  digest d = h.get();
+  sprintf (tmpstr, "%016llx%016llx", (unsigned long long)d.a, (unsigned long long)d.b);
+  key = tmpstr;
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   LRU list. The lock must be held.
+---------------------------------------------------------------------------- */
+std::string vs_result_cache::entry_path (const std::string &key) const
+{
+  return dir + key + VS_RESULT_CACHE_EXT;
+}
+
+// Put an entry at the front of the list.
+void vs_result_cache::touch (const std::string &key, long long size)
+{
+  std::unordered_map<std::string, entry>::iterator it = entries.find(key);
+
+  if (it != entries.end())
+    {
+    bytes -= it->second.bytes;
+    lru.erase (it->second.lru);
+    }
+  lru.push_front (key);
+  entries[key].bytes = size;
+  entries[key].lru = lru.begin();
+  bytes += size;
+}
+
+void vs_result_cache::forget (const std::string &key)
+{
+  std::unordered_map<std::string, entry>::iterator it = entries.find(key);
+
+  if (it == entries.end()) return;
+  bytes -= it->second.bytes;
+  lru.erase (it->second.lru);
+  entries.erase (it);
+}
+
+// Remove the least recently used results until the directory fits.
+void vs_result_cache::evict (void)
+{
+  std::string key;
+
+  while (bytes > max_bytes && lru.size() > 1)
+    {
+    key = lru.back();
+    remove (entry_path(key).c_str());
+    forget (key);
+    st.evictions++;
+    }
+}
+
+
+/* ----------------------------------------------------------------------------
+   Get and store results.
+---------------------------------------------------------------------------- */
+int vs_result_cache::find (const std::string &key, std::vector<vs_real> &values,
+                           vs_real *t_end, double *seconds)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  vss_result_header head;
+  std::string path;
+  FILE *fp;
+  int ok = 0;
+
+  if (dir.empty() || entries.find(key) == entries.end())
+    {
+    st.misses++;
+    return -1;
+    }
+
+  path = entry_path(key);
+  if ((fp = fopen(path.c_str(), "rb")) != NULL)
+    {
+    if (fread(&head, sizeof(head), 1, fp) == 1 && head.magic == VS_RESULT_CACHE_MAGIC &&
+        head.version == VS_RESULT_CACHE_VERSION && head.n >= 0)
+      {
+      values.resize (head.n);
+      ok = fread(values.data(), sizeof(vs_real), head.n, fp) == (size_t)head.n;
+      }
+    fclose (fp);
+    }
+  if (!ok)
+    {
+    // damaged or removed behind our back
+    remove (path.c_str());
+    forget (key);
+    st.misses++;
+    return -1;
+    }
+
+  if (t_end) *t_end = head.t_end;
+  if (seconds) *seconds = head.seconds;
+#ifdef _WIN32
+  _utime (path.c_str(), NULL);
+#else
+  utime (path.c_str(), NULL);
+#endif
+  touch (key, entries[key].bytes);
+  st.hits++;
+  return 0;
+}
+
+int vs_result_cache::store (const std::string &key, const std::vector<vs_real> &values,
+                            vs_real t_end, double seconds)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  vss_result_header head;
+  std::string path, tmp;
+  FILE *fp;
+  int err;
+
+  if (dir.empty()) return -1;
+  head.magic = VS_RESULT_CACHE_MAGIC;
+  head.version = VS_RESULT_CACHE_VERSION;
+  head.n = (int32_t)values.size();
+  head.pad = 0;
+  head.t_end = t_end;
+  head.seconds = seconds;
+
+  // write a temporary file and rename it, so readers never see half a result
+  path = entry_path(key);
+  tmp = path + ".tmp";
+  if ((fp = fopen(tmp.c_str(), "wb")) == NULL)
+    {
+    error = "The cache file \"" + tmp + "\" could not be written.";
+    return -1;
+    }
+  err = fwrite(&head, sizeof(head), 1, fp) != 1 ||
+        fwrite(values.data(), sizeof(vs_real), values.size(), fp) != values.size();
+  if (fclose(fp)) err = 1;
+#ifdef _WIN32
+  if (!err) remove(path.c_str());
+#endif
+  if (err || rename(tmp.c_str(), path.c_str()))
+    {
+    remove (tmp.c_str());
+    error = "The cache file \"" + path + "\" could not be written.";
+    return -1;
+    }
+
+  touch (key, (long long)(sizeof(head) + values.size()*sizeof(vs_real)));
+  st.stores++;
+  evict ();
+  return 0;
+}
+
+void vs_result_cache::clear (void)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  std::list<std::string>::iterator it;
+
+  for (it = lru.begin(); it != lru.end(); ++it) remove(entry_path(*it).c_str());
+  entries.clear ();
+  lru.clear ();
+  bytes = 0;
+}
+
+vs_result_cache_stats vs_result_cache::stats (void)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  vs_result_cache_stats s = st;
+
+  s.entries = (long long)entries.size();
+  s.bytes = bytes;
+  return s;
+}
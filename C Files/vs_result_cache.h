@@ -0,0 +1,120 @@
+/* Content-addressed cache of run results, to skip runs that were already made.
+
+   Optimizers and sweep scripts often ask again for a configuration that was
+   already simulated. A vs_result_cache keeps the result of each run in a
+   directory on local disk, in a file named by a hash of everything that
+   determines the run:
+     - the solver DLL named with DLLFILE in the simfile (its contents),
+     - the INPUT parsfile of the simfile and every parsfile it loads with
+       PARSFILE, in order, without blank lines and comment lines,
+     - the data files the parsfiles name (road files, tables, other
+       includes): any word after a keyword, other than an output keyword,
+       that names an existing file in DATADIR or in the parsfile's own
+       directory (by contents),
+     - the parameter changes, sorted by keyword (keywords are not case
+       sensitive),
+     - the timing from vs_read_configuration, when the caller has it.
+   Output files (ECHO, FINAL, LOGFILE, ERDFILE, ...) do not change the key.
+   Files are hashed once and remembered by path, size and modification time,
+   so the key of an unchanged configuration costs a few calls to stat.
+
+   A result is a vector of numbers (the exports at the end of the run, or
+   cost values) plus the end time and the wall-clock time of the run that
+   made it. The directory is limited in total size;
+   the least recently used results are removed first. Hits, misses, stores
+   and evictions are counted.
+
+   A vs_job_pool uses a cache with vs_job_pool::set_cache (see vs_jobs.h).
+
+   Log:
+   Oct 18, 26. Hash the data files named in parsfiles; keep the run time.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_RESULT_CACHE_H
+  #define _VS_RESULT_CACHE_H
+
+  #include <stdint.h>
+  #include <list>
+  #include <mutex>
+  #include <string>
+  #include <unordered_map>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_jobs.h"     // vs_job_mods
+
+  #define VS_RESULT_CACHE_MAGIC    0x43525356u // "VSRC"
+  #define VS_RESULT_CACHE_VERSION  2
+  #define VS_RESULT_CACHE_EXT      ".vsr"
+
+  typedef struct
+    {
+    long long hits, misses, stores, evictions;
+    long long entries, bytes; // now in the directory
+    } vs_result_cache_stats;
+
+  class vs_result_cache
+    {
+    public:
+      vs_result_cache ();
+
+      // Use a directory (made if needed) limited to max_bytes. Results already
+      // in it are kept. Return 0 if OK, -1 if not.
+      int open (const char *dir, long long max_bytes);
+      void close (void);
+      vs_bool is_open (void) const {return !dir.empty();}
+
+      // Key of a run (32 hex digits). timing = {tstart, tstop, tstep} or NULL.
+      // Return 0 if OK, -1 if the simfile could not be read.
+      int make_key (const char *simfile, const vs_job_mods &mods,
+                    const vs_real *timing, std::string &key);
+
+      // Get a stored result and the seconds its run took (seconds may be
+      // NULL). Return 0 if found, -1 if not.
+      int find (const std::string &key, std::vector<vs_real> &values,
+                vs_real *t_end, double *seconds = NULL);
+
+      // Store a result, removing old ones to stay within the size limit.
+      // Return 0 if OK, -1 if the file could not be written.
+      int store (const std::string &key, const std::vector<vs_real> &values,
+                 vs_real t_end, double seconds = 0.0);
+
+      void clear (void); // remove all results
+      vs_result_cache_stats stats (void);
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      struct digest {uint64_t a, b;};
+      struct hasher;
+      struct file_info
+        {
+        long long size, mtime;
+        digest    hash;                   // canonical contents
+        std::vector<std::string> parsfiles; // loaded with PARSFILE, in order
+        std::vector<std::string> data;      // words that may name data files
+        };
+      struct entry
+        {
+        long long bytes;
+        std::list<std::string>::iterator lru;
+        };
+
+      const file_info *file (const std::string &path, vs_bool is_parsfile);
+      void add_tree (hasher &h, const std::string &path,
+                     const std::string &data_dir, int depth);
+      std::string entry_path (const std::string &key) const;
+      void touch (const std::string &key, long long bytes);
+      void evict (void);
+      void forget (const std::string &key);
+
+      std::mutex lock;
+      std::string dir, error;
+      long long max_bytes, bytes;
+      std::unordered_map<std::string, file_info> files; // by path
+      std::unordered_map<std::string, entry> entries;   // by key
+      std::list<std::string> lru;                       // most recent first
+      vs_result_cache_stats st;
+    };
+
+#endif  // end block for _VS_RESULT_CACHE_H
@@ -0,0 +1,106 @@
+/* Rewind buffer for driver-in-the-loop sessions. See vs_rewind.h.
+
+   Log:
+   Oct 18, 26. Start the solver's save timer, or report that it can't be.
+   Oct 18, 26. No snapshots, and an error, if the DLL cannot copy the state.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_rewind.h"       // rewind buffer
+
+vs_rewind_ring::vs_rewind_ring (vs_real window_seconds, vs_real cadence_seconds)
+  : window(window_seconds), cadence(cadence_seconds), t_next(0.0), tstep(0.0),
+    n(0), cap(0), head(0), count(0)
+{
+}
+
+void vs_rewind_ring::reserve (int n_state)
+{
+  n = n_state;
+  cap = (int)ceil(window/(cadence > 0.0 ? cadence : 1e-3)) + 1;
+  state.assign ((size_t)cap*n, 0.0);
+  times.assign (cap, 0.0);
+  head = count = 0;
+}
+
+// Start of a run: size the ring for the model unless already done, and
+// start the save timer so that the solver calls VS_EXT_EQ_SAVE.
+void vs_rewind_ring::start (vs_real t)
+{
+  int n_state;
+
+  head = count = 0;
+  if (api->vs_n_derivatives == NULL || api->vs_n_extra_state_variables == NULL ||
+      api->vs_copy_all_state_vars_to_array == NULL ||
+      api->vs_copy_all_state_vars_from_array == NULL)
+    {
+    api->vs_printf_error ("%s\n", vs_api_missing("vs_copy_all_state_vars_to_array").c_str());
+    cap = 0;
+    return;
+    }
+  if (api->vs_start_save_timer == NULL)
+    {
+    api->vs_printf_error ("%s\n", vs_api_missing("vs_start_save_timer").c_str());
+    cap = 0;
+    return;
+    }
+  api->vs_start_save_timer (t);
+  n_state = api->vs_n_derivatives() + api->vs_n_extra_state_variables();
+  if (n_state != n || cap == 0) reserve(n_state);
+  tstep = api->vs_get_tstep();
+  t_next = t;
+}
+
+void vs_rewind_ring::capture (vs_real t)
+{
+  api->vs_copy_all_state_vars_to_array (&state[(size_t)head*n]);
+  times[head] = t;
+  head = (head + 1) % cap;
+  if (count < cap) count++;
+  t_next = t + cadence - 0.5*tstep;
+}
+
+vs_real vs_rewind_ring::oldest (void) const
+{
+  return count ? times[slot(0)] : -1.0;
+}
+
+vs_real vs_rewind_ring::newest (void) const
+{
+  return count ? times[slot(count - 1)] : -1.0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Restore the model state from the ring.
+---------------------------------------------------------------------------- */
+vs_real vs_rewind_ring::rewind (vs_real t)
+{
+  int lo = 0, hi, mid, s;
+
+  if (count == 0) return -1.0;
+
+  // last k with times[slot(k)] <= t; the ring is in time order
+  hi = count - 1;
+  while (lo < hi)
+    {
+    mid = (lo + hi + 1)/2;
+    if (times[slot(mid)] <= t + 1e-9*tstep) lo = mid;
+    else hi = mid - 1;
+    }
+
+  s = slot(lo);
+  api->vs_copy_all_state_vars_from_array (&state[(size_t)s*n]);
+  count = lo + 1;
+  head = (s + 1) % cap;
+  t_next = times[s] + cadence - 0.5*tstep;
+  return times[s];
+}
@@ -0,0 +1,84 @@
+/* Rewind buffer for driver-in-the-loop sessions.
+
+   After an incident the operator wants to go back a few seconds and drive
+   again. The solver can do that with vs_set_request_to_restore(t) only if a
+   state was saved at t. A vs_rewind_ring keeps the model state of the last
+   few seconds instead, in a ring of snapshots taken with
+   vs_copy_all_state_vars_to_array at VS_EXT_EQ_SAVE, at most once per
+   cadence (simulation seconds).
+
+   The solver calls VS_EXT_EQ_SAVE only while its save timer runs, so the
+   ring starts it with vs_start_save_timer at VS_EXT_EQ_INIT (a DLL without
+   that function gets an error and no snapshots). EQ_SAVE then comes at the
+   model's own save interval (SAVE_DT in the stand-in solver), and each save
+   also keeps the solver's own saved state; a cadence shorter than that
+   interval gives one snapshot per save.
+
+   All memory is allocated at VS_EXT_EQ_INIT (or earlier with reserve()), so
+   nothing is allocated while the session runs. A rewind is a binary search
+   over the ring and one copy with vs_copy_all_state_vars_from_array, well
+   within one frame. Snapshots newer than the restored one are dropped, so
+   the ring continues from the new time line.
+
+   rewind() changes the model state and must be called on the thread that
+   steps the model, between steps. The caller continues the run from the
+   returned time.
+
+   Log:
+   Oct 18, 26. Start the save timer at VS_EXT_EQ_INIT.
+   Oct 18, 26. No snapshots if the DLL cannot copy the state.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_REWIND_H
+  #define _VS_REWIND_H
+
+  #include <vector>
+
+  #include "vs_deftypes.h"     // VS types and definitions
+  #include "vs_ext_dispatch.h" // external code dispatcher
+
+  class vs_rewind_ring : public vs_ext_subsystem
+    {
+    public:
+      // window: seconds kept; cadence: seconds between snapshots
+      vs_rewind_ring (vs_real window = 10.0, vs_real cadence = 0.01);
+
+      // Allocate for n_state values now instead of at VS_EXT_EQ_INIT.
+      void reserve (int n_state);
+
+      // Put the model back to the last snapshot at or before t, or to the
+      // oldest one if t is before the window. Return the time of the state,
+      // or -1 if the ring is empty.
+      vs_real rewind (vs_real t);
+
+      // Go back by a number of seconds from the newest snapshot.
+      vs_real rewind_by (vs_real seconds) {return rewind(newest() - seconds);}
+
+      vs_real oldest (void) const;
+      vs_real newest (void) const;
+      int     size (void) const {return count;}
+      int     capacity (void) const {return cap;}
+      size_t  bytes (void) const {return state.size()*sizeof(vs_real);}
+
+      // vs_ext_subsystem
+      unsigned calc_mask (void) const
+        {return VS_EXT_MASK(VS_EXT_EQ_INIT) | VS_EXT_MASK(VS_EXT_EQ_SAVE);}
+      void calc (vs_real t, vs_ext_loc where)
+        {
+        if (where == VS_EXT_EQ_SAVE) {if (cap && t >= t_next) capture(t);}
+        else start(t);
+        }
+
+    private:
+      void start (vs_real t);
+      void capture (vs_real t);
+      int  slot (int k) const {return (head + cap - count + k) % cap;}
+
+      vs_real window, cadence, t_next, tstep;
+      int n, cap, head, count;        // head: slot of the next snapshot
+      std::vector<vs_real> state;     // cap x n
+      std::vector<vs_real> times;     // cap
+    };
+
+#endif  // end block for _VS_REWIND_H
@@ -0,0 +1,351 @@
+/* Tiled road store. See vs_road_tiles.h.
+
+   File: a 64 KB header block, then the tiles, each stride bytes (a
+   multiple of 64 KB). A tile has tile_samples + 1 records of
+   4 + n_lat doubles: x, y, yaw, mu, z[n_lat].
+
+   Log:
+   Oct 18, 26. open() rejects headers whose layout or sizes do not fit.
+   Oct 18, 26. xy(): yaw interpolated the short way across the +/- pi wrap.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_mmap.h"       // mapped files
+#include "vs_road_tiles.h" // tiled road store
+
+#define VSS_BLOCK   65536 // alignment of the tiles in the file
+#define VSS_VERSION 1
+
+enum {VSS_X, VSS_Y, VSS_YAW, VSS_MU, VSS_Z}; // values of a record
+
+typedef struct
+  {
+  char      magic[8]; // "VSROADT"
+  int       version, tile_samples, n_lat, pad;
+  double    s0, ds, l_min, dl;
+  long long n_samples, n_tiles, stride;
+  } vss_header;
+
+static size_t vss_round_up (size_t n)
+{
+  return (n + VSS_BLOCK - 1)/VSS_BLOCK*VSS_BLOCK;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Writer.
+---------------------------------------------------------------------------- */
+vs_road_tile_writer::vs_road_tile_writer ()
+  : fp(NULL), n_in_tile(0), rec(0), n_samples(0), n_tiles(0), stride(0)
+{
+  memset (&lay, 0, sizeof(lay));
+}
+
+vs_road_tile_writer::~vs_road_tile_writer ()
+{
+  if (fp) close();
+}
+
+int vs_road_tile_writer::open (const char *path, const vs_road_tile_layout &layout)
+{
+  static const char zeros[VSS_BLOCK] = {0};
+
+  if (fp) close();
+  error.clear ();
+  if (layout.ds <= 0.0 || layout.tile_samples < 1 || layout.n_lat < 1 ||
+      (layout.n_lat > 1 && layout.dl <= 0.0))
+    {
+    error = "The road tile layout is not valid.";
+    return -1;
+    }
+  if ((fp = fopen(path, "wb")) == NULL)
+    {
+    error = std::string("Cannot write the road file ") + path + ".";
+    return -1;
+    }
+  lay = layout;
+  rec = VSS_Z + lay.n_lat;
+  stride = vss_round_up((size_t)(lay.tile_samples + 1)*rec*sizeof(vs_real));
+  tile.assign ((size_t)(lay.tile_samples + 1)*rec, 0.0);
+  n_in_tile = 0;
+  n_samples = n_tiles = 0;
+  if (fwrite(zeros, 1, VSS_BLOCK, fp) != VSS_BLOCK) // header, written at close()
+    {
+    error = "Cannot write the road file.";
+    fclose (fp);
+    fp = NULL;
+    return -1;
+    }
+  return 0;
+}
+
+int vs_road_tile_writer::write_tile (void)
+{
+  static const char zeros[VSS_BLOCK] = {0};
+  size_t bytes = tile.size()*sizeof(vs_real);
+
+  if (fwrite(tile.data(), 1, bytes, fp) != bytes ||
+      fwrite(zeros, 1, stride - bytes, fp) != stride - bytes)
+    {
+    error = "Cannot write the road file.";
+    return -1;
+    }
+  n_tiles++;
+  return 0;
+}
+
+// A tile is written when it is full; its last record starts the next one.
+int vs_road_tile_writer::add (vs_real x, vs_real y, vs_real yaw, vs_real mu,
+                              const vs_real *z)
+{
+  vs_real *r;
+
+  if (fp == NULL) return -1;
+  r = &tile[(size_t)n_in_tile*rec];
+  r[VSS_X] = x;
+  r[VSS_Y] = y;
+  r[VSS_YAW] = yaw;
+  r[VSS_MU] = mu;
+  memcpy (r + VSS_Z, z, lay.n_lat*sizeof(vs_real));
+  n_samples++;
+  if (++n_in_tile <= lay.tile_samples) return 0;
+
+  if (write_tile()) return -1;
+  memcpy (tile.data(), r, rec*sizeof(vs_real));
+  n_in_tile = 1;
+  return 0;
+}
+
+// The last tile is filled with copies of the last sample.
+int vs_road_tile_writer::close (void)
+{
+  vss_header h;
+  int status = 0;
+
+  if (fp == NULL) return -1;
+  if (n_samples < 2)
+    {
+    error = "A road needs two samples or more.";
+    status = -1;
+    }
+  else if (n_in_tile > 1)
+    {
+    for (int i = n_in_tile; i <= lay.tile_samples; i++)
+      memcpy (&tile[(size_t)i*rec], &tile[(size_t)(n_in_tile - 1)*rec], rec*sizeof(vs_real));
+    status = write_tile();
+    }
+
+  memset (&h, 0, sizeof(h));
+  memcpy (h.magic, "VSROADT", 8);
+  h.version = VSS_VERSION;
+  h.tile_samples = lay.tile_samples;
+  h.n_lat = lay.n_lat;
+  h.s0 = lay.s0;
+  h.ds = lay.ds;
+  h.l_min = lay.l_min;
+  h.dl = lay.dl;
+  h.n_samples = n_samples;
+  h.n_tiles = n_tiles;
+  h.stride = (long long)stride;
+  if (!status && (fseek(fp, 0, SEEK_SET) || fwrite(&h, sizeof(h), 1, fp) != 1))
+    {
+    error = "Cannot write the road file.";
+    status = -1;
+    }
+  if (fclose(fp) && !status)
+    {
+    error = "Cannot write the road file.";
+    status = -1;
+    }
+  fp = NULL;
+  return status;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Reader.
+---------------------------------------------------------------------------- */
+vs_road_tiles::vs_road_tiles ()
+  : base(NULL), n_samples(0), tiles(0), current(-1), lo(0), hi(-1), stride(0), rec(0),
+    ahead(1), behind(1)
+{
+  memset (&lay, 0, sizeof(lay));
+  memset (&st, 0, sizeof(st));
+}
+
+int vs_road_tiles::open (const char *path)
+{
+  vss_header h;
+
+  close ();
+  error.clear ();
+  if (file.open(path))
+    {
+    error = std::string("Cannot open the road file ") + path + ".";
+    return -1;
+    }
+  memset (&h, 0, sizeof(h));
+  if (file.size() >= sizeof(h)) memcpy(&h, file.data(), sizeof(h));
+  // the layout as the writer's open() checks it, and tiles that hold their
+  // records and all the samples
+  if (memcmp(h.magic, "VSROADT", 8) || h.version != VSS_VERSION ||
+      !(h.ds > 0.0) || h.tile_samples < 1 || h.n_lat < 1 ||
+      (h.n_lat > 1 && !(h.dl > 0.0)) || h.n_samples < 2 || h.n_tiles < 1 ||
+      h.stride < (long long)(h.tile_samples + 1)*(VSS_Z + h.n_lat)*(long long)sizeof(vs_real) ||
+      h.n_tiles > (long long)(file.size()/(size_t)h.stride) ||
+      h.n_tiles*h.tile_samples < h.n_samples - 1 ||
+      file.size() < VSS_BLOCK + (size_t)h.stride*h.n_tiles)
+    {
+    error = std::string("The file ") + path + " is not a complete road tile file.";
+    file.close ();
+    return -1;
+    }
+
+  lay.s0 = h.s0;
+  lay.ds = h.ds;
+  lay.tile_samples = h.tile_samples;
+  lay.n_lat = h.n_lat;
+  lay.l_min = h.l_min;
+  lay.dl = h.dl;
+  n_samples = h.n_samples;
+  tiles = h.n_tiles;
+  stride = (size_t)h.stride;
+  rec = VSS_Z + lay.n_lat;
+  base = (const char *)file.data() + VSS_BLOCK;
+  return 0;
+}
+
+void vs_road_tiles::close (void)
+{
+  file.close ();
+  base = NULL;
+  n_samples = tiles = 0;
+  current = -1;
+  lo = 0;
+  hi = -1;
+  memset (&st, 0, sizeof(st));
+}
+
+void vs_road_tiles::set_window (int n_ahead, int n_behind)
+{
+  ahead = n_ahead > 0 ? n_ahead : 0;
+  behind = n_behind > 0 ? n_behind : 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Make tile k the current one and move the window with it: tiles that left
+   it are dropped, tiles that entered it are read ahead.
+---------------------------------------------------------------------------- */
+void vs_road_tiles::move_to (long long k)
+{
+  long long new_lo, new_hi, i;
+  vs_bool forward = current < 0 || k > current;
+
+  new_lo = k - (forward ? behind : ahead);
+  new_hi = k + (forward ? ahead : behind);
+  if (new_lo < 0) new_lo = 0;
+  if (new_hi > tiles - 1) new_hi = tiles - 1;
+
+  for (i = lo; i <= hi; i++)
+    if (i < new_lo || i > new_hi)
+      {
+      file.advise (VSS_BLOCK + (size_t)i*stride, stride, VS_MAP_DONTNEED);
+      st.evicted++;
+      }
+  for (i = new_lo; i <= new_hi; i++)
+    if (i < lo || i > hi)
+      {
+      file.advise (VSS_BLOCK + (size_t)i*stride, stride, VS_MAP_WILLNEED);
+      st.prefetched++;
+      }
+  lo = new_lo;
+  hi = new_hi;
+  current = k;
+  st.tile_changes++;
+}
+
+// Record before station s (its successor is the next record in the same
+// tile) and the fraction from it to s.
+const vs_real *vs_road_tiles::locate (vs_real s, vs_real *f)
+{
+  vs_real u = (s - lay.s0)/lay.ds, last = (vs_real)(n_samples - 1);
+  long long i, k;
+
+  if (!(u > 0.0)) u = 0.0; // also NaN
+  if (u > last) u = last;
+  i = (long long)u;
+  if (i > n_samples - 2) i = n_samples - 2;
+  *f = u - (vs_real)i;
+  k = i/lay.tile_samples;
+  if (k != current) move_to(k);
+  return (const vs_real *)(base + (size_t)k*stride) +
+         (size_t)(i - k*lay.tile_samples)*rec;
+}
+
+void vs_road_tiles::contact (vs_real s, vs_real l, vs_real *z, vs_real *dzds,
+                             vs_real *dzdl, vs_real *mu)
+{
+  const vs_real *a, *b;
+  vs_real f, g = 0.0, v, za0, za1, zb0, zb1;
+  int j = 0;
+
+  if (base == NULL)
+    {
+    if (z) *z = 0.0;
+    if (dzds) *dzds = 0.0;
+    if (dzdl) *dzdl = 0.0;
+    if (mu) *mu = 1.0;
+    return;
+    }
+  a = locate(s, &f);
+  b = a + rec;
+  if (lay.n_lat > 1)
+    {
+    v = (l - lay.l_min)/lay.dl;
+    if (!(v > 0.0)) v = 0.0;
+    if (v > lay.n_lat - 1) v = lay.n_lat - 1;
+    j = (int)v;
+    if (j > lay.n_lat - 2) j = lay.n_lat - 2;
+    g = v - j;
+    }
+  za0 = a[VSS_Z + j];
+  zb0 = b[VSS_Z + j];
+  za1 = lay.n_lat > 1 ? a[VSS_Z + j + 1] : za0;
+  zb1 = lay.n_lat > 1 ? b[VSS_Z + j + 1] : zb0;
+
+  if (z) *z = (1.0 - f)*((1.0 - g)*za0 + g*za1) + f*((1.0 - g)*zb0 + g*zb1);
+  if (dzds) *dzds = ((1.0 - g)*(zb0 - za0) + g*(zb1 - za1))/lay.ds;
+  if (dzdl) *dzdl = lay.n_lat > 1 ? ((1.0 - f)*(za1 - za0) + f*(zb1 - zb0))/lay.dl : 0.0;
+  if (mu) *mu = a[VSS_MU] + f*(b[VSS_MU] - a[VSS_MU]);
+}
+
+// Point l to the left of the reference line.
+void vs_road_tiles::xy (vs_real s, vs_real l, vs_real *x, vs_real *y, vs_real *yaw)
+{
+  const vs_real *a, *b;
+  vs_real f, psi;
+
+  if (base == NULL)
+    {
+    if (x) *x = 0.0;
+    if (y) *y = 0.0;
+    if (yaw) *yaw = 0.0;
+    return;
+    }
+  a = locate(s, &f);
+  b = a + rec;
+  // Yaw may wrap between samples (pi to -pi): take the short way round.
+  psi = a[VSS_YAW] + f*remainder(b[VSS_YAW] - a[VSS_YAW], 8.0*atan(1.0));
+  if (x) *x = a[VSS_X] + f*(b[VSS_X] - a[VSS_X]) - l*sin(psi);
+  if (y) *y = a[VSS_Y] + f*(b[VSS_Y] - a[VSS_Y]) + l*cos(psi);
+  if (yaw) *yaw = psi;
+}
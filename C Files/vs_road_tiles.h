@@ -0,0 +1,139 @@
+/* Tiled road store for very long routes, read from a memory-mapped file.
+
+   A solver loads its road whole. Route-replay scenarios over hundreds of
+   kilometers of measured profile do not fit that way, and the external
+   code that previews or probes the road (contact models, planners) does
+   not need more than a few hundred meters of it at a time. A vs_road_tiles
+   file holds the road as samples every ds along the station, each with the
+   reference line (x, y, yaw), the friction and a row of elevations across
+   the road. The samples are cut into tiles of tile_samples steps, each
+   starting on a 64 KB boundary of the file. The last sample of a tile is
+   repeated as the first of the next, so any query stays in one tile.
+
+   The file is mapped, not read. A query moves the current tile to the tile
+   of its station, and when that changes, the tiles of the window around it
+   are advised: read ahead for those in the direction of travel (set_window
+   ahead) and dropped for those left behind (more than behind tiles back).
+   Resident memory is then about (ahead + behind + 1) tiles, whatever the
+   length of the route.
+
+     vs_road_tile_writer w;                // once, from the measured road
+     w.open ("route.vrt", layout);
+     for (...) w.add (x, y, yaw, mu, z);   // one sample per ds, in order
+     w.close ();
+
+     vs_road_tiles road;                   // in the run
+     road.open ("route.vrt");
+     road.set_window (2, 1);
+     road.contact (s, l, &z, &dzds, &dzdl, &mu);
+
+   Queries outside the road use its first or last sample (and the first or
+   last elevation across it). Elevations are bilinear in s and l.
+
+   Log:
+   Oct 18, 26. open() checks the header.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_ROAD_TILES_H
+  #define _VS_ROAD_TILES_H
+
+  #include <stdio.h>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_mmap.h"     // mapped files
+
+  typedef struct
+    {
+    vs_real s0;           // station of the first sample, m
+    vs_real ds;           // station step, m
+    int     tile_samples; // station steps per tile
+    int     n_lat;        // elevations across the road (1 or more)
+    vs_real l_min, dl;    // lateral position of the first one, and step, m
+    } vs_road_tile_layout;
+
+  typedef struct
+    {
+    long long tile_changes; // queries that moved to another tile
+    long long prefetched;   // tiles advised to be read ahead
+    long long evicted;      // tiles advised to be dropped
+    } vs_road_tile_stats;
+
+  // Writes a tiled road file, one sample at a time.
+  class vs_road_tile_writer
+    {
+    public:
+      vs_road_tile_writer ();
+      ~vs_road_tile_writer ();
+
+      // Return 0 if OK, -1 if not.
+      int open (const char *path, const vs_road_tile_layout &layout);
+      int add (vs_real x, vs_real y, vs_real yaw, vs_real mu, const vs_real *z);
+      int close (void); // writes the last tile and the header
+
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_road_tile_writer (const vs_road_tile_writer &);            // not copyable
+      vs_road_tile_writer &operator= (const vs_road_tile_writer &);
+
+      int write_tile (void);
+
+      FILE *fp;
+      vs_road_tile_layout lay;
+      std::vector<vs_real> tile; // tile_samples + 1 records
+      int       n_in_tile, rec;  // records in tile, values per record
+      long long n_samples, n_tiles;
+      size_t    stride;          // bytes per tile in the file
+      std::string error;
+    };
+
+  // Reads a tiled road file.
+  class vs_road_tiles
+    {
+    public:
+      vs_road_tiles ();
+
+      // Return 0 if OK, -1 if not (also if the header gives a layout the
+      // writer would not accept, or tiles too small for their records or
+      // too few for the samples).
+      int  open (const char *path);
+      void close (void);
+
+      // Tiles read ahead in the direction of travel and kept behind the
+      // current one. The default is 1 and 1.
+      void set_window (int ahead, int behind);
+
+      // Road at station s and lateral position l.
+      void contact (vs_real s, vs_real l, vs_real *z, vs_real *dzds, vs_real *dzdl,
+                    vs_real *mu);
+      void xy (vs_real s, vs_real l, vs_real *x, vs_real *y, vs_real *yaw);
+
+      const vs_road_tile_layout &layout (void) const {return lay;}
+      vs_real   s_start (void) const {return lay.s0;}
+      vs_real   s_end (void) const {return lay.s0 + (n_samples - 1)*lay.ds;}
+      long long n_tiles (void) const {return tiles;}
+      size_t    tile_bytes (void) const {return stride;}
+      const vs_road_tile_stats &stats (void) const {return st;}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_road_tiles (const vs_road_tiles &);            // not copyable
+      vs_road_tiles &operator= (const vs_road_tiles &);
+
+      const vs_real *locate (vs_real s, vs_real *f);
+      void move_to (long long k);
+
+      vs_mapped_file file;
+      vs_road_tile_layout lay;
+      const char *base;        // first tile
+      long long n_samples, tiles, current, lo, hi; // window: tiles lo to hi
+      size_t    stride;
+      int       rec, ahead, behind;
+      vs_road_tile_stats st;
+      std::string error;
+    };
+
+#endif  // end block for _VS_ROAD_TILES_H
@@ -0,0 +1,70 @@
+/* Run a simfile in real time with vs_rt_stepper and report timing statistics.
+
+   Usage: vs_rt_run [-cpu n] [-priority p] [-spin us] [-period s] [-lock]
+                    [-no_catch_up] [-json file] simfile
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_solver.h"     // per-instance solver API
+#include "vs_rt_stepper.h" // real-time stepping
+
+static vs_rt_stepper *stepper;
+
+static void vss_interrupt (int)
+{
+  if (stepper) stepper->stop();
+}
+
+int main (int argc, char **argv)
+{
+  vs_rt_config cfg;
+  vs_solver solver;
+  const char *simfile = NULL, *json = NULL;
+  int i, status;
+
+  vs_rt_config_default (&cfg);
+  for (i = 1; i < argc; i++)
+    {
+    if (!strcmp(argv[i], "-cpu") && i + 1 < argc) cfg.cpu = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-priority") && i + 1 < argc) cfg.priority = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-spin") && i + 1 < argc) cfg.spin = atof(argv[++i])*1e-6;
+    else if (!strcmp(argv[i], "-period") && i + 1 < argc) cfg.period = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-lock")) cfg.lock_memory = TRUE;
+    else if (!strcmp(argv[i], "-no_catch_up")) cfg.catch_up = FALSE;
+    else if (!strcmp(argv[i], "-json") && i + 1 < argc) json = argv[++i];
+    else simfile = argv[i];
+    }
+  if (simfile == NULL)
+    {
+    printf ("Usage: vs_rt_run [-cpu n] [-priority p] [-spin us] [-period s] [-lock]\n"
+            "                 [-no_catch_up] [-json file] simfile\n");
+    return 1;
+    }
+
+  if (solver.load_simfile(simfile))
+    {
+    printf ("%s\n", solver.error_message());
+    return 1;
+    }
+
+  vs_rt_stepper rt(cfg);
+  stepper = &rt;
+  signal (SIGINT, vss_interrupt);
+  status = rt.run(solver.api, simfile);
+  stepper = NULL;
+
+  if (rt.warnings()[0]) printf("%s", rt.warnings());
+  if (status) printf("%s\n", solver.api.vs_get_error_message());
+  rt.print_stats (stdout);
+  if (json && rt.write_stats_json(json)) printf("Could not write \"%s\".\n", json);
+  return status ? 1 : 0;
+}
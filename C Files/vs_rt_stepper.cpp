@@ -0,0 +1,305 @@
+/* Real-time stepping of a VS solver. See vs_rt_stepper.h.
+
+   Log:
+   Oct 18, 26. restore_thread() undoes the pinning, priority and memory
+               locking of setup_thread().
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+  #include <errno.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/mman.h>
+  #include <time.h>
+#endif
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_solver.h"     // per-instance solver API
+#include "vs_rt_stepper.h" // real-time stepping
+
+// Monotonic clock in nanoseconds.
+static long long vss_now_ns (void)
+{
+#ifdef __linux__
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000000LL + ts.tv_nsec;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+void vs_rt_config_default (vs_rt_config *config)
+{
+  config->period = 0.0;
+  config->cpu = -1;
+  config->priority = 0;
+  config->lock_memory = FALSE;
+  config->spin = 100e-6;
+  config->catch_up = TRUE;
+  config->max_catch_up = 10;
+}
+
+vs_rt_stepper::vs_rt_stepper (const vs_rt_config &config)
+  : cfg(config), stopping(false), old_policy(0), old_priority(0), sched_changed(FALSE),
+    memory_locked(FALSE), api(NULL), frame(NULL), user(NULL), t(0.0), tstep(0.0),
+    imports(NULL), exports(NULL)
+{
+  memset (&st, 0, sizeof(st));
+}
+
+
+/* ----------------------------------------------------------------------------
+   Pin the calling thread, raise its priority and lock memory as configured,
+   keeping the settings they replace for restore_thread(). Failures are not
+   fatal; they are collected in warn.
+---------------------------------------------------------------------------- */
+void vs_rt_stepper::setup_thread (void)
+{
+  warn.clear ();
+  old_cpus.clear ();
+  sched_changed = memory_locked = FALSE;
+#ifdef __linux__
+  char tmpstr[200];
+  if (cfg.cpu >= 0)
+    {
+    cpu_set_t set, old;
+    int i;
+
+    CPU_ZERO (&old);
+    pthread_getaffinity_np (pthread_self(), sizeof(old), &old);
+    CPU_ZERO (&set);
+    CPU_SET (cfg.cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+      {
+      sprintf (tmpstr, "Could not pin the thread to CPU %d.\n", cfg.cpu);
+      warn += tmpstr;
+      }
+    else
+      for (i = 0; i < CPU_SETSIZE; i++) if (CPU_ISSET(i, &old)) old_cpus.push_back(i);
+    }
+  if (cfg.priority > 0)
+    {
+    struct sched_param par, old;
+    memset (&par, 0, sizeof(par));
+    par.sched_priority = cfg.priority;
+    if (pthread_getschedparam(pthread_self(), &old_policy, &old) == 0)
+      old_priority = old.sched_priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &par))
+      {
+      sprintf (tmpstr, "Could not set SCHED_FIFO priority %d (needs CAP_SYS_NICE).\n",
+               cfg.priority);
+      warn += tmpstr;
+      }
+    else
+      sched_changed = TRUE;
+    }
+  if (cfg.lock_memory)
+    {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+      warn += "Could not lock memory (mlockall).\n";
+    else
+      memory_locked = TRUE;
+    }
+#else
+  if (cfg.cpu >= 0 || cfg.priority > 0 || cfg.lock_memory)
+    warn += "Thread pinning, priority and memory locking are only supported on Linux.\n";
+#endif
+}
+
+// Put back the settings that setup_thread() changed. Memory locked by
+// mlockall is unlocked, even if it was locked before the run.
+void vs_rt_stepper::restore_thread (void)
+{
+#ifdef __linux__
+  if (!old_cpus.empty())
+    {
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    for (size_t i = 0; i < old_cpus.size(); i++) CPU_SET(old_cpus[i], &set);
+    pthread_setaffinity_np (pthread_self(), sizeof(set), &set);
+    }
+  if (sched_changed)
+    {
+    struct sched_param par;
+    memset (&par, 0, sizeof(par));
+    par.sched_priority = old_priority;
+    pthread_setschedparam (pthread_self(), old_policy, &par);
+    }
+  if (memory_locked) munlockall();
+#endif
+  old_cpus.clear ();
+  sched_changed = memory_locked = FALSE;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Sleep until shortly before an absolute deadline, then busy-wait.
+---------------------------------------------------------------------------- */
+void vs_rt_stepper::wait_until (long long deadline)
+{
+  long long wake = deadline - (long long)(cfg.spin*1e9);
+
+  if (vss_now_ns() < wake)
+    {
+#ifdef __linux__
+    struct timespec ts;
+    ts.tv_sec = (time_t)(wake/1000000000LL);
+    ts.tv_nsec = (long)(wake%1000000000LL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+      ;
+#else
+    std::this_thread::sleep_for (std::chrono::nanoseconds(wake - vss_now_ns()));
+#endif
+    }
+  while (vss_now_ns() < deadline)
+    ;
+}
+
+// Exchange I/O and advance the model one step. Return nonzero when done.
+int vs_rt_stepper::step (void)
+{
+  long long t0;
+  double dt;
+  int status;
+
+  if (frame) frame(t, imports, exports, user);
+  t0 = vss_now_ns();
+  status = api->vs_integrate_io(t, imports, exports);
+  dt = (vss_now_ns() - t0)*1e-9;
+  t += tstep;
+
+  st.steps++;
+  st.step_sum += dt;
+  if (dt > st.step_max) st.step_max = dt;
+  return status || stopping;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Run a simfile in real time. Return 0 if OK, -1 if the solver had an error.
+---------------------------------------------------------------------------- */
+int vs_rt_stepper::run (const vs_api_table &solver_api, const char *simfile,
+                        vs_rt_frame_func frame_func, void *frame_user)
+{
+  std::vector<vs_real> imp, exp;
+  int n_import = 0, n_export = 0, done = 0, bin, k;
+  vs_real tstart, tstop;
+  long long period, next, woke, late, missed, now;
+
+  api = &solver_api;
+  frame = frame_func;
+  user = frame_user;
+  stopping = false;
+  memset (&st, 0, sizeof(st));
+
+  api->vs_read_configuration (simfile, &n_import, &n_export, &tstart, &tstop, &tstep);
+  if (api->vs_error_occurred()) return -1;
+  imp.assign (n_import + 1, 0.0);
+  exp.assign (n_export + 1, 0.0);
+  imports = imp.data();
+  exports = exp.data();
+  t = tstart;
+  period = (long long)floor((cfg.period > 0.0 ? cfg.period : tstep)*1e9 + 0.5);
+
+  setup_thread ();
+  next = vss_now_ns() + period;
+  while (!done)
+    {
+    wait_until (next);
+    woke = vss_now_ns();
+    late = woke - next;
+    st.frames++;
+    st.jitter_sum += late*1e-9;
+    st.jitter_sq += late*1e-9*late*1e-9;
+    if (late*1e-9 > st.jitter_max) st.jitter_max = late*1e-9;
+    for (bin = 0; bin < VS_RT_HIST_BINS - 1 && late >= (1000LL << bin); bin++)
+      ;
+    st.jitter_hist[bin]++;
+
+    done = step();
+    next += period;
+
+    // overrun: the step ended after the next deadline
+    if (!done && vss_now_ns() > next)
+      {
+      st.overruns++;
+      for (k = 0; cfg.catch_up && k < cfg.max_catch_up && !done &&
+                  vss_now_ns() > next; k++)
+        {
+        done = step();
+        next += period;
+        st.caught_up++;
+        }
+
+      // drop the deadlines that are still in the past
+      if (!done && (now = vss_now_ns()) > next)
+        {
+        missed = (now - next)/period + 1;
+        st.skipped += missed;
+        next += missed*period;
+        }
+      }
+    }
+
+  api->vs_terminate_run (t);
+  restore_thread ();
+  imports = exports = NULL;
+  return api->vs_error_occurred() ? -1 : 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Report the timing statistics.
+---------------------------------------------------------------------------- */
+void vs_rt_stepper::print_stats (FILE *fp) const
+{
+  double n = st.frames ? (double)st.frames : 1.0;
+  double mean = st.jitter_sum/n;
+  int i;
+
+  fprintf (fp, "Frames %lld, steps %lld, overruns %lld, caught up %lld, skipped %lld\n",
+           st.frames, st.steps, st.overruns, st.caught_up, st.skipped);
+  fprintf (fp, "Wake-up jitter: mean %.2f us, rms %.2f us, max %.2f us\n",
+           mean*1e6, sqrt(st.jitter_sq/n)*1e6, st.jitter_max*1e6);
+  fprintf (fp, "Step time: mean %.2f us, max %.2f us\n",
+           st.steps ? st.step_sum/st.steps*1e6 : 0.0, st.step_max*1e6);
+  fprintf (fp, "Jitter histogram (us):");
+  for (i = 0; i < VS_RT_HIST_BINS; i++)
+    if (st.jitter_hist[i])
+      fprintf (fp, " <%lld:%lld", 1LL << i, st.jitter_hist[i]);
+  fprintf (fp, "\n");
+}
+
+int vs_rt_stepper::write_stats_json (const char *filename) const
+{
+  FILE *fp = fopen(filename, "w");
+  double n = st.frames ? (double)st.frames : 1.0;
+  int i;
+
+  if (fp == NULL) return -1;
+  fprintf (fp, "{\"frames\": %lld, \"steps\": %lld, \"overruns\": %lld, "
+               "\"caught_up\": %lld, \"skipped\": %lld,\n",
+           st.frames, st.steps, st.overruns, st.caught_up, st.skipped);
+  fprintf (fp, " \"jitter_mean_us\": %.3f, \"jitter_rms_us\": %.3f, "
+               "\"jitter_max_us\": %.3f,\n", st.jitter_sum/n*1e6,
+           sqrt(st.jitter_sq/n)*1e6, st.jitter_max*1e6);
+  fprintf (fp, " \"step_mean_us\": %.3f, \"step_max_us\": %.3f,\n",
+           st.steps ? st.step_sum/st.steps*1e6 : 0.0, st.step_max*1e6);
+  fprintf (fp, " \"jitter_hist_us\": [");
+  for (i = 0; i < VS_RT_HIST_BINS; i++)
+    fprintf (fp, "%s%lld", i ? ", " : "", st.jitter_hist[i]);
+  fprintf (fp, "]}\n");
+  return fclose(fp) ? -1 : 0;
+}
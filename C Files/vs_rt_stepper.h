@@ -0,0 +1,110 @@
+/* Real-time stepping of a VS solver for driver- and hardware-in-the-loop rigs.
+
+   vs_rt_stepper calls vs_integrate_io once per frame, paced by absolute
+   deadlines: frame k is due at start + k*period, so timing errors do not
+   accumulate. On Linux the thread sleeps with clock_nanosleep(TIMER_ABSTIME)
+   until shortly before the deadline and busy-waits the rest, which removes
+   most of the wake-up latency of the sleep. Other systems fall back on
+   std::this_thread::sleep_until for the coarse part.
+
+   A frame that ends after the next deadline is an overrun. With catch_up the
+   missed frames are run back to back (up to max_catch_up per overrun) so the
+   simulation keeps up with the wall clock; otherwise, and for frames beyond
+   that limit, the deadlines are skipped. Wake-up jitter, step time, overruns
+   and skipped frames are collected in vs_rt_stats.
+
+   The CPU pinning, SCHED_FIFO priority and memory locking of the config
+   apply to the thread that calls run(), for the run only: they are undone
+   when run() returns.
+
+   Log:
+   Oct 18, 26. Thread settings are restored at the end of run().
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_RT_STEPPER_H
+  #define _VS_RT_STEPPER_H
+
+  #include <stdio.h>
+  #include <atomic>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_solver.h"   // per-instance solver API
+
+  typedef struct
+    {
+    vs_real period;       // wall-clock seconds per frame, 0 = vs_get_tstep()
+    int     cpu;          // CPU to pin the stepping thread to, -1 = none
+    int     priority;     // SCHED_FIFO priority, 0 = keep the current policy
+    vs_bool lock_memory;  // mlockall() to avoid page faults while running
+    vs_real spin;         // seconds of busy-waiting before each deadline
+    vs_bool catch_up;     // run missed frames back to back after an overrun
+    int     max_catch_up; // limit of extra steps per overrun
+    } vs_rt_config;
+
+  #define VS_RT_HIST_BINS 16 // jitter histogram: bin i holds < 2^i microseconds
+
+  typedef struct
+    {
+    long long frames;     // deadlines that were waited for
+    long long steps;      // calls to vs_integrate_io
+    long long overruns;   // frames that ended after the next deadline
+    long long caught_up;  // extra steps run back to back after overruns
+    long long skipped;    // deadlines dropped
+    double    jitter_max, jitter_sum, jitter_sq; // wake-up lateness, seconds
+    double    step_max, step_sum;                // vs_integrate_io time
+    long long jitter_hist[VS_RT_HIST_BINS];
+    } vs_rt_stats;
+
+  // Called before each step to exchange I/O with the rig.
+  typedef void (*vs_rt_frame_func) (vs_real t, vs_real *imports,
+                                    const vs_real *exports, void *user);
+
+  void vs_rt_config_default (vs_rt_config *config);
+
+  class vs_rt_stepper
+    {
+    public:
+      vs_rt_stepper (const vs_rt_config &config);
+
+      // Read the simfile and run it in real time until the solver stops or
+      // stop() is called. Return 0 if the run ended OK, -1 if not.
+      int run (const vs_api_table &api, const char *simfile,
+               vs_rt_frame_func frame = NULL, void *user = NULL);
+
+      // Safe to call from any thread.
+      void stop (void) {stopping = true;}
+
+      const vs_rt_stats &stats (void) const {return st;}
+      void print_stats (FILE *fp) const;
+      int  write_stats_json (const char *filename) const;
+
+      // Problems setting up the thread (pinning, priority), if any.
+      const char *warnings (void) const {return warn.c_str();}
+
+    private:
+      void setup_thread (void);
+      void restore_thread (void);
+      void wait_until (long long deadline);
+      int  step (void);
+
+      vs_rt_config cfg;
+      vs_rt_stats st;
+      std::atomic<bool> stopping;
+      std::string warn;
+
+      // thread settings before setup_thread(), for restore_thread()
+      std::vector<int> old_cpus;      // CPUs of the old affinity, if changed
+      int     old_policy, old_priority;
+      vs_bool sched_changed, memory_locked;
+
+      // state of the current run
+      const vs_api_table *api;
+      vs_rt_frame_func frame;
+      void *user;
+      vs_real t, tstep, *imports, *exports;
+    };
+
+#endif  // end block for _VS_RT_STEPPER_H
@@ -0,0 +1,286 @@
+/* Precomputed import schedules. See vs_schedule.h.
+
+   Log:
+   Oct 18, 26. run() checks the simfile's start time and step against the
+               schedule's, and ends the run it started on a mismatch.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define VSS_SSE2
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+#include "vs_schedule.h" // import schedules
+
+/* ----------------------------------------------------------------------------
+   Cosine of an array. x = q*PI + r with |r| <= PI/2, then
+     cos(x) = (-1)^q cos(r),
+   where cos(r) is its Taylor series to r^18 (error < 4e-15 at PI/2). PI is
+   split in three parts so q*PI is exact for |q| up to about 2^24. Adding
+   1.5*2^52 rounds to the nearest integer and leaves it in the low bits.
+---------------------------------------------------------------------------- */
+#define VSS_MAGIC 6755399441055744.0 // 1.5*2^52
+#define VSS_PI_A  3.14159250259399414062
+#define VSS_PI_B  1.50995788317231926867e-7
+#define VSS_PI_C  1.07806057163162381058e-14
+
+static const vs_real vss_cos_coef[10] =
+  { // (-1)^k/(2k)!, highest first
+  -1.0/6402373705728000.0, 1.0/20922789888000.0, -1.0/87178291200.0,
+  1.0/479001600.0, -1.0/3628800.0, 1.0/40320.0, -1.0/720.0, 1.0/24.0, -0.5, 1.0
+  };
+
+static inline vs_real vss_cos (vs_real x)
+{
+  vs_real qm = x*(1.0/PI) + VSS_MAGIC, q = qm - VSS_MAGIC, r, z, p;
+  unsigned long long bits;
+  int i;
+
+  r = ((x - q*VSS_PI_A) - q*VSS_PI_B) - q*VSS_PI_C;
+  z = r*r;
+  p = vss_cos_coef[0];
+  for (i = 1; i < 10; i++) p = p*z + vss_cos_coef[i];
+  memcpy (&bits, &qm, sizeof(bits));
+  return (bits & 1) ? -p : p;
+}
+
+void vs_cos_array (int n, const vs_real *x, vs_real *y)
+{
+  int i = 0;
+
+#ifdef VSS_SSE2
+  const __m128d inv_pi = _mm_set1_pd(1.0/PI), magic = _mm_set1_pd(VSS_MAGIC);
+  const __m128d pi_a = _mm_set1_pd(VSS_PI_A), pi_b = _mm_set1_pd(VSS_PI_B),
+                pi_c = _mm_set1_pd(VSS_PI_C);
+  __m128d v, qm, q, r, z, p;
+  int j;
+
+  for (; i + 2 <= n; i += 2)
+    {
+    v = _mm_loadu_pd(x + i);
+    qm = _mm_add_pd(_mm_mul_pd(v, inv_pi), magic);
+    q = _mm_sub_pd(qm, magic);
+    r = _mm_sub_pd(v, _mm_mul_pd(q, pi_a));
+    r = _mm_sub_pd(r, _mm_mul_pd(q, pi_b));
+    r = _mm_sub_pd(r, _mm_mul_pd(q, pi_c));
+    z = _mm_mul_pd(r, r);
+    p = _mm_set1_pd(vss_cos_coef[0]);
+    for (j = 1; j < 10; j++)
+      p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(vss_cos_coef[j]));
+
+    // odd q: flip the sign bit
+    p = _mm_xor_pd(p, _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(qm), 63)));
+    _mm_storeu_pd (y + i, p);
+    }
+#endif
+  for (; i < n; i++) y[i] = vss_cos(x[i]);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Building the schedule.
+---------------------------------------------------------------------------- */
+vs_schedule::vs_schedule (int n_imports, vs_real tstart, vs_real tstep, int n_steps)
+  : n_imp(n_imports > 0 ? n_imports : 1), n(n_steps > 0 ? n_steps : 1),
+    t_start(tstart), dt(tstep > 0.0 ? tstep : 0.001), inv_dt(1.0/dt), dirty(TRUE)
+{
+  cols.assign ((size_t)n_imp*n, 0.0);
+}
+
+void vs_schedule::clear (void)
+{
+  cols.assign (cols.size(), 0.0);
+  dirty = TRUE;
+}
+
+// First step with time > t (or >= t), from 0 to n.
+int vs_schedule::first_after (vs_real t, vs_bool or_equal) const
+{
+  vs_real k_real = floor((t - t_start)/dt);
+  int k;
+
+  k = k_real < -1.0 ? 0 : k_real > n ? n : (int)k_real;
+  while (k > 0 && (or_equal ? time(k - 1) >= t : time(k - 1) > t)) k--;
+  while (k < n && (or_equal ? time(k) < t : time(k) <= t)) k++;
+  return k;
+}
+
+void vs_schedule::constant (int col, vs_real value)
+{
+  vs_real *c = &cols[(size_t)col*n];
+  for (int k = 0; k < n; k++) c[k] += value;
+  dirty = TRUE;
+}
+
+// Like vs_step_smooth(t, t0, h0, t1, h1).
+void vs_schedule::step_smooth (int col, vs_real t0, vs_real h0, vs_real t1, vs_real h1)
+{
+  vs_real *c = &cols[(size_t)col*n], *arg, half = 0.5*(h1 - h0);
+  int k, k0 = first_after(t0, FALSE), k1 = first_after(t1, TRUE);
+
+  if (k1 < k0) k1 = k0;
+  scratch.resize (k1 - k0);
+  arg = scratch.data();
+  for (k = 0; k < k0; k++) c[k] += h0;
+  for (k = k0; k < k1; k++) arg[k - k0] = PI*(time(k) - t0)/(t1 - t0);
+  vs_cos_array (k1 - k0, arg, arg);
+  for (k = k0; k < k1; k++) c[k] += h0 + half*(1.0 - arg[k - k0]);
+  for (k = k1; k < n; k++) c[k] += h1;
+  dirty = TRUE;
+}
+
+void vs_schedule::ramp (int col, vs_real t0, vs_real h0, vs_real t1, vs_real h1)
+{
+  vs_real *c = &cols[(size_t)col*n];
+  int k, k0 = first_after(t0, FALSE), k1 = first_after(t1, TRUE);
+
+  if (k1 < k0) k1 = k0;
+  for (k = 0; k < k0; k++) c[k] += h0;
+  for (k = k0; k < k1; k++) c[k] += h0 + (h1 - h0)*(time(k) - t0)/(t1 - t0);
+  for (k = k1; k < n; k++) c[k] += h1;
+  dirty = TRUE;
+}
+
+// amplitude*sin(phase), with the frequency going from f0 to f1 over [t0, t1].
+void vs_schedule::sine_sweep (int col, vs_real t0, vs_real t1, vs_real amplitude,
+                              vs_real f0, vs_real f1)
+{
+  vs_real *c = &cols[(size_t)col*n], *arg, tau, rate;
+  int k, k0 = first_after(t0, TRUE), k1 = first_after(t1, FALSE);
+
+  if (k1 < k0) k1 = k0;
+  rate = t1 > t0 ? 0.5*(f1 - f0)/(t1 - t0) : 0.0;
+  scratch.resize (k1 - k0);
+  arg = scratch.data();
+  for (k = k0; k < k1; k++)
+    {
+    tau = time(k) - t0;
+    arg[k - k0] = 2.0*PI*tau*(f0 + rate*tau) - PI_HALF; // sin(x) = cos(x - PI/2)
+    }
+  vs_cos_array (k1 - k0, arg, arg);
+  for (k = k0; k < k1; k++) c[k] += amplitude*arg[k - k0];
+  dirty = TRUE;
+}
+
+void vs_schedule::table (int col, int n_pts, const vs_real *t, const vs_real *y)
+{
+  vs_real *c = &cols[(size_t)col*n], slope;
+  int j, k, k0, k1;
+
+  if (n_pts < 1) return;
+  k0 = first_after(t[0], FALSE);
+  for (k = 0; k < k0; k++) c[k] += y[0];
+  for (j = 0; j + 1 < n_pts; j++)
+    {
+    k1 = first_after(t[j + 1], FALSE);
+    slope = t[j + 1] > t[j] ? (y[j + 1] - y[j])/(t[j + 1] - t[j]) : 0.0;
+    for (k = k0; k < k1; k++) c[k] += y[j] + slope*(time(k) - t[j]);
+    if (k1 > k0) k0 = k1;
+    }
+  for (k = k0; k < n; k++) c[k] += y[n_pts - 1];
+  dirty = TRUE;
+}
+
+void vs_schedule::scale (int col, vs_real gain)
+{
+  vs_real *c = &cols[(size_t)col*n];
+  for (int k = 0; k < n; k++) c[k] *= gain;
+  dirty = TRUE;
+}
+
+// Like vs_max(lower, vs_min(upper, value)).
+void vs_schedule::limit (int col, vs_real lower, vs_real upper)
+{
+  vs_real *c = &cols[(size_t)col*n];
+  for (int k = 0; k < n; k++)
+    {
+    vs_real v = c[k] < upper ? c[k] : upper;
+    c[k] = v > lower ? v : lower;
+    }
+  dirty = TRUE;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Using the schedule.
+---------------------------------------------------------------------------- */
+void vs_schedule::finish (void)
+{
+  int i, k;
+
+  rows.resize (cols.size());
+  for (i = 0; i < n_imp; i++)
+    for (k = 0; k < n; k++) rows[(size_t)k*n_imp + i] = cols[(size_t)i*n + k];
+  dirty = FALSE;
+}
+
+const vs_real *vs_schedule::row (int k)
+{
+  if (dirty) finish();
+  k = k < 0 ? 0 : k >= n ? n - 1 : k;
+  return &rows[(size_t)k*n_imp];
+}
+
+void vs_schedule::fill (vs_real t, vs_real *imports)
+{
+  vs_real x = (t - t_start)*inv_dt + 0.5;
+  int k = x < 1.0 ? 0 : x >= n ? n - 1 : (int)x, i;
+  const vs_real *r;
+
+  if (dirty) finish();
+  r = &rows[(size_t)k*n_imp];
+  for (i = 0; i < n_imp; i++) imports[i] = r[i];
+}
+
+void vs_schedule::frame (vs_real t, vs_real *imports, const vs_real *, void *user)
+{
+  ((vs_schedule *)user)->fill (t, imports);
+}
+
+int vs_schedule::run (const vs_api_table &api, const char *simfile)
+{
+  std::vector<vs_real> imp, exp;
+  int n_import = 0, n_export = 0;
+  vs_real t, tstop, tstep;
+  int status;
+
+  error.clear ();
+  api.vs_read_configuration (simfile, &n_import, &n_export, &t, &tstop, &tstep);
+  if (api.vs_error_occurred())
+    {
+    error = "The solver could not start the run.";
+    return -1;
+    }
+  if (n_import != n_imp)
+    error = "The simfile has " + std::to_string(n_import) + " imports; the schedule has " +
+            std::to_string(n_imp) + ".";
+  else if (fabs(tstep - dt) > 1e-9*dt || fabs(t - t_start) > 1e-6*dt)
+    error = "The simfile starts at " + std::to_string(t) + " s with a step of " +
+            std::to_string(tstep) + " s; the schedule was built for " +
+            std::to_string(t_start) + " s and " + std::to_string(dt) + " s.";
+  if (!error.empty())
+    {
+    api.vs_terminate_run (t);
+    return -1;
+    }
+  imp.assign (n_import + 1, 0.0);
+  exp.assign (n_export + 1, 0.0);
+  do
+    {
+    fill (t, imp.data());
+    status = api.vs_integrate_io(t, imp.data(), exp.data());
+    t += tstep;
+    }
+  while (!status);
+
+  api.vs_terminate_run (t);
+  return api.vs_error_occurred() ? -1 : 0;
+}
@@ -0,0 +1,100 @@
+/* Precomputed import schedules for open-loop runs.
+
+   Drivers for open-loop tests (steer ramps, throttle steps, sine sweeps)
+   usually compute each import every step with vs_step_smooth, vs_max and
+   vs_min, through a chain of time tests. A vs_schedule builds the whole run
+   up front as a dense matrix, one row of imports per step, so the run loop
+   only copies a row:
+
+     vs_schedule s(n_import, tstart, tstep, n_steps);
+     s.step_smooth (STEER, 1.0, 0.0, 1.5, 30.0); // signals on a column add up
+     s.step_smooth (STEER, 3.0, 0.0, 3.5, -30.0);
+     s.sine_sweep (STEER, 5.0, 25.0, 10.0, 0.2, 3.0);
+     s.table (THROTTLE, n, t, y);
+     s.limit (THROTTLE, 0.0, 1.0);
+     s.run (api, simfile);          // or s.frame with vs_rt_stepper
+
+   Each piece is built over index ranges found from its start and end times,
+   so no step tests the time. The cosines of smooth steps and sweeps come
+   from vs_cos_array(), a polynomial evaluated two values at a time with SSE2
+   (plain C elsewhere, with the same results); its error is below 4e-15 for
+   arguments up to about 1e5.
+
+   Columns are indices in the import array of vs_integrate_io. Step k is at
+   t = tstart + k*tstep; after the last row, the last row is repeated.
+
+   Log:
+   Oct 18, 26. run() rejects a simfile whose TSTART or step differs.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SCHEDULE_H
+  #define _VS_SCHEDULE_H
+
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_solver.h"   // per-instance solver API
+
+  // y[i] = cos(x[i]).
+  void vs_cos_array (int n, const vs_real *x, vs_real *y);
+
+  class vs_schedule
+    {
+    public:
+      vs_schedule (int n_imports, vs_real tstart, vs_real tstep, int n_steps);
+
+      // All columns back to zero.
+      void clear (void);
+
+      // Pieces added to a column. Before t0 and after t1 smooth steps and
+      // ramps hold h0 and h1; a sine sweep (frequencies in Hz, linear in
+      // time) is zero outside [t0, t1]. Tables are linear with flat ends.
+      void constant (int col, vs_real value);
+      void step_smooth (int col, vs_real t0, vs_real h0, vs_real t1, vs_real h1);
+      void ramp (int col, vs_real t0, vs_real h0, vs_real t1, vs_real h1);
+      void sine_sweep (int col, vs_real t0, vs_real t1, vs_real amplitude,
+                       vs_real f0, vs_real f1);
+      void table (int col, int n, const vs_real *t, const vs_real *y);
+
+      // Operations on the column built so far.
+      void scale (int col, vs_real gain);
+      void limit (int col, vs_real lower, vs_real upper);
+
+      int     n_imports (void) const {return n_imp;}
+      int     n_steps (void) const {return n;}
+      vs_real time (int k) const {return t_start + k*dt;}
+      vs_real value (int col, int k) const {return cols[(size_t)col*n + k];}
+
+      // Row k of the import matrix (clamped to the last row).
+      const vs_real *row (int k);
+
+      // Copy the row for time t into imports.
+      void fill (vs_real t, vs_real *imports);
+
+      // Run a simfile with these imports through vs_integrate_io. Return 0 if
+      // OK, -1 if the solver had an error, or if the import count, start time
+      // or time step read from the simfile differs from the schedule's (the
+      // rows would be applied at the wrong times).
+      int run (const vs_api_table &api, const char *simfile);
+      const char *error_message (void) const {return error.c_str();}
+
+      // Frame function for vs_rt_stepper; user is the vs_schedule.
+      static void frame (vs_real t, vs_real *imports, const vs_real *exports,
+                         void *user);
+
+    private:
+      int  first_after (vs_real t, vs_bool or_equal) const;
+      void finish (void);
+
+      int n_imp, n;
+      vs_real t_start, dt, inv_dt;
+      std::vector<vs_real> cols;    // column-major, built by the pieces
+      std::vector<vs_real> rows;    // row-major copy for the run loop
+      std::vector<vs_real> scratch; // arguments and cosines
+      vs_bool dirty;
+      std::string error;
+    };
+
+#endif  // end block for _VS_SCHEDULE_H
@@ -0,0 +1,77 @@
+/* Sparse stream of sensor detections. See vs_sensor_hits.h.
+
+   Log:
+   Oct 18, 26. read() removed (see vs_sensor_hits.h).
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "vs_deftypes.h"    // VS types and definitions
+#include "vs_sensor_hits.h" // sensor hit stream
+
+vs_sensor_hit_stream::vs_sensor_hit_stream (int n_sensors) : time(0.0)
+{
+  set_sensors (n_sensors);
+}
+
+void vs_sensor_hit_stream::set_sensors (int n_sensors)
+{
+  first.assign ((n_sensors > 0 ? n_sensors : 0) + 1, 0);
+  next.assign (first.size(), 0);
+}
+
+int vs_sensor_hit_stream::compact (const vs_real *connect, int max_connections,
+                                   int n_fields)
+{
+  const vs_real *slot = connect;
+  int s, k, added = 0;
+
+  if (n_fields < VS_SENSOR_SLOT_N) return 0;
+  for (s = 0; s < n_sensors(); s++)
+    for (k = 0; k < max_connections; k++, slot += n_fields)
+      {
+      if (!(slot[VS_SENSOR_SLOT_OBJECT] >= 1.0)) continue;
+      add (s, (int)floor(slot[VS_SENSOR_SLOT_OBJECT] + 0.5), slot[VS_SENSOR_SLOT_RANGE],
+           slot[VS_SENSOR_SLOT_RANGE_RATE], slot[VS_SENSOR_SLOT_AZIMUTH],
+           slot[VS_SENSOR_SLOT_ELEVATION], slot[VS_SENSOR_SLOT_VISIBLE]);
+      added++;
+      }
+  return added;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Group by sensor: count, then place each hit (counting sort) unless they
+   were added in sensor order, as compact() and most sensor models add them.
+---------------------------------------------------------------------------- */
+void vs_sensor_hit_stream::finish (void)
+{
+  size_t i, n = hits.size();
+  int s, last = 0, n_s = n_sensors();
+  vs_bool in_order = TRUE;
+
+  std::fill (first.begin(), first.end(), 0);
+  for (i = 0; i < n; i++)
+    {
+    s = hits[i].sensor;
+    if (s < 0 || s >= n_s || s < last) in_order = FALSE;
+    if (s < 0 || s >= n_s) continue;
+    first[s + 1]++;
+    last = s;
+    }
+  for (s = 0; s < n_s; s++) first[s + 1] += first[s];
+  if (in_order) return;
+
+  scratch.resize (first[n_s]);
+  std::copy (first.begin(), first.end(), next.begin());
+  for (i = 0; i < n; i++)
+    {
+    s = hits[i].sensor;
+    if (s >= 0 && s < n_s) scratch[next[s]++] = hits[i];
+    }
+  hits.swap (scratch);
+}
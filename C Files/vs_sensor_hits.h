@@ -0,0 +1,113 @@
+/* Sparse stream of sensor detections, instead of the dense connection array.
+
+   vs_get_n_export_sensor (&max_connections) sizes the sensor export for
+   the worst case: every sensor with max_connections objects in view, each
+   slot with all of its fields. vs_get_sensor_connections fills all of it
+   every step, and fusion code then scans every slot to find the few that
+   hold a detection. In traffic runs most slots are empty.
+
+   A vs_sensor_hit_stream holds the detections of one step as a list of
+   records (sensor, object, range, range rate, azimuth, elevation, visible
+   fraction) in an arena that is kept from step to step: clear() empties it
+   without giving memory back, so once it has seen the busiest step, filling
+   it allocates nothing. A sensor model adds its hits directly; a dense
+   array can be compacted into it at the boundary (compact()), so that
+   everything after it (fusion, logging, sending to another process)
+   handles only the detections. After finish(), the hits are grouped by
+   sensor and each sensor's hits can be iterated.
+
+     vs_sensor_hit_stream hits(n_sensors);
+     each step:
+       hits.clear (t);
+       hits.add (...);                    // per detection, or compact()
+       hits.finish ();
+       for (const vs_sensor_hit *h = hits.begin(s); h < hits.end(s); h++)
+         ...
+
+   Dense layout read by compact(): for each sensor, max_connections slots of
+   n_fields values; the first VS_SENSOR_SLOT_N of them are as in
+   vs_sensor_slot, and the slot is empty when its object number is below 1.
+   This layout is an assumption, not the documented layout of
+   vs_get_sensor_connections: the API manual gives neither the order of the
+   fields nor what vs_get_n_export_sensor counts. Check it against the
+   solver's sensor outputs (or map the fields first) before compacting a
+   solver's array; this is why there is no function here that reads the
+   solver directly.
+
+   Log:
+   Oct 18, 26. The dense slot layout is marked as assumed; read() removed
+               until it is checked against a solver.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SENSOR_HITS_H
+  #define _VS_SENSOR_HITS_H
+
+  #include <stddef.h>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  // Fields of a slot in a dense connection array (assumed order, see above).
+  typedef enum
+    {
+    VS_SENSOR_SLOT_OBJECT, VS_SENSOR_SLOT_RANGE, VS_SENSOR_SLOT_RANGE_RATE,
+    VS_SENSOR_SLOT_AZIMUTH, VS_SENSOR_SLOT_ELEVATION, VS_SENSOR_SLOT_VISIBLE,
+    VS_SENSOR_SLOT_N
+    } vs_sensor_slot;
+
+  typedef struct
+    {
+    int     sensor, object; // sensor from 0; object number from the slot
+    vs_real range, range_rate, azimuth, elevation, visible;
+    } vs_sensor_hit;
+
+  class vs_sensor_hit_stream
+    {
+    public:
+      vs_sensor_hit_stream (int n_sensors = 0);
+
+      void set_sensors (int n_sensors);
+      int  n_sensors (void) const {return (int)first.size() - 1;}
+
+      // Start a step: no hits, memory kept.
+      void clear (vs_real t) {hits.clear(); time = t;}
+
+      // Room for n hits without allocating in later steps.
+      void reserve (size_t n) {hits.reserve(n); scratch.reserve(n);}
+
+      void add (const vs_sensor_hit &h) {hits.push_back(h);}
+      void add (int sensor, int object, vs_real range, vs_real range_rate,
+                vs_real azimuth, vs_real elevation, vs_real visible)
+        {
+        vs_sensor_hit h = {sensor, object, range, range_rate, azimuth, elevation,
+                           visible};
+        hits.push_back (h);
+        }
+
+      // Add the detections of a dense connection array (layout above).
+      // Return the number added.
+      int  compact (const vs_real *connect, int max_connections, int n_fields);
+
+      // Group the hits by sensor (stable). Hits with a sensor out of range
+      // are dropped.
+      void finish (void);
+
+      // All hits; after finish(), those of sensor s from begin(s) to end(s).
+      size_t size (void) const {return hits.size();}
+      const vs_sensor_hit *data (void) const {return hits.data();}
+      const vs_sensor_hit *begin (int s) const {return hits.data() + first[s];}
+      const vs_sensor_hit *end (int s) const {return hits.data() + first[s + 1];}
+      vs_real t (void) const {return time;}
+
+      // Bytes of hit records in this step, and the most the arena has held.
+      size_t bytes (void) const {return hits.size()*sizeof(vs_sensor_hit);}
+      size_t capacity_bytes (void) const {return hits.capacity()*sizeof(vs_sensor_hit);}
+
+    private:
+      std::vector<vs_sensor_hit> hits, scratch; // scratch: for the grouping
+      std::vector<size_t> first, next;          // by sensor, after finish()
+      vs_real time;
+    };
+
+#endif  // end block for _VS_SENSOR_HITS_H
@@ -0,0 +1,477 @@
+/* Table data shared between processes. See vs_shared_tables.h.
+
+   Log:
+   Oct 18, 26. The hash is vs_hasher (vs_hash.h).
+   Oct 18, 26. Regions record their creator; a region left unfilled by a
+               creator that died is removed and made again.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <errno.h>
+  #include <signal.h>
+  #include <unistd.h>
+#endif
+#ifdef __GLIBC__
+  #include <malloc.h>
+#endif
+
+#include "vs_deftypes.h"      // VS types and definitions
+#include "vs_hash.h"          // content hash
+#include "vs_shm.h"           // shared memory regions
+#include "vs_shared_tables.h" // shared table data
+
+#define VSS_MAGIC   0x56544142u
+#define VSS_VERSION 2
+#define VSS_ALIGN   64  // arrays start on cache lines
+#define VSS_BLANK   0.1 // seconds a region may exist without its creator's pid
+
+// Layout of a region: header, one descriptor per table, then the arrays.
+// Offsets are bytes from the start of the region; 0 means no array.
+typedef struct
+  {
+  uint32_t magic, version;
+  volatile uint32_t ready; // set by the creator when the arrays are written
+  int32_t  ntab;
+  uint64_t hash[2], bytes;
+  int64_t  creator, made;  // pid of the creator, and when it made the region
+  } vss_header;            // (ms of the system clock); written first
+
+typedef struct
+  {
+  int32_t  type, nx, ny, pad;
+  uint64_t x, y, dydx, f; // f: nx*ny values of a 2D table, row by row
+  } vss_desc;
+
+static vs_bool vss_is_2d (vs_table_type type)
+{
+  return type >= VS_TAB_2D && type != VS_TAB_EQ;
+}
+
+// Does the table have arrays to share?
+static vs_bool vss_has_arrays (const vs_table *tab)
+{
+  if (tab->type == VS_TAB_CONST || tab->type == VS_TAB_COEF || tab->type == VS_TAB_EQ)
+    return FALSE;
+  if (tab->nx < 1 || tab->x == NULL || tab->y == NULL) return FALSE;
+  return vss_is_2d(tab->type) ? tab->ny > 0 && tab->fxy != NULL : TRUE;
+}
+
+static int64_t vss_pid (void)
+{
+#ifdef _WIN32
+  return (int64_t)GetCurrentProcessId();
+#else
+  return (int64_t)getpid();
+#endif
+}
+
+static int64_t vss_clock_ms (void)
+{
+  return (int64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Is the process still running? (TRUE if it can't be told.)
+static vs_bool vss_alive (int64_t pid)
+{
+#ifdef _WIN32
+  HANDLE h = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+  DWORD code = STILL_ACTIVE;
+
+  if (h == NULL) return GetLastError() != ERROR_INVALID_PARAMETER;
+  GetExitCodeProcess (h, &code);
+  CloseHandle (h);
+  return code == STILL_ACTIVE;
+#else
+  return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+#endif
+}
+
+static size_t vss_round (size_t n)
+{
+  return (n + VSS_ALIGN - 1)/VSS_ALIGN*VSS_ALIGN;
+}
+
+// Descriptors of the tables of a group (desc may be NULL). Return the size
+// of the region.
+static size_t vss_layout (const vs_tab_group *g, vss_desc *desc)
+{
+  size_t off = vss_round(sizeof(vss_header) + g->ntab*sizeof(vss_desc)), n;
+  vss_desc d;
+  int i;
+
+  for (i = 0; i < g->ntab; i++)
+    {
+    const vs_table *tab = g->table[i];
+
+    memset (&d, 0, sizeof(d));
+    d.type = tab->type;
+    if (vss_has_arrays(tab))
+      {
+      d.nx = tab->nx;
+      d.x = off;
+      off = vss_round(off + tab->nx*sizeof(vs_real));
+      if (vss_is_2d(tab->type))
+        {
+        d.ny = tab->ny;
+        d.y = off;
+        off = vss_round(off + tab->ny*sizeof(vs_real));
+        d.f = off;
+        n = (size_t)tab->nx*tab->ny;
+        }
+      else
+        {
+        d.y = off;
+        off = vss_round(off + tab->nx*sizeof(vs_real));
+        d.dydx = tab->dydx ? off : 0;
+        n = tab->dydx ? tab->nx : 0;
+        }
+      off = vss_round(off + n*sizeof(vs_real));
+      }
+    if (desc) desc[i] = d;
+    }
+  return off;
+}
+
+static void vss_hash (const vs_tab_group *g, unsigned long long hash[2])
+{
+  vs_hasher h;
+  int i;
+
+  h.add ((int64_t)g->ntab);
+  for (i = 0; i < g->ntab; i++)
+    {
+    const vs_table *tab = g->table[i];
+    int j;
+
+    h.add ((int64_t)tab->type);
+    if (!vss_has_arrays(tab)) continue;
+    h.add ((int64_t)tab->nx);
+    h.add (tab->x, tab->nx*sizeof(vs_real));
+    if (vss_is_2d(tab->type))
+      {
+      h.add ((int64_t)tab->ny);
+      h.add (tab->y, tab->ny*sizeof(vs_real));
+      for (j = 0; j < tab->nx; j++) h.add(tab->fxy[j], tab->ny*sizeof(vs_real));
+      }
+    else
+      {
+      h.add (tab->y, tab->nx*sizeof(vs_real));
+      h.add ((int64_t)(tab->dydx != NULL));
+      if (tab->dydx) h.add(tab->dydx, tab->nx*sizeof(vs_real));
+      }
+    }
+  hash[0] = h.h[0];
+  hash[1] = h.h[1];
+}
+
+static std::string vss_name (const unsigned long long hash[2])
+{
+  char buf[40];
+
+  snprintf (buf, sizeof(buf), "%016llx%016llx", hash[0], hash[1]);
+  return std::string(VS_SHARED_TABLES_PREFIX) + buf;
+}
+
+/* ----------------------------------------------------------------------------
+   Copy the arrays of a group into a region (copy = TRUE), or compare them
+   with those of a region. Return TRUE if they are the same.
+---------------------------------------------------------------------------- */
+static vs_bool vss_copy (const vs_tab_group *g, char *base, vs_bool copy)
+{
+  const vss_desc *desc = (const vss_desc *)(base + sizeof(vss_header));
+  int i, j;
+
+  for (i = 0; i < g->ntab; i++)
+    {
+    const vs_table *tab = g->table[i];
+    const vss_desc &d = desc[i];
+    size_t nx = d.nx*sizeof(vs_real), ny = d.ny*sizeof(vs_real);
+
+    if (d.x == 0) continue;
+    if (copy)
+      {
+      memcpy (base + d.x, tab->x, nx);
+      if (d.f)
+        {
+        memcpy (base + d.y, tab->y, ny);
+        for (j = 0; j < d.nx; j++) memcpy(base + d.f + j*ny, tab->fxy[j], ny);
+        }
+      else
+        {
+        memcpy (base + d.y, tab->y, nx);
+        if (d.dydx) memcpy(base + d.dydx, tab->dydx, nx);
+        }
+      continue;
+      }
+    if (memcmp(base + d.x, tab->x, nx)) return FALSE;
+    if (d.f)
+      {
+      if (memcmp(base + d.y, tab->y, ny)) return FALSE;
+      for (j = 0; j < d.nx; j++)
+        if (memcmp(base + d.f + j*ny, tab->fxy[j], ny)) return FALSE;
+      }
+    else
+      {
+      if (memcmp(base + d.y, tab->y, nx)) return FALSE;
+      if (d.dydx && memcmp(base + d.dydx, tab->dydx, nx)) return FALSE;
+      }
+    }
+  return TRUE;
+}
+
+
+vs_shared_tables::vs_shared_tables () : wait(10.0), created(0), opened(0), replaced(0)
+{
+}
+
+vs_shared_tables::~vs_shared_tables ()
+{
+  detach_all ();
+}
+
+std::string vs_shared_tables::region_name (const vs_tab_group *group)
+{
+  unsigned long long hash[2];
+
+  vss_hash (group, hash);
+  return vss_name(hash);
+}
+
+/* ----------------------------------------------------------------------------
+   Share the arrays of a group. Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_shared_tables::share (vs_tab_group *group, malloc_func release)
+{
+  unsigned long long hash[2];
+  region *r;
+  size_t i;
+  int j;
+
+  error.clear ();
+  if (group == NULL || group->ntab < 1 || group->table == NULL)
+    {
+    error = "The table group has no tables.";
+    return -1;
+    }
+  for (i = 0; i < regions.size(); i++)
+    if (regions[i]->group == group)
+      {
+      error = "The table group is already shared.";
+      return -1;
+      }
+  for (j = 0; j < group->ntab; j++)
+    {
+    vs_table_type type = group->table[j]->type;
+    if (type == VS_TAB_2D_INDEP_COLS || type == VS_TAB_2D_VAR_WIDTH ||
+        type == VS_TAB_2D_VAR_WIDTH_STEP)
+      {
+      error = "Tables with sub-tables cannot be shared.";
+      return -1;
+      }
+    }
+
+  vss_hash (group, hash);
+  r = new region;
+  r->group = group;
+  if (map(*r, hash, vss_layout(group, NULL)))
+    {
+    delete r;
+    return -1;
+    }
+  attach (*r, release);
+#ifdef __GLIBC__
+  if (release) malloc_trim (0); // else the freed arrays stay resident in the heap
+#endif
+  regions.push_back (r);
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Find the region with the group's data, or make it. Return 0 if OK, -1 if
+   not.
+
+   A region that is not ready is being filled, unless its creator died
+   first: then its pid is no longer running, or the region is older than
+   the wait, or it has no pid (or no size) for VSS_BLANK seconds (the
+   creator died right after making it). Such a region is removed and made
+   again here. Two processes may both remove it; each then maps the region
+   it made or found, so both work, with the data in memory twice.
+---------------------------------------------------------------------------- */
+int vs_shared_tables::map (region &r, const unsigned long long hash[2], size_t bytes)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now(),
+    stop = now + std::chrono::microseconds((long long)(wait*1e6)), blank = now;
+  const vs_tab_group *g = r.group;
+  std::string name = vss_name(hash);
+  vs_bool is_blank = FALSE, stale;
+  vss_header *h;
+
+  for (;;)
+    {
+    stale = FALSE;
+    if (r.shm.open(name.c_str(), TRUE) == 0)
+      {
+      h = (vss_header *)r.shm.data();
+      if (r.shm.size() >= sizeof(vss_header) && h->ready)
+        {
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (h->magic != VSS_MAGIC || h->version != VSS_VERSION || h->ntab != g->ntab ||
+            h->bytes != bytes || r.shm.size() < bytes ||
+            !vss_copy(g, (char *)r.shm.data(), FALSE))
+          {
+          r.shm.close ();
+          error = "Region " + name + " holds other data.";
+          return -1;
+          }
+        opened++;
+        return 0;
+        }
+      if (r.shm.size() < sizeof(vss_header) || h->creator == 0)
+        is_blank = TRUE;
+      else
+        {
+        is_blank = FALSE;
+        stale = !vss_alive(h->creator) || vss_clock_ms() - h->made > wait*1000.0;
+        }
+      r.shm.close (); // still being filled
+      }
+    else if (r.shm.create(name.c_str(), bytes, TRUE, TRUE) == 0)
+      {
+      h = (vss_header *)r.shm.data();
+      h->creator = vss_pid();
+      h->made = vss_clock_ms();
+      h->magic = VSS_MAGIC;
+      h->version = VSS_VERSION;
+      h->ntab = g->ntab;
+      h->hash[0] = hash[0];
+      h->hash[1] = hash[1];
+      h->bytes = bytes;
+      vss_layout (g, (vss_desc *)((char *)h + sizeof(vss_header)));
+      vss_copy (g, (char *)h, TRUE);
+      std::atomic_thread_fence (std::memory_order_release);
+      h->ready = 1;
+      r.shm.protect (TRUE);
+      created++;
+      return 0;
+      }
+    else
+      is_blank = TRUE; // exists, but can't be mapped yet (no size)
+
+    now = std::chrono::steady_clock::now();
+    if (!is_blank) blank = now;
+    else if (now - blank > std::chrono::milliseconds((long long)(VSS_BLANK*1000.0)))
+      stale = TRUE;
+    if (stale)
+      {
+      vs_shm::remove (name.c_str());
+      replaced++;
+      blank = now;
+      continue;
+      }
+    if (now > stop)
+      {
+      error = "Region " + name + " could not be made or opened.";
+      return -1;
+      }
+    std::this_thread::sleep_for (std::chrono::milliseconds(1));
+    }
+}
+
+
+/* ----------------------------------------------------------------------------
+   Point the tables of a group at the region, keeping what they had.
+---------------------------------------------------------------------------- */
+void vs_shared_tables::attach (region &r, malloc_func release)
+{
+  char *base = (char *)r.shm.data();
+  const vss_desc *desc = (const vss_desc *)(base + sizeof(vss_header));
+  vs_tab_group *g = r.group;
+  int i, j;
+
+  r.tables.resize (g->ntab);
+  r.rows.resize (g->ntab);
+  for (i = 0; i < g->ntab; i++)
+    {
+    vs_table *tab = g->table[i];
+    const vss_desc &d = desc[i];
+    saved &s = r.tables[i];
+
+    if (d.x && release) release(tab, tab->type, 0, 0);
+    s.x = tab->x;
+    s.y = tab->y;
+    s.dydx = tab->dydx;
+    s.fxy = tab->fxy;
+    s.nx = tab->nx;
+    s.ny = tab->ny;
+    if (d.x == 0) continue;
+
+    tab->nx = d.nx;
+    tab->x = (vs_real *)(base + d.x);
+    tab->y = (vs_real *)(base + d.y);
+    if (d.f)
+      {
+      tab->ny = d.ny;
+      r.rows[i].resize (d.nx);
+      for (j = 0; j < d.nx; j++) r.rows[i][j] = (vs_real *)(base + d.f) + (size_t)j*d.ny;
+      tab->fxy = r.rows[i].data();
+      }
+    else
+      tab->dydx = d.dydx ? (vs_real *)(base + d.dydx) : NULL;
+    }
+}
+
+
+void vs_shared_tables::detach (vs_tab_group *group)
+{
+  size_t i;
+  int j;
+
+  for (i = 0; i < regions.size(); i++)
+    {
+    region *r = regions[i];
+
+    if (r->group != group) continue;
+    for (j = 0; j < group->ntab; j++)
+      {
+      vs_table *tab = group->table[j];
+      const saved &s = r->tables[j];
+
+      tab->x = s.x;
+      tab->y = s.y;
+      tab->dydx = s.dydx;
+      tab->fxy = s.fxy;
+      tab->nx = s.nx;
+      tab->ny = s.ny;
+      }
+    delete r; // unmaps
+    regions.erase (regions.begin() + i);
+    return;
+    }
+}
+
+void vs_shared_tables::detach_all (void)
+{
+  while (!regions.empty()) detach(regions.back()->group);
+}
+
+size_t vs_shared_tables::shared_bytes (void) const
+{
+  size_t i, n = 0;
+
+  for (i = 0; i < regions.size(); i++) n += regions[i]->shm.size();
+  return n;
+}
@@ -0,0 +1,112 @@
+/* Table data shared by the solver instances running on one machine.
+
+   When N copies of a solver run on a node, each one allocates the same
+   tire, aero and road tables. vs_shared_tables puts the arrays of a table
+   group (x, y, dydx of 1D tables; x, y, fxy of 2D tables) in a read-only
+   shared memory region (vs_shm) named by a hash of their contents, and
+   points the tables at it. The first process with a given content creates
+   the region; the others map it, so the data is in memory once per node.
+
+   The tables themselves (type, gain, offset, hints) stay in each process;
+   only the arrays are shared. Lookups write the per-instance hints (jx, jy),
+   never the arrays.
+
+     vs_shared_tables shared;
+     // fill the group's tables (vs_malloc_table_data, spline slopes done)
+     shared.share (group, vs_malloc_table_data); // solver copies released
+     ... run ...
+     shared.detach_all ();                        // before vs_terminate_run
+     vs_terminate_run (t);
+
+   With a release function (the solver's vs_malloc_table_data), the private
+   arrays are given back to the solver as empty tables before the tables
+   are pointed at the region; detach() puts those empty arrays back, so the
+   solver frees its own memory at the end of the run. Without one, the
+   private arrays are left to the caller and put back on detach().
+
+   Rules while shared: do not refill the tables or recompute spline slopes
+   (vs_copy_table_data), and detach before the solver frees table data.
+   Tables that use sub-tables (independent columns, variable width) are not
+   supported. The region name goes away when the process that created it
+   detaches; processes that mapped it keep their mapping, and later ones
+   make a new region. A region whose creator died before filling it (its
+   pid is gone, or it is older than the wait) is removed and made again by
+   the next process, instead of making it wait and fail.
+
+   Log:
+   Oct 18, 26. Regions left unfilled by a dead creator are made again.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SHARED_TABLES_H
+  #define _VS_SHARED_TABLES_H
+
+  #include <stddef.h>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_shm.h"      // shared memory regions
+
+  #define VS_SHARED_TABLES_PREFIX "vs_tab_" // region name = prefix + hash
+
+  class vs_shared_tables
+    {
+    public:
+      // Same form as vs_malloc_table_data.
+      typedef void (*malloc_func) (vs_table *tab, int type, int nx, int ny);
+
+      vs_shared_tables ();
+      ~vs_shared_tables (); // detaches all groups
+
+      // Point the tables of a group at a shared copy of their arrays. Return
+      // 0 if OK, -1 if not (the tables then keep their own data).
+      int  share (vs_tab_group *group, malloc_func release = NULL);
+
+      // Point the tables back at their own arrays.
+      void detach (vs_tab_group *group);
+      void detach_all (void);
+
+      // Seconds to wait for another process that is filling a region.
+      void set_wait (double seconds) {wait = seconds;}
+
+      // Bytes of shared arrays mapped, and regions made or found here, and
+      // regions removed here because their creator died while filling them.
+      size_t shared_bytes (void) const;
+      int    n_created (void) const {return created;}
+      int    n_opened (void) const {return opened;}
+      int    n_replaced (void) const {return replaced;}
+
+      // Name of the region for the group's current data.
+      static std::string region_name (const vs_tab_group *group);
+
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_shared_tables (const vs_shared_tables &);            // not copyable
+      vs_shared_tables &operator= (const vs_shared_tables &);
+
+      // Arrays of a table before it was pointed at the region.
+      struct saved
+        {
+        vs_real *x, *y, *dydx, **fxy;
+        int nx, ny;
+        };
+      struct region
+        {
+        vs_tab_group *group;
+        vs_shm shm;
+        std::vector<saved> tables;
+        std::vector<std::vector<vs_real *> > rows; // fxy row pointers
+        };
+
+      int  map (region &r, const unsigned long long hash[2], size_t bytes);
+      void attach (region &r, malloc_func release);
+
+      std::vector<region *> regions;
+      std::string error;
+      double wait;
+      int created, opened, replaced;
+    };
+
+#endif  // end block for _VS_SHARED_TABLES_H
@@ -0,0 +1,210 @@
+/* Named shared memory regions. See vs_shm.h.
+
+   Log:
+   Oct 18, 26. create() never truncates an existing region.
+   Oct 18, 26. Exclusive create and protect().
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <errno.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <dirent.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_shm.h"      // shared memory regions
+
+// OS name for a region.
+static std::string vss_os_name (const char *name)
+{
+#ifdef _WIN32
+  return std::string("Local\\") + name;
+#else
+  return std::string("/") + name;
+#endif
+}
+
+
+vs_shm::vs_shm () : addr(NULL), length(0), handle(NULL)
+{
+}
+
+vs_shm::~vs_shm ()
+{
+  close ();
+}
+
+/* ----------------------------------------------------------------------------
+   Create a region and map it read/write, or reuse one of that name that is
+   at least size bytes (not exclusive). Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_shm::create (const char *name, size_t size, vs_bool remove_on_close,
+                    vs_bool exclusive)
+{
+  std::string os_name = vss_os_name(name);
+
+  close ();
+#ifdef _WIN32
+  handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                              (DWORD)((unsigned long long)size >> 32),
+                              (DWORD)size, os_name.c_str());
+  if (handle == NULL) return -1;
+  if (exclusive && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+    close ();
+    return -1;
+    }
+  addr = MapViewOfFile((HANDLE)handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (addr == NULL)
+    {
+    close ();
+    return -1;
+    }
+#else
+  // A region of that name may be mapped by a live process: it is never
+  // truncated, and its name is only removed on error if it was made here.
+  struct stat st;
+  vs_bool made = TRUE;
+  int fd = shm_open(os_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0 && errno == EEXIST && !exclusive)
+    {
+    made = FALSE;
+    fd = shm_open(os_name.c_str(), O_RDWR, 0);
+    if (fd >= 0 && (fstat(fd, &st) || (size_t)st.st_size < size))
+      {
+      ::close (fd);
+      return -1;
+      }
+    }
+  if (fd < 0) return -1;
+  if (made && ftruncate(fd, (off_t)size))
+    {
+    ::close (fd);
+    shm_unlink (os_name.c_str());
+    return -1;
+    }
+  addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close (fd);
+  if (addr == MAP_FAILED)
+    {
+    addr = NULL;
+    if (made) shm_unlink(os_name.c_str());
+    return -1;
+    }
+#endif
+  length = size;
+  if (remove_on_close) owned = name;
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Open an existing region by name. Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_shm::open (const char *name, vs_bool read_only)
+{
+  std::string os_name = vss_os_name(name);
+
+  close ();
+#ifdef _WIN32
+  MEMORY_BASIC_INFORMATION info;
+  handle = OpenFileMappingA(read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS,
+                            FALSE, os_name.c_str());
+  if (handle == NULL) return -1;
+  addr = MapViewOfFile((HANDLE)handle, read_only ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS,
+                       0, 0, 0);
+  if (addr == NULL || !VirtualQuery(addr, &info, sizeof(info)))
+    {
+    close ();
+    return -1;
+    }
+  length = info.RegionSize;
+#else
+  struct stat st;
+  int fd = shm_open(os_name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
+  if (fd < 0) return -1;
+  if (fstat(fd, &st) || st.st_size == 0)
+    {
+    ::close (fd);
+    return -1;
+    }
+  addr = mmap(NULL, (size_t)st.st_size, read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+              MAP_SHARED, fd, 0);
+  ::close (fd);
+  if (addr == MAP_FAILED)
+    {
+    addr = NULL;
+    return -1;
+    }
+  length = (size_t)st.st_size;
+#endif
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Unmap the region, and remove its name if this object created it.
+---------------------------------------------------------------------------- */
+void vs_shm::close (void)
+{
+#ifdef _WIN32
+  if (addr) UnmapViewOfFile(addr);
+  if (handle) CloseHandle((HANDLE)handle);
+#else
+  if (addr) munmap(addr, length);
+#endif
+  if (!owned.empty()) remove(owned.c_str());
+  addr = NULL;
+  handle = NULL;
+  length = 0;
+  owned.clear ();
+}
+
+int vs_shm::protect (vs_bool read_only)
+{
+  if (addr == NULL) return -1;
+#ifdef _WIN32
+  DWORD old;
+  return VirtualProtect(addr, length, read_only ? PAGE_READONLY : PAGE_READWRITE, &old)
+         ? 0 : -1;
+#else
+  return mprotect(addr, length, read_only ? PROT_READ : PROT_READ | PROT_WRITE) ? -1 : 0;
+#endif
+}
+
+void vs_shm::remove (const char *name)
+{
+#ifdef _WIN32
+  (void)name; // a Windows mapping goes away with its last handle
+#else
+  shm_unlink (vss_os_name(name).c_str());
+#endif
+}
+
+std::vector<std::string> vs_shm::list (const char *prefix)
+{
+  std::vector<std::string> names;
+#ifndef _WIN32
+  DIR *dir = opendir("/dev/shm");
+  struct dirent *entry;
+  size_t n = strlen(prefix);
+
+  if (dir == NULL) return names;
+  while ((entry = readdir(dir)) != NULL)
+    if (!strncmp(entry->d_name, prefix, n)) names.push_back(entry->d_name);
+  closedir (dir);
+#else
+  (void)prefix;
+#endif
+  return names;
+}
@@ -0,0 +1,66 @@
+/* Named shared memory regions, for data that several processes on one machine
+   map at the same time (telemetry, shared tables).
+
+   A region is created by one process and opened by name by the others. Names
+   are plain identifiers such as "vs_tel_run42"; the OS-specific prefix is
+   added here ("/" for POSIX shm_open, "Local\" for Windows file mappings).
+
+   Log:
+   Oct 18, 26. create() reuses an existing region instead of truncating it.
+   Oct 18, 26. Exclusive create and protect(), for regions filled once and
+               then only read.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SHM_H
+  #define _VS_SHM_H
+
+  #include <stddef.h>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  class vs_shm
+    {
+    public:
+      vs_shm ();
+      ~vs_shm ();
+
+      // Create a region of the given size, mapped read/write. If the name
+      // exists (a region left by a run that did not close it, or one still
+      // mapped by others), it is reused as it is when it has at least size
+      // bytes, and never truncated; with exclusive, fail instead (another
+      // process made it first). With remove_on_close the name is removed
+      // when this object closes it. Return 0 if OK, -1 if not.
+      int  create (const char *name, size_t size, vs_bool remove_on_close = TRUE,
+                   vs_bool exclusive = FALSE);
+
+      // Open an existing region. Return 0 if OK, -1 if not.
+      int  open (const char *name, vs_bool read_only = TRUE);
+      void close (void);
+
+      // Change the access of this mapping. Return 0 if OK, -1 if not.
+      int  protect (vs_bool read_only);
+
+      void  *data (void) const {return addr;}
+      size_t size (void) const {return length;}
+
+      // Names of existing regions that start with prefix. Only supported
+      // where the OS lists them (Linux /dev/shm); empty otherwise.
+      static std::vector<std::string> list (const char *prefix);
+
+      // Remove a region by name. Mappings that are open stay valid.
+      static void remove (const char *name);
+
+    private:
+      vs_shm (const vs_shm &);            // not copyable
+      vs_shm &operator= (const vs_shm &);
+
+      void  *addr;
+      size_t length;
+      void  *handle;       // file mapping handle (Windows only)
+      std::string owned;   // name to remove on close, if any
+    };
+
+#endif  // end block for _VS_SHM_H
@@ -0,0 +1,312 @@
+/* Per-instance loading of a VS solver DLL. See vs_solver.h.
+
+   Log:
+   Oct 18, 26. The private copy count is atomic: pool workers load at once.
+   Oct 18, 26. Only the core functions are required; the others are NULL if
+               the DLL lacks them.
+   Oct 18, 26. Sensor functions.
+   Oct 18, 26. vs_copy_import_vars.
+   Oct 18, 26. vs_get_sym_attribute.
+   Oct 18, 26. Road and table functions.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+#include "vs_solver.h"   // per-instance solver API
+
+// Copy a file byte by byte. Return 0 if OK.
+static int vss_copy_file (const char *from, const char *to)
+{
+  FILE *in, *out;
+  char buffer[65536];
+  size_t n;
+  int    err = 0;
+
+  if ((in = fopen(from, "rb")) == NULL) return -1;
+  if ((out = fopen(to, "wb")) == NULL)
+    {
+    fclose (in);
+    return -1;
+    }
+  while (!err && (n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    err = fwrite(buffer, 1, n, out) != n;
+  if (ferror(in)) err = 1;
+  fclose (in);
+  if (fclose(out)) err = 1;
+  return err ? -1 : 0;
+}
+
+// Name for a private copy of a DLL, unique within the machine. Threads of a
+// vs_job_pool call this at the same time.
+static std::string vss_private_copy_name (const char *path)
+{
+  static std::atomic<int> count(0);
+  char tmpstr[FILENAME_MAX];
+  const char *base = strrchr(path, '/');
+  const char *bslash = strrchr(path, '\\');
+
+  if (bslash > base) base = bslash;
+  base = base ? base + 1 : path;
+#ifdef _WIN32
+  char dir[FILENAME_MAX];
+  GetTempPathA (FILENAME_MAX, dir);
+  sprintf (tmpstr, "%svs_%lu_%d_%s", dir, GetCurrentProcessId(), ++count, base);
+#else
+  sprintf (tmpstr, "/tmp/vs_%ld_%d_%s", (long)getpid(), ++count, base);
+#endif
+  return tmpstr;
+}
+
+
+vs_solver::vs_solver () : handle(NULL)
+{
+  memset (&api, 0, sizeof(api));
+}
+
+vs_solver::~vs_solver ()
+{
+  unload ();
+}
+
+// try to get the address of an API function from the DLL
+int vs_solver::get (void *api_func, const char *name)
+{
+#ifdef _WIN32
+  (*(void **)api_func) = (void *)GetProcAddress((HMODULE)handle, name);
+#else
+  (*(void **)api_func) = dlsym(handle, name);
+#endif
+  if (*(void **)api_func) return 0;
+  error = "The VS API function \"" + std::string(name) +
+          "\" could not be found in the DLL \"" + dll_path + "\".";
+  return -2;
+}
+
+// get an API function that not every DLL has; NULL if it is not there
+void vs_solver::get_optional (void *api_func, const char *name)
+{
+#ifdef _WIN32
+  (*(void **)api_func) = (void *)GetProcAddress((HMODULE)handle, name);
+#else
+  (*(void **)api_func) = dlsym(handle, name);
+#endif
+}
+
+
+/* ----------------------------------------------------------------------------
+   Load a solver DLL and get its API functions. Return 0 if OK, -1 if the DLL
+   could not be loaded, -2 if a function is missing.
+---------------------------------------------------------------------------- */
+int vs_solver::load (const char *path, vs_bool private_copy)
+{
+  const char *load_path = path;
+
+  unload ();
+  dll_path = path;
+  if (private_copy)
+    {
+    copy_path = vss_private_copy_name(path);
+    if (vss_copy_file(path, copy_path.c_str()))
+      {
+      error = "Could not make a private copy of the DLL \"" + dll_path + "\".";
+      copy_path.clear ();
+      return -1;
+      }
+    load_path = copy_path.c_str();
+    }
+
+#ifdef _WIN32
+  handle = (void *)LoadLibraryA(load_path);
+#else
+  handle = dlopen(load_path, RTLD_NOW | RTLD_LOCAL);
+#endif
+  if (handle == NULL)
+    {
+    unload ();
+    error = "The DLL \"" + dll_path + "\" did not load.";
+#ifndef _WIN32
+    error += std::string(" ") + dlerror();
+#endif
+    return -1;
+    }
+
+  // core functions, in every solver DLL this works with
+  // simple run function (chapter 2)
+  if (get(&api.vs_run, "vs_run")) goto missing;
+
+  // managing import/export arrays (chapter 4)
+  if (get(&api.vs_integrate_io, "vs_integrate_io")) goto missing;
+  if (get(&api.vs_read_configuration, "vs_read_configuration")) goto missing;
+  if (get(&api.vs_terminate_run, "vs_terminate_run")) goto missing;
+
+  // utility functions (chapter 5)
+  if (get(&api.vs_error_occurred, "vs_error_occurred")) goto missing;
+  if (get(&api.vs_get_error_message, "vs_get_error_message")) goto missing;
+  if (get(&api.vs_get_tstep, "vs_get_tstep")) goto missing;
+  if (get(&api.vs_printf, "vs_printf")) goto missing;
+  if (get(&api.vs_printf_error, "vs_printf_error")) goto missing;
+
+  // more detailed control of run (chapter 6)
+  if (get(&api.vs_free_all, "vs_free_all")) goto missing;
+  if (get(&api.vs_initialize, "vs_initialize")) goto missing;
+  if (get(&api.vs_integrate, "vs_integrate")) goto missing;
+  if (get(&api.vs_setdef_and_read, "vs_setdef_and_read")) goto missing;
+  if (get(&api.vs_stop_run, "vs_stop_run")) goto missing;
+  if (get(&api.vs_terminate, "vs_terminate")) goto missing;
+
+  // interacting with the VS math model (chapter 7)
+  if (get(&api.vs_get_var_id, "vs_get_var_id")) goto missing;
+  if (get(&api.vs_get_var_ptr, "vs_get_var_ptr")) goto missing;
+  if (get(&api.vs_set_stop_run, "vs_set_stop_run")) goto missing;
+  if (get(&api.vs_set_sym_real, "vs_set_sym_real")) goto missing;
+  if (get(&api.vs_write_to_echo_file, "vs_write_to_echo_file")) goto missing;
+
+  // optional functions: NULL if the DLL lacks them; the tools that need one
+  // check for it and report an error
+  get_optional (&api.vs_copy_export_vars, "vs_copy_export_vars");
+  get_optional (&api.vs_copy_import_vars, "vs_copy_import_vars");
+
+  // installation of callback functions with user data (chapter 6)
+  get_optional (&api.vs_install_calc_function2, "vs_install_calc_function2");
+  get_optional (&api.vs_install_echo_function2, "vs_install_echo_function2");
+  get_optional (&api.vs_install_setdef_function2, "vs_install_setdef_function2");
+  get_optional (&api.vs_install_scan_function2, "vs_install_scan_function2");
+  get_optional (&api.vs_install_free_function2, "vs_install_free_function2");
+
+  // interacting with the VS math model (chapter 7)
+  get_optional (&api.vs_get_sym_attribute, "vs_get_sym_attribute");
+
+  // 3D road properties (chapter 7)
+  get_optional (&api.vs_get_road_contact, "vs_get_road_contact");
+  get_optional (&api.vs_get_road_start_stop, "vs_get_road_start_stop");
+  get_optional (&api.vs_road_l_i, "vs_road_l_i");
+  get_optional (&api.vs_road_s_i, "vs_road_s_i");
+  get_optional (&api.vs_road_x_sl_i, "vs_road_x_sl_i");
+  get_optional (&api.vs_road_y_sl_i, "vs_road_y_sl_i");
+
+  // moving objects and sensors (chapter 7)
+  get_optional (&api.vs_define_sensors, "vs_define_sensors");
+  get_optional (&api.vs_get_n_export_sensor, "vs_get_n_export_sensor");
+  get_optional (&api.vs_get_sensor_connections, "vs_get_sensor_connections");
+
+  // configurable table functions (chapter 7)
+  get_optional (&api.vs_table_calc, "vs_table_calc");
+  get_optional (&api.vs_table_index, "vs_table_index");
+  get_optional (&api.vs_install_keyword_tab_group, "vs_install_keyword_tab_group");
+  get_optional (&api.vs_malloc_table_data, "vs_malloc_table_data");
+
+  // saving and restoring the model state (chapter 8)
+  get_optional (&api.vs_start_save_timer, "vs_start_save_timer");
+  get_optional (&api.vs_stop_save_timer, "vs_stop_save_timer");
+
+  // managing arrays to support restarts (chapter 8)
+  get_optional (&api.vs_copy_all_state_vars_from_array,
+                "vs_copy_all_state_vars_from_array");
+  get_optional (&api.vs_copy_all_state_vars_to_array,
+                "vs_copy_all_state_vars_to_array");
+  get_optional (&api.vs_get_export_names, "vs_get_export_names");
+  get_optional (&api.vs_get_import_names, "vs_get_import_names");
+  get_optional (&api.vs_n_derivatives, "vs_n_derivatives");
+  get_optional (&api.vs_n_extra_state_variables, "vs_n_extra_state_variables");
+
+  return 0;
+
+missing:
+  {
+  std::string msg = error;
+  unload ();
+  error = msg;
+  }
+  return -2;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Get the solver path from the keyword DLLFILE in a simfile (see
+   vs_get_dll_path in vs_get_api.c). Return 0 if OK, -1 if not, with a
+   message in error.
+---------------------------------------------------------------------------- */
+int vs_solver::simfile_dll_path (const char *simfile, std::string &path,
+                                 std::string &error)
+{
+  FILE *fp;
+  char *key, *rest, tmpstr[FILENAME_MAX + 16];
+
+  if ((fp = fopen(simfile, "r")) == NULL)
+    {
+    error = "The simfile \"" + std::string(simfile) + "\" could not be opened.";
+    return -1;
+    }
+
+  // scan simfile one line at a time for keyword "DLLFILE"
+  while (fgets(tmpstr, sizeof(tmpstr), fp))
+    {
+    key = strtok(tmpstr, " \t\n");
+    rest = strtok(NULL, "\n\t");
+    if (key == NULL) continue;
+    if (!strcmp(key, "DLLFILE") && rest && rest[0])
+      {
+      fclose (fp);
+      path = rest;
+      return 0;
+      }
+    else if (!strcmp(key, "END")) break;
+    }
+
+  fclose (fp);
+  error = "The simfile \"" + std::string(simfile) + "\" did not identify a DLL "
+          "file with the keyword DLLFILE.";
+  return -1;
+}
+
+/* ----------------------------------------------------------------------------
+   Load the solver DLL identified in a simfile. Return 0 if OK, -1 or -2 if not.
+---------------------------------------------------------------------------- */
+int vs_solver::load_simfile (const char *simfile, vs_bool private_copy)
+{
+  std::string path, msg;
+
+  unload ();
+  if (simfile_dll_path(simfile, path, msg))
+    {
+    error = msg;
+    return -1;
+    }
+  return load(path.c_str(), private_copy);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Release the DLL and remove its private copy, if any.
+---------------------------------------------------------------------------- */
+void vs_solver::unload (void)
+{
+  if (handle)
+    {
+#ifdef _WIN32
+    FreeLibrary ((HMODULE)handle);
+#else
+    dlclose (handle);
+#endif
+    handle = NULL;
+    }
+  if (!copy_path.empty())
+    {
+    remove (copy_path.c_str());
+    copy_path.clear ();
+    }
+  memset (&api, 0, sizeof(api));
+  error.clear ();
+}
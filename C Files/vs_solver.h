@@ -0,0 +1,165 @@
+/* Per-instance access to the API of a VS solver DLL.
+
+   vs_get_api.c fills the global function pointers declared in vs_api.h, so a
+   program can only drive one solver at a time. A vs_solver object owns its own
+   library handle and its own table of API functions. Several solvers can be
+   loaded side by side, and the table is handed explicitly to the C++ tools
+   that drive a model (see vs_ext_dispatch.h).
+
+   A DLL loaded twice from the same path is shared by the OS, including all of
+   its global model data. Use load() with private_copy = TRUE to give each
+   instance its own copy of the solver.
+
+   Only the core functions (marked in vs_solver.cpp) are required by load().
+   The others are NULL if the DLL lacks them; a tool that needs one checks
+   it and reports what is missing (see vs_api_missing).
+
+   Log:
+   Oct 18, 26. Only the core functions are required; the others are NULL if
+               the DLL lacks them.
+   Oct 18, 26. Sensor functions.
+   Oct 18, 26. vs_copy_import_vars.
+   Oct 18, 26. vs_get_sym_attribute.
+   Oct 18, 26. Road and table functions.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SOLVER_H
+  #define _VS_SOLVER_H
+
+  #include <string>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  // API functions used by the C++ tools, named as in vs_api.h.
+  typedef struct
+    {
+    // simple run function (chapter 2)
+    int      (*vs_run) (const char *simfile);
+
+    // managing import/export arrays (chapter 4)
+    void     (*vs_copy_export_vars) (vs_real *exports);
+    void     (*vs_copy_import_vars) (vs_real *imports);
+    int      (*vs_integrate_io) (vs_real t, vs_real *imports, vs_real *exports);
+    void     (*vs_read_configuration) (const char *simfile, int *n_import,
+                                       int *n_export, vs_real *tstart,
+                                       vs_real *tstop, vs_real *tstep);
+    void     (*vs_terminate_run) (vs_real t);
+
+    // utility functions (chapter 5)
+    vs_bool  (*vs_error_occurred) (void);
+    char    *(*vs_get_error_message) (void);
+    vs_real  (*vs_get_tstep) (void);
+    void     (*vs_printf) (const char *format, ...);
+    void     (*vs_printf_error) (const char *format, ...);
+
+    // installation of callback functions with user data (chapter 6)
+    void     (*vs_install_calc_function2) (void (*calc) (vs_real time,
+                                           vs_ext_loc where, void *userData),
+                                           void *userData);
+    void     (*vs_install_echo_function2) (void (*echo) (vs_ext_loc where,
+                                           void *userData), void *userData);
+    void     (*vs_install_setdef_function2) (void (*setdef) (void *userData),
+                                             void *userData);
+    void     (*vs_install_scan_function2) (vs_bool (*scan) (char *, char *,
+                                           void *userData), void *userData);
+    void     (*vs_install_free_function2) (void (*func) (void *userData),
+                                           void *userData);
+
+    // more detailed control of run (chapter 6)
+    void     (*vs_free_all) (void);
+    void     (*vs_initialize) (vs_real t, void (*ext_calc) (vs_real, vs_ext_loc),
+                               void (*ext_echo) (vs_ext_loc));
+    int      (*vs_integrate) (vs_real *t, void (*ext_eq_in) (vs_real, vs_ext_loc));
+    vs_real  (*vs_setdef_and_read) (const char *simfile, void (*ext_setdef) (void),
+                                    int (*ext_scan) (char *, char *));
+    int      (*vs_stop_run) (void);
+    void     (*vs_terminate) (vs_real t, void (*ext_echo) (vs_ext_loc));
+
+    // interacting with the VS math model (chapter 7)
+    int      (*vs_get_sym_attribute) (int id, vs_sym_attr_type type, void **att);
+    int      (*vs_get_var_id) (char *keyword, vs_sym_attr_type *type);
+    vs_real *(*vs_get_var_ptr) (char *keyword);
+    void     (*vs_set_stop_run) (vs_real stop_gt_0, const char *format, ...);
+    int      (*vs_set_sym_real) (int id, vs_sym_attr_type dataType, vs_real value);
+    void     (*vs_write_to_echo_file) (const char *format, ...);
+
+    // 3D road properties (chapter 7)
+    void     (*vs_get_road_contact) (vs_real y, vs_real x, int inst, vs_real *z,
+                                     vs_real *dzdy, vs_real *dzdx, vs_real *mu);
+    void     (*vs_get_road_start_stop) (vs_real *start, vs_real *stop);
+    vs_real  (*vs_road_l_i) (vs_real x, vs_real y, vs_real inst);
+    vs_real  (*vs_road_s_i) (vs_real x, vs_real y, vs_real inst);
+    vs_real  (*vs_road_x_sl_i) (vs_real s, vs_real l, vs_real inst);
+    vs_real  (*vs_road_y_sl_i) (vs_real s, vs_real l, vs_real inst);
+
+    // moving objects and sensors (chapter 7)
+    int      (*vs_define_sensors) (int n);
+    int      (*vs_get_n_export_sensor) (int *max_connections);
+    int      (*vs_get_sensor_connections) (vs_real *connect);
+
+    // configurable table functions (chapter 7)
+    vs_real  (*vs_table_calc) (int index, vs_real xcol, vs_real x, int itab,
+                               int inst);
+    int      (*vs_table_index) (char *name);
+    int      (*vs_install_keyword_tab_group) (vs_tab_group *tabs);
+    void     (*vs_malloc_table_data) (vs_table *tab, int type, int nx, int ny);
+
+    // saving and restoring the model state (chapter 8)
+    void     (*vs_start_save_timer) (vs_real t);
+    void     (*vs_stop_save_timer) (void);
+
+    // managing arrays to support restarts (chapter 8)
+    void     (*vs_copy_all_state_vars_from_array) (vs_real *array);
+    void     (*vs_copy_all_state_vars_to_array) (vs_real *array);
+    int      (*vs_get_export_names) (char **expNames);
+    int      (*vs_get_import_names) (char **impNames);
+    int      (*vs_n_derivatives) (void);
+    int      (*vs_n_extra_state_variables) (void);
+    } vs_api_table;
+
+
+  // Message for an optional API function that a tool needs and the DLL
+  // lacks.
+  inline std::string vs_api_missing (const char *name)
+    {
+    return "The solver DLL has no \"" + std::string(name) + "\", needed here.";
+    }
+
+  // One loaded solver DLL and its API.
+  class vs_solver
+    {
+    public:
+      vs_solver ();
+      ~vs_solver ();
+
+      // Load the DLL and get the API. Return 0 if OK, -1 if the DLL did not
+      // load, -2 if a core API function is missing (as with vs_get_api).
+      int  load (const char *path, vs_bool private_copy = FALSE);
+      int  load_simfile (const char *simfile, vs_bool private_copy = FALSE);
+      void unload (void);
+
+      // Path of the DLL named with DLLFILE in a simfile. Return 0 if OK.
+      static int simfile_dll_path (const char *simfile, std::string &path,
+                                   std::string &error);
+
+      vs_bool     loaded (void) const {return handle != NULL;}
+      const char *path (void) const {return dll_path.c_str();}
+      const char *error_message (void) const {return error.c_str();}
+
+      vs_api_table api; // valid after load() returned 0
+
+    private:
+      vs_solver (const vs_solver &);            // not copyable
+      vs_solver &operator= (const vs_solver &);
+
+      int  get (void *api_func, const char *name);
+      void get_optional (void *api_func, const char *name);
+
+      void        *handle;   // HMODULE on Windows, dlopen handle otherwise
+      std::string dll_path;  // path given to load()
+      std::string copy_path; // private copy of the DLL, removed on unload
+      std::string error;
+    };
+
+#endif  // end block for _VS_SOLVER_H
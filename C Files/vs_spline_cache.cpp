@@ -0,0 +1,441 @@
+/* Bicubic spline coefficients of 2D tables. See vs_spline_cache.h.
+
+   Cache file: a 64-byte header, the nx x values and ny y values of the
+   table (padded to 64 bytes), then 16 coefficients per cell, cell (i, j) at
+   16*(i*(ny - 1) + j), c[k][l] at 4*k + l. A file is named by the hash of
+   the table; load() compares the sizes and the x and y values with the
+   table's, so only a hash collision of two tables with the same grid and
+   different values could give wrong coefficients (about 2^-128).
+
+   Log:
+   Oct 18, 26. The file keeps x and y, compared on load (version 2). The
+               hash is vs_hasher.
+   Oct 18, 26. Coefficients are kept by the cache, not put in the table.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+  #include <direct.h>
+  #include <process.h>
+#else
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_hash.h"         // content hash
+#include "vs_mmap.h"         // mapped files
+#include "vs_task_pool.h"    // parallel build
+#include "vs_spline_cache.h" // spline coefficient cache
+
+#define VSS_VERSION 2
+#define VSS_HEAD    64 // bytes of the header
+
+typedef struct
+  {
+  char     magic[8]; // "VSSPLC"
+  int32_t  version, nx, ny, pad;
+  uint64_t hash[2];
+  int64_t  n_cells;
+  char     spare[16];
+  } vss_header;
+
+static void vss_hash (const vs_table *tab, uint64_t hash[2])
+{
+  vs_hasher h;
+  int i;
+
+  h.add ((int64_t)VSS_VERSION);
+  h.add ((int64_t)tab->nx);
+  h.add ((int64_t)tab->ny);
+  h.add (tab->x, tab->nx*sizeof(vs_real));
+  h.add (tab->y, tab->ny*sizeof(vs_real));
+  for (i = 0; i < tab->nx; i++) h.add(tab->fxy[i], tab->ny*sizeof(vs_real));
+  hash[0] = h.h[0];
+  hash[1] = h.h[1];
+}
+
+static size_t vss_cells (const vs_table *tab)
+{
+  return (size_t)(tab->nx - 1)*(tab->ny - 1);
+}
+
+// Offset of the coefficients in a cache file, and the file size.
+static size_t vss_coef_offset (const vs_table *tab)
+{
+  return VSS_HEAD + (((tab->nx + tab->ny)*sizeof(vs_real) + 63) & ~(size_t)63);
+}
+
+static size_t vss_file_size (const vs_table *tab)
+{
+  return vss_coef_offset(tab) + vss_cells(tab)*16*sizeof(vs_real);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Slopes at the points of row i: df/dx, df/dy and d2f/dxdy, from the
+   neighbors on both sides (one side on the edges).
+---------------------------------------------------------------------------- */
+static void vss_slopes (const vs_table *tab, int i, vs_real *fx, vs_real *fy,
+                        vs_real *fxy)
+{
+  int i0 = i > 0 ? i - 1 : i, i1 = i < tab->nx - 1 ? i + 1 : i, j, j0, j1;
+  const vs_real *x = tab->x, *y = tab->y, *f = tab->fxy[i];
+  const vs_real *f0 = tab->fxy[i0], *f1 = tab->fxy[i1];
+  vs_real dx = x[i1] - x[i0], dy;
+
+  for (j = 0; j < tab->ny; j++)
+    {
+    j0 = j > 0 ? j - 1 : j;
+    j1 = j < tab->ny - 1 ? j + 1 : j;
+    dy = y[j1] - y[j0];
+    fx[j] = (f1[j] - f0[j])/dx;
+    fy[j] = (f[j1] - f[j0])/dy;
+    fxy[j] = (f1[j1] - f1[j0] - f0[j1] + f0[j0])/(dx*dy);
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   Coefficients of the cells of row i. With F the values and scaled slopes
+   at the corners, ordered (0, 1, d/d0, d/d1) in each direction, and M the
+   Hermite matrix, A = M F M'.
+---------------------------------------------------------------------------- */
+static void vss_build_row (const vs_table *tab, int i, vs_real *c)
+{
+  std::vector<vs_real> s((size_t)6*tab->ny);
+  vs_real *fx0 = &s[0], *fy0 = fx0 + tab->ny, *fxy0 = fy0 + tab->ny;
+  vs_real *fx1 = fxy0 + tab->ny, *fy1 = fx1 + tab->ny, *fxy1 = fy1 + tab->ny;
+  const vs_real *f0 = tab->fxy[i], *f1 = tab->fxy[i + 1];
+  vs_real dx = tab->x[i + 1] - tab->x[i], dy, F[4][4], G[4][4];
+  int j, k;
+
+  vss_slopes (tab, i, fx0, fy0, fxy0);
+  vss_slopes (tab, i + 1, fx1, fy1, fxy1);
+  for (j = 0; j < tab->ny - 1; j++, c += 16)
+    {
+    dy = tab->y[j + 1] - tab->y[j];
+    F[0][0] = f0[j];        F[0][1] = f0[j + 1];
+    F[0][2] = fy0[j]*dy;    F[0][3] = fy0[j + 1]*dy;
+    F[1][0] = f1[j];        F[1][1] = f1[j + 1];
+    F[1][2] = fy1[j]*dy;    F[1][3] = fy1[j + 1]*dy;
+    F[2][0] = fx0[j]*dx;    F[2][1] = fx0[j + 1]*dx;
+    F[2][2] = fxy0[j]*dx*dy; F[2][3] = fxy0[j + 1]*dx*dy;
+    F[3][0] = fx1[j]*dx;    F[3][1] = fx1[j + 1]*dx;
+    F[3][2] = fxy1[j]*dx*dy; F[3][3] = fxy1[j + 1]*dx*dy;
+
+    for (k = 0; k < 4; k++) // G = M F
+      {
+      G[0][k] = F[0][k];
+      G[1][k] = F[2][k];
+      G[2][k] = -3.0*F[0][k] + 3.0*F[1][k] - 2.0*F[2][k] - F[3][k];
+      G[3][k] = 2.0*F[0][k] - 2.0*F[1][k] + F[2][k] + F[3][k];
+      }
+    for (k = 0; k < 4; k++) // A = G M'
+      {
+      c[4*k] = G[k][0];
+      c[4*k + 1] = G[k][2];
+      c[4*k + 2] = -3.0*G[k][0] + 3.0*G[k][1] - 2.0*G[k][2] - G[k][3];
+      c[4*k + 3] = 2.0*G[k][0] - 2.0*G[k][1] + G[k][2] + G[k][3];
+      }
+    }
+}
+
+// Interval of v in x[0..n-1], limited to the first and last ones.
+static int vss_interval (const vs_real *x, int n, vs_real v)
+{
+  int lo = 0, hi = n - 2, mid;
+
+  while (lo < hi)
+    {
+    mid = (lo + hi + 1)/2;
+    if (x[mid] <= v) lo = mid;
+    else hi = mid - 1;
+    }
+  return lo;
+}
+
+
+vs_spline_cache::vs_spline_cache (int n_workers) : pool(n_workers)
+{
+  memset (&st, 0, sizeof(st));
+}
+
+vs_spline_cache::~vs_spline_cache ()
+{
+  detach_all ();
+}
+
+int vs_spline_cache::set_dir (const char *directory)
+{
+  struct stat sb;
+
+  error.clear ();
+  dir = directory ? directory : "";
+  if (dir.empty()) return 0;
+  if (dir[dir.size() - 1] != '/' && dir[dir.size() - 1] != '\\') dir += "/";
+#ifdef _WIN32
+  _mkdir (dir.c_str());
+#else
+  mkdir (dir.c_str(), 0777);
+#endif
+  if (stat(dir.c_str(), &sb) || !(sb.st_mode & S_IFDIR))
+    {
+    error = "The cache directory \"" + dir + "\" could not be made.";
+    dir.clear ();
+    return -1;
+    }
+  return 0;
+}
+
+static std::string vss_file_name (const uint64_t hash[2])
+{
+  char buf[40];
+
+  snprintf (buf, sizeof(buf), "%016llx%016llx", (unsigned long long)hash[0],
+            (unsigned long long)hash[1]);
+  return std::string("vs_spl_") + buf + VS_SPLINE_CACHE_EXT;
+}
+
+std::string vs_spline_cache::file_name (const vs_table *tab)
+{
+  uint64_t hash[2];
+
+  vss_hash (tab, hash);
+  return vss_file_name(hash);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Build and evaluate.
+---------------------------------------------------------------------------- */
+void vs_spline_cache::build (const vs_table *tab, vs_real *c)
+{
+  size_t row = (size_t)16*(tab->ny - 1);
+
+  pool.run (tab->nx - 1, [&] (int i, int) {vss_build_row(tab, i, c + i*row);});
+}
+
+vs_real vs_spline_cache::eval (const vs_table *tab, const vs_2d_spline_coef *coef,
+                               vs_real x, vs_real y)
+{
+  vs_real t, u, r[4], **c;
+  int i, j, k;
+
+  if (x < tab->x[0]) x = tab->x[0];
+  if (x > tab->x[tab->nx - 1]) x = tab->x[tab->nx - 1];
+  if (y < tab->y[0]) y = tab->y[0];
+  if (y > tab->y[tab->ny - 1]) y = tab->y[tab->ny - 1];
+  i = vss_interval(tab->x, tab->nx, x);
+  j = vss_interval(tab->y, tab->ny, y);
+  t = (x - tab->x[i])/(tab->x[i + 1] - tab->x[i]);
+  u = (y - tab->y[j])/(tab->y[j + 1] - tab->y[j]);
+  c = coef->c[i][j];
+  for (k = 0; k < 4; k++) r[k] = ((c[k][3]*u + c[k][2])*u + c[k][1])*u + c[k][0];
+  return ((r[3]*t + r[2])*t + r[1])*t + r[0];
+}
+
+vs_real vs_spline_cache::eval (const vs_table *tab, vs_real x, vs_real y) const
+{
+  const entry *e = find(tab);
+  return e ? eval(tab, &e->coef, x, y) : 0.0;
+}
+
+// Point coef.c of an entry at coefficients laid out as in build().
+void vs_spline_cache::index (entry &e, vs_real *c)
+{
+  int nx = e.tab->nx, ny = e.tab->ny;
+  size_t n = vss_cells(e.tab);
+
+  e.rows.resize (nx - 1);
+  e.cells.resize (n);
+  e.quads.resize (4*n);
+  pool.run (nx - 1, [&] (int i, int)
+    {
+    size_t cell = (size_t)i*(ny - 1);
+    int j, k;
+
+    e.rows[i] = &e.cells[cell];
+    for (j = 0; j < ny - 1; j++, cell++)
+      {
+      e.cells[cell] = &e.quads[4*cell];
+      for (k = 0; k < 4; k++) e.quads[4*cell + k] = c + 16*cell + 4*k;
+      }
+    });
+  e.coef.c = e.rows.data();
+}
+
+
+/* ----------------------------------------------------------------------------
+   Cache files. load() maps a file and checks it is for the table's data;
+   store() builds into a new file and renames it into place, so readers
+   never see half a file. Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_spline_cache::load (entry &e, const std::string &path, const uint64_t hash[2])
+{
+  const vss_header *h;
+  const vs_real *x;
+
+  if (e.file.open(path.c_str())) return -1;
+  h = (const vss_header *)e.file.data();
+  x = (const vs_real *)((const char *)e.file.data() + VSS_HEAD);
+  if (e.file.size() < VSS_HEAD || memcmp(h->magic, "VSSPLC", 7) ||
+      h->version != VSS_VERSION || h->nx != e.tab->nx || h->ny != e.tab->ny ||
+      h->hash[0] != hash[0] || h->hash[1] != hash[1] ||
+      h->n_cells != (int64_t)vss_cells(e.tab) || e.file.size() < vss_file_size(e.tab) ||
+      memcmp(x, e.tab->x, e.tab->nx*sizeof(vs_real)) ||
+      memcmp(x + e.tab->nx, e.tab->y, e.tab->ny*sizeof(vs_real)))
+    {
+    e.file.close ();
+    return -1;
+    }
+  index (e, (vs_real *)((char *)e.file.data() + vss_coef_offset(e.tab)));
+  return 0;
+}
+
+int vs_spline_cache::store (entry &e, const std::string &path, const uint64_t hash[2])
+{
+  vs_mapped_file out;
+  vss_header h;
+  vs_real *x;
+  char pid[32];
+  std::string tmp;
+
+#ifdef _WIN32
+  snprintf (pid, sizeof(pid), ".%d.tmp", _getpid());
+#else
+  snprintf (pid, sizeof(pid), ".%ld.tmp", (long)getpid());
+#endif
+  tmp = path + pid;
+  if (out.create(tmp.c_str(), vss_file_size(e.tab)))
+    {
+    error = "The cache file \"" + tmp + "\" could not be written.";
+    return -1;
+    }
+  x = (vs_real *)((char *)out.data() + VSS_HEAD);
+  memcpy (x, e.tab->x, e.tab->nx*sizeof(vs_real));
+  memcpy (x + e.tab->nx, e.tab->y, e.tab->ny*sizeof(vs_real));
+  build (e.tab, (vs_real *)((char *)out.data() + vss_coef_offset(e.tab)));
+  memset (&h, 0, sizeof(h));
+  memcpy (h.magic, "VSSPLC", 7);
+  h.version = VSS_VERSION;
+  h.nx = e.tab->nx;
+  h.ny = e.tab->ny;
+  h.hash[0] = hash[0];
+  h.hash[1] = hash[1];
+  h.n_cells = (int64_t)vss_cells(e.tab);
+  memcpy (out.data(), &h, sizeof(h));
+  if (out.flush())
+    {
+    out.close ();
+    remove (tmp.c_str());
+    error = "The cache file \"" + tmp + "\" could not be written.";
+    return -1;
+    }
+  out.close ();
+#ifdef _WIN32
+  remove (path.c_str()); // rename does not replace a file
+#endif
+  if (rename(tmp.c_str(), path.c_str()) || load(e, path, hash))
+    {
+    remove (tmp.c_str());
+    error = "The cache file \"" + path + "\" could not be written.";
+    return -1;
+    }
+  st.stored++;
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Attach and detach. A cache file that cannot be written is not an error:
+   the coefficients are then built in memory (error_message() says why).
+---------------------------------------------------------------------------- */
+int vs_spline_cache::attach (const vs_table *tab)
+{
+  typedef std::chrono::steady_clock clock;
+  clock::time_point start = clock::now();
+  std::string path;
+  uint64_t hash[2];
+  entry *e;
+
+  error.clear ();
+  if (tab == NULL || tab->type != VS_TAB_2D_SPLINE || tab->nx < 2 || tab->ny < 2 ||
+      tab->x == NULL || tab->y == NULL || tab->fxy == NULL)
+    {
+    error = "The table is not a 2D spline table with 2 x 2 points or more.";
+    return -1;
+    }
+  if (find(tab))
+    {
+    error = "The table already has coefficients in this cache.";
+    return -1;
+    }
+
+  e = new entry;
+  e->tab = tab;
+  e->coef.c = NULL;
+  if (!dir.empty())
+    {
+    vss_hash (tab, hash);
+    path = dir + vss_file_name(hash);
+    }
+  if (!path.empty() && load(*e, path, hash) == 0)
+    {
+    st.loaded++;
+    st.load_seconds += std::chrono::duration<double>(clock::now() - start).count();
+    }
+  else
+    {
+    if (path.empty() || store(*e, path, hash))
+      {
+      e->data.resize (vss_cells(tab)*16);
+      build (tab, e->data.data());
+      index (*e, e->data.data());
+      }
+    st.built++;
+    st.build_seconds += std::chrono::duration<double>(clock::now() - start).count();
+    }
+  entries.push_back (e);
+  return 0;
+}
+
+const vs_spline_cache::entry *vs_spline_cache::find (const vs_table *tab) const
+{
+  size_t i;
+
+  for (i = 0; i < entries.size(); i++)
+    if (entries[i]->tab == tab) return entries[i];
+  return NULL;
+}
+
+const vs_2d_spline_coef *vs_spline_cache::coefficients (const vs_table *tab) const
+{
+  const entry *e = find(tab);
+  return e ? &e->coef : NULL;
+}
+
+void vs_spline_cache::detach (const vs_table *tab)
+{
+  size_t i;
+
+  for (i = 0; i < entries.size(); i++)
+    if (entries[i]->tab == tab)
+      {
+      delete entries[i];
+      entries.erase (entries.begin() + i);
+      return;
+      }
+}
+
+void vs_spline_cache::detach_all (void)
+{
+  while (!entries.empty()) detach(entries.back()->tab);
+}
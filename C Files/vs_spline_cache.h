@@ -0,0 +1,137 @@
+/* Bicubic spline coefficients of VS_TAB_2D_SPLINE tables, built in parallel
+   and kept in a cache on disk, for evaluation by the host.
+
+   A 2D spline table needs 16 coefficients for each cell of its grid. For
+   tire carpets and road grids with hundreds of rows and columns, building
+   them is a large part of startup, and a sweep builds the same ones again
+   and again. A vs_spline_cache builds them with the rows of cells spread
+   over a vs_task_pool, and stores them in a directory, in a file named by a
+   hash of the table data (x, y, fxy). The next run with the same data maps
+   that file instead of building, and runs on one machine share its pages.
+   The file also keeps x and y, which are compared with the table's when it
+   is mapped; fxy is trusted to the 128-bit hash.
+
+   The coefficients are the host's own. A VS solver builds the coefficients
+   of its tables inside the DLL, in its own layout and with its own end
+   conditions, none of which the API documents, so the cache does not
+   replace them: attach() leaves tab->coef alone, and the solver's startup is
+   not changed. The cache is for host code that evaluates the same carpets
+   as the solver (a host-side tire or road model, a surrogate, a check of
+   the solver's outputs) and would otherwise build its own coefficients on
+   every run.
+
+     vs_spline_cache cache(0);            // one worker per core
+     cache.set_dir ("/tmp/vs_splines");   // optional
+     // the tables are read (vs_copy_table_data, or by the solver)
+     cache.attach (tab);
+     ... cache.eval (tab, x, y) ...
+     cache.detach_all ();                 // before the table is freed
+
+   Cell (i, j) spans x[i] to x[i+1] (rows of fxy) and y[j] to y[j+1]
+   (columns). With t and u the fractions across it,
+     f = sum over k, l of c[i][j][k][l]*t^k*u^l.
+   The slopes at the grid points are finite differences of fxy (central
+   inside, one-sided on the edges), so the surface goes through every point
+   with continuous slopes. It need not match the solver's own spline
+   between the points.
+
+   Rules while attached: do not refill the table; the coefficients are for
+   the data it had when attached.
+
+   Log:
+   Oct 18, 26. Cache files keep x and y, compared when mapped.
+   Oct 18, 26. For the host only: attach() no longer sets tab->coef, which
+               the solver owns; coefficients() and eval() give the host the
+               cached coefficients.
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SPLINE_CACHE_H
+  #define _VS_SPLINE_CACHE_H
+
+  #include <stdint.h>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h"  // VS types and definitions
+  #include "vs_mmap.h"      // mapped files
+  #include "vs_task_pool.h" // parallel build
+
+  #define VS_SPLINE_CACHE_EXT ".vsc"
+
+  typedef struct
+    {
+    long long loaded;   // tables given coefficients from a cache file
+    long long built;    // tables given coefficients built here
+    long long stored;   // cache files written
+    double build_seconds, load_seconds; // total for each kind of attach()
+    } vs_spline_cache_stats;
+
+  class vs_spline_cache
+    {
+    public:
+      // n_workers 0: one per hardware thread.
+      vs_spline_cache (int n_workers = 0);
+      ~vs_spline_cache (); // detaches all tables
+
+      // Directory of the cache files (made if needed). With none (the
+      // default, or ""), coefficients are built for every attach().
+      // Return 0 if OK, -1 if not.
+      int  set_dir (const char *dir);
+
+      // Build or load the coefficients of a VS_TAB_2D_SPLINE table (2 x 2
+      // points or more) and keep them for the table. The table is not
+      // changed. Return 0 if OK, -1 if not.
+      int  attach (const vs_table *tab);
+
+      // Coefficients kept for a table, NULL if it is not attached.
+      const vs_2d_spline_coef *coefficients (const vs_table *tab) const;
+
+      // Drop the coefficients of a table, or of all.
+      void detach (const vs_table *tab);
+      void detach_all (void);
+
+      // Coefficients of a table into c, 16 per cell, cell (i, j) at
+      // 16*(i*(ny - 1) + j), built on the pool. No cache.
+      void build (const vs_table *tab, vs_real *c);
+
+      // Value of an attached table at row x and column y, with no gain or
+      // offset; x and y are limited to the grid. 0 if not attached. The
+      // static form takes coefficients laid out as coefficients() gives.
+      vs_real eval (const vs_table *tab, vs_real x, vs_real y) const;
+      static vs_real eval (const vs_table *tab, const vs_2d_spline_coef *coef,
+                           vs_real x, vs_real y);
+
+      // Name of the cache file for a table's current data.
+      static std::string file_name (const vs_table *tab);
+
+      const vs_spline_cache_stats &stats (void) const {return st;}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_spline_cache (const vs_spline_cache &);            // not copyable
+      vs_spline_cache &operator= (const vs_spline_cache &);
+
+      struct entry
+        {
+        const vs_table *tab;
+        vs_2d_spline_coef coef;
+        vs_mapped_file file;          // cache file, if any
+        std::vector<vs_real> data;    // else the coefficients
+        std::vector<vs_real ***> rows; // index for coef.c
+        std::vector<vs_real **>  cells;
+        std::vector<vs_real *>   quads;
+        };
+
+      const entry *find (const vs_table *tab) const;
+      int  load (entry &e, const std::string &path, const uint64_t hash[2]);
+      int  store (entry &e, const std::string &path, const uint64_t hash[2]);
+      void index (entry &e, vs_real *c);
+
+      vs_task_pool pool;
+      std::vector<entry *> entries;
+      std::string dir, error;
+      vs_spline_cache_stats st;
+    };
+
+#endif  // end block for _VS_SPLINE_CACHE_H
@@ -0,0 +1,254 @@
+/* Gaussian-process surrogate of a scalar cost. See vs_surrogate.h.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_surrogate.h" // surrogate model
+
+#define VSS_NOISE 1e-6 // nugget added to the kernel diagonal (normalized cost)
+
+// Length scales tried by fit(), in scaled units.
+static const vs_real vss_lengths[] = {0.05, 0.1, 0.2, 0.35, 0.5, 0.75, 1.0, 1.5};
+
+
+vs_surrogate::vs_surrogate (int n_dims)
+  : dims(n_dims), min_points(2*n_dims + 2), next_fit(8), fixed_length(FALSE),
+    dirty(FALSE), length(0.3), noise(VSS_NOISE), y_mean(0.0), y_std(1.0),
+    y_best(HUGE_VAL), lo(n_dims, 0.0), hi(n_dims, 1.0), cap(0)
+{
+}
+
+void vs_surrogate::set_bounds (const vs_real *lower, const vs_real *upper)
+{
+  lo.assign (lower, lower + dims);
+  hi.assign (upper, upper + dims);
+}
+
+void vs_surrogate::set_length_scale (vs_real ls)
+{
+  fixed_length = ls > 0.0;
+  if (fixed_length) length = ls;
+  if (size()) factor();
+  dirty = TRUE;
+}
+
+void vs_surrogate::scale (const vs_real *x, vs_real *s) const
+{
+  for (int i = 0; i < dims; i++)
+    s[i] = hi[i] > lo[i] ? (x[i] - lo[i])/(hi[i] - lo[i]) : x[i];
+}
+
+vs_real vs_surrogate::kernel (const vs_real *a, const vs_real *b) const
+{
+  vs_real d2 = 0.0, d;
+
+  for (int i = 0; i < dims; i++)
+    {
+    d = a[i] - b[i];
+    d2 += d*d;
+    }
+  return exp(-0.5*d2/(length*length));
+}
+
+
+/* ----------------------------------------------------------------------------
+   Cholesky factor of the kernel matrix of all points, and the log likelihood
+   of the normalized costs with the current length scale.
+---------------------------------------------------------------------------- */
+vs_real vs_surrogate::factor (void)
+{
+  int n = size(), i, j, k;
+  vs_real sum, log_det = 0.0, fit_term = 0.0;
+
+  cap = n > cap ? n : cap;
+  chol.assign ((size_t)cap*cap, 0.0);
+  for (i = 0; i < n; i++)
+    for (j = 0; j <= i; j++)
+      {
+      sum = kernel(&xs[i*dims], &xs[j*dims]) + (i == j ? noise : 0.0);
+      for (k = 0; k < j; k++) sum -= chol[i*cap + k]*chol[j*cap + k];
+      if (i == j)
+        chol[i*cap + i] = sqrt(sum > noise ? sum : noise);
+      else
+        chol[i*cap + j] = sum/chol[j*cap + j];
+      }
+
+  solve ();
+  for (i = 0; i < n; i++)
+    {
+    log_det += log(chol[i*cap + i]);
+    fit_term += alpha[i]*(y[i] - y_mean)/y_std;
+    }
+  return -0.5*fit_term - log_det - 0.5*n*log(6.283185307179586);
+}
+
+// Try each length scale and keep the most likely.
+void vs_surrogate::fit (void)
+{
+  vs_real ll, best_ll = -HUGE_VAL, best_length = length;
+  size_t i;
+
+  for (i = 0; i < sizeof(vss_lengths)/sizeof(vss_lengths[0]); i++)
+    {
+    length = vss_lengths[i];
+    if ((ll = factor()) > best_ll)
+      {
+      best_ll = ll;
+      best_length = length;
+      }
+    }
+  length = best_length;
+  factor ();
+}
+
+// Normalize the costs and solve K alpha = r by forward and back substitution.
+void vs_surrogate::solve (void)
+{
+  int n = size(), i, k;
+  vs_real sum = 0.0, sq = 0.0;
+
+  for (i = 0; i < n; i++) sum += y[i];
+  y_mean = n ? sum/n : 0.0;
+  for (i = 0; i < n; i++) sq += (y[i] - y_mean)*(y[i] - y_mean);
+  y_std = n > 1 ? sqrt(sq/(n - 1)) : 1.0;
+  if (y_std < 1e-12) y_std = 1.0;
+
+  alpha.resize (n);
+  for (i = 0; i < n; i++)
+    {
+    sum = (y[i] - y_mean)/y_std;
+    for (k = 0; k < i; k++) sum -= chol[i*cap + k]*alpha[k];
+    alpha[i] = sum/chol[i*cap + i];
+    }
+  for (i = n - 1; i >= 0; i--)
+    {
+    sum = alpha[i];
+    for (k = i + 1; k < n; k++) sum -= chol[k*cap + i]*alpha[k];
+    alpha[i] = sum/chol[i*cap + i];
+    }
+  dirty = FALSE;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Learn one point: add a row to the Cholesky factor.
+---------------------------------------------------------------------------- */
+void vs_surrogate::add (const vs_real *x, vs_real cost)
+{
+  int n, i, k;
+  vs_real sum, d;
+  std::vector<vs_real> old;
+
+  xs.resize (xs.size() + dims);
+  scale (x, &xs[xs.size() - dims]);
+  y.push_back (cost);
+  if (cost < y_best) y_best = cost;
+  n = size();
+  dirty = TRUE;
+
+  if (!fixed_length && n >= next_fit)
+    {
+    next_fit *= 2;
+    fit ();
+    return;
+    }
+
+  // grow the factor by doubling its row stride
+  if (n > cap)
+    {
+    old.swap (chol);
+    chol.assign ((size_t)2*n*2*n, 0.0);
+    for (i = 0; i < n - 1; i++)
+      memcpy (&chol[i*2*n], &old[i*cap], (i + 1)*sizeof(vs_real));
+    cap = 2*n;
+    }
+
+  // new row l: L l = k, then the diagonal term
+  const vs_real *s = &xs[(n - 1)*dims];
+  d = 1.0 + noise;
+  for (i = 0; i < n - 1; i++)
+    {
+    sum = kernel(s, &xs[i*dims]);
+    for (k = 0; k < i; k++) sum -= chol[i*cap + k]*chol[(n - 1)*cap + k];
+    chol[(n - 1)*cap + i] = sum/chol[i*cap + i];
+    d -= chol[(n - 1)*cap + i]*chol[(n - 1)*cap + i];
+    }
+  chol[(n - 1)*cap + n - 1] = sqrt(d > noise ? d : noise);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Predict the cost at a point.
+---------------------------------------------------------------------------- */
+void vs_surrogate::predict (const vs_real *x, vs_real *mean, vs_real *sd)
+{
+  int n = size(), i, k;
+  vs_real sum, m = 0.0, var = 1.0;
+  vs_real *ks, *v;
+  std::vector<vs_real> s(dims);
+
+  if (n == 0)
+    {
+    *mean = 0.0;
+    *sd = HUGE_VAL;
+    return;
+    }
+  if (dirty) solve();
+  scale (x, s.data());
+  work.resize (2*n);
+  ks = work.data();
+  v = ks + n;
+
+  for (i = 0; i < n; i++)
+    {
+    ks[i] = kernel(s.data(), &xs[i*dims]);
+    m += ks[i]*alpha[i];
+    }
+  for (i = 0; i < n; i++)
+    {
+    sum = ks[i];
+    for (k = 0; k < i; k++) sum -= chol[i*cap + k]*v[k];
+    v[i] = sum/chol[i*cap + i];
+    var -= v[i]*v[i];
+    }
+  *mean = y_mean + y_std*m;
+  *sd = y_std*sqrt(var > 0.0 ? var : 0.0);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Keep the candidates that might beat the best cost so far.
+---------------------------------------------------------------------------- */
+int vs_surrogate::screen (int n, const vs_real *x, vs_real kappa, vs_bool *keep,
+                          vs_real *lcb)
+{
+  int i, n_kept = 0, i_min = 0;
+  vs_real mean, sd, bound, min_bound = HUGE_VAL;
+
+  for (i = 0; i < n; i++)
+    {
+    predict (&x[i*dims], &mean, &sd);
+    bound = mean - kappa*sd;
+    if (lcb) lcb[i] = bound;
+    keep[i] = size() < min_points || bound < y_best;
+    n_kept += keep[i] ? 1 : 0;
+    if (bound < min_bound)
+      {
+      min_bound = bound;
+      i_min = i;
+      }
+    }
+  if (n > 0 && n_kept == 0)
+    {
+    keep[i_min] = TRUE;
+    n_kept = 1;
+    }
+  return n_kept;
+}
@@ -0,0 +1,82 @@
+/* Surrogate model of a scalar cost, to screen candidates before running them.
+
+   A full run takes seconds to minutes, and most parameter sets proposed by an
+   optimizer are clearly poor. A vs_surrogate is a Gaussian-process regression
+   of a cost over the parameters (squared exponential kernel). It learns from
+   each finished run with add(), one point at a time: the Cholesky factor of
+   the kernel matrix is extended by one row, O(n^2) per point. The length
+   scale is fitted by maximum likelihood over a small grid whenever the number
+   of points doubles.
+
+   screen() keeps the candidates whose lower confidence bound
+     mean - kappa*sd
+   is below the best cost so far, so runs (e.g. with vs_job_pool) are made
+   only for points that might improve on it. Larger kappa prunes less. Until
+   min_points runs are known, all candidates are kept.
+
+   Parameters are scaled to [0, 1] with set_bounds(); costs are normalized by
+   their mean and standard deviation. Arrays of points are row-major, n x
+   n_dims. The cost is minimized.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_SURROGATE_H
+  #define _VS_SURROGATE_H
+
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  class vs_surrogate
+    {
+    public:
+      vs_surrogate (int n_dims);
+
+      // Range of each parameter (default 0 to 1).
+      void set_bounds (const vs_real *lower, const vs_real *upper);
+
+      // Length scale in scaled units; 0 (default) fits it from the data.
+      void set_length_scale (vs_real length);
+
+      // Number of runs before screen() starts to prune (default 2*n_dims + 2).
+      void set_min_points (int n) {min_points = n;}
+
+      // Learn the cost of one finished run.
+      void add (const vs_real *x, vs_real cost);
+
+      int     size (void) const {return (int)y.size();}
+      int     n_dims (void) const {return dims;}
+      vs_real best (void) const {return y_best;}
+      vs_real length_scale (void) const {return length;}
+
+      // Predicted cost and its standard deviation at x.
+      void predict (const vs_real *x, vs_real *mean, vs_real *sd);
+
+      // Screen n candidates. keep[i] is set TRUE for those worth a run, lcb[i]
+      // (may be NULL) gets the lower confidence bound. Return the number kept;
+      // at least one is kept if n > 0.
+      int screen (int n, const vs_real *x, vs_real kappa, vs_bool *keep,
+                  vs_real *lcb);
+
+    private:
+      vs_real kernel (const vs_real *a, const vs_real *b) const;
+      vs_real factor (void);      // refactor all points; return log likelihood
+      void    fit (void);         // pick the length scale
+      void    solve (void);       // alpha = K^-1 (y - mean)/std
+      void    scale (const vs_real *x, vs_real *s) const;
+
+      int dims, min_points, next_fit;
+      vs_bool fixed_length, dirty;
+      vs_real length, noise, y_mean, y_std, y_best;
+      std::vector<vs_real> lo, hi;
+      std::vector<vs_real> xs;    // scaled points, n x dims
+      std::vector<vs_real> y;     // costs
+      std::vector<vs_real> chol;  // lower Cholesky factor, n x n (row stride cap)
+      std::vector<vs_real> alpha;
+      std::vector<vs_real> work;  // k* and v in predict
+      int cap;                    // row stride of chol
+    };
+
+#endif  // end block for _VS_SURROGATE_H
@@ -1,2 +1,24 @@
-/* Define macros for specific OS. Nothing for Windows
+/* Define macros for specific OS. Nothing for Windows. Elsewhere, the names
+   used to load a VS DLL map to the dlfcn functions, so vs_get_api.c and
+   programs like solver_extended.c build unchanged.
+
+   Log:
+   Oct 18, 26. Macros for systems with dlfcn.h.
 */
+
+#ifndef _VS_TARGET_H
+  #define _VS_TARGET_H
+
+  #if !defined(_WIN32) && !defined(_WIN64)
+    #include <dlfcn.h>
+
+    #ifndef __cdecl
+      #define __cdecl
+    #endif
+    typedef void *HMODULE;
+    #define LoadLibrary(path)         dlopen(path, RTLD_NOW | RTLD_LOCAL)
+    #define GetProcAddress(dll, name) dlsym(dll, name)
+    #define FreeLibrary(dll)          dlclose(dll)
+  #endif
+
+#endif  // end block for _VS_TARGET_H
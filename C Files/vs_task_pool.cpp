@@ -0,0 +1,135 @@
+/* Work-stealing pool. See vs_task_pool.h.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vs_deftypes.h"  // VS types and definitions
+#include "vs_task_pool.h" // work-stealing pool
+
+vs_task_pool::vs_task_pool (int n_workers)
+  : job(NULL), generation(0), busy(0), stopping(false), n_steals(0)
+{
+  int i;
+
+  if (n_workers <= 0) n_workers = (int)std::thread::hardware_concurrency();
+  if (n_workers <= 0) n_workers = 1;
+  for (i = 0; i < n_workers; i++) queues.push_back(new queue);
+  for (i = 1; i < n_workers; i++)
+    threads.push_back (std::thread(&vs_task_pool::thread_main, this, i));
+}
+
+vs_task_pool::~vs_task_pool ()
+{
+  size_t i;
+
+  {
+  std::lock_guard<std::mutex> guard(lock);
+  stopping = true;
+  }
+  start.notify_all ();
+  for (i = 0; i < threads.size(); i++) threads[i].join();
+  for (i = 0; i < queues.size(); i++) delete queues[i];
+}
+
+
+/* ----------------------------------------------------------------------------
+   Run a batch of tasks, with the caller as worker 0.
+---------------------------------------------------------------------------- */
+void vs_task_pool::run (int n_tasks, const std::function<void (int, int)> &func)
+{
+  int n = size(), w, i;
+
+  if (n_tasks <= 0) return;
+  for (w = 0; w < n; w++)
+    {
+    std::lock_guard<std::mutex> guard(queues[w]->lock);
+    for (i = (int)((long long)n_tasks*w/n); i < (int)((long long)n_tasks*(w + 1)/n); i++)
+      queues[w]->tasks.push_back(i);
+    }
+
+    {
+    std::lock_guard<std::mutex> guard(lock);
+    job = &func;
+    busy = n;
+    generation++;
+    }
+  start.notify_all ();
+
+  work (0);
+
+  std::unique_lock<std::mutex> guard(lock);
+  busy--;
+  while (busy > 0) done.wait(guard);
+  job = NULL;
+}
+
+void vs_task_pool::thread_main (int worker)
+{
+  long long seen = 0;
+
+  for (;;)
+    {
+      {
+      std::unique_lock<std::mutex> guard(lock);
+      while (!stopping && generation == seen) start.wait(guard);
+      if (stopping) return;
+      seen = generation;
+      }
+    work (worker);
+      {
+      std::lock_guard<std::mutex> guard(lock);
+      busy--;
+      }
+    done.notify_all ();
+    }
+}
+
+// Next task for a worker: its own front, else another's back. -1 if none.
+int vs_task_pool::take (int worker)
+{
+  int n = size(), w, k, task;
+
+    {
+    queue &q = *queues[worker];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (!q.tasks.empty())
+      {
+      task = q.tasks.front();
+      q.tasks.pop_front ();
+      return task;
+      }
+    }
+
+  for (k = 1; k < n; k++)
+    {
+    w = (worker + k) % n;
+    queue &q = *queues[w];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (!q.tasks.empty())
+      {
+      task = q.tasks.back();
+      q.tasks.pop_back ();
+      n_steals++;
+      return task;
+      }
+    }
+  return -1;
+}
+
+// Tasks are only added before the workers start, so when no deque has any
+// left, the worker is done.
+void vs_task_pool::work (int worker)
+{
+  int task;
+
+  while ((task = take(worker)) >= 0) (*job)(task, worker);
+}
@@ -0,0 +1,70 @@
+/* Work-stealing pool for batches of small, independent tasks (one per run
+   and channel in post-processing, one per table, ...).
+
+   run() numbers the tasks 0 to n-1 and gives each worker a contiguous block
+   of them in its own deque. A worker takes tasks from the front of its
+   deque; when it is empty, it steals from the back of the others', so uneven
+   tasks still keep all workers busy. The calling thread is worker 0, and
+   run() returns when all tasks are done.
+
+     vs_task_pool pool(0);                    // one worker per core
+     pool.run (n, [&] (int task, int worker) {...});
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_TASK_POOL_H
+  #define _VS_TASK_POOL_H
+
+  #include <atomic>
+  #include <condition_variable>
+  #include <deque>
+  #include <functional>
+  #include <mutex>
+  #include <thread>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+
+  class vs_task_pool
+    {
+    public:
+      // n_workers 0: one per hardware thread.
+      vs_task_pool (int n_workers = 0);
+      ~vs_task_pool ();
+
+      int size (void) const {return (int)queues.size();}
+
+      // Call func(task, worker) for every task and wait. Not reentrant.
+      void run (int n_tasks, const std::function<void (int, int)> &func);
+
+      // Tasks taken from another worker's deque, since the pool was made.
+      long long steals (void) const {return n_steals;}
+
+    private:
+      vs_task_pool (const vs_task_pool &);            // not copyable
+      vs_task_pool &operator= (const vs_task_pool &);
+
+      struct queue
+        {
+        std::mutex lock;
+        std::deque<int> tasks;
+        };
+
+      void thread_main (int worker);
+      void work (int worker);
+      int  take (int worker);
+
+      std::vector<queue *>     queues;  // one per worker
+      std::vector<std::thread> threads; // workers 1 .. n-1
+      std::mutex lock;
+      std::condition_variable start, done;
+      const std::function<void (int, int)> *job;
+      long long generation;
+      int  busy;           // workers still in the current batch
+      bool stopping;
+      std::atomic<long long> n_steals;
+    };
+
+#endif  // end block for _VS_TASK_POOL_H
@@ -0,0 +1,176 @@
+/* Live telemetry from running solvers. See vs_telemetry.h.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+#include "vs_deftypes.h"    // VS types and definitions
+#include "vs_solver.h"      // per-instance solver API
+#include "vs_var_binding.h" // cached variable pointers
+#include "vs_shm.h"         // shared memory regions
+#include "vs_telemetry.h"   // telemetry tap and reader
+
+static double vss_wall_seconds (void)
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int vss_pid (void)
+{
+#ifdef _WIN32
+  return (int)GetCurrentProcessId();
+#else
+  return (int)getpid();
+#endif
+}
+
+
+vs_telemetry_tap::vs_telemetry_tap (const char *run_name)
+  : period(0.1), t_next(0.0), t_start(0.0), wall_start(0.0), steps(0), block(NULL)
+{
+  static int count = 0;
+  char tmpstr[64];
+
+  if (run_name && run_name[0]) run = run_name;
+  else
+    {
+    sprintf (tmpstr, "pid%d_%d", vss_pid(), ++count);
+    run = tmpstr;
+    }
+}
+
+/* ----------------------------------------------------------------------------
+   Add an export channel (output short name or other keyword). Return its
+   index in the sample, or -1 if there are already VS_TELEMETRY_MAX_CHAN.
+---------------------------------------------------------------------------- */
+int vs_telemetry_tap::add_channel (const char *keyword)
+{
+  if (channels.size() >= VS_TELEMETRY_MAX_CHAN) return -1;
+  return channels.add(keyword);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Set up the shared block when the model is initialized.
+---------------------------------------------------------------------------- */
+void vs_telemetry_tap::start (vs_real t)
+{
+  std::string name = VS_TELEMETRY_PREFIX + run;
+  int i;
+
+  channels.resolve (*api);
+  if (block == NULL)
+    {
+    if (shm.create(name.c_str(), sizeof(vs_telemetry_block)))
+      {
+      api->vs_printf ("Telemetry for run \"%s\" is not available: the shared "
+                      "memory could not be created.\n", run.c_str());
+      return;
+      }
+    block = new (shm.data()) vs_telemetry_block;
+    block->seq.store (0);
+    }
+
+  block->magic = VS_TELEMETRY_MAGIC;
+  block->version = VS_TELEMETRY_VERSION;
+  block->pid = vss_pid();
+  block->n_channels = channels.size();
+  block->period = period;
+  strncpy (block->run, run.c_str(), sizeof(block->run) - 1);
+  for (i = 0; i < channels.size(); i++)
+    strncpy (block->channels[i], channels.keyword(i), VS_TELEMETRY_NAME_LEN - 1);
+
+  steps = 0;
+  t_start = t;
+  wall_start = vss_wall_seconds();
+  publish (t, VS_TELEMETRY_STARTING);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Write one sample with the seqlock protocol and set the next sample time.
+---------------------------------------------------------------------------- */
+void vs_telemetry_tap::publish (vs_real t, vs_telemetry_state state)
+{
+  vs_telemetry_sample s;
+  uint64_t seq;
+
+  t_next = t + period - 0.5*api->vs_get_tstep();
+  if (block == NULL) return;
+
+  s.t = t;
+  s.wall = vss_wall_seconds() - wall_start;
+  s.rtf = s.wall > 0.0 ? (t - t_start)/s.wall : 0.0;
+  s.steps = steps;
+  s.state = state;
+  s.error = api->vs_error_occurred();
+  memset (s.values, 0, sizeof(s.values));
+  channels.gather (s.values);
+
+  seq = block->seq.load(std::memory_order_relaxed);
+  block->seq.store (seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence (std::memory_order_release);
+  memcpy (&block->sample, &s, sizeof(s));
+  block->seq.store (seq + 2, std::memory_order_release);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Open the telemetry of a run. Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_telemetry_reader::open (const char *run)
+{
+  std::string name = VS_TELEMETRY_PREFIX + std::string(run);
+
+  close ();
+  if (shm.open(name.c_str())) return -1;
+  block = (const vs_telemetry_block *)shm.data();
+  if (shm.size() < sizeof(vs_telemetry_block) || block->magic != VS_TELEMETRY_MAGIC ||
+      block->version != VS_TELEMETRY_VERSION)
+    {
+    close ();
+    return -1;
+    }
+  return 0;
+}
+
+int vs_telemetry_reader::read (vs_telemetry_sample *sample) const
+{
+  uint64_t s1, s2;
+  int tries;
+
+  if (block == NULL) return -1;
+  for (tries = 0; tries < 10000; tries++)
+    {
+    s1 = block->seq.load(std::memory_order_acquire);
+    if (s1 & 1) continue;
+    memcpy (sample, &block->sample, sizeof(*sample));
+    std::atomic_thread_fence (std::memory_order_acquire);
+    s2 = block->seq.load(std::memory_order_relaxed);
+    if (s1 == s2) return 0;
+    }
+  return -1;
+}
+
+std::vector<std::string> vs_telemetry_reader::list (void)
+{
+  std::vector<std::string> runs = vs_shm::list(VS_TELEMETRY_PREFIX);
+  for (size_t i = 0; i < runs.size(); i++)
+    runs[i].erase (0, strlen(VS_TELEMETRY_PREFIX));
+  return runs;
+}
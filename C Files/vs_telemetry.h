@@ -0,0 +1,136 @@
+/* Live telemetry from running solvers, for monitoring long batch runs.
+
+   A vs_telemetry_tap is a subsystem (see vs_ext_dispatch.h) that publishes the
+   state of one run in a small shared memory block: simulation time, real-time
+   factor, step count, error state from vs_error_occurred(), and a few export
+   channels. It samples at a configurable simulation-time period. Between
+   samples the cost per step is one comparison, so the integration thread is
+   not slowed down.
+
+   The block is a seqlock: the solver thread never waits, and readers retry if
+   they catch a sample while it is being written. Any number of monitor
+   processes can read any number of runs with vs_telemetry_reader (see
+   vs_monitor.cpp).
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_TELEMETRY_H
+  #define _VS_TELEMETRY_H
+
+  #include <stdint.h>
+  #include <atomic>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h"     // VS types and definitions
+  #include "vs_ext_dispatch.h" // external code dispatcher
+  #include "vs_var_binding.h"  // cached variable pointers
+  #include "vs_shm.h"          // shared memory regions
+
+  #define VS_TELEMETRY_PREFIX    "vs_tel_" // shared memory name = prefix + run
+  #define VS_TELEMETRY_MAGIC     0x5654454Cu
+  #define VS_TELEMETRY_VERSION   1
+  #define VS_TELEMETRY_MAX_CHAN  32 // export channels per run
+  #define VS_TELEMETRY_NAME_LEN  32 // channel name length, with NULL
+
+  typedef enum
+    {
+    VS_TELEMETRY_STARTING, VS_TELEMETRY_RUNNING, VS_TELEMETRY_ENDED
+    } vs_telemetry_state;
+
+  // One published sample.
+  typedef struct
+    {
+    double  t;          // simulation time
+    double  wall;       // wall-clock seconds since VS_EXT_EQ_INIT
+    double  rtf;        // real-time factor: simulated seconds per wall second
+    int64_t steps;      // VS_EXT_EQ_OUT calls so far
+    int32_t state;      // vs_telemetry_state
+    int32_t error;      // vs_error_occurred() when sampled
+    double  values[VS_TELEMETRY_MAX_CHAN]; // channels, in user order
+    } vs_telemetry_sample;
+
+  // Layout of the shared block. The header is written once before the run.
+  typedef struct
+    {
+    uint32_t magic, version;
+    int32_t  pid, n_channels;
+    double   period;    // sample period, simulation seconds (0 = every step)
+    char     run[64];
+    char     channels[VS_TELEMETRY_MAX_CHAN][VS_TELEMETRY_NAME_LEN];
+    alignas(64) std::atomic<uint64_t> seq; // odd while a sample is written
+    vs_telemetry_sample sample;
+    } vs_telemetry_block;
+
+
+  // Publisher, added to the dispatcher of one solver.
+  class vs_telemetry_tap : public vs_ext_subsystem
+    {
+    public:
+      // run: name of the run, unique on the machine (default: from the pid)
+      vs_telemetry_tap (const char *run = NULL);
+
+      // Configure before the run starts.
+      int  add_channel (const char *keyword);
+      void set_period (vs_real seconds) {period = seconds;}
+      const char *run_name (void) const {return run.c_str();}
+
+      // vs_ext_subsystem
+      unsigned calc_mask (void) const
+        {
+        return VS_EXT_MASK(VS_EXT_EQ_INIT) | VS_EXT_MASK(VS_EXT_EQ_OUT) |
+               VS_EXT_MASK(VS_EXT_EQ_END);
+        }
+      void calc (vs_real t, vs_ext_loc where)
+        {
+        if (where == VS_EXT_EQ_OUT)
+          {
+          steps++;
+          if (t >= t_next) publish(t, VS_TELEMETRY_RUNNING);
+          }
+        else if (where == VS_EXT_EQ_INIT) start(t);
+        else if (where == VS_EXT_EQ_END)  publish(t, VS_TELEMETRY_ENDED);
+        }
+
+    private:
+      void start (vs_real t);
+      void publish (vs_real t, vs_telemetry_state state);
+
+      std::string run;
+      vs_real period, t_next, t_start;
+      double  wall_start;
+      int64_t steps;
+      vs_var_binding channels;
+      vs_shm shm;
+      vs_telemetry_block *block;
+    };
+
+
+  // Reader, used by monitor processes.
+  class vs_telemetry_reader
+    {
+    public:
+      vs_telemetry_reader () : block(NULL) {}
+
+      int  open (const char *run);
+      void close (void) {shm.close(); block = NULL;}
+
+      // Copy a consistent sample. Return 0 if OK, -1 if not open or if the
+      // writer kept changing it.
+      int read (vs_telemetry_sample *sample) const;
+
+      int         n_channels (void) const {return block ? block->n_channels : 0;}
+      const char *channel (int i) const {return block->channels[i];}
+      int         pid (void) const {return block ? block->pid : 0;}
+
+      // Runs currently published on this machine.
+      static std::vector<std::string> list (void);
+
+    private:
+      vs_shm shm;
+      const vs_telemetry_block *block;
+    };
+
+#endif  // end block for _VS_TELEMETRY_H
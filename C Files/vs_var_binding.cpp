@@ -0,0 +1,67 @@
+/* Cached pointers to model variables. See vs_var_binding.h.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"     // VS types and definitions
+#include "vs_solver.h"       // per-instance solver API
+#include "vs_ext_dispatch.h" // external code dispatcher
+#include "vs_var_binding.h"  // cached variable pointers
+
+vs_var_binding::vs_var_binding ()
+{
+}
+
+/* ----------------------------------------------------------------------------
+   Declare a keyword. A keyword that was already declared keeps its slot.
+---------------------------------------------------------------------------- */
+int vs_var_binding::add (const char *keyword)
+{
+  for (size_t i = 0; i < keywords.size(); i++)
+    if (keywords[i] == keyword) return (int)i;
+  keywords.push_back (keyword);
+  ptrs.clear (); // must resolve again
+  return (int)keywords.size() - 1;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Look up each keyword once. Return the number of keywords not found.
+---------------------------------------------------------------------------- */
+int vs_var_binding::resolve (const vs_api_table &solver_api)
+{
+  size_t i, n_missing = 0;
+
+  missing.assign (keywords.size(), 0.0);
+  ptrs.resize (keywords.size());
+  for (i = 0; i < keywords.size(); i++)
+    {
+    ptrs[i] = solver_api.vs_get_var_ptr((char *)keywords[i].c_str());
+    if (ptrs[i] == NULL)
+      {
+      ptrs[i] = &missing[i];
+      n_missing++;
+      }
+    }
+  return (int)n_missing;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Resolve when the model has been initialized. Unknown keywords are errors.
+---------------------------------------------------------------------------- */
+void vs_var_binding::calc (vs_real /*t*/, vs_ext_loc where)
+{
+  if (where != VS_EXT_EQ_INIT || api == NULL) return;
+  if (resolve(*api) == 0) return;
+
+  for (size_t i = 0; i < keywords.size(); i++)
+    if (ptrs[i] == &missing[i])
+      api->vs_printf_error ("The keyword \"%s\" is not a variable in this model.\n",
+                            keywords[i].c_str());
+}
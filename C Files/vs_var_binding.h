@@ -0,0 +1,74 @@
+/* Cached pointers to model variables, for external code that reads or writes
+   many imports, outputs or parameters by keyword every step.
+
+   vs_get_var_ptr() looks a keyword up by name, which is too slow to repeat
+   for dozens of variables per step. A vs_var_binding holds a list of keywords
+   declared up front. It resolves them once, when the solver calls external
+   code with VS_EXT_EQ_INIT, into one contiguous array of vs_real pointers.
+   After that, gather() and scatter() move all values between the model and a
+   plain array without any string lookups.
+
+     vs_var_binding io;
+     int steer = io.add("IMP_STEER_SW");   // before the run
+     ...
+     ext.add (&io);                        // ahead of the subsystems using it
+     ...
+     io.gather (values);                   // each step
+     values[steer] = ...;
+     io.scatter (values);
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_VAR_BINDING_H
+  #define _VS_VAR_BINDING_H
+
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h"     // VS types and definitions
+  #include "vs_solver.h"       // per-instance solver API
+  #include "vs_ext_dispatch.h" // external code dispatcher
+
+  class vs_var_binding : public vs_ext_subsystem
+    {
+    public:
+      vs_var_binding ();
+
+      // Declare a keyword and return its slot in the value arrays.
+      int add (const char *keyword);
+      int size (void) const {return (int)keywords.size();}
+      const char *keyword (int i) const {return keywords[i].c_str();}
+
+      // Resolve all keywords. Return the number that could not be found;
+      // those slots point at a dummy value so gather/scatter stay safe.
+      int resolve (const vs_api_table &api);
+      vs_bool resolved (void) const {return ptrs.size() == keywords.size();}
+
+      // Copy all values from the model into values[], or back.
+      void gather (vs_real *values) const
+        {
+        vs_real *const *p = ptrs.data();
+        for (size_t i = 0, n = ptrs.size(); i < n; i++) values[i] = *p[i];
+        }
+      void scatter (const vs_real *values) const
+        {
+        vs_real *const *p = ptrs.data();
+        for (size_t i = 0, n = ptrs.size(); i < n; i++) *p[i] = values[i];
+        }
+
+      // Direct access to one variable after resolve().
+      vs_real *ptr (int i) const {return ptrs[i];}
+
+      // vs_ext_subsystem: resolve at VS_EXT_EQ_INIT.
+      unsigned calc_mask (void) const {return VS_EXT_MASK(VS_EXT_EQ_INIT);}
+      void     calc (vs_real t, vs_ext_loc where);
+
+    private:
+      std::vector<std::string> keywords;
+      std::vector<vs_real *>   ptrs;    // one per keyword, in the same order
+      std::vector<vs_real>     missing; // targets for unresolved keywords
+    };
+
+#endif  // end block for _VS_VAR_BINDING_H
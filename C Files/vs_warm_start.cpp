@@ -0,0 +1,214 @@
+/* Warm-start image of an initialized model. See vs_warm_start.h.
+
+   Log:
+   Oct 18, 26. Check the optional API functions that are used.
+   Oct 18, 26. Created.
+*/
+
+// Standard C/C++ headers.
+#include <ctype.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "vs_deftypes.h"   // VS types and definitions
+#include "vs_solver.h"     // per-instance solver API
+#include "vs_jobs.h"       // vs_job_mods, vs_job_result, vs_job_run
+#include "vs_warm_start.h" // warm-start image
+
+#define VSS_MAX_SYMS 10000000 // stop looking for symbols here
+
+static double vss_wall_seconds (void)
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string vss_upper (const std::string &s)
+{
+  std::string u(s);
+  for (size_t i = 0; i < u.size(); i++) u[i] = (char)toupper((unsigned char)u[i]);
+  return u;
+}
+
+
+vs_warm_image::vs_warm_image (vs_solver &solver)
+  : solver(solver), t0(0.0), tstop(NULL), opened(FALSE), cold(0)
+{
+}
+
+vs_warm_image::~vs_warm_image ()
+{
+  close ();
+}
+
+void vs_warm_image::needs_init (const char *keyword)
+{
+  init_keys.insert (vss_upper(keyword));
+}
+
+/* ----------------------------------------------------------------------------
+   Read and initialize, then capture the states and every symbol value.
+   Return 0 if OK, -1 if not.
+---------------------------------------------------------------------------- */
+int vs_warm_image::open (const char *sim)
+{
+  const vs_api_table &api = solver.api;
+  void *att;
+  int id, n;
+
+  close ();
+  simfile = sim;
+  error.clear ();
+  if (api.vs_get_sym_attribute == NULL) error = vs_api_missing("vs_get_sym_attribute");
+  else if (api.vs_n_derivatives == NULL || api.vs_n_extra_state_variables == NULL)
+    error = vs_api_missing("vs_n_derivatives");
+  else if (api.vs_copy_all_state_vars_to_array == NULL ||
+           api.vs_copy_all_state_vars_from_array == NULL)
+    error = vs_api_missing("vs_copy_all_state_vars_to_array");
+  if (!error.empty()) return -1;
+  t0 = api.vs_setdef_and_read(sim, NULL, NULL);
+  if (!api.vs_error_occurred()) api.vs_initialize(t0, NULL, NULL);
+  if (!api.vs_error_occurred()) tstop = api.vs_get_var_ptr((char *)"TSTOP");
+  if (api.vs_error_occurred() || tstop == NULL)
+    {
+    error = api.vs_error_occurred() ? api.vs_get_error_message()
+                                    : "The model has no TSTOP parameter.";
+    api.vs_terminate (t0, NULL);
+    api.vs_free_all ();
+    return -1;
+    }
+  opened = TRUE;
+
+  n = api.vs_n_derivatives() + api.vs_n_extra_state_variables();
+  state.assign (n > 0 ? n : 0, 0.0);
+  if (n > 0) api.vs_copy_all_state_vars_to_array(state.data());
+
+  // Symbols are numbered from 0; an integer symbol has an int value.
+  for (id = 0; id < VSS_MAX_SYMS && !api.vs_get_sym_attribute(id, PAR_KEYWORD, &att); id++)
+    {
+    if (!api.vs_get_sym_attribute(id, PAR_INTEGER, &att) && att)
+      {
+      int_ptr.push_back ((int *)att);
+      ints.push_back (*(int *)att);
+      }
+    else if (!api.vs_get_sym_attribute(id, PAR_REAL, &att) && att)
+      {
+      real_ptr.push_back ((vs_real *)att);
+      reals.push_back (*(vs_real *)att);
+      }
+    }
+  return 0;
+}
+
+void vs_warm_image::close (void)
+{
+  if (opened)
+    {
+    solver.api.vs_terminate (t0, NULL);
+    solver.api.vs_free_all ();
+    }
+  opened = FALSE;
+  tstop = NULL;
+  real_ptr.clear ();
+  reals.clear ();
+  int_ptr.clear ();
+  ints.clear ();
+  state.clear ();
+}
+
+
+/* ----------------------------------------------------------------------------
+   Back to the image, then the changes. Return 0 if OK, -1 if a keyword is
+   not a parameter.
+---------------------------------------------------------------------------- */
+int vs_warm_image::reset (const vs_job_mods &mods)
+{
+  const vs_api_table &api = solver.api;
+  vs_sym_attr_type type;
+  size_t i;
+  int id;
+
+  for (i = 0; i < reals.size(); i++) *real_ptr[i] = reals[i];
+  for (i = 0; i < ints.size(); i++) *int_ptr[i] = ints[i];
+  if (!state.empty()) api.vs_copy_all_state_vars_from_array(state.data());
+
+  for (i = 0; i < mods.size(); i++)
+    {
+    id = api.vs_get_var_id((char *)mods[i].first.c_str(), &type);
+    if (id < 0)
+      {
+      error = "The keyword \"" + mods[i].first + "\" is not a parameter in this model.";
+      return -1;
+      }
+    api.vs_set_sym_real (id, type, mods[i].second);
+    }
+  return 0;
+}
+
+vs_bool vs_warm_image::cold_run (const vs_job_mods &mods) const
+{
+  for (size_t i = 0; i < mods.size(); i++)
+    if (init_keys.count(vss_upper(mods[i].first))) return TRUE;
+  return FALSE;
+}
+
+
+/* ----------------------------------------------------------------------------
+   One run: from the image, or with vs_job_run if a change needs the model
+   to be initialized. Return 0 if OK.
+---------------------------------------------------------------------------- */
+int vs_warm_image::run (const vs_job_mods &mods, const std::atomic<bool> *cancel,
+                        vs_job_result *result)
+{
+  const vs_api_table &api = solver.api;
+  double wall = vss_wall_seconds();
+  vs_real t, tstep;
+  int n;
+
+  if (cold_run(mods))
+    {
+    close ();
+    cold++;
+    return vs_job_run(solver, simfile.c_str(), mods, cancel, result);
+    }
+
+  result->status = VS_JOB_FAILED;
+  result->t_end = 0.0;
+  result->exports.clear ();
+  result->error.clear ();
+  result->cached = FALSE;
+  if (!opened && open(simfile.c_str()))
+    {
+    result->error = error;
+    result->seconds = vss_wall_seconds() - wall;
+    return -1;
+    }
+
+  if (reset(mods))
+    result->error = error;
+  else
+    {
+    t = t0;
+    tstep = api.vs_get_tstep();
+    while (t < *tstop - 0.5*tstep && !api.vs_error_occurred() &&
+           !(cancel && cancel->load(std::memory_order_relaxed)))
+      api.vs_integrate (&t, NULL);
+
+    n = api.vs_get_export_names && api.vs_copy_export_vars ?
+        api.vs_get_export_names(NULL) : 0;
+    result->exports.assign (n > 0 ? n : 0, 0.0);
+    if (n > 0) api.vs_copy_export_vars(result->exports.data());
+    result->t_end = t;
+    if (api.vs_error_occurred())
+      {
+      result->error = api.vs_get_error_message();
+      close (); // the error stays set; start again on the next run
+      }
+    else
+      result->status = cancel && cancel->load() ? VS_JOB_CANCELLED : VS_JOB_DONE;
+    }
+  result->seconds = vss_wall_seconds() - wall;
+  return result->status == VS_JOB_DONE ? 0 : -1;
+}
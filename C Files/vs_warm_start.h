@@ -0,0 +1,98 @@
+/* Warm-start image of an initialized model, for sweeps that change a few
+   parameters between runs.
+
+   vs_job_run reads the parsfiles (vs_setdef_and_read) and initializes the
+   model (vs_initialize) for every run. A vs_warm_image does that once, then
+   captures the model right after initialization: the state arrays
+   (vs_copy_all_state_vars_to_array) and the value of every symbol that
+   vs_get_sym_attribute points to (parameters, outputs, imports). Each run
+   puts those values back, applies its changes with vs_set_sym_real, and
+   integrates from the start time.
+
+     vs_warm_image image(solver);
+     image.needs_init ("SPEED");       // used by vs_initialize: runs cold
+     image.open ("Runs/Run1.sim");
+     for (...) image.run (mods, NULL, &result);
+
+   Limits, because the solver is not started again:
+   - A parameter used only by vs_initialize (an initial speed or position)
+     has no effect when changed on an image. Name such keywords with
+     needs_init(); runs that change one are made cold with vs_job_run, and
+     the image is made again for the next warm run.
+   - vs_stop_run() stays set once a run has ended, so a warm run ends at
+     TSTOP (which may be changed like any parameter), on an error or when
+     cancelled, not when the model asks to stop.
+   - The ERD, echo and end files of the session are those of the first run;
+     warm runs add to the same ERD file. Sweeps should take their results
+     from the exports (vs_job_result) and write no ERD file.
+   After an error the session is closed and the next run opens it again.
+
+   Log:
+   Oct 18, 26. Created.
+*/
+
+#ifndef _VS_WARM_START_H
+  #define _VS_WARM_START_H
+
+  #include <atomic>
+  #include <set>
+  #include <string>
+  #include <vector>
+
+  #include "vs_deftypes.h" // VS types and definitions
+  #include "vs_solver.h"   // per-instance solver API
+  #include "vs_jobs.h"     // vs_job_mods, vs_job_result, vs_job_run
+
+  class vs_warm_image
+    {
+    public:
+      vs_warm_image (vs_solver &solver);
+      ~vs_warm_image (); // closes the session
+
+      // Read the simfile, initialize the model and capture the image.
+      // Return 0 if OK, -1 if not.
+      int  open (const char *simfile);
+
+      // End the session (vs_terminate and vs_free_all).
+      void close (void);
+
+      // Put the model back to the image and apply the changes; the run goes
+      // on from start_time(). Return 0 if OK, -1 if a keyword is not a
+      // parameter (the changes before it are applied).
+      int  reset (const vs_job_mods &mods = vs_job_mods());
+
+      // One run from the image, or cold if a change needs vs_initialize.
+      // cancel may be NULL. Return 0 if OK.
+      int  run (const vs_job_mods &mods, const std::atomic<bool> *cancel,
+                vs_job_result *result);
+
+      // A keyword used by vs_initialize; changing it makes the run cold.
+      void needs_init (const char *keyword);
+
+      vs_bool is_open (void) const {return opened;}
+      vs_real start_time (void) const {return t0;}
+      int     n_symbols (void) const {return (int)(reals.size() + ints.size());}
+      int     n_states (void) const {return (int)state.size();}
+      int     n_cold (void) const {return cold;}
+      const char *error_message (void) const {return error.c_str();}
+
+    private:
+      vs_warm_image (const vs_warm_image &);            // not copyable
+      vs_warm_image &operator= (const vs_warm_image &);
+
+      vs_bool cold_run (const vs_job_mods &mods) const;
+
+      vs_solver &solver;
+      std::string simfile, error;
+      std::set<std::string> init_keys;    // upper case
+      std::vector<vs_real *> real_ptr;    // symbol values of the image
+      std::vector<vs_real>   reals;
+      std::vector<int *>     int_ptr;
+      std::vector<int>       ints;
+      std::vector<vs_real>   state;       // all state variables
+      vs_real t0, *tstop;
+      vs_bool opened;
+      int cold;
+    };
+
+#endif  // end block for _VS_WARM_START_H
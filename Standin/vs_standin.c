@@ -0,0 +1,2640 @@
+/* Stand-in VS solver: a shared library with the API of a VS solver DLL (all
+   of vs_api.h), for building, testing and benchmarking the tools in
+   "C Files" on machines without a VS product.
+
+   The model is a single-track vehicle driven along a road by a preview
+   (pure pursuit) steering controller and a speed controller, with tire
+   forces limited by the friction of the road under each axle. It reads a
+   simfile and parsfiles like a VS solver, calls the installed external
+   functions at the usual places, writes echo, end, log and ERD files, and
+   keeps tables and a road that can be queried through the API.
+
+   Simfile keywords: INPUT, ECHO, FINAL, LOGFILE, ERDFILE, DATADIR, DLLFILE
+   (others are ignored), END.
+
+   Parsfile lines:
+     KEYWORD value                parameter (see vss_define_model)
+     PARSFILE path                read another parsfile (relative paths are
+                                  in DATADIR, or next to the file)
+     IMPORT name / EXPORT name    choose imports and exports; the first one
+                                  replaces the default set
+     ROOT_TABLE [type]            1D table, data lines "x y", ENDTABLE;
+                                  type LINEAR (default), LINEAR_FLAT,
+                                  LINEAR_LOOP, STEP, SPLINE, SPLINE_FLAT
+     ROOT_CARPET [type]           2D table: the first data line has the
+                                  column values, each next line a row value
+                                  and its outputs, ENDTABLE; type LINEAR,
+                                  STEP or SPLINE (kept as a 2D spline
+                                  table, but evaluated linearly: the
+                                  stand-in builds no bicubic coefficients)
+     ROOT_CONSTANT v, ROOT_COEFFICIENT v, ROOT_GAIN v, ROOT_OFFSET v,
+     ROOT_START_X v, ROOT_SCALE_X v
+   A table keyword may end with an index in parentheses, as ROOT_TABLE(2),
+   for groups with several tables. A table gives
+     offset + gain*F((x - start_x)/scale_x).
+   Lines starting with # or ! are comments; END ends a file.
+
+   Built-in tables: ROAD_CURV (curvature vs. station), ROAD_Z (elevation
+   carpet vs. station and lateral position), ROAD_MU (friction vs. station),
+   TARGET_L (target lateral position vs. station), SPEED_TARGET (km/h vs.
+   station; constant SPEED if not given).
+
+   Settings to make the model heavier for benchmarks: N_OSC adds that many
+   filter states and outputs (OSC_i); with OPT_OSC_IMPORTS 1 it also adds
+   imports IMP_OSC_i (in g, added to the input of each filter), which are
+   off by default so that N_OSC alone gives the same symbols as before.
+   WORK adds that many multiply-adds to each evaluation of the derivatives,
+   IPRINT sets the steps per ERD record.
+
+   vs_copy_import_vars and vs_copy_export_vars scale the channels from
+   packed arrays (vss_pack_io). That is this stand-in's own code: a real
+   solver DLL copies in its own way. The client-side form, which works with
+   any DLL, is vs_io_scaling (C Files/vs_io_scaling.h).
+
+   Log:
+   Oct 18, 26. SPLINE carpets are evaluated linearly; tab->coef is not
+               read (it was set by vs_spline_cache).
+   Oct 18, 26. IMP_OSC_i only with OPT_OSC_IMPORTS; note on the packed
+               copies.
+   Oct 18, 26. Created.
+*/
+
+// Standard C headers.
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define VSS_SSE2
+#endif
+
+#include "vs_deftypes.h" // VS types and definitions
+
+#define VSS_MAX_INST    64   // instances of road queries with their own hint
+#define VSS_MAX_CHARS   1024 // length of a line in a parsfile
+#define VSS_G           9.80665
+#define VSS_DEG         (180.0/PI)
+
+#ifdef _WIN32
+  #define VSS_SEP '\\'
+#else
+  #define VSS_SEP '/'
+#endif
+
+typedef void (*vss_calc_func) (vs_real, vs_ext_loc);
+typedef void (*vss_echo_func) (vs_ext_loc);
+typedef void (*vss_calc2_func) (vs_real, vs_ext_loc, void *);
+typedef void (*vss_echo2_func) (vs_ext_loc, void *);
+typedef void (*vss_setdef2_func) (void *);
+typedef vs_bool (*vss_scan2_func) (char *, char *, void *);
+typedef void (*vss_free2_func) (void *);
+
+typedef enum {VSS_PAR, VSS_PAR_INT, VSS_VAR, VSS_IMP, VSS_OUT} vss_kind;
+
+// A keyword of the model: parameter, variable, import or output.
+typedef struct
+  {
+  char *keyword, *desc, *units;
+  vs_real *real;   // value in internal units (NULL for VSS_PAR_INT)
+  int *integer;    // VSS_PAR_INT only
+  vs_real gain;    // multiply to get user units
+  vss_kind kind;
+  vs_bool own;     // real was allocated here
+  } vss_sym;
+
+// Units defined with vs_define_units.
+typedef struct
+  {
+  char *desc;
+  vs_real gain;
+  } vss_unit;
+
+// Saved state (chapter 8).
+typedef struct
+  {
+  vs_real t, *state;
+  } vss_saved;
+
+
+/* ----------------------------------------------------------------------------
+   Data of the solver.
+---------------------------------------------------------------------------- */
+// installed functions
+static vss_calc_func    calc_func, init_calc, init_eq_in;
+static vss_echo_func    echo_func, init_echo;
+static void           (*setdef_func) (void);
+static vs_bool        (*scan_func) (char *, char *);
+static void           (*free_func) (void);
+static vss_calc2_func   calc2_func;
+static vss_echo2_func   echo2_func;
+static vss_setdef2_func setdef2_func;
+static vss_scan2_func   scan2_func;
+static vss_free2_func   free2_func;
+static void *calc2_data, *echo2_data, *setdef2_data, *scan2_data, *free2_data;
+
+// messages and files
+static char error_msg[4096], output_msg[4096], stop_msg[1024];
+static vs_bool error_flag;
+static char simfile_name[FILENAME_MAX], infile_name[FILENAME_MAX],
+            echofile_name[FILENAME_MAX], endfile_name[FILENAME_MAX],
+            logfile_name[FILENAME_MAX], erdfile_name[FILENAME_MAX],
+            datadir[FILENAME_MAX];
+static FILE *echo_fp, *log_fp, *erd_fp, *read_fp;
+
+// symbols, units, tables
+static vss_sym  *syms;
+static int       n_syms, max_syms;
+static vss_unit *units;
+static int       n_units;
+static vs_tab_group **groups;
+static vs_bool  *own_group; // made here (vs_define_table), so freed here
+static int       n_groups;
+static int      *imports, *exports; // symbol ids
+static int       n_imports, n_exports;
+static vs_bool   imports_given, exports_given;
+static char    **import_names, **export_names;
+static vs_real **import_ptr, **export_ptr; // packed by vss_pack_io
+static vs_real  *import_gain, *export_gain;
+static void     *io_block;
+static vs_bool   io_packed;
+static vs_real   io_sink, io_zero; // variables of unknown channels
+static int       n_moving_objects, n_sensors;
+
+// parameters
+static vs_real tstart, tstop, tstep, speed, mass, izz, lf, lr, cf, cr,
+               steer_ratio, steer_tau, preview, k_speed, a_max, b_max, drag,
+               road_length, road_ds, road_x0, road_y0, road_yaw0,
+               road_width, save_dt, work_par, n_osc_par, iprint_par;
+static int     opt_driver, opt_speed, opt_road_loop, opt_pause, opt_osc_imports;
+
+// state
+static int      n_osc, work, iprint, n_state;
+static vs_real *state, *deriv, *state0, *k1; // n_state values each
+static vs_real  t_now, delta_cmd, imp_steer, imp_throttle, imp_brake,
+                mu_f, mu_r, odometer;
+static vs_real  out_x, out_y, out_z, out_yaw, out_vx, out_vy, out_avz, out_ay,
+                out_ax, out_steer, out_station, out_lat, out_mu_f, out_mu_r,
+                out_ax_cmd, *out_osc, *imp_osc;
+static vs_bool  stop_flag, initialized, save_timer;
+static vs_real  save_next;
+static vss_saved *saved;
+static int      n_saved, max_saved;
+static vs_real  restore_request;
+static vs_bool  restore_requested;
+static long long n_steps, n_records;
+static float   *erd_row;
+
+// road, sampled every road_ds
+static vs_real *road_sx, *road_sy, *road_syaw;
+static int      road_n;
+static int      road_hint[VSS_MAX_INST];
+static int      tab_road_curv, tab_road_z, tab_road_mu, tab_target_l,
+                tab_speed_target;
+static vs_bool  speed_target_given;
+
+static vs_real vss_table_eval (vs_table *tab, vs_real xcol, vs_real x, int inst);
+static void    vss_free_model (void);
+VS_API_EXPORT void    vs_malloc_table_data (vs_table *tab, int type, int nx, int ny);
+VS_API_EXPORT int     vs_define_table (char *root, int ntab, int ninst);
+VS_API_EXPORT int     vs_stop_run (void);
+VS_API_EXPORT void    vs_save_state (void);
+VS_API_EXPORT vs_real vs_restore_state (void);
+VS_API_EXPORT void    vs_free_saved_states (void);
+
+
+/* ----------------------------------------------------------------------------
+   Utilities.
+---------------------------------------------------------------------------- */
+static char *vss_strdup (const char *s)
+{
+  char *d = (char *)malloc(strlen(s ? s : "") + 1);
+  strcpy (d, s ? s : "");
+  return d;
+}
+
+static void vss_upper (char *s)
+{
+  for (; *s; s++) *s = (char)toupper((unsigned char)*s);
+}
+
+static int vss_same (const char *a, const char *b)
+{
+  while (*a && toupper((unsigned char)*a) == toupper((unsigned char)*b)) a++, b++;
+  return *a == 0 && *b == 0;
+}
+
+static void *vss_grow (void *p, int *max, int need, size_t size)
+{
+  if (need <= *max) return p;
+  *max = need < 16 ? 16 : 2*need;
+  return realloc(p, (size_t)*max*size);
+}
+
+// Path of a file named in a parsfile: as is if absolute, else in DATADIR or
+// next to the parsfile.
+static void vss_resolve (const char *name, const char *from, char *path)
+{
+  const char *slash;
+
+  if (name[0] == '/' || name[0] == '\\' || (name[0] && name[1] == ':'))
+    strcpy (path, name);
+  else if (datadir[0])
+    sprintf (path, "%s%s", datadir, name);
+  else
+    {
+    slash = strrchr(from, '/');
+    if (strrchr(from, '\\') > slash) slash = strrchr(from, '\\');
+    if (slash)
+      sprintf (path, "%.*s%s", (int)(slash - from + 1), from, name);
+    else
+      strcpy (path, name);
+    }
+}
+
+static void vss_log (const char *format, ...)
+{
+  va_list args;
+
+  if (log_fp == NULL) return;
+  va_start (args, format);
+  vfprintf (log_fp, format, args);
+  va_end (args);
+}
+
+static void vss_error (const char *format, ...)
+{
+  size_t n = strlen(error_msg);
+  va_list args;
+
+  va_start (args, format);
+  if (n < sizeof(error_msg) - 1)
+    vsnprintf (error_msg + n, sizeof(error_msg) - n, format, args);
+  va_end (args);
+  error_flag = TRUE;
+  vss_log ("Error: %s", error_msg + n);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Symbols.
+---------------------------------------------------------------------------- */
+static int vss_find_sym (const char *keyword)
+{
+  int i;
+
+  for (i = 0; i < n_syms; i++)
+    if (vss_same(syms[i].keyword, keyword)) return i;
+  return -1;
+}
+
+static int vss_add_sym (const char *keyword, const char *desc, const char *unit,
+                        vs_real gain, vss_kind kind, vs_real *real, int *integer)
+{
+  int id = vss_find_sym(keyword);
+  vss_sym *s;
+
+  if (id < 0)
+    {
+    syms = (vss_sym *)vss_grow(syms, &max_syms, n_syms + 1, sizeof(vss_sym));
+    id = n_syms++;
+    memset (&syms[id], 0, sizeof(vss_sym));
+    }
+  else
+    {
+    free (syms[id].keyword);
+    free (syms[id].desc);
+    free (syms[id].units);
+    if (syms[id].own) free(syms[id].real);
+    }
+  s = &syms[id];
+  s->keyword = vss_strdup(keyword);
+  vss_upper (s->keyword);
+  s->desc = vss_strdup(desc);
+  s->units = vss_strdup(unit);
+  s->gain = gain;
+  s->kind = kind;
+  s->integer = integer;
+  s->own = real == NULL && integer == NULL;
+  s->real = s->own ? (vs_real *)calloc(1, sizeof(vs_real)) : real;
+  return id;
+}
+
+// Value in user units.
+static vs_real vss_sym_value (int id)
+{
+  if (syms[id].integer) return *syms[id].integer;
+  return *syms[id].real*syms[id].gain;
+}
+
+static void vss_set_sym_value (int id, vs_real value)
+{
+  if (syms[id].integer) *syms[id].integer = (int)floor(value + 0.5);
+  else *syms[id].real = value/syms[id].gain;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Tables.
+---------------------------------------------------------------------------- */
+static char *vss_keyword (const char *root, const char *suffix)
+{
+  char *k = (char *)malloc(strlen(root) + strlen(suffix) + 1);
+  sprintf (k, "%s%s", root, suffix);
+  vss_upper (k);
+  return k;
+}
+
+static void vss_free_table_data (vs_table *tab)
+{
+  int i;
+
+  if (tab->fxy)
+    for (i = 0; i < tab->nx; i++) free(tab->fxy[i]);
+  free (tab->fxy);
+  free (tab->x);
+  free (tab->y);
+  free (tab->dydx);
+  free (tab->loop);
+  tab->x = tab->y = tab->dydx = tab->loop = NULL;
+  tab->fxy = NULL;
+  tab->nx = tab->ny = 0;
+}
+
+static vs_table *vss_new_table (vs_tab_group *g)
+{
+  vs_table *tab = (vs_table *)calloc(1, sizeof(vs_table));
+
+  tab->tabs = g;
+  tab->visible = TRUE;
+  tab->type = VS_TAB_CONST;
+  tab->gain = 1.0;
+  tab->scale_x = 1.0;
+  tab->jx = (int *)calloc(g->ninst, sizeof(int));
+  tab->jy = (int *)calloc(g->ninst, sizeof(int));
+  return tab;
+}
+
+static int vss_add_group (vs_tab_group *g, vs_bool own)
+{
+  groups = (vs_tab_group **)realloc(groups, (n_groups + 1)*sizeof(vs_tab_group *));
+  own_group = (vs_bool *)realloc(own_group, (n_groups + 1)*sizeof(vs_bool));
+  groups[n_groups] = g;
+  own_group[n_groups] = own;
+  return n_groups++;
+}
+
+static void vss_free_group (vs_tab_group *g)
+{
+  int i;
+
+  for (i = 0; i < g->ntab; i++)
+    {
+    vss_free_table_data (g->table[i]);
+    free (g->table[i]->jx);
+    free (g->table[i]->jy);
+    free (g->table[i]->eq_desc);
+    free (g->table[i]);
+    }
+  free (g->table);
+  free (g->root_keyword);
+  free (g->table_keyword);
+  free (g->carpet_keyword);
+  free (g->gain_keyword);
+  free (g->offset_keyword);
+  free (g->constant_keyword);
+  free (g->coefficient_keyword);
+  free (g->start_x_keyword);
+  free (g->scale_x_keyword);
+  free (g->equation_keyword);
+  free (g->title);
+  free (g);
+}
+
+// Slopes at the knots of a natural cubic spline through the table points.
+static void vss_spline_slopes (vs_table *tab)
+{
+  int i, n = tab->nx;
+  vs_real *m, *c, h, h0, h1, w;
+
+  free (tab->dydx);
+  tab->dydx = (vs_real *)calloc(n, sizeof(vs_real));
+  if (n < 2) return;
+  if (n == 2)
+    {
+    tab->dydx[0] = tab->dydx[1] = (tab->y[1] - tab->y[0])/(tab->x[1] - tab->x[0]);
+    return;
+    }
+
+  // second derivatives m (m[0] = m[n-1] = 0) by the tridiagonal algorithm
+  m = (vs_real *)calloc(n, sizeof(vs_real));
+  c = (vs_real *)calloc(n, sizeof(vs_real));
+  for (i = 1; i < n - 1; i++)
+    {
+    h0 = tab->x[i] - tab->x[i - 1];
+    h1 = tab->x[i + 1] - tab->x[i];
+    w = 2.0*(h0 + h1) - h0*c[i - 1];
+    c[i] = h1/w;
+    m[i] = (6.0*((tab->y[i + 1] - tab->y[i])/h1 - (tab->y[i] - tab->y[i - 1])/h0) -
+            h0*m[i - 1])/w;
+    }
+  for (i = n - 3; i >= 1; i--) m[i] -= c[i]*m[i + 1];
+
+  for (i = 0; i < n - 1; i++)
+    {
+    h = tab->x[i + 1] - tab->x[i];
+    tab->dydx[i] = (tab->y[i + 1] - tab->y[i])/h - h*(2.0*m[i] + m[i + 1])/6.0;
+    }
+  h = tab->x[n - 1] - tab->x[n - 2];
+  tab->dydx[n - 1] = (tab->y[n - 1] - tab->y[n - 2])/h + h*(m[n - 2] + 2.0*m[n - 1])/6.0;
+  free (m);
+  free (c);
+}
+
+// Interval j of a sorted array with x[j] <= v < x[j+1] (0 to n-2). The
+// search starts from the hint, and falls back to bisection if v is far.
+static int vss_interval (const vs_real *x, int n, vs_real v, int *hint)
+{
+  int j = *hint, k, lo, hi, mid;
+
+  if (n < 2) return 0;
+  if (j < 0 || j > n - 2) j = 0;
+  for (k = 0; k < 8; k++)
+    {
+    if (v < x[j] && j > 0) j--;
+    else if (v >= x[j + 1] && j < n - 2) j++;
+    else
+      {
+      *hint = j;
+      return j;
+      }
+    }
+
+  lo = 0;
+  hi = n - 2;
+  while (lo < hi)
+    {
+    mid = (lo + hi + 1)/2;
+    if (x[mid] <= v) lo = mid;
+    else hi = mid - 1;
+    }
+  *hint = lo;
+  return lo;
+}
+
+static vs_real vss_eval_1d (vs_table *tab, vs_real v, int inst)
+{
+  int n = tab->nx, j;
+  vs_real *x = tab->x, *y = tab->y, h, u, range;
+  vs_table_type type = tab->type;
+
+  if (n < 2) return n ? y[0] : 0.0;
+  if (type == VS_TAB_LIN_LOOP || type == VS_SPLINE_LOOP)
+    {
+    range = x[n - 1] - x[0];
+    if (range > 0.0) v = x[0] + fmod(fmod(v - x[0], range) + range, range);
+    }
+  else if (type == VS_TAB_LIN_FLAT || type == VS_SPLINE_FLAT || type == VS_TAB_STEP)
+    {
+    if (v <= x[0]) return y[0];
+    if (v >= x[n - 1]) return y[n - 1];
+    }
+
+  j = vss_interval(x, n, v, &tab->jx[inst]);
+  h = x[j + 1] - x[j];
+  u = (v - x[j])/h;
+  switch (type)
+    {
+    case VS_TAB_STEP:
+      return y[j];
+    case VS_SPLINE: case VS_SPLINE_LOOP: case VS_SPLINE_FLAT:
+      if (u < 0.0) return y[0] + (v - x[0])*tab->dydx[0];
+      if (u > 1.0) return y[n - 1] + (v - x[n - 1])*tab->dydx[n - 1];
+      return (1.0 + 2.0*u)*(1.0 - u)*(1.0 - u)*y[j] + u*(1.0 - u)*(1.0 - u)*h*tab->dydx[j] +
+             u*u*(3.0 - 2.0*u)*y[j + 1] - u*u*(1.0 - u)*h*tab->dydx[j + 1];
+    default:
+      return y[j] + u*(y[j + 1] - y[j]);
+    }
+}
+
+// 2D table: rows are x (nx values), columns are y (ny values), fxy[row][col].
+static vs_real vss_eval_2d (vs_table *tab, vs_real col, vs_real row, int inst)
+{
+  int i, j;
+  vs_real u, w, *f0, *f1;
+
+  if (tab->nx < 1 || tab->ny < 1) return 0.0;
+  if (row < tab->x[0]) row = tab->x[0];
+  if (row > tab->x[tab->nx - 1]) row = tab->x[tab->nx - 1];
+  if (col < tab->y[0]) col = tab->y[0];
+  if (col > tab->y[tab->ny - 1]) col = tab->y[tab->ny - 1];
+  i = vss_interval(tab->x, tab->nx, row, &tab->jx[inst]);
+  j = vss_interval(tab->y, tab->ny, col, &tab->jy[inst]);
+  if (tab->type == VS_TAB_2D_STEP || tab->nx < 2 || tab->ny < 2)
+    return tab->fxy[i][j];
+
+  u = (row - tab->x[i])/(tab->x[i + 1] - tab->x[i]);
+  w = (col - tab->y[j])/(tab->y[j + 1] - tab->y[j]);
+  f0 = tab->fxy[i];
+  f1 = tab->fxy[i + 1];
+  return (1.0 - u)*((1.0 - w)*f0[j] + w*f0[j + 1]) + u*((1.0 - w)*f1[j] + w*f1[j + 1]);
+}
+
+static vs_real vss_table_eval (vs_table *tab, vs_real xcol, vs_real x, int inst)
+{
+  vs_real f;
+
+  switch (tab->type)
+    {
+    case VS_TAB_CONST: return tab->constant;
+    case VS_TAB_COEF:  return tab->offset + x*tab->coefficient;
+    case VS_TAB_EQ:    return tab->constant; // see vss_read_table_keyword
+    default: break;
+    }
+  x = (x - tab->start_x)/tab->scale_x;
+  if (tab->type >= VS_TAB_2D) f = vss_eval_2d(tab, xcol, x, inst);
+  else f = vss_eval_1d(tab, x, inst);
+  return tab->offset + tab->gain*f;
+}
+
+// Table of a built-in group, evaluated for instance 0.
+static vs_real vss_tab (int group, vs_real x)
+{
+  return vss_table_eval(groups[group]->table[0], 0.0, x, 0);
+}
+
+static vs_real vss_tab_2d (int group, vs_real col, vs_real row, int inst)
+{
+  return vss_table_eval(groups[group]->table[0], col, row, inst);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Road, sampled every road_ds from the curvature table.
+---------------------------------------------------------------------------- */
+static void vss_build_road (void)
+{
+  int i;
+  vs_real k0, k1, yaw_mid;
+
+  free (road_sx);
+  free (road_sy);
+  free (road_syaw);
+  if (road_ds <= 0.0) road_ds = 1.0;
+  road_n = (int)ceil(road_length/road_ds) + 1;
+  if (road_n < 2) road_n = 2;
+  road_sx = (vs_real *)malloc(road_n*sizeof(vs_real));
+  road_sy = (vs_real *)malloc(road_n*sizeof(vs_real));
+  road_syaw = (vs_real *)malloc(road_n*sizeof(vs_real));
+  road_sx[0] = road_x0;
+  road_sy[0] = road_y0;
+  road_syaw[0] = road_yaw0;
+  k0 = vss_tab(tab_road_curv, 0.0);
+  for (i = 1; i < road_n; i++)
+    {
+    k1 = vss_tab(tab_road_curv, i*road_ds);
+    road_syaw[i] = road_syaw[i - 1] + 0.5*(k0 + k1)*road_ds;
+    yaw_mid = 0.5*(road_syaw[i - 1] + road_syaw[i]);
+    road_sx[i] = road_sx[i - 1] + road_ds*cos(yaw_mid);
+    road_sy[i] = road_sy[i - 1] + road_ds*sin(yaw_mid);
+    k0 = k1;
+    }
+  memset (road_hint, 0, sizeof(road_hint));
+}
+
+static int vss_road_inst (vs_real inst)
+{
+  int i = (int)inst;
+  return i < 0 || i >= VSS_MAX_INST ? 0 : i;
+}
+
+static vs_real vss_s_loop (vs_real s)
+{
+  vs_real len = (road_n - 1)*road_ds;
+
+  if (!opt_road_loop || len <= 0.0) return s;
+  return fmod(fmod(s, len) + len, len);
+}
+
+// Segment of station s and the fraction along it (may be outside 0-1 past
+// the ends of the road).
+static int vss_road_seg (vs_real s, vs_real *u)
+{
+  int j;
+
+  s = vss_s_loop(s);
+  j = (int)floor(s/road_ds);
+  if (j < 0) j = 0;
+  if (j > road_n - 2) j = road_n - 2;
+  *u = s/road_ds - j;
+  return j;
+}
+
+static void vss_road_xy (vs_real s, vs_real l, vs_real *x, vs_real *y, vs_real *yaw)
+{
+  vs_real u, a;
+  int j = vss_road_seg(s, &u);
+
+  a = road_syaw[j] + u*(road_syaw[j + 1] - road_syaw[j]);
+  if (x) *x = road_sx[j] + u*(road_sx[j + 1] - road_sx[j]) - l*sin(a);
+  if (y) *y = road_sy[j] + u*(road_sy[j + 1] - road_sy[j]) + l*cos(a);
+  if (yaw) *yaw = a;
+}
+
+/* Station and lateral position (left > 0) of a point. The search walks from
+   the segment found last time for the same instance, so following a
+   vehicle costs a step or two; if the point is far from it, every sample is
+   checked. */
+static void vss_road_sl (vs_real x, vs_real y, int inst, vs_real *s, vs_real *l)
+{
+  int j = road_hint[inst], k, i;
+  vs_real dx, dy, px, py, u = 0.0, d, best;
+
+  if (j < 0 || j > road_n - 2) j = 0;
+  for (k = 0; k < 64; k++)
+    {
+    dx = road_sx[j + 1] - road_sx[j];
+    dy = road_sy[j + 1] - road_sy[j];
+    px = x - road_sx[j];
+    py = y - road_sy[j];
+    u = (px*dx + py*dy)/(road_ds*road_ds);
+    if (u < 0.0 && j > 0) j--;
+    else if (u > 1.0 && j < road_n - 2) j++;
+    else break;
+    }
+
+  // lost: nearest sample, then settle on its segment
+  if (k == 64 || fabs(px*dy - py*dx)/road_ds > 10.0*road_width + 10.0*road_ds)
+    {
+    best = 1e300;
+    for (i = 0; i < road_n; i++)
+      {
+      d = (x - road_sx[i])*(x - road_sx[i]) + (y - road_sy[i])*(y - road_sy[i]);
+      if (d < best)
+        {
+        best = d;
+        j = i;
+        }
+      }
+    if (j > road_n - 2) j = road_n - 2;
+    for (k = 0; k < 2; k++)
+      {
+      dx = road_sx[j + 1] - road_sx[j];
+      dy = road_sy[j + 1] - road_sy[j];
+      px = x - road_sx[j];
+      py = y - road_sy[j];
+      u = (px*dx + py*dy)/(road_ds*road_ds);
+      if (u < 0.0 && j > 0) j--;
+      else if (u > 1.0 && j < road_n - 2) j++;
+      else break;
+      }
+    }
+
+  road_hint[inst] = j;
+  if (s) *s = (j + u)*road_ds;
+  if (l) *l = (dx*py - dy*px)/road_ds;
+}
+
+static vs_real vss_road_z_sl (vs_real s, vs_real l, int inst)
+{
+  return vss_tab_2d(tab_road_z, l, vss_s_loop(s), inst);
+}
+
+static void vss_road_slopes (vs_real s, vs_real l, int inst, vs_real *dzds, vs_real *dzdl)
+{
+  const vs_real h = 0.05;
+
+  if (dzds) *dzds = (vss_road_z_sl(s + h, l, inst) - vss_road_z_sl(s - h, l, inst))/(2.0*h);
+  if (dzdl) *dzdl = (vss_road_z_sl(s, l + h, inst) - vss_road_z_sl(s, l - h, inst))/(2.0*h);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Reading simfiles and parsfiles.
+---------------------------------------------------------------------------- */
+static char *vss_trim (char *s)
+{
+  char *end;
+
+  while (isspace((unsigned char)*s)) s++;
+  end = s + strlen(s);
+  while (end > s && isspace((unsigned char)end[-1])) *--end = 0;
+  return s;
+}
+
+// Numbers on a line, separated by spaces, tabs or commas. Return the count.
+static int vss_numbers (char *line, vs_real **values, int *max)
+{
+  int n = 0;
+  char *p = line, *end;
+  vs_real v;
+
+  for (;;)
+    {
+    while (*p == ' ' || *p == '\t' || *p == ',') p++;
+    if (*p == 0 || *p == '\n' || *p == '\r') break;
+    v = strtod(p, &end);
+    if (end == p) break;
+    *values = (vs_real *)vss_grow(*values, max, n + 1, sizeof(vs_real));
+    (*values)[n++] = v;
+    p = end;
+    }
+  return n;
+}
+
+static vs_table_type vss_table_type (const char *word, vs_bool carpet)
+{
+  if (carpet)
+    {
+    if (vss_same(word, "STEP")) return VS_TAB_2D_STEP;
+    return vss_same(word, "SPLINE") ? VS_TAB_2D_SPLINE : VS_TAB_2D;
+    }
+  if (vss_same(word, "LINEAR_FLAT")) return VS_TAB_LIN_FLAT;
+  if (vss_same(word, "LINEAR_LOOP")) return VS_TAB_LIN_LOOP;
+  if (vss_same(word, "STEP")) return VS_TAB_STEP;
+  if (vss_same(word, "SPLINE")) return VS_SPLINE;
+  if (vss_same(word, "SPLINE_FLAT")) return VS_SPLINE_FLAT;
+  if (vss_same(word, "SPLINE_LOOP")) return VS_SPLINE_LOOP;
+  return VS_TAB_LIN;
+}
+
+/* Data lines of a table up to ENDTABLE, from the open parsfile. 1D: "x y"
+   lines. 2D: the column values, then lines with a row value and one output
+   per column. */
+static void vss_read_table_data (vs_table *tab, vs_table_type type, const char *file)
+{
+  char line[VSS_MAX_CHARS], *p;
+  vs_real *v = NULL, *xs = NULL, *ys = NULL, *cols = NULL, *f = NULL;
+  int max_v = 0, max_x = 0, max_y = 0, max_f = 0, n, nx = 0, ny = 0, i, j;
+  vs_bool carpet = type >= VS_TAB_2D;
+
+  while (fgets(line, sizeof(line), read_fp))
+    {
+    p = vss_trim(line);
+    if (*p == 0 || *p == '#' || *p == '!') continue;
+    if (vss_same(p, "ENDTABLE") || !strncmp(p, "ENDTABLE", 8)) break;
+    n = vss_numbers(p, &v, &max_v);
+    if (n == 0)
+      {
+      vss_error ("Line \"%s\" in table data of file %s is not numbers.\n", p, file);
+      break;
+      }
+    if (!carpet)
+      {
+      if (n < 2) continue;
+      xs = (vs_real *)vss_grow(xs, &max_x, nx + 1, sizeof(vs_real));
+      ys = (vs_real *)vss_grow(ys, &max_y, nx + 1, sizeof(vs_real));
+      xs[nx] = v[0];
+      ys[nx++] = v[1];
+      }
+    else if (cols == NULL)
+      {
+      ny = n;
+      cols = (vs_real *)malloc(n*sizeof(vs_real));
+      memcpy (cols, v, n*sizeof(vs_real));
+      }
+    else
+      {
+      xs = (vs_real *)vss_grow(xs, &max_x, nx + 1, sizeof(vs_real));
+      f = (vs_real *)vss_grow(f, &max_f, (nx + 1)*ny, sizeof(vs_real));
+      xs[nx] = v[0];
+      for (j = 0; j < ny; j++) f[nx*ny + j] = j + 1 < n ? v[j + 1] : 0.0;
+      nx++;
+      }
+    }
+
+  if (nx > 0 && (!carpet || ny > 0))
+    {
+    vs_malloc_table_data (tab, type, nx, carpet ? ny : 0);
+    memcpy (tab->x, xs, nx*sizeof(vs_real));
+    if (carpet)
+      {
+      memcpy (tab->y, cols, ny*sizeof(vs_real));
+      for (i = 0; i < nx; i++) memcpy (tab->fxy[i], f + i*ny, ny*sizeof(vs_real));
+      }
+    else
+      {
+      memcpy (tab->y, ys, nx*sizeof(vs_real));
+      if (type == VS_SPLINE || type == VS_SPLINE_FLAT || type == VS_SPLINE_LOOP)
+        vss_spline_slopes (tab);
+      }
+    }
+  else if (!error_flag)
+    vss_error ("A table in file %s has no data.\n", file);
+
+  free (v);
+  free (xs);
+  free (ys);
+  free (cols);
+  free (f);
+}
+
+static int vss_keyword_is (const char *key, const char *keyword)
+{
+  return keyword && keyword[0] && vss_same(key, keyword);
+}
+
+/* Table keywords: key is upper case without its (index). Return TRUE if key
+   belongs to a table group. */
+static vs_bool vss_scan_table (const char *key, int index, char *rest, const char *file)
+{
+  int i, itab;
+  vs_tab_group *g;
+  vs_table *tab;
+  vs_real v = atof(rest);
+
+  for (i = 0; i < n_groups; i++)
+    {
+    g = groups[i];
+    itab = index > 0 ? index - 1 : 0;
+    if (!(vss_keyword_is(key, g->table_keyword) || vss_keyword_is(key, g->carpet_keyword) ||
+          vss_keyword_is(key, g->gain_keyword) || vss_keyword_is(key, g->offset_keyword) ||
+          vss_keyword_is(key, g->constant_keyword) ||
+          vss_keyword_is(key, g->coefficient_keyword) ||
+          vss_keyword_is(key, g->start_x_keyword) || vss_keyword_is(key, g->scale_x_keyword)))
+      continue;
+    if (itab >= g->ntab)
+      {
+      vss_error ("Index %d of keyword %s in file %s is more than the %d tables.\n",
+                 index, key, file, g->ntab);
+      return TRUE;
+      }
+    tab = g->table[itab];
+
+    if (vss_keyword_is(key, g->table_keyword))
+      vss_read_table_data (tab, vss_table_type(vss_trim(rest), FALSE), file);
+    else if (vss_keyword_is(key, g->carpet_keyword))
+      vss_read_table_data (tab, vss_table_type(vss_trim(rest), TRUE), file);
+    else if (vss_keyword_is(key, g->gain_keyword)) tab->gain = v;
+    else if (vss_keyword_is(key, g->offset_keyword)) tab->offset = v;
+    else if (vss_keyword_is(key, g->start_x_keyword)) tab->start_x = v;
+    else if (vss_keyword_is(key, g->scale_x_keyword)) tab->scale_x = v != 0.0 ? v : 1.0;
+    else if (vss_keyword_is(key, g->constant_keyword))
+      {
+      vss_free_table_data (tab);
+      tab->type = VS_TAB_CONST;
+      tab->constant = v;
+      }
+    else
+      {
+      vss_free_table_data (tab);
+      tab->type = VS_TAB_COEF;
+      tab->coefficient = v;
+      }
+    if (i == tab_speed_target) speed_target_given = TRUE;
+    return TRUE;
+    }
+  return FALSE;
+}
+
+static void vss_read_file (const char *path, int depth);
+
+// Choose an import or export by name; the first one given replaces the
+// default set. The names are checked after all files are read, when the
+// outputs that depend on parameters exist.
+static void vss_choose_io (const char *name, vs_bool import)
+{
+  char ***names = import ? &import_names : &export_names;
+  int *n = import ? &n_imports : &n_exports, i;
+  vs_bool *given = import ? &imports_given : &exports_given;
+
+  if (!*given)
+    {
+    for (i = 0; i < *n; i++) free((*names)[i]);
+    *n = 0;
+    }
+  *given = TRUE;
+  *names = (char **)realloc(*names, (*n + 1)*sizeof(char *));
+  (*names)[*n] = vss_strdup(name);
+  vss_upper ((*names)[(*n)++]);
+}
+
+// Symbol ids of the chosen imports and exports.
+static void vss_resolve_io (void)
+{
+  static const char *def_imports[] = {"IMP_STEER_SW", "IMP_THROTTLE", "IMP_BRAKE"};
+  static const char *def_exports[] =
+    {"XO", "YO", "YAW", "VX", "AY", "STEER_SW", "STATION", "LAT"};
+  int i, k, id;
+
+  if (!imports_given)
+    for (i = 0; i < 3; i++) vss_choose_io (def_imports[i], TRUE);
+  if (!exports_given)
+    for (i = 0; i < 8; i++) vss_choose_io (def_exports[i], FALSE);
+
+  for (k = 0; k < 2; k++)
+    {
+    int n = k ? n_exports : n_imports, **ids = k ? &exports : &imports;
+    char **names = k ? export_names : import_names;
+
+    *ids = (int *)realloc(*ids, (n + 1)*sizeof(int));
+    for (i = 0; i < n; i++)
+      {
+      id = vss_find_sym(names[i]);
+      if (id < 0 || syms[id].kind != (k ? VSS_OUT : VSS_IMP))
+        {
+        vss_error ("%s \"%s\" is not a known %s.\n", k ? "EXPORT" : "IMPORT", names[i],
+                   k ? "output variable" : "import");
+        id = -1;
+        }
+      (*ids)[i] = id;
+      }
+    }
+  io_packed = FALSE;
+}
+
+// Round up to a multiple of 64 bytes.
+static size_t vss_align64 (size_t n)
+{
+  return (n + 63) & ~(size_t)63;
+}
+
+// Variables and gains of the imports and exports in four arrays, each on a
+// 64-byte boundary of one block, so a copy reads no symbol and is a
+// multiply (divide for imports) per channel. Packed again when the units or
+// variables of symbols change.
+static void vss_pack_io (void)
+{
+  size_t np_i = vss_align64((n_imports + 1)*sizeof(vs_real *)),
+         np_e = vss_align64((n_exports + 1)*sizeof(vs_real *)),
+         ng_i = vss_align64((n_imports + 2)*sizeof(vs_real)),
+         ng_e = vss_align64((n_exports + 2)*sizeof(vs_real));
+  char *p;
+  int i;
+
+  free (io_block);
+  io_block = malloc(np_i + np_e + ng_i + ng_e + 64);
+  p = (char *)io_block + (64 - (size_t)io_block % 64) % 64;
+  import_ptr = (vs_real **)p;
+  export_ptr = (vs_real **)(p + np_i);
+  import_gain = (vs_real *)(p + np_i + np_e);
+  export_gain = (vs_real *)(p + np_i + np_e + ng_i);
+
+  for (i = 0; i < n_imports; i++)
+    {
+    import_ptr[i] = imports[i] >= 0 ? syms[imports[i]].real : &io_sink;
+    import_gain[i] = imports[i] >= 0 ? syms[imports[i]].gain : 1.0;
+    }
+  for (i = 0; i < n_exports; i++)
+    {
+    export_ptr[i] = exports[i] >= 0 ? syms[exports[i]].real : &io_zero;
+    export_gain[i] = exports[i] >= 0 ? syms[exports[i]].gain : 1.0;
+    }
+  io_packed = TRUE;
+}
+
+// One line of a simfile or parsfile. Return FALSE at END.
+static vs_bool vss_read_line (char *line, const char *file, int depth)
+{
+  char *p = vss_trim(line), *rest, *paren, key[VSS_MAX_CHARS], path[FILENAME_MAX];
+  int id, index = 0;
+
+  if (*p == 0 || *p == '#' || *p == '!') return TRUE;
+  rest = p;
+  while (*rest && !isspace((unsigned char)*rest)) rest++;
+  if (*rest) *rest++ = 0;
+  rest = vss_trim(rest);
+  strcpy (key, p);
+  vss_upper (key);
+  if (!strcmp(key, "END")) return FALSE;
+
+  // installed scan functions see every line first
+  if (scan_func && scan_func(key, rest)) return TRUE;
+  if (scan2_func && scan2_func(key, rest, scan2_data)) return TRUE;
+
+  if (!strcmp(key, "PARSFILE") || !strcmp(key, "INPUT"))
+    {
+    vss_resolve (rest, file, path);
+    if (!strcmp(key, "INPUT")) strcpy (infile_name, path);
+    vss_read_file (path, depth + 1);
+    }
+  else if (!strcmp(key, "ECHO")) strcpy (echofile_name, rest);
+  else if (!strcmp(key, "FINAL")) strcpy (endfile_name, rest);
+  else if (!strcmp(key, "ERDFILE")) strcpy (erdfile_name, rest);
+  else if (!strcmp(key, "DATADIR")) strcpy (datadir, rest);
+  else if (!strcmp(key, "DLLFILE") || !strcmp(key, "PROGDIR") ||
+           !strcmp(key, "PRODUCT_ID") || !strcmp(key, "VEHICLE_CODE")) ;
+  else if (!strcmp(key, "LOGFILE"))
+    {
+    strcpy (logfile_name, rest);
+    if (log_fp) fclose(log_fp);
+    log_fp = fopen(logfile_name, "w");
+    }
+  else if (!strcmp(key, "IMPORT")) vss_choose_io (rest, TRUE);
+  else if (!strcmp(key, "EXPORT")) vss_choose_io (rest, FALSE);
+  else
+    {
+    if ((paren = strchr(key, '(')) != NULL)
+      {
+      index = atoi(paren + 1);
+      *paren = 0;
+      }
+    if (vss_scan_table(key, index, rest, file)) return TRUE;
+    id = vss_find_sym(key);
+    if (id >= 0 && (syms[id].kind == VSS_PAR || syms[id].kind == VSS_PAR_INT ||
+                    syms[id].kind == VSS_VAR))
+      vss_set_sym_value (id, atof(rest));
+    else
+      vss_log ("Warning: keyword %s in file %s is not recognized.\n", key, file);
+    }
+  return TRUE;
+}
+
+static void vss_read_file (const char *path, int depth)
+{
+  char line[VSS_MAX_CHARS];
+  FILE *fp, *parent = read_fp;
+
+  if (depth > 32)
+    {
+    vss_error ("Parsfiles are nested too deeply at %s.\n", path);
+    return;
+    }
+  if ((fp = fopen(path, "r")) == NULL)
+    {
+    vss_error ("Could not open the file \"%s\".\n", path);
+    return;
+    }
+  vss_log ("Reading %s\n", path);
+  read_fp = fp;
+  while (!error_flag && fgets(line, sizeof(line), fp))
+    if (!vss_read_line(line, path, depth)) break;
+  fclose (fp);
+  read_fp = parent;
+}
+
+
+/* ----------------------------------------------------------------------------
+   The model.
+---------------------------------------------------------------------------- */
+enum {VSS_X, VSS_Y, VSS_YAW, VSS_VX, VSS_VY, VSS_AVZ, VSS_DELTA, VSS_N_BASE};
+#define VSS_N_EXTRA 2 // odometer and the steer command
+#define VSS_N_SYS   4 // system parameters, the first keywords defined
+
+static volatile vs_real vss_sink; // keeps the WORK loop
+
+static vs_real vss_unit_gain (const char *desc)
+{
+  static const struct {const char *desc; vs_real gain;} builtin[] =
+    {
+    {"deg", VSS_DEG}, {"deg/s", VSS_DEG}, {"km/h", 3.6}, {"g", 1.0/VSS_G},
+    {"mm", 1000.0}, {"rpm", 30.0/PI}
+    };
+  int i;
+
+  for (i = n_units - 1; i >= 0; i--)
+    if (!strcmp(units[i].desc, desc)) return units[i].gain;
+  for (i = 0; i < (int)(sizeof(builtin)/sizeof(builtin[0])); i++)
+    if (!strcmp(builtin[i].desc, desc)) return builtin[i].gain;
+  return 1.0;
+}
+
+static int vss_table (const char *root, int ninst, vs_real constant)
+{
+  int index = vs_define_table((char *)root, 1, ninst);
+
+  groups[index]->table[0]->constant = constant;
+  return index;
+}
+
+static void vss_par (const char *keyword, const char *desc, vs_real *real,
+                     const char *unit, vs_real value)
+{
+  vss_set_sym_value (vss_add_sym(keyword, desc, unit, vss_unit_gain(unit), VSS_PAR,
+                                 real, NULL), value);
+}
+
+static void vss_par_int (const char *keyword, const char *desc, int *integer, int value)
+{
+  *integer = value;
+  vss_add_sym (keyword, desc, "", 1.0, VSS_PAR_INT, NULL, integer);
+}
+
+static void vss_out (const char *name, const char *desc, vs_real *real, const char *unit)
+{
+  vss_add_sym (name, desc, unit, vss_unit_gain(unit), VSS_OUT, real, NULL);
+}
+
+static void vss_imp (const char *name, const char *desc, vs_real *real, const char *unit)
+{
+  vss_add_sym (name, desc, unit, vss_unit_gain(unit), VSS_IMP, real, NULL);
+}
+
+// Keywords of the built-in model, with default values in user units.
+static void vss_define_model (void)
+{
+  vss_par ("TSTART", "Time at the start of the run", &tstart, "s", 0.0);
+  vss_par ("TSTOP", "Time at the end of the run", &tstop, "s", 20.0);
+  vss_par ("TSTEP", "Time step", &tstep, "s", 0.001);
+  vss_par ("SAVE_DT", "Interval between saved states", &save_dt, "s", 0.1);
+  vss_par ("SPEED", "Initial (and target) speed", &speed, "km/h", 60.0);
+  vss_par ("M_TOTAL", "Vehicle mass", &mass, "kg", 1500.0);
+  vss_par ("IZZ", "Yaw moment of inertia", &izz, "kg-m2", 2500.0);
+  vss_par ("LX_FRONT", "Distance from the CG to the front axle", &lf, "m", 1.2);
+  vss_par ("LX_REAR", "Distance from the CG to the rear axle", &lr, "m", 1.5);
+  vss_par ("CF", "Cornering stiffness of the front axle", &cf, "N/rad", 80000.0);
+  vss_par ("CR", "Cornering stiffness of the rear axle", &cr, "N/rad", 90000.0);
+  vss_par ("STEER_RATIO", "Steering wheel angle / road wheel angle", &steer_ratio, "-", 16.0);
+  vss_par ("STEER_TAU", "Time constant of the steering actuator", &steer_tau, "s", 0.05);
+  vss_par ("PREVIEW", "Preview time of the driver", &preview, "s", 1.0);
+  vss_par ("K_SPEED", "Gain of the speed controller", &k_speed, "1/s", 1.0);
+  vss_par ("A_MAX", "Largest acceleration command", &a_max, "g", 0.4);
+  vss_par ("B_MAX", "Largest braking command", &b_max, "g", 0.8);
+  vss_par ("DRAG", "Drag deceleration / speed squared", &drag, "1/m", 0.0004);
+  vss_par ("ROAD_LENGTH", "Length of the road", &road_length, "m", 2000.0);
+  vss_par ("ROAD_DS", "Interval between road samples", &road_ds, "m", 1.0);
+  vss_par ("ROAD_X0", "X coordinate of the start of the road", &road_x0, "m", 0.0);
+  vss_par ("ROAD_Y0", "Y coordinate of the start of the road", &road_y0, "m", 0.0);
+  vss_par ("ROAD_YAW0", "Heading of the start of the road", &road_yaw0, "deg", 0.0);
+  vss_par ("ROAD_WIDTH", "Width between the road edges", &road_width, "m", 7.2);
+  vss_par ("N_OSC", "Number of extra filter states", &n_osc_par, "-", 0.0);
+  vss_par ("WORK", "Extra multiply-adds per derivative evaluation", &work_par, "-", 0.0);
+  vss_par ("IPRINT", "Time steps per ERD record", &iprint_par, "-", 1.0);
+  vss_par_int ("OPT_DRIVER", "Steer with the preview driver (0: import only)", &opt_driver, 1);
+  vss_par_int ("OPT_SPEED", "Use the speed controller (0: imports only)", &opt_speed, 1);
+  vss_par_int ("OPT_ROAD_LOOP", "The road is a closed loop", &opt_road_loop, 0);
+  vss_par_int ("OPT_PAUSE", "Pause at the end of the run", &opt_pause, 0);
+  vss_par_int ("OPT_OSC_IMPORTS", "Define the filter imports IMP_OSC_i", &opt_osc_imports, 0);
+
+  vss_imp ("IMP_STEER_SW", "Steering wheel angle added to the driver", &imp_steer, "deg");
+  vss_imp ("IMP_THROTTLE", "Acceleration added to the command", &imp_throttle, "g");
+  vss_imp ("IMP_BRAKE", "Deceleration added to the command", &imp_brake, "g");
+
+  vss_out ("XO", "X coordinate of the CG", &out_x, "m");
+  vss_out ("YO", "Y coordinate of the CG", &out_y, "m");
+  vss_out ("ZO", "Road elevation under the CG", &out_z, "m");
+  vss_out ("YAW", "Yaw angle", &out_yaw, "deg");
+  vss_out ("VX", "Longitudinal speed", &out_vx, "km/h");
+  vss_out ("VY", "Lateral speed", &out_vy, "km/h");
+  vss_out ("AVZ", "Yaw rate", &out_avz, "deg/s");
+  vss_out ("AY", "Lateral acceleration", &out_ay, "g");
+  vss_out ("AX", "Longitudinal acceleration", &out_ax, "g");
+  vss_out ("AX_CMD", "Acceleration command", &out_ax_cmd, "g");
+  vss_out ("STEER_SW", "Steering wheel angle", &out_steer, "deg");
+  vss_out ("STATION", "Station of the CG on the road", &out_station, "m");
+  vss_out ("LAT", "Lateral position of the CG on the road", &out_lat, "m");
+  vss_out ("MU_F", "Road friction under the front axle", &out_mu_f, "-");
+  vss_out ("MU_R", "Road friction under the rear axle", &out_mu_r, "-");
+
+  tab_road_curv = vss_table("ROAD_CURV", VSS_MAX_INST, 0.0);
+  tab_road_z = vss_table("ROAD_Z", VSS_MAX_INST, 0.0);
+  tab_road_mu = vss_table("ROAD_MU", VSS_MAX_INST, 0.85);
+  tab_target_l = vss_table("TARGET_L", 1, 0.0);
+  tab_speed_target = vss_table("SPEED_TARGET", 1, 60.0);
+  speed_target_given = FALSE;
+}
+
+// Outputs OSC_1 ... and, with OPT_OSC_IMPORTS, imports IMP_OSC_1 ... after
+// N_OSC is known.
+static void vss_define_osc (void)
+{
+  char name[32], desc[64];
+  int i;
+
+  n_osc = (int)n_osc_par;
+  if (n_osc < 0) n_osc = 0;
+  free (out_osc);
+  free (imp_osc);
+  out_osc = (vs_real *)calloc(n_osc + 1, sizeof(vs_real));
+  imp_osc = (vs_real *)calloc(n_osc + 1, sizeof(vs_real));
+  for (i = 0; i < n_osc; i++)
+    {
+    sprintf (name, "OSC_%d", i + 1);
+    sprintf (desc, "Lateral acceleration filtered with tau %g s", 0.05*(i + 1));
+    vss_out (name, desc, &out_osc[i], "g");
+    if (!opt_osc_imports) continue;
+    sprintf (name, "IMP_OSC_%d", i + 1);
+    sprintf (desc, "Added to the input of filter %d", i + 1);
+    vss_imp (name, desc, &imp_osc[i], "g");
+    }
+}
+
+// Derivatives of the differential states y at the current driver commands.
+static void vss_derivs (const vs_real *y, vs_real *dy)
+{
+  vs_real vx = y[VSS_VX], vy = y[VSS_VY], r = y[VSS_AVZ], delta = y[VSS_DELTA],
+          c = cos(y[VSS_YAW]), sn = sin(y[VSS_YAW]), vx_eff = vx > 1.0 ? vx : 1.0,
+          wb = lf + lr, fzf = mass*VSS_G*lr/wb, fzr = mass*VSS_G*lf/wb,
+          af, ar, fyf, fyr, ay, acc = 0.0, s;
+  int i;
+
+  vss_road_sl (y[VSS_X], y[VSS_Y], 0, &s, NULL);
+  mu_f = vss_table_eval(groups[tab_road_mu]->table[0], 0.0, vss_s_loop(s + lf), 1);
+  mu_r = vss_table_eval(groups[tab_road_mu]->table[0], 0.0, vss_s_loop(s - lr), 2);
+  if (mu_f < 0.01) mu_f = 0.01;
+  if (mu_r < 0.01) mu_r = 0.01;
+
+  af = delta - atan2(vy + lf*r, vx_eff);
+  ar = -atan2(vy - lr*r, vx_eff);
+  fyf = mu_f*fzf*tanh(cf*af/(mu_f*fzf));
+  fyr = mu_r*fzr*tanh(cr*ar/(mu_r*fzr));
+
+  dy[VSS_X] = vx*c - vy*sn;
+  dy[VSS_Y] = vx*sn + vy*c;
+  dy[VSS_YAW] = r;
+  dy[VSS_VX] = out_ax_cmd - drag*vx*fabs(vx) + vy*r - fyf*sin(delta)/mass;
+  dy[VSS_VY] = (fyf*cos(delta) + fyr)/mass - vx*r;
+  dy[VSS_AVZ] = (lf*fyf*cos(delta) - lr*fyr)/izz;
+  dy[VSS_DELTA] = (delta_cmd - delta)/steer_tau;
+  ay = dy[VSS_VY] + vx*r;
+  for (i = 0; i < n_osc; i++)
+    dy[VSS_N_BASE + i] = (ay + imp_osc[i] - y[VSS_N_BASE + i])/(0.05*(i + 1));
+
+  for (i = 0; i < work; i++) acc = acc*0.999999 + 1e-9*i;
+  if (work) vss_sink = acc;
+}
+
+// Preview driver and speed controller, once per step.
+static void vss_driver (void)
+{
+  vs_real s, l, ld, tx, ty, a, v_target, ax;
+
+  vss_road_sl (state[VSS_X], state[VSS_Y], 0, &s, &l);
+  out_station = s;
+  out_lat = l;
+
+  ld = state[VSS_VX]*preview;
+  if (ld < 2.0) ld = 2.0;
+  vss_road_xy (s + ld, vss_tab(tab_target_l, vss_s_loop(s + ld)), &tx, &ty, NULL);
+  a = atan2(ty - state[VSS_Y], tx - state[VSS_X]) - state[VSS_YAW];
+  a = atan2(sin(a), cos(a));
+  delta_cmd = imp_steer/steer_ratio;
+  if (opt_driver) delta_cmd += atan(2.0*(lf + lr)*sin(a)/ld);
+
+  v_target = speed_target_given ? vss_tab(tab_speed_target, vss_s_loop(s))/3.6 : speed;
+  ax = (opt_speed ? k_speed*(v_target - state[VSS_VX]) : 0.0) + imp_throttle - imp_brake;
+  if (ax > a_max) ax = a_max;
+  if (ax < -b_max) ax = -b_max;
+  out_ax_cmd = ax;
+}
+
+static void vss_outputs (void)
+{
+  int i;
+
+  vss_derivs (state, deriv);
+  out_x = state[VSS_X];
+  out_y = state[VSS_Y];
+  out_yaw = state[VSS_YAW];
+  out_vx = state[VSS_VX];
+  out_vy = state[VSS_VY];
+  out_avz = state[VSS_AVZ];
+  out_ay = deriv[VSS_VY] + state[VSS_VX]*state[VSS_AVZ];
+  out_ax = deriv[VSS_VX] - state[VSS_VY]*state[VSS_AVZ];
+  out_steer = state[VSS_DELTA]*steer_ratio;
+  vss_road_sl (out_x, out_y, 0, &out_station, &out_lat);
+  out_z = vss_road_z_sl(out_station, out_lat, 0);
+  out_mu_f = mu_f;
+  out_mu_r = mu_r;
+  for (i = 0; i < n_osc; i++) out_osc[i] = state[VSS_N_BASE + i];
+}
+
+// One step of Heun's method.
+static void vss_step (vs_real h)
+{
+  int i;
+
+  memcpy (state0, state, n_state*sizeof(vs_real));
+  vss_derivs (state0, k1);
+  for (i = 0; i < n_state; i++) state[i] = state0[i] + h*k1[i];
+  vss_derivs (state, deriv);
+  for (i = 0; i < n_state; i++) state[i] = state0[i] + 0.5*h*(k1[i] + deriv[i]);
+  odometer += h*0.5*(state0[VSS_VX] + state[VSS_VX]);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Files written by the solver.
+---------------------------------------------------------------------------- */
+static const char *vss_type_word (vs_table_type type)
+{
+  switch (type)
+    {
+    case VS_TAB_LIN_FLAT: return "LINEAR_FLAT";
+    case VS_TAB_LIN_LOOP: return "LINEAR_LOOP";
+    case VS_TAB_STEP: case VS_TAB_2D_STEP: return "STEP";
+    case VS_SPLINE: case VS_TAB_2D_SPLINE: return "SPLINE";
+    case VS_SPLINE_FLAT: return "SPLINE_FLAT";
+    case VS_SPLINE_LOOP: return "SPLINE_LOOP";
+    default: return "LINEAR";
+    }
+}
+
+// Table data as parsfile lines, so an echo file can be read back.
+static void vss_echo_table (FILE *fp, vs_tab_group *g, int itab)
+{
+  vs_table *tab = g->table[itab];
+  char index[16];
+  int i, j;
+
+  index[0] = 0;
+  if (g->ntab > 1) sprintf(index, "(%d)", itab + 1);
+  if (tab->type == VS_TAB_CONST)
+    {
+    if (g->constant_keyword)
+      fprintf (fp, "%s%s %.9g\n", g->constant_keyword, index, tab->constant);
+    return;
+    }
+  if (tab->type == VS_TAB_COEF)
+    {
+    if (g->coefficient_keyword)
+      fprintf (fp, "%s%s %.9g\n", g->coefficient_keyword, index, tab->coefficient);
+    }
+  else if (tab->type >= VS_TAB_2D && g->carpet_keyword)
+    {
+    fprintf (fp, "%s%s %s\n", g->carpet_keyword, index, vss_type_word(tab->type));
+    for (j = 0; j < tab->ny; j++) fprintf (fp, j ? ", %.9g" : "%.9g", tab->y[j]);
+    fprintf (fp, "\n");
+    for (i = 0; i < tab->nx; i++)
+      {
+      fprintf (fp, "%.9g", tab->x[i]);
+      for (j = 0; j < tab->ny; j++) fprintf (fp, ", %.9g", tab->fxy[i][j]);
+      fprintf (fp, "\n");
+      }
+    fprintf (fp, "ENDTABLE\n");
+    }
+  else if (g->table_keyword)
+    {
+    fprintf (fp, "%s%s %s\n", g->table_keyword, index, vss_type_word(tab->type));
+    for (i = 0; i < tab->nx; i++) fprintf (fp, "%.9g, %.9g\n", tab->x[i], tab->y[i]);
+    fprintf (fp, "ENDTABLE\n");
+    }
+  if (tab->gain != 1.0 && g->gain_keyword)
+    fprintf (fp, "%s%s %.9g\n", g->gain_keyword, index, tab->gain);
+  if (tab->offset != 0.0 && g->offset_keyword)
+    fprintf (fp, "%s%s %.9g\n", g->offset_keyword, index, tab->offset);
+  if (tab->start_x != 0.0 && g->start_x_keyword)
+    fprintf (fp, "%s%s %.9g\n", g->start_x_keyword, index, tab->start_x);
+  if (tab->scale_x != 1.0 && g->scale_x_keyword)
+    fprintf (fp, "%s%s %.9g\n", g->scale_x_keyword, index, tab->scale_x);
+}
+
+static void vss_echo_calls (vs_ext_loc where, void (*ext_echo) (vs_ext_loc))
+{
+  if (echo_func) echo_func (where);
+  if (echo2_func) echo2_func (where, echo2_data);
+  if (init_echo) init_echo (where);
+  if (ext_echo && ext_echo != init_echo) ext_echo (where);
+}
+
+/* Echo file (at the start) or end file (at the end): all parameters and
+   tables as a parsfile, with the installed echo functions called at the
+   usual places. */
+static void vss_write_echo (const char *path, vs_real t, void (*ext_echo) (vs_ext_loc))
+{
+  int i, j;
+
+  if (path[0] == 0) return;
+  if ((echo_fp = fopen(path, "w")) == NULL)
+    {
+    vss_error ("Could not write the file \"%s\".\n", path);
+    return;
+    }
+  fprintf (echo_fp, "PARSFILE\n! Stand-in VS solver, time %g s\n! Simfile %s\n\n",
+           t, simfile_name);
+  vss_echo_calls (VS_EXT_ECHO_TOP, ext_echo);
+
+  fprintf (echo_fp, "\n! System parameters\n");
+  for (i = 0; i < VSS_N_SYS && i < n_syms; i++)
+    fprintf (echo_fp, "%-24s %.9g ! %s [%s]\n", syms[i].keyword, vss_sym_value(i),
+             syms[i].desc, syms[i].units);
+  vss_echo_calls (VS_EXT_ECHO_SYPARS, ext_echo);
+
+  fprintf (echo_fp, "\n! Model parameters\n");
+  for (; i < n_syms; i++)
+    if (syms[i].kind == VSS_PAR || syms[i].kind == VSS_PAR_INT || syms[i].kind == VSS_VAR)
+      fprintf (echo_fp, "%-24s %.9g ! %s [%s]\n", syms[i].keyword, vss_sym_value(i),
+               syms[i].desc, syms[i].units);
+  fprintf (echo_fp, "\n! Tables\n");
+  for (i = 0; i < n_groups; i++)
+    if (i != tab_speed_target || speed_target_given)
+      for (j = 0; j < groups[i]->ntab; j++) vss_echo_table (echo_fp, groups[i], j);
+  fprintf (echo_fp, "\n");
+  for (i = 0; i < n_imports; i++) fprintf (echo_fp, "IMPORT %s\n", import_names[i]);
+  for (i = 0; i < n_exports; i++) fprintf (echo_fp, "EXPORT %s\n", export_names[i]);
+  vss_echo_calls (VS_EXT_ECHO_PARS, ext_echo);
+  vss_echo_calls (VS_EXT_ECHO_END, ext_echo);
+  fprintf (echo_fp, "\nEND\n");
+  fclose (echo_fp);
+  echo_fp = NULL;
+}
+
+// Binary records go to the .bin file during the run; the .erd header is
+// written at the end, when the number of records is known.
+static void vss_erd_bin_path (char *bin)
+{
+  char *dot;
+
+  strcpy (bin, erdfile_name);
+  dot = strrchr(bin, '.');
+  if (dot && !strchr(dot, '/') && !strchr(dot, '\\')) strcpy (dot, ".bin");
+  else strcat (bin, ".bin");
+}
+
+static void vss_open_erd (void)
+{
+  char bin[FILENAME_MAX + 8];
+
+  n_records = 0;
+  if (erdfile_name[0] == 0) return;
+  vss_erd_bin_path (bin);
+  if ((erd_fp = fopen(bin, "wb")) == NULL)
+    {
+    vss_error ("Could not write the file \"%s\".\n", bin);
+    return;
+    }
+  free (erd_row);
+  erd_row = (float *)malloc((n_exports + 1)*sizeof(float));
+}
+
+static void vss_write_erd_row (void)
+{
+  int i;
+
+  if (erd_fp == NULL) return;
+  erd_row[0] = (float)t_now;
+  for (i = 0; i < n_exports; i++) erd_row[i + 1] = (float)vss_sym_value(exports[i]);
+  fwrite (erd_row, sizeof(float), n_exports + 1, erd_fp);
+  n_records++;
+}
+
+static void vss_close_erd (void)
+{
+  FILE *fp;
+  int i;
+
+  if (erd_fp == NULL) return;
+  fclose (erd_fp);
+  erd_fp = NULL;
+  if ((fp = fopen(erdfile_name, "w")) == NULL)
+    {
+    vss_error ("Could not write the file \"%s\".\n", erdfile_name);
+    return;
+    }
+  fprintf (fp, "ERDFILEV2.00\n%d 1 %lld 1 4\n", n_exports + 1, n_records);
+  fprintf (fp, "TITLE Stand-in VS solver, %s\n", simfile_name);
+  fprintf (fp, "SHORTNAME Time");
+  for (i = 0; i < n_exports; i++)
+    fprintf (fp, "%s%s", (i + 1) % 10 ? " " : "\nSHORTNAME ", export_names[i]);
+  fprintf (fp, "\nEND\n");
+  fclose (fp);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Run control (chapters 2, 4 and 6).
+---------------------------------------------------------------------------- */
+static void vss_calc (vs_real t, vs_ext_loc where)
+{
+  if (calc_func) calc_func (t, where);
+  if (calc2_func) calc2_func (t, where, calc2_data);
+  if (init_calc) init_calc (t, where);
+}
+
+static void vss_free_model (void)
+{
+  int i, j;
+
+  for (i = 0; i < n_syms; i++)
+    {
+    free (syms[i].keyword);
+    free (syms[i].desc);
+    free (syms[i].units);
+    if (syms[i].own) free(syms[i].real);
+    }
+  free (syms);
+  syms = NULL;
+  n_syms = max_syms = 0;
+  for (i = 0; i < n_units; i++) free(units[i].desc);
+  free (units);
+  units = NULL;
+  n_units = 0;
+  for (i = 0; i < n_groups; i++)
+    if (own_group[i])
+      vss_free_group (groups[i]);
+    else // the caller's group; the data is ours (vs_malloc_table_data)
+      for (j = 0; j < groups[i]->ntab; j++) vss_free_table_data(groups[i]->table[j]);
+  free (groups);
+  free (own_group);
+  groups = NULL;
+  own_group = NULL;
+  n_groups = 0;
+  for (i = 0; i < n_imports; i++) free(import_names[i]);
+  for (i = 0; i < n_exports; i++) free(export_names[i]);
+  free (import_names);
+  free (export_names);
+  free (imports);
+  free (exports);
+  free (io_block);
+  import_names = export_names = NULL;
+  imports = exports = NULL;
+  io_block = NULL;
+  import_ptr = export_ptr = NULL;
+  import_gain = export_gain = NULL;
+  io_packed = FALSE;
+  n_imports = n_exports = 0;
+  imports_given = exports_given = FALSE;
+
+  free (state);
+  free (deriv);
+  free (state0);
+  free (k1);
+  free (out_osc);
+  free (imp_osc);
+  state = deriv = state0 = k1 = out_osc = imp_osc = NULL;
+  n_state = n_osc = 0;
+  vs_free_saved_states ();
+  free (saved);
+  saved = NULL;
+  max_saved = 0;
+  free (road_sx);
+  free (road_sy);
+  free (road_syaw);
+  road_sx = road_sy = road_syaw = NULL;
+  road_n = 0;
+  if (erd_fp) fclose(erd_fp);
+  free (erd_row);
+  erd_fp = NULL;
+  erd_row = NULL;
+  initialized = stop_flag = save_timer = restore_requested = FALSE;
+}
+
+// Read a simfile and the parsfiles it names, after setting the defaults of
+// the model and the installed setdef functions. Return the start time.
+VS_API_EXPORT vs_real vs_setdef_and_read (const char *simfile, void (*ext_setdef) (void),
+                                          int (*ext_scan) (char *, char *))
+{
+  vs_bool (*scan) (char *, char *) = scan_func;
+
+  vss_free_model ();
+  error_msg[0] = output_msg[0] = stop_msg[0] = 0;
+  error_flag = FALSE;
+  strcpy (simfile_name, simfile);
+  infile_name[0] = echofile_name[0] = endfile_name[0] = erdfile_name[0] = 0;
+  logfile_name[0] = datadir[0] = 0;
+  if (log_fp) fclose(log_fp);
+  log_fp = NULL;
+
+  vss_define_model ();
+  if (setdef_func) setdef_func ();
+  if (setdef2_func) setdef2_func (setdef2_data);
+  if (ext_setdef) ext_setdef ();
+
+  if (ext_scan) scan_func = (vs_bool (*) (char *, char *))ext_scan;
+  vss_read_file (simfile, 0);
+  scan_func = scan;
+
+  vss_define_osc ();
+  vss_resolve_io ();
+  return tstart;
+}
+
+VS_API_EXPORT void vs_initialize (vs_real t, void (*ext_calc) (vs_real, vs_ext_loc),
+                                  void (*ext_echo) (vs_ext_loc))
+{
+  if (error_flag) return;
+  init_calc = ext_calc;
+  init_echo = ext_echo;
+  t_now = t;
+  work = (int)work_par;
+  iprint = (int)iprint_par > 0 ? (int)iprint_par : 1;
+  n_state = VSS_N_BASE + n_osc;
+  free (state);
+  free (deriv);
+  free (state0);
+  free (k1);
+  state = (vs_real *)calloc(n_state, sizeof(vs_real));
+  deriv = (vs_real *)calloc(n_state, sizeof(vs_real));
+  state0 = (vs_real *)calloc(n_state, sizeof(vs_real));
+  k1 = (vs_real *)calloc(n_state, sizeof(vs_real));
+
+  vss_calc (t, VS_EXT_EQ_PRE_INIT);
+  vss_build_road ();
+  vss_road_xy (0.0, vss_tab(tab_target_l, 0.0), &state[VSS_X], &state[VSS_Y],
+               &state[VSS_YAW]);
+  state[VSS_VX] = speed;
+  odometer = delta_cmd = 0.0;
+  imp_steer = imp_throttle = imp_brake = 0.0;
+  n_steps = 0;
+  stop_flag = FALSE;
+  vss_calc (t, VS_EXT_EQ_INIT);
+  vss_driver ();
+  vss_outputs ();
+  vss_calc (t, VS_EXT_EQ_INIT2);
+
+  vss_write_echo (echofile_name, t, ext_echo);
+  vss_open_erd ();
+  vss_write_erd_row ();
+  vss_log ("Initialized at t = %g s with %d states\n", t, n_state);
+  initialized = TRUE;
+}
+
+/* Advance one time step: calc functions at EQ_IN, the step, then EQ_OUT and
+   (when the save timer is on and a save is due) EQ_SAVE. Return nonzero
+   when the run is over. */
+VS_API_EXPORT int vs_integrate (vs_real *t, void (*ext_eq_in) (vs_real, vs_ext_loc))
+{
+  if (!initialized || error_flag) return 1;
+  if (restore_requested && vs_restore_state() >= 0.0) *t = t_now;
+  t_now = *t;
+
+  vss_calc (t_now, VS_EXT_EQ_IN);
+  if (ext_eq_in && ext_eq_in != init_calc) ext_eq_in (t_now, VS_EXT_EQ_IN);
+  vss_driver ();
+  vss_step (tstep);
+  t_now += tstep;
+  *t = t_now;
+  n_steps++;
+  vss_outputs ();
+  vss_calc (t_now, VS_EXT_EQ_OUT);
+
+  if (save_timer && t_now >= save_next - 0.5*tstep)
+    {
+    vss_calc (t_now, VS_EXT_EQ_SAVE);
+    vs_save_state ();
+    while (save_next <= t_now + 0.5*tstep) save_next += save_dt > tstep ? save_dt : tstep;
+    }
+  if (n_steps % iprint == 0) vss_write_erd_row ();
+  if (t_now >= tstop - 0.5*tstep) stop_flag = TRUE;
+  return vs_stop_run();
+}
+
+VS_API_EXPORT int vs_stop_run (void)
+{
+  return stop_flag || error_flag;
+}
+
+VS_API_EXPORT void vs_terminate (vs_real t, void (*ext_echo) (vs_ext_loc))
+{
+  if (!initialized) return;
+  vss_calc (t, VS_EXT_EQ_END);
+  vss_close_erd ();
+  vss_write_echo (endfile_name, t, ext_echo);
+  vss_log ("Run ended at t = %g s after %lld steps%s%s\n", t, n_steps,
+           stop_msg[0] ? ": " : "", stop_msg);
+  initialized = FALSE;
+}
+
+VS_API_EXPORT void vs_free_all (void)
+{
+  if (free_func) free_func ();
+  if (free2_func) free2_func (free2_data);
+  vss_free_model ();
+  if (log_fp) fclose(log_fp);
+  log_fp = NULL;
+}
+
+VS_API_EXPORT int vs_run (char *simfile)
+{
+  vs_real t = vs_setdef_and_read(simfile, NULL, NULL);
+
+  if (!error_flag)
+    {
+    vs_initialize (t, NULL, NULL);
+    while (!vs_stop_run()) vs_integrate (&t, NULL);
+    }
+  vs_terminate (t, NULL);
+  vs_free_all ();
+  return error_flag ? -1 : 0;
+}
+
+VS_API_EXPORT void vs_read_configuration (const char *simfile, int *n_import,
+                         int *n_export, vs_real *t_start, vs_real *t_stop, vs_real *t_step)
+{
+  vs_real t = vs_setdef_and_read(simfile, NULL, NULL);
+
+  if (!error_flag) vs_initialize (t, NULL, NULL);
+  *n_import = n_imports;
+  *n_export = n_exports;
+  *t_start = tstart;
+  *t_stop = tstop;
+  *t_step = tstep;
+}
+
+// Imports and exports are scaled as they are copied, two channels at a time
+// with SSE2, from the arrays of vss_pack_io.
+VS_API_EXPORT void vs_copy_import_vars (vs_real *import)
+{
+  int i = 0;
+
+  if (!io_packed) vss_pack_io ();
+#ifdef VSS_SSE2
+  for (; i + 2 <= n_imports; i += 2)
+    {
+    __m128d v = _mm_div_pd(_mm_loadu_pd(import + i), _mm_load_pd(import_gain + i));
+    _mm_storel_pd (import_ptr[i], v);
+    _mm_storeh_pd (import_ptr[i + 1], v);
+    }
+#endif
+  for (; i < n_imports; i++) *import_ptr[i] = import[i]/import_gain[i];
+}
+
+VS_API_EXPORT void vs_copy_export_vars (vs_real *export)
+{
+  int i = 0;
+
+  if (!io_packed) vss_pack_io ();
+#ifdef VSS_SSE2
+  for (; i + 2 <= n_exports; i += 2)
+    {
+    __m128d v = _mm_loadh_pd(_mm_load_sd(export_ptr[i]), export_ptr[i + 1]);
+    _mm_storeu_pd (export + i, _mm_mul_pd(v, _mm_load_pd(export_gain + i)));
+    }
+#endif
+  for (; i < n_exports; i++) export[i] = *export_ptr[i]*export_gain[i];
+}
+
+VS_API_EXPORT void vs_copy_io (vs_real *import, vs_real *export)
+{
+  vs_copy_import_vars (import);
+  vs_copy_export_vars (export);
+}
+
+VS_API_EXPORT int vs_integrate_io (vs_real t, vs_real *import, vs_real *export)
+{
+  int status;
+
+  vs_copy_import_vars (import);
+  status = vs_integrate(&t, init_eq_in);
+  vs_copy_export_vars (export);
+  return status;
+}
+
+VS_API_EXPORT int vs_integrate_IO (vs_real t, vs_real *import, vs_real *export)
+{
+  return vs_integrate_io(t, import, export);
+}
+
+VS_API_EXPORT vs_bool vs_integrate_io_2 (vs_real t, vs_real *import, vs_real *export,
+                                         void (*ext_calc) (vs_real, vs_ext_loc))
+{
+  init_eq_in = ext_calc;
+  return vs_integrate_io(t, import, export) ? TRUE : FALSE;
+}
+
+VS_API_EXPORT void vs_terminate_run (vs_real t)
+{
+  vs_terminate (t, NULL);
+  vs_free_all ();
+}
+
+VS_API_EXPORT void vs_scale_import_vars (void) {} // scaled when copied
+VS_API_EXPORT void vs_scale_export_vars (void) {}
+VS_API_EXPORT int  vs_bar_graph_update (int *x) {(void)x; return 0;}
+VS_API_EXPORT int  vs_during_event (void) {return 0;}
+
+
+/* ----------------------------------------------------------------------------
+   Conditions and messages (chapter 5).
+---------------------------------------------------------------------------- */
+VS_API_EXPORT vs_bool vs_error_occurred (void) {return error_flag;}
+VS_API_EXPORT vs_real vs_get_tstep (void) {return tstep;}
+VS_API_EXPORT vs_bool vs_opt_pause (void) {return opt_pause != 0;}
+
+VS_API_EXPORT void vs_clear_error_message (void)
+{
+  error_msg[0] = 0;
+  error_flag = FALSE;
+}
+
+VS_API_EXPORT void vs_clear_output_message (void) {output_msg[0] = 0;}
+
+VS_API_EXPORT char *vs_get_echofile_name (void) {return echofile_name;}
+VS_API_EXPORT char *vs_get_endfile_name (void) {return endfile_name;}
+VS_API_EXPORT char *vs_get_erdfile_name (void) {return erdfile_name;}
+VS_API_EXPORT char *vs_get_error_message (void) {return error_msg;}
+VS_API_EXPORT char *vs_get_infile_name (void) {return infile_name;}
+VS_API_EXPORT char *vs_get_logfile_name (void) {return logfile_name;}
+VS_API_EXPORT char *vs_get_output_message (void) {return output_msg;}
+VS_API_EXPORT char *vs_get_simfile_name (void) {return simfile_name;}
+VS_API_EXPORT char *vs_get_version_model (void) {return (char *)"Stand-in single-track 1.0";}
+VS_API_EXPORT char *vs_get_version_product (void) {return (char *)"Stand-in";}
+VS_API_EXPORT char *vs_get_version_vs (void) {return (char *)"Stand-in 1.0";}
+
+VS_API_EXPORT void vs_printf (const char *format, ...)
+{
+  size_t n = strlen(output_msg);
+  va_list args;
+
+  va_start (args, format);
+  if (n < sizeof(output_msg) - 1)
+    vsnprintf (output_msg + n, sizeof(output_msg) - n, format, args);
+  va_end (args);
+  vss_log ("%s", output_msg + n);
+}
+
+VS_API_EXPORT void vs_printf_error (const char *format, ...)
+{
+  char tmpstr[1024];
+  va_list args;
+
+  va_start (args, format);
+  vsnprintf (tmpstr, sizeof(tmpstr), format, args);
+  va_end (args);
+  vss_error ("%s", tmpstr);
+}
+
+VS_API_EXPORT void vs_set_stop_run (vs_real stop_gt_0, const char *format, ...)
+{
+  va_list args;
+
+  if (stop_gt_0 <= 0.0) return;
+  stop_flag = TRUE;
+  va_start (args, format);
+  vsnprintf (stop_msg, sizeof(stop_msg), format, args);
+  va_end (args);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Installing callback functions (chapter 6).
+---------------------------------------------------------------------------- */
+VS_API_EXPORT void vs_install_calc_function (void (*calc) (vs_real, vs_ext_loc))
+  {calc_func = calc;}
+VS_API_EXPORT void vs_install_echo_function (void (*echo) (vs_ext_loc))
+  {echo_func = echo;}
+VS_API_EXPORT void vs_install_setdef_function (void (*setdef) (void))
+  {setdef_func = setdef;}
+VS_API_EXPORT void vs_install_scan_function (vs_bool (*scan) (char *, char *))
+  {scan_func = scan;}
+VS_API_EXPORT void vs_install_free_function (void (*func) (void))
+  {free_func = func;}
+
+VS_API_EXPORT void vs_install_calc_function2 (vss_calc2_func calc, void *data)
+{
+  calc2_func = calc;
+  calc2_data = data;
+}
+
+VS_API_EXPORT void vs_install_echo_function2 (vss_echo2_func echo, void *data)
+{
+  echo2_func = echo;
+  echo2_data = data;
+}
+
+VS_API_EXPORT void vs_install_setdef_function2 (vss_setdef2_func setdef, void *data)
+{
+  setdef2_func = setdef;
+  setdef2_data = data;
+}
+
+VS_API_EXPORT void vs_install_scan_function2 (vss_scan2_func scan, void *data)
+{
+  scan2_func = scan;
+  scan2_data = data;
+}
+
+VS_API_EXPORT void vs_install_free_function2 (vss_free2_func func, void *data)
+{
+  free2_func = func;
+  free2_data = data;
+}
+
+
+/* ----------------------------------------------------------------------------
+   The model's keywords (chapter 7).
+---------------------------------------------------------------------------- */
+VS_API_EXPORT int vs_define_parameter (char *keyword, char *desc, vs_real *real, char *unit)
+{
+  return vss_add_sym(keyword, desc, unit, vss_unit_gain(unit), VSS_PAR, real, NULL);
+}
+
+VS_API_EXPORT int vs_define_parameter_int (char *keyword, char *desc, int *integer)
+{
+  return vss_add_sym(keyword, desc, "", 1.0, VSS_PAR_INT, NULL, integer);
+}
+
+VS_API_EXPORT int vs_define_variable (char *keyword, char *desc, vs_real *real)
+{
+  return vss_add_sym(keyword, desc, "", 1.0, VSS_VAR, real, NULL);
+}
+
+VS_API_EXPORT int vs_define_import (char *keyword, char *desc, vs_real *real, char *unit)
+{
+  return vss_add_sym(keyword, desc, unit, vss_unit_gain(unit), VSS_IMP, real, NULL);
+}
+
+VS_API_EXPORT int vs_define_output (char *shortname, char *longname, vs_real *real,
+                                    char *unit)
+{
+  return vss_add_sym(shortname, longname, unit, vss_unit_gain(unit), VSS_OUT, real, NULL);
+}
+
+VS_API_EXPORT int vs_define_indexed_parameter_array (char *keyword)
+{
+  vss_log ("Warning: indexed parameter %s is not supported.\n", keyword);
+  return -1;
+}
+
+VS_API_EXPORT void vs_define_units (char *desc, vs_real gain)
+{
+  units = (vss_unit *)realloc(units, (n_units + 1)*sizeof(vss_unit));
+  units[n_units].desc = vss_strdup(desc);
+  units[n_units++].gain = gain;
+  io_packed = FALSE;
+}
+
+VS_API_EXPORT void vs_set_units (char *var_keyword, char *units_keyword)
+{
+  int id = vss_find_sym(var_keyword);
+
+  if (id < 0) return;
+  free (syms[id].units);
+  syms[id].units = vss_strdup(units_keyword);
+  syms[id].gain = vss_unit_gain(units_keyword);
+  io_packed = FALSE;
+}
+
+static vs_sym_attr_type vss_value_type (vss_kind kind)
+{
+  switch (kind)
+    {
+    case VSS_OUT: return OUTVAR_VALUE;
+    case VSS_IMP: return IMP_REAL;
+    case VSS_VAR: return SV_VALUE;
+    default:      return PAR_VALUE;
+    }
+}
+
+VS_API_EXPORT int vs_get_var_id (char *keyword, vs_sym_attr_type *type)
+{
+  int id = vss_find_sym(keyword);
+
+  if (id >= 0 && type) *type = vss_value_type(syms[id].kind);
+  return id;
+}
+
+VS_API_EXPORT vs_real *vs_get_var_ptr (char *keyword)
+{
+  int id = vss_find_sym(keyword);
+
+  return id < 0 ? NULL : syms[id].real;
+}
+
+VS_API_EXPORT int *vs_get_var_ptr_int (char *keyword)
+{
+  int id = vss_find_sym(keyword);
+
+  return id < 0 ? NULL : syms[id].integer;
+}
+
+VS_API_EXPORT vs_bool vs_have_keyword_in_database (char *keyword)
+{
+  int i;
+
+  if (vss_find_sym(keyword) >= 0) return TRUE;
+  for (i = 0; i < n_groups; i++)
+    if (vss_keyword_is(keyword, groups[i]->table_keyword) ||
+        vss_keyword_is(keyword, groups[i]->carpet_keyword) ||
+        vss_keyword_is(keyword, groups[i]->constant_keyword)) return TRUE;
+  return FALSE;
+}
+
+// Attributes named ..._VALUE are in user units; ..._REAL are internal.
+VS_API_EXPORT int vs_set_sym_real (int id, vs_sym_attr_type type, vs_real value)
+{
+  if (id < 0 || id >= n_syms) return -1;
+  if (type == OUTVAR_VALUE || type == PAR_VALUE || type == SYS_PAR_VALUE ||
+      type == SV_VALUE)
+    vss_set_sym_value (id, value);
+  else if (syms[id].integer)
+    *syms[id].integer = (int)value;
+  else
+    *syms[id].real = value;
+  return 0;
+}
+
+VS_API_EXPORT int vs_set_sym_int (int id, vs_sym_attr_type type, int value)
+{
+  return vs_set_sym_real(id, type, (vs_real)value);
+}
+
+VS_API_EXPORT int vs_get_sym_attribute (int id, vs_sym_attr_type type, void **att)
+{
+  if (id < 0 || id >= n_syms) return -1;
+  switch (type)
+    {
+    case OUTVAR_SHORT_NAME: case IMP_KEYWORD: case SV_KEYWORD: case PAR_KEYWORD:
+    case SYS_PAR_KEYWORD: case ISYM_KEYWORD:
+      *att = syms[id].keyword;
+      break;
+    case OUTVAR_LONG_NAME: case OUTVAR_ECHO_DESC: case IMP_DESC: case SV_DESC:
+    case PAR_DESC: case SYS_PAR_DESC:
+      *att = syms[id].desc;
+      break;
+    case OUTVAR_UNITS: case IMP_UNITS: case SV_UNITS: case PAR_UNITS:
+    case SYS_PAR_UNITS: case ISYM_UNITS:
+      *att = syms[id].units;
+      break;
+    case PAR_INTEGER: case SYS_PAR_INTEGER: case ISYM_INTEGER:
+      *att = syms[id].integer;
+      break;
+    default:
+      *att = syms[id].real;
+      break;
+    }
+  return 0;
+}
+
+VS_API_EXPORT int vs_set_sym_attribute (int id, vs_sym_attr_type type, const void *att)
+{
+  vss_sym *s;
+
+  if (id < 0 || id >= n_syms) return -1;
+  s = &syms[id];
+  switch (type)
+    {
+    case OUTVAR_SHORT_NAME: case IMP_KEYWORD: case SV_KEYWORD: case PAR_KEYWORD:
+    case SYS_PAR_KEYWORD:
+      free (s->keyword);
+      s->keyword = vss_strdup((const char *)att);
+      vss_upper (s->keyword);
+      break;
+    case OUTVAR_LONG_NAME: case OUTVAR_ECHO_DESC: case IMP_DESC: case SV_DESC:
+    case PAR_DESC: case SYS_PAR_DESC:
+      free (s->desc);
+      s->desc = vss_strdup((const char *)att);
+      break;
+    case OUTVAR_UNITS: case IMP_UNITS: case SV_UNITS: case PAR_UNITS: case SYS_PAR_UNITS:
+      vs_set_units (s->keyword, (char *)att);
+      break;
+    case OUTVAR_REAL: case IMP_REAL: case PAR_REAL: case SYS_PAR_REAL:
+      if (s->own) free(s->real);
+      s->own = FALSE;
+      s->real = (vs_real *)att;
+      io_packed = FALSE;
+      break;
+    default:
+      break; // visibility and others have no effect here
+    }
+  return 0;
+}
+
+VS_API_EXPORT vs_real vs_import_result (int id, vs_real native)
+{
+  (void)id;
+  return native;
+}
+
+VS_API_EXPORT void vs_install_calc_func (char *name, void *func)
+{
+  (void)func;
+  vss_log ("Warning: function %s is not used (no equations here).\n", name);
+}
+
+VS_API_EXPORT void vs_install_symbolic_func (char *name, void *func, int n_args)
+{
+  (void)func;
+  (void)n_args;
+  vss_log ("Warning: function %s is not used (no equations here).\n", name);
+}
+
+VS_API_EXPORT int vs_install_keyword_alias (char *existing, char *alias)
+{
+  int id = vss_find_sym(existing), a;
+
+  if (id < 0) return -1;
+  a = vss_add_sym(alias, syms[id].desc, syms[id].units, syms[id].gain, syms[id].kind,
+                  syms[id].real, syms[id].integer);
+  return a;
+}
+
+// Next line of the parsfile being read, for scan functions that read blocks.
+VS_API_EXPORT void vs_read_next_line (char *buffer, int n)
+{
+  size_t len;
+
+  buffer[0] = 0;
+  if (read_fp == NULL || fgets(buffer, n, read_fp) == NULL) return;
+  len = strlen(buffer);
+  while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == '\r')) buffer[--len] = 0;
+}
+
+VS_API_EXPORT char *vs_string_copy_internal (char **target, char *source)
+{
+  free (*target);
+  *target = vss_strdup(source);
+  return *target;
+}
+
+VS_API_EXPORT void vs_write_to_echo_file (const char *format, ...)
+{
+  va_list args;
+
+  if (echo_fp == NULL) return;
+  va_start (args, format);
+  vfprintf (echo_fp, format, args);
+  va_end (args);
+}
+
+VS_API_EXPORT void vs_write_header_to_echo_file (char *buffer)
+{
+  if (echo_fp) fprintf(echo_fp, "\n! %s\n", buffer);
+}
+
+VS_API_EXPORT void vs_write_f_to_echo_file (char *key, vs_real value, char *doc)
+{
+  if (echo_fp) fprintf(echo_fp, "%-24s %.9g ! %s\n", key, value, doc ? doc : "");
+}
+
+VS_API_EXPORT void vs_write_i_to_echo_file (char *key, int value, char *doc)
+{
+  if (echo_fp) fprintf(echo_fp, "%-24s %d ! %s\n", key, value, doc ? doc : "");
+}
+
+VS_API_EXPORT void vs_write_to_logfile (int level, const char *format, ...)
+{
+  va_list args;
+
+  (void)level;
+  if (log_fp == NULL) return;
+  va_start (args, format);
+  vfprintf (log_fp, format, args);
+  va_end (args);
+}
+
+
+/* ----------------------------------------------------------------------------
+   The road (chapter 7). Instances (inst) keep their own search hints.
+---------------------------------------------------------------------------- */
+VS_API_EXPORT vs_real vs_s_loop (vs_real s) {return vss_s_loop(s);}
+
+VS_API_EXPORT void vs_get_road_start_stop (vs_real *start, vs_real *stop)
+{
+  *start = 0.0;
+  *stop = road_n > 1 ? (road_n - 1)*road_ds : 0.0;
+}
+
+VS_API_EXPORT vs_real vs_road_s_i (vs_real x, vs_real y, vs_real inst)
+{
+  vs_real s;
+
+  if (road_n < 2) return x;
+  vss_road_sl (x, y, vss_road_inst(inst), &s, NULL);
+  return s;
+}
+
+VS_API_EXPORT vs_real vs_road_l_i (vs_real x, vs_real y, vs_real inst)
+{
+  vs_real l;
+
+  if (road_n < 2) return y;
+  vss_road_sl (x, y, vss_road_inst(inst), NULL, &l);
+  return l;
+}
+
+VS_API_EXPORT vs_real vs_road_s (vs_real x, vs_real y) {return vs_road_s_i(x, y, 0.0);}
+VS_API_EXPORT vs_real vs_road_l (vs_real x, vs_real y) {return vs_road_l_i(x, y, 0.0);}
+
+VS_API_EXPORT vs_real vs_road_x_sl_i (vs_real s, vs_real l, vs_real inst)
+{
+  vs_real x;
+
+  (void)inst;
+  if (road_n < 2) return s;
+  vss_road_xy (s, l, &x, NULL, NULL);
+  return x;
+}
+
+VS_API_EXPORT vs_real vs_road_y_sl_i (vs_real s, vs_real l, vs_real inst)
+{
+  vs_real y;
+
+  (void)inst;
+  if (road_n < 2) return l;
+  vss_road_xy (s, l, NULL, &y, NULL);
+  return y;
+}
+
+VS_API_EXPORT vs_real vs_road_x_i (vs_real s, vs_real inst) {return vs_road_x_sl_i(s, 0.0, inst);}
+VS_API_EXPORT vs_real vs_road_y_i (vs_real s, vs_real inst) {return vs_road_y_sl_i(s, 0.0, inst);}
+VS_API_EXPORT vs_real vs_road_x (vs_real s) {return vs_road_x_sl_i(s, 0.0, 0.0);}
+VS_API_EXPORT vs_real vs_road_y (vs_real s) {return vs_road_y_sl_i(s, 0.0, 0.0);}
+
+VS_API_EXPORT void vs_get_road_xy_j (vs_real s, vs_real l, vs_real *x, vs_real *y, int *j)
+{
+  vs_real u;
+
+  if (road_n < 2)
+    {
+    *x = s;
+    *y = l;
+    return;
+    }
+  vss_road_xy (s, l, x, y, NULL);
+  if (j) *j = vss_road_seg(s, &u);
+}
+
+VS_API_EXPORT vs_real vs_road_yaw_i (vs_real s, vs_real direction, vs_real inst)
+{
+  vs_real yaw = 0.0;
+
+  (void)inst;
+  if (road_n > 1) vss_road_xy (s, 0.0, NULL, NULL, &yaw);
+  return direction < 0.0 ? yaw + PI : yaw;
+}
+
+VS_API_EXPORT vs_real vs_road_yaw (vs_real s, vs_real direction)
+{
+  return vs_road_yaw_i(s, direction, 0.0);
+}
+
+VS_API_EXPORT vs_real vs_road_yaw_j (vs_real s, vs_real direction, int *j)
+{
+  vs_real u;
+
+  if (j && road_n > 1) *j = vss_road_seg(s, &u);
+  return vs_road_yaw_i(s, direction, 0.0);
+}
+
+VS_API_EXPORT vs_real vs_road_curv_i (vs_real s, vs_real inst)
+{
+  if (n_groups == 0) return 0.0;
+  return vss_table_eval(groups[tab_road_curv]->table[0], 0.0, vss_s_loop(s),
+                        vss_road_inst(inst));
+}
+
+VS_API_EXPORT vs_real vs_road_curv_j (vs_real s, int *j)
+{
+  vs_real u;
+
+  if (j && road_n > 1) *j = vss_road_seg(s, &u);
+  return vs_road_curv_i(s, 0.0);
+}
+
+VS_API_EXPORT vs_real vs_road_z_sl_i (vs_real s, vs_real l, vs_real inst)
+{
+  if (n_groups == 0) return 0.0;
+  return vss_road_z_sl(s, l, vss_road_inst(inst));
+}
+
+VS_API_EXPORT vs_real vs_road_z_i (vs_real x, vs_real y, vs_real inst)
+{
+  int i = vss_road_inst(inst);
+  vs_real s, l;
+
+  if (road_n < 2) return 0.0;
+  vss_road_sl (x, y, i, &s, &l);
+  return vss_road_z_sl(s, l, i);
+}
+
+VS_API_EXPORT vs_real vs_road_z (vs_real x, vs_real y) {return vs_road_z_i(x, y, 0.0);}
+
+VS_API_EXPORT void vs_get_dzds_dzdl_i (vs_real s, vs_real l, vs_real *dzds, vs_real *dzdl,
+                                       vs_real inst)
+{
+  if (n_groups == 0)
+    {
+    *dzds = *dzdl = 0.0;
+    return;
+    }
+  vss_road_slopes (s, l, vss_road_inst(inst), dzds, dzdl);
+}
+
+VS_API_EXPORT void vs_get_dzds_dzdl (vs_real s, vs_real l, vs_real *dzds, vs_real *dzdl)
+{
+  vs_get_dzds_dzdl_i (s, l, dzds, dzdl, 0.0);
+}
+
+VS_API_EXPORT void vs_get_road_contact_sl (vs_real s, vs_real l, int inst, vs_real *z,
+                                           vs_real *dzds, vs_real *dzdl, vs_real *mu)
+{
+  int i = vss_road_inst(inst);
+
+  if (n_groups == 0) return;
+  if (z) *z = vss_road_z_sl(s, l, i);
+  vss_road_slopes (s, l, i, dzds, dzdl);
+  if (mu) *mu = vss_table_eval(groups[tab_road_mu]->table[0], 0.0, vss_s_loop(s), i);
+}
+
+// Note the order of the coordinates: y, then x.
+VS_API_EXPORT void vs_get_road_contact (vs_real y, vs_real x, int inst, vs_real *z,
+                                        vs_real *dzdy, vs_real *dzdx, vs_real *mu)
+{
+  int i = vss_road_inst(inst);
+  vs_real s, l, a, dzds, dzdl;
+
+  if (road_n < 2) return;
+  vss_road_sl (x, y, i, &s, &l);
+  vs_get_road_contact_sl (s, l, i, z, &dzds, &dzdl, mu);
+  vss_road_xy (s, 0.0, NULL, NULL, &a);
+  if (dzdx) *dzdx = dzds*cos(a) - dzdl*sin(a);
+  if (dzdy) *dzdy = dzds*sin(a) + dzdl*cos(a);
+}
+
+VS_API_EXPORT void vs_get_road_xyz (vs_real s, vs_real l, vs_real *x, vs_real *y, vs_real *z)
+{
+  if (road_n < 2) return;
+  vss_road_xy (s, l, x, y, NULL);
+  *z = vss_road_z_sl(s, l, 0);
+}
+
+// Slopes along and across a heading yaw; pitch is positive nose down.
+VS_API_EXPORT vs_real vs_road_pitch_sl_i (vs_real s, vs_real l, vs_real yaw, vs_real inst)
+{
+  vs_real dzds, dzdl, a;
+
+  vs_get_dzds_dzdl_i (s, l, &dzds, &dzdl, inst);
+  a = yaw - vs_road_yaw_i(s, 1.0, inst);
+  return -atan(dzds*cos(a) + dzdl*sin(a));
+}
+
+VS_API_EXPORT vs_real vs_road_roll_sl_i (vs_real s, vs_real l, vs_real yaw, vs_real inst)
+{
+  vs_real dzds, dzdl, a;
+
+  vs_get_dzds_dzdl_i (s, l, &dzds, &dzdl, inst);
+  a = yaw - vs_road_yaw_i(s, 1.0, inst);
+  return atan(dzdl*cos(a) - dzds*sin(a));
+}
+
+VS_API_EXPORT vs_real vs_target_l (vs_real s)
+{
+  return n_groups ? vss_tab(tab_target_l, vss_s_loop(s)) : 0.0;
+}
+
+VS_API_EXPORT vs_real vs_target_heading (vs_real s)
+{
+  const vs_real h = 0.5;
+
+  return vs_road_yaw(s, 1.0) + atan((vs_target_l(s + h) - vs_target_l(s - h))/(2.0*h));
+}
+
+// Edge 0 is the left edge, others the right.
+VS_API_EXPORT int vs_get_lat_pos_of_edge (int edge, vs_real s, int opt_road, vs_real *l)
+{
+  (void)s;
+  (void)opt_road;
+  *l = edge == 0 ? 0.5*road_width : -0.5*road_width;
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Moving objects and sensors (chapter 7): counted, but there is no traffic.
+---------------------------------------------------------------------------- */
+VS_API_EXPORT int vs_define_moving_objects (int n)
+{
+  n_moving_objects = n;
+  return 0;
+}
+
+VS_API_EXPORT int vs_define_sensors (int n)
+{
+  n_sensors = n;
+  return 0;
+}
+
+VS_API_EXPORT void vs_free_sensors_and_objects (void)
+{
+  n_moving_objects = n_sensors = 0;
+}
+
+VS_API_EXPORT int vs_get_n_export_sensor (int *max_connections)
+{
+  if (max_connections) *max_connections = 0;
+  return 0;
+}
+
+VS_API_EXPORT int vs_get_sensor_connections (vs_real *connect)
+{
+  (void)connect;
+  return 0;
+}
+
+
+/* ----------------------------------------------------------------------------
+   Configurable tables (chapter 7). itab and inst start at 0.
+---------------------------------------------------------------------------- */
+VS_API_EXPORT int vs_define_table (char *root, int ntab, int ninst)
+{
+  vs_tab_group *g = (vs_tab_group *)calloc(1, sizeof(vs_tab_group));
+  int i;
+
+  g->ntab = ntab > 0 ? ntab : 1;
+  g->ninst = ninst > 0 ? ninst : 1;
+  g->type_default = VS_TAB_LIN;
+  g->root_keyword = vss_keyword(root, "");
+  g->title = vss_strdup(root);
+  g->table_keyword = vss_keyword(root, "_TABLE");
+  g->carpet_keyword = vss_keyword(root, "_CARPET");
+  g->gain_keyword = vss_keyword(root, "_GAIN");
+  g->offset_keyword = vss_keyword(root, "_OFFSET");
+  g->constant_keyword = vss_keyword(root, "_CONSTANT");
+  g->coefficient_keyword = vss_keyword(root, "_COEFFICIENT");
+  g->start_x_keyword = vss_keyword(root, "_START_X");
+  g->scale_x_keyword = vss_keyword(root, "_SCALE_X");
+  g->table = (vs_table **)calloc(g->ntab, sizeof(vs_table *));
+  for (i = 0; i < g->ntab; i++) g->table[i] = vss_new_table(g);
+  return vss_add_group(g, TRUE);
+}
+
+VS_API_EXPORT vs_real vs_table_calc (int index, vs_real xcol, vs_real x, int itab, int inst)
+{
+  vs_tab_group *g;
+
+  if (index < 0 || index >= n_groups) return 0.0;
+  g = groups[index];
+  if (itab < 0 || itab >= g->ntab || inst < 0 || inst >= g->ninst) return 0.0;
+  return vss_table_eval(g->table[itab], xcol, x, inst);
+}
+
+VS_API_EXPORT int vs_table_index (char *name)
+{
+  int i;
+
+  for (i = 0; i < n_groups; i++)
+    if (groups[i]->root_keyword && vss_same(groups[i]->root_keyword, name)) return i;
+  return -1;
+}
+
+VS_API_EXPORT int vs_table_ntab (int index)
+{
+  return index < 0 || index >= n_groups ? 0 : groups[index]->ntab;
+}
+
+VS_API_EXPORT int vs_table_ninst (int index)
+{
+  return index < 0 || index >= n_groups ? 0 : groups[index]->ninst;
+}
+
+// Arrays for the data of a table; 2D types have ny columns.
+VS_API_EXPORT void vs_malloc_table_data (vs_table *tab, int type, int nx, int ny)
+{
+  int i;
+
+  vss_free_table_data (tab);
+  tab->type = (vs_table_type)type;
+  tab->nx = nx;
+  tab->x = (vs_real *)calloc(nx, sizeof(vs_real));
+  if (type >= VS_TAB_2D && type != VS_TAB_EQ)
+    {
+    tab->ny = ny;
+    tab->y = (vs_real *)calloc(ny, sizeof(vs_real));
+    tab->fxy = (vs_real **)calloc(nx, sizeof(vs_real *));
+    for (i = 0; i < nx; i++) tab->fxy[i] = (vs_real *)calloc(ny, sizeof(vs_real));
+    }
+  else
+    {
+    tab->y = (vs_real *)calloc(nx, sizeof(vs_real));
+    tab->dydx = (vs_real *)calloc(nx, sizeof(vs_real));
+    }
+}
+
+// Update what is derived from the data (spline slopes) after a caller has
+// filled the tables of a group.
+VS_API_EXPORT void vs_copy_table_data (vs_tab_group *tabg)
+{
+  int i;
+  vs_table *tab;
+
+  for (i = 0; i < tabg->ntab; i++)
+    {
+    tab = tabg->table[i];
+    if (tab->type == VS_SPLINE || tab->type == VS_SPLINE_FLAT || tab->type == VS_SPLINE_LOOP)
+      vss_spline_slopes (tab);
+    }
+}
+
+// A group made by the caller, with its own keywords. Its tables need jx
+// (and jy for 2D) arrays of ninst hints.
+VS_API_EXPORT int vs_install_keyword_tab_group (vs_tab_group *tabs)
+{
+  return vss_add_group(tabs, FALSE);
+}
+
+
+/* ----------------------------------------------------------------------------
+   Saving and restoring the model state (chapter 8). The state is the
+   differential states followed by the extra ones (odometer, steer command).
+---------------------------------------------------------------------------- */
+VS_API_EXPORT int vs_n_derivatives (void) {return n_state;}
+VS_API_EXPORT int vs_n_extra_state_variables (void) {return VSS_N_EXTRA;}
+
+VS_API_EXPORT void vs_copy_differential_state_vars_to_array (vs_real *array)
+{
+  memcpy (array, state, n_state*sizeof(vs_real));
+}
+
+VS_API_EXPORT void vs_copy_differential_state_vars_from_array (vs_real *array)
+{
+  memcpy (state, array, n_state*sizeof(vs_real));
+}
+
+VS_API_EXPORT void vs_copy_extra_state_vars_to_array (vs_real *array)
+{
+  array[0] = odometer;
+  array[1] = delta_cmd;
+}
+
+VS_API_EXPORT void vs_copy_extra_state_vars_from_array (vs_real *array)
+{
+  odometer = array[0];
+  delta_cmd = array[1];
+}
+
+VS_API_EXPORT void vs_copy_all_state_vars_to_array (vs_real *array)
+{
+  vs_copy_differential_state_vars_to_array (array);
+  vs_copy_extra_state_vars_to_array (array + n_state);
+}
+
+VS_API_EXPORT void vs_copy_all_state_vars_from_array (vs_real *array)
+{
+  vs_copy_differential_state_vars_from_array (array);
+  vs_copy_extra_state_vars_from_array (array + n_state);
+  if (initialized) vss_outputs ();
+}
+
+VS_API_EXPORT void vs_start_save_timer (vs_real t)
+{
+  save_timer = TRUE;
+  save_next = t;
+}
+
+VS_API_EXPORT void vs_stop_save_timer (void) {save_timer = FALSE;}
+
+VS_API_EXPORT int vs_get_request_to_save (void)
+{
+  return save_timer && t_now >= save_next - 0.5*tstep;
+}
+
+VS_API_EXPORT void vs_save_state (void)
+{
+  int n = n_state + VSS_N_EXTRA;
+
+  saved = (vss_saved *)vss_grow(saved, &max_saved, n_saved + 1, sizeof(vss_saved));
+  saved[n_saved].t = t_now;
+  saved[n_saved].state = (vs_real *)malloc(n*sizeof(vs_real));
+  vs_copy_all_state_vars_to_array (saved[n_saved++].state);
+}
+
+VS_API_EXPORT void vs_free_saved_states (void)
+{
+  int i;
+
+  for (i = 0; i < n_saved; i++) free(saved[i].state);
+  n_saved = 0;
+}
+
+VS_API_EXPORT void vs_set_request_to_restore (vs_real t)
+{
+  restore_request = t;
+  restore_requested = TRUE;
+}
+
+VS_API_EXPORT int vs_get_request_to_restore (void) {return restore_requested;}
+
+// Latest saved state at or before t.
+static int vss_saved_index (vs_real t)
+{
+  int i;
+
+  for (i = n_saved - 1; i >= 0; i--)
+    if (saved[i].t <= t + 1e-9) return i;
+  return -1;
+}
+
+VS_API_EXPORT vs_real vs_get_saved_state_time (vs_real t)
+{
+  int i = vss_saved_index(t);
+
+  return i < 0 ? -1.0 : saved[i].t;
+}
+
+// Restore the state requested with vs_set_request_to_restore; later saves
+// are dropped. Return its time, or -1 if none was saved.
+VS_API_EXPORT vs_real vs_restore_state (void)
+{
+  int i = vss_saved_index(restore_request), k;
+
+  restore_requested = FALSE;
+  if (i < 0) return -1.0;
+  vs_copy_all_state_vars_from_array (saved[i].state);
+  t_now = saved[i].t;
+  for (k = i + 1; k < n_saved; k++) free(saved[k].state);
+  n_saved = i + 1;
+  stop_flag = FALSE;
+  save_next = t_now + save_dt;
+  return t_now;
+}
+
+VS_API_EXPORT int vs_get_export_names (char **names)
+{
+  int i;
+
+  if (names)
+    for (i = 0; i < n_exports; i++) names[i] = export_names[i];
+  return n_exports;
+}
+
+VS_API_EXPORT int vs_get_import_names (char **names)
+{
+  int i;
+
+  if (names)
+    for (i = 0; i < n_imports; i++) names[i] = import_names[i];
+  return n_imports;
+}
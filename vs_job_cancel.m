@@ -0,0 +1,4 @@
+function vs_job_cancel(id)
+%VS_JOB_CANCEL  Cancel a queued job, or stop a running one with vs_set_stop_run.
+
+calllib('vs_jobs', 'vs_job_cancel', id);
@@ -0,0 +1,5 @@
+function [status] = vs_job_poll(id)
+%VS_JOB_POLL  Status of a job: 'queued', 'running', 'done', 'failed',
+%   'cancelled' or 'unknown'.
+
+status = vs_job_status_name(calllib('vs_jobs', 'vs_job_poll', id));
@@ -0,0 +1,12 @@
+function [exports, t_end, status, error_message] = vs_job_result(id, keep)
+%VS_JOB_RESULT  Wait for a job and return its export variables at the end of
+%   the run. The job is freed unless keep is true.
+
+status = vs_job_wait(id);
+n = calllib('vs_jobs', 'vs_job_n_exports', id);
+[~, exports] = calllib('vs_jobs', 'vs_job_get_exports', id, zeros(1, n), n);
+t_end = calllib('vs_jobs', 'vs_job_end_time', id);
+error_message = calllib('vs_jobs', 'vs_job_error', id);
+if nargin < 2 || ~keep
+    calllib('vs_jobs', 'vs_job_free', id);
+end
@@ -0,0 +1,9 @@
+function [name] = vs_job_status_name(status)
+%VS_JOB_STATUS_NAME  Name of a vs_job_status value from the vs_jobs library.
+
+names = {'queued', 'running', 'done', 'failed', 'cancelled'};
+if status >= 0 && status < numel(names)
+    name = names{status + 1};
+else
+    name = 'unknown';
+end
@@ -0,0 +1,12 @@
+function [id] = vs_job_submit(sim_file, mods)
+%VS_JOB_SUBMIT  Queue a run and return its job id at once.
+%   Mods: optional key-value pairings in a containers.Map structure, applied
+%   after the parsfiles are read.
+
+keys = {};
+values = [];
+if nargin > 1 && ~isempty(mods)
+    keys = mods.keys();
+    values = cell2mat(mods.values());
+end
+id = calllib('vs_jobs', 'vs_job_submit', sim_file, numel(keys), keys, values);
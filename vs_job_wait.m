@@ -0,0 +1,8 @@
+function [status] = vs_job_wait(id, timeout)
+%VS_JOB_WAIT  Wait for a job to end, at most timeout seconds if given.
+%   Returns the status as with vs_job_poll.
+
+if nargin < 2
+    timeout = -1;
+end
+status = vs_job_status_name(calllib('vs_jobs', 'vs_job_wait', id, timeout));
@@ -0,0 +1,11 @@
+function vs_jobs_cache(cache_dir, max_mb)
+%VS_JOBS_CACHE  Keep run results in cache_dir (at most max_mb megabytes) so
+%   that vs_job_submit returns at once for a run that was already made.
+%   Call after vs_jobs_start and before submitting runs.
+
+if nargin < 2
+    max_mb = 1024;
+end
+if calllib('vs_jobs', 'vs_jobs_cache', cache_dir, max_mb) ~= 0
+    error('vs_jobs_cache: the directory %s could not be used.', cache_dir);
+end
@@ -0,0 +1,6 @@
+function [stats] = vs_jobs_cache_stats()
+%VS_JOBS_CACHE_STATS  Hit and miss counts of the run result cache.
+
+[~, s] = calllib('vs_jobs', 'vs_jobs_cache_stats', zeros(1, 6));
+stats = struct('hits', s(1), 'misses', s(2), 'stores', s(3), ...
+               'evictions', s(4), 'entries', s(5), 'bytes', s(6));
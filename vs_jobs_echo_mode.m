@@ -0,0 +1,21 @@
+function vs_jobs_echo_mode(mode, sample_every)
+%VS_JOBS_ECHO_MODE  Batch mode for the ECHO, FINAL and LOGFILE files of runs
+%   made with vs_job_submit. The files are written to a local directory and
+%   moved to their places in the background.
+%   mode: 'all' keeps them for every run, 'sample' for one run in
+%   sample_every, 'none' for none. Failed runs always keep them.
+
+if nargin < 2
+    sample_every = 10;
+end
+switch mode
+    case 'all'
+        code = 0;
+    case 'sample'
+        code = 1;
+    case 'none'
+        code = 2;
+    otherwise
+        error('vs_jobs_echo_mode: mode must be all, sample or none.');
+end
+calllib('vs_jobs', 'vs_jobs_echo_mode', code, sample_every);
@@ -0,0 +1,12 @@
+function [n_workers] = vs_jobs_start(lib_path, n_workers)
+%VS_JOBS_START  Load the vs_jobs library and start its pool of solver workers.
+%   lib_path is the vs_jobs DLL; n_workers = 0 uses one worker per core.
+%   Runs are then made with vs_job_submit, vs_job_wait and vs_job_result.
+
+if nargin < 2
+    n_workers = 0;
+end
+if ~libisloaded('vs_jobs')
+    loadlibrary(lib_path, 'vs_jobs_def_m.h', 'alias', 'vs_jobs');
+end
+n_workers = calllib('vs_jobs', 'vs_jobs_start', n_workers);
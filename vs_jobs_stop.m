@@ -0,0 +1,7 @@
+function vs_jobs_stop()
+%VS_JOBS_STOP  Cancel queued runs, wait for running ones and unload vs_jobs.
+
+if libisloaded('vs_jobs')
+    calllib('vs_jobs', 'vs_jobs_stop');
+    unloadlibrary('vs_jobs');
+end